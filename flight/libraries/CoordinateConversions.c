@@ -175,7 +175,7 @@ void RPY2Quaternion(const float rpy[3], float q[4])
 }
 
 // ** Find Rbe, that rotates a vector from earth fixed to body frame, from quaternion **
-void Quaternion2R(float q[4], float Rbe[3][3])
+void Quaternion2R(const float q[4], float Rbe[3][3])
 {
     const float q0s = q[0] * q[0], q1s = q[1] * q[1], q2s = q[2] * q[2], q3s = q[3] * q[3];
 
@@ -57,7 +57,7 @@ void Quaternion2RPY(const float q[4], float rpy[3]);
 void RPY2Quaternion(const float rpy[3], float q[4]);
 
 // ** Find Rbe, that rotates a vector from earth fixed to body frame, from quaternion **
-void Quaternion2R(float q[4], float Rbe[3][3]);
+void Quaternion2R(const float q[4], float Rbe[3][3]);
 
 // ** Find first row of Rbe, that rotates a vector from earth fixed to body frame, from quaternion **
 // ** This vector corresponds to the fuselage/roll vector xB **
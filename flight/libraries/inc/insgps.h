@@ -32,6 +32,7 @@
 #ifndef INSGPS_H_
 #define INSGPS_H_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -53,7 +54,52 @@
  * @}
  */
 
-// Exposed Function Prototypes
+// Nav structure containing current solution
+struct NavStruct {
+    float Pos[3]; // Position in meters and relative to a local NED frame
+    float Vel[3]; // Velocity in meters and in NED
+    float q[4]; // unit quaternion rotation relative to NED
+    float gyro_bias[3];
+    float accel_bias[3];
+};
+
+/**
+ * Complete state of one filter. Its layout depends on the variant that is
+ * linked in, so callers allocate ins_context_size() bytes and call ins_init()
+ * before using it. Several contexts can run side by side.
+ */
+typedef struct insgps_context insgps_context;
+
+size_t ins_context_size();
+void ins_init(insgps_context *ins);
+void ins_state_prediction(insgps_context *ins, const float gyro_data[3], const float accel_data[3], float dT);
+void ins_covariance_prediction(insgps_context *ins, float dT);
+void ins_correction(insgps_context *ins, const float mag_data[3], const float Pos[3], const float Vel[3],
+                    float BaroAlt, uint16_t SensorsUsed);
+void ins_reset_p(insgps_context *ins, const float PDiag[13]);
+void ins_get_variance(const insgps_context *ins, float PDiag[13]);
+// Mean normalized innovation squared and RMS innovation of each measurement
+// (see R in EKFConfiguration) since ins_init() or the last reset, 0 if unused
+void ins_get_innovation_stats(const insgps_context *ins, float NIS[10], float RMS[10]);
+void ins_reset_innovation_stats(insgps_context *ins);
+void ins_set_state(insgps_context *ins, const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3]);
+void ins_set_pos_vel_var(insgps_context *ins, const float PosVar[3], const float VelVar[3]);
+void ins_set_gyro_bias(insgps_context *ins, const float gyro_bias[3]);
+void ins_set_accel_var(insgps_context *ins, const float accel_var[3]);
+void ins_set_gyro_var(insgps_context *ins, const float gyro_var[3]);
+void ins_set_gyro_bias_var(insgps_context *ins, const float gyro_bias_var[3]);
+void ins_set_mag_north(insgps_context *ins, const float B[3]);
+void ins_set_mag_var(insgps_context *ins, const float scaled_mag_var[3]);
+void ins_set_baro_var(insgps_context *ins, const float baro_var);
+void ins_set_armed(insgps_context *ins, bool armed);
+void ins_pos_vel_reset(insgps_context *ins, const float pos[3], const float vel[3]);
+const struct NavStruct *ins_get_nav(const insgps_context *ins);
+#ifdef UNIT_TEST
+// Linearized system and full covariance of the 13 state filter, for tests
+void ins_get_system(const insgps_context *ins, float F[13][13], float G[13][9], float Q[9], float P[13][13]);
+#endif
+
+// Single instance interface, a thin wrapper around one static context
 void INSGPSInit();
 void INSStatePrediction(const float gyro_data[3], const float accel_data[3], float dT);
 void INSCovariancePrediction(float dT);
@@ -61,6 +107,8 @@ void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[
                    float BaroAlt, uint16_t SensorsUsed);
 void INSResetP(const float PDiag[13]);
 void INSGetVariance(float PDiag[13]);
+void INSGetInnovationStats(float NIS[10], float RMS[10]);
+void INSResetInnovationStats();
 void INSSetState(const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3]);
 void INSSetPosVelVar(const float PosVar[3], const float VelVar[3]);
 void INSSetGyroBias(const float gyro_bias[3]);
@@ -79,19 +127,13 @@ void MagVelBaroCorrection(float mag_data[3], float Vel[3], float BaroAlt);
 void FullCorrection(float mag_data[3], float Pos[3], float Vel[3],
                     float BaroAlt);
 void GpsBaroCorrection(float Pos[3], float Vel[3], float BaroAlt);
-void GpsMagCorrection(float mag_data[3], float Pos[3], float Vel[2]);
+void GpsMagCorrection(float mag_data[3], float Pos[3], float Vel[3]);
 void VelBaroCorrection(float Vel[3], float BaroAlt);
 
 uint16_t ins_get_num_states();
 
-// Nav structure containing current solution
-extern struct NavStruct {
-    float Pos[3]; // Position in meters and relative to a local NED frame
-    float Vel[3]; // Velocity in meters and in NED
-    float q[4]; // unit quaternion rotation relative to NED
-    float gyro_bias[3];
-    float accel_bias[3];
-} Nav;
+// Nav structure containing the solution of the single filter instance
+extern struct NavStruct Nav;
 
 /**
  * @}
@@ -32,6 +32,7 @@
 #include "insgps.h"
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 #include <pios_math.h>
 #include <mathmisc.h>
 
@@ -40,13 +41,29 @@
 #define NUMW 9 // number of plant noise inputs, w is disturbance noise vector
 #define NUMV 10 // number of measurements, v is the measurement noise vector
 #define NUMU 6 // number of deterministic inputs, U is the input vector
+#define NUMP (NUMX * (NUMX + 1) / 2) // elements of the upper triangle of P
+
+// P is symmetric, only its upper triangle is stored, row by row. PUPPER(i, j)
+// is the index of element i, j with i <= j, PINDEX(i, j) that of any element.
+#define PUPPER(i, j) ((i) * (2 * NUMX - (i) - 1) / 2 + (j))
+#define PINDEX(i, j) ((i) <= (j) ? PUPPER(i, j) : PUPPER(j, i))
 #pragma GCC optimize "O3"
+// Exponential moving averages of the innovations of each measurement, over
+// about the last 1 / INNOVATION_ALPHA of them so that they follow the sensors
+// through a flight
+#define INNOVATION_ALPHA (1.0f / 128.0f)
+struct InnovationStats {
+    uint8_t seeded[NUMV]; // the first measurement starts the averages
+    float   nis[NUMV]; // normalized innovation squared, Error^2 / (H*P*H' + R)
+    float   sq[NUMV]; // Error^2
+};
+
 // Private functions
 void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
-                          float Q[NUMW], float dT, float P[NUMX][NUMX]);
+                          float Q[NUMW], float dT, float P[NUMP]);
 static void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
-                         float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
-                         uint16_t SensorsUsed);
+                         float Y[NUMV], float P[NUMP], float X[NUMX],
+                         uint16_t SensorsUsed, struct InnovationStats *Stats);
 static void RungeKutta(float X[NUMX], float U[NUMU], float dT);
 static void StateEq(float X[NUMX], float U[NUMU], float Xdot[NUMX]);
 static void LinearizeFG(float X[NUMX], float U[NUMU], float F[NUMX][NUMX],
@@ -76,16 +93,13 @@ static void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX]);
 // b.............  ......oXo
 // c.............  ......ooX
 
-static int8_t FrowMin[NUMX] = { 3, 4, 5, 6, 6, 6, 5, 5, 5, 5, 13, 13, 13 };
-static int8_t FrowMax[NUMX] = { 3, 4, 5, 9, 9, 9, 12, 12, 12, 12, -1, -1, -1 };
-
-static int8_t GrowMin[NUMX] = { 9, 9, 9, 3, 3, 3, 0, 0, 0, 0, 6, 7, 8 };
-static int8_t GrowMax[NUMX] = { -1, -1, -1, 5, 5, 5, 2, 2, 2, 2, 6, 7, 8 };
+// F and G are only used by CovariancePrediction(), which has the sparsity
+// above written into its loop bounds.
 
 static int8_t HrowMin[NUMV] = { 0, 1, 2, 3, 4, 5, 6, 6, 6, 2 };
 static int8_t HrowMax[NUMV] = { 0, 1, 2, 3, 4, 5, 9, 9, 9, 2 };
 
-static struct EKFData {
+struct insgps_context {
     // linearized system matrices
     float F[NUMX][NUMX];
     float G[NUMX][NUMW];
@@ -93,16 +107,16 @@ static struct EKFData {
     // local magnetic unit vector in NED frame
     float Be[3];
     float BeScaleFactor;
-    // covariance matrix and state vector
-    float P[NUMX][NUMX];
+    // covariance matrix (upper triangle) and state vector
+    float P[NUMP];
     float X[NUMX];
     // input noise and measurement noise variances
     float Q[NUMW];
     float R[NUMV];
-} ekf;
-
-// Global variables
-struct NavStruct Nav;
+    // current solution
+    struct InnovationStats innovation;
+    struct NavStruct nav;
+};
 
 // *************  Exposed Functions ****************
 // *************************************************
@@ -112,74 +126,103 @@ uint16_t ins_get_num_states()
     return NUMX;
 }
 
-void INSGPSInit() // pretty much just a place holder for now
+size_t ins_context_size()
+{
+    return sizeof(insgps_context);
+}
+
+const struct NavStruct *ins_get_nav(const insgps_context *ins)
 {
-    ekf.Be[0] = 1.0f;
-    ekf.Be[1] = 0.0f;
-    ekf.Be[2] = 0.0f; // local magnetic unit vector
+    return &ins->nav;
+}
 
+#ifdef UNIT_TEST
+void ins_get_system(const insgps_context *ins, float F[NUMX][NUMX], float G[NUMX][NUMW], float Q[NUMW], float P[NUMX][NUMX])
+{
+    memcpy(F, ins->F, sizeof(ins->F));
+    memcpy(G, ins->G, sizeof(ins->G));
+    memcpy(Q, ins->Q, sizeof(ins->Q));
     for (int i = 0; i < NUMX; i++) {
         for (int j = 0; j < NUMX; j++) {
-            ekf.P[i][j] = 0.0f; // zero all terms
-            ekf.F[i][j] = 0.0f;
+            P[i][j] = ins->P[PINDEX(i, j)];
+        }
+    }
+}
+#endif /* UNIT_TEST */
+
+void ins_init(insgps_context *ins)
+{
+    ins_reset_innovation_stats(ins);
+    memset(&ins->nav, 0, sizeof(ins->nav));
+
+    ins->Be[0] = 1.0f;
+    ins->Be[1] = 0.0f;
+    ins->Be[2] = 0.0f; // local magnetic unit vector
+
+    for (int i = 0; i < NUMP; i++) {
+        ins->P[i] = 0.0f; // zero all terms
+    }
+    for (int i = 0; i < NUMX; i++) {
+        for (int j = 0; j < NUMX; j++) {
+            ins->F[i][j] = 0.0f;
         }
 
         for (int j = 0; j < NUMW; j++) {
-            ekf.G[i][j] = 0.0f;
+            ins->G[i][j] = 0.0f;
         }
 
         for (int j = 0; j < NUMV; j++) {
-            ekf.H[j][i] = 0.0f;
+            ins->H[j][i] = 0.0f;
         }
 
-        ekf.X[i] = 0.0f;
+        ins->X[i] = 0.0f;
     }
     for (int i = 0; i < NUMW; i++) {
-        ekf.Q[i] = 0.0f;
+        ins->Q[i] = 0.0f;
     }
     for (int i = 0; i < NUMV; i++) {
-        ekf.R[i] = 0.0f;
+        ins->R[i] = 0.0f;
     }
 
 
-    ekf.P[0][0]   = ekf.P[1][1] = ekf.P[2][2] = 25.0f;            // initial position variance (m^2)
-    ekf.P[3][3]   = ekf.P[4][4] = ekf.P[5][5] = 5.0f;             // initial velocity variance (m/s)^2
-    ekf.P[6][6]   = ekf.P[7][7] = ekf.P[8][8] = ekf.P[9][9] = 1e-5f;  // initial quaternion variance
-    ekf.P[10][10] = ekf.P[11][11] = ekf.P[12][12] = 1e-9f; // initial gyro bias variance (rad/s)^2
+    ins->P[PUPPER(0, 0)]   = ins->P[PUPPER(1, 1)] = ins->P[PUPPER(2, 2)] = 25.0f;            // initial position variance (m^2)
+    ins->P[PUPPER(3, 3)]   = ins->P[PUPPER(4, 4)] = ins->P[PUPPER(5, 5)] = 5.0f;             // initial velocity variance (m/s)^2
+    ins->P[PUPPER(6, 6)]   = ins->P[PUPPER(7, 7)] = ins->P[PUPPER(8, 8)] = ins->P[PUPPER(9, 9)] = 1e-5f;  // initial quaternion variance
+    ins->P[PUPPER(10, 10)] = ins->P[PUPPER(11, 11)] = ins->P[PUPPER(12, 12)] = 1e-9f; // initial gyro bias variance (rad/s)^2
 
-    ekf.X[0]  = ekf.X[1] = ekf.X[2] = ekf.X[3] = ekf.X[4] = ekf.X[5] = 0.0f; // initial pos and vel (m)
-    ekf.X[6]  = 1.0f;
-    ekf.X[7]  = ekf.X[8] = ekf.X[9] = 0.0f;      // initial quaternion (level and North) (m/s)
-    ekf.X[10] = ekf.X[11] = ekf.X[12] = 0.0f; // initial gyro bias (rad/s)
+    ins->X[0]  = ins->X[1] = ins->X[2] = ins->X[3] = ins->X[4] = ins->X[5] = 0.0f; // initial pos and vel (m)
+    ins->X[6]  = 1.0f;
+    ins->X[7]  = ins->X[8] = ins->X[9] = 0.0f;      // initial quaternion (level and North) (m/s)
+    ins->X[10] = ins->X[11] = ins->X[12] = 0.0f; // initial gyro bias (rad/s)
 
-    ekf.Q[0]  = ekf.Q[1] = ekf.Q[2] = 50e-4f;        // gyro noise variance (rad/s)^2
-    ekf.Q[3]  = ekf.Q[4] = ekf.Q[5] = 0.00001f;      // accelerometer noise variance (m/s^2)^2
-    ekf.Q[6]  = ekf.Q[7] = ekf.Q[8] = 2e-8f;     // gyro bias random walk variance (rad/s^2)^2
+    ins->Q[0]  = ins->Q[1] = ins->Q[2] = 50e-4f;        // gyro noise variance (rad/s)^2
+    ins->Q[3]  = ins->Q[4] = ins->Q[5] = 0.00001f;      // accelerometer noise variance (m/s^2)^2
+    ins->Q[6]  = ins->Q[7] = ins->Q[8] = 2e-8f;     // gyro bias random walk variance (rad/s^2)^2
 
-    ekf.R[0]  = ekf.R[1] = 0.004f;   // High freq GPS horizontal position noise variance (m^2)
-    ekf.R[2]  = 0.036f;          // High freq GPS vertical position noise variance (m^2)
-    ekf.R[3]  = ekf.R[4] = 0.004f;   // High freq GPS horizontal velocity noise variance (m/s)^2
-    ekf.R[5]  = 100.0f;          // High freq GPS vertical velocity noise variance (m/s)^2
-    ekf.R[6]  = ekf.R[7] = ekf.R[8] = 0.005f;    // magnetometer unit vector noise variance
-    ekf.R[9]  = .25f;                    // High freq altimeter noise variance (m^2)
+    ins->R[0]  = ins->R[1] = 0.004f;   // High freq GPS horizontal position noise variance (m^2)
+    ins->R[2]  = 0.036f;          // High freq GPS vertical position noise variance (m^2)
+    ins->R[3]  = ins->R[4] = 0.004f;   // High freq GPS horizontal velocity noise variance (m/s)^2
+    ins->R[5]  = 100.0f;          // High freq GPS vertical velocity noise variance (m/s)^2
+    ins->R[6]  = ins->R[7] = ins->R[8] = 0.005f;    // magnetometer unit vector noise variance
+    ins->R[9]  = .25f;                    // High freq altimeter noise variance (m^2)
 }
 
 // ! Set the current flight state
-void INSSetArmed(bool armed)
+void ins_set_armed(insgps_context *ins, bool armed)
 {
     return;
 
     // Speed up convergence of accel and gyro bias when not armed
     if (armed) {
-        ekf.Q[9] = 1e-4f;
-        ekf.Q[8] = 2e-9f;
+        ins->Q[9] = 1e-4f;
+        ins->Q[8] = 2e-9f;
     } else {
-        ekf.Q[9] = 1e-2f;
-        ekf.Q[8] = 2e-8f;
+        ins->Q[9] = 1e-2f;
+        ins->Q[8] = 2e-8f;
     }
 }
 
-void INSResetP(const float PDiag[NUMX])
+void ins_reset_p(insgps_context *ins, const float PDiag[NUMX])
 {
     uint8_t i, j;
 
@@ -187,123 +230,141 @@ void INSResetP(const float PDiag[NUMX])
     for (i = 0; i < NUMX; i++) {
         if (PDiag != 0) {
             for (j = 0; j < NUMX; j++) {
-                ekf.P[i][j] = ekf.P[j][i] = 0.0f;
+                ins->P[PINDEX(i, j)] = 0.0f;
             }
-            ekf.P[i][i] = PDiag[i];
+            ins->P[PUPPER(i, i)] = PDiag[i];
         }
     }
 }
 
-void INSGetVariance(float PDiag[NUMX])
+void ins_get_variance(const insgps_context *ins, float PDiag[NUMX])
 {
     uint8_t i;
 
     // retrieve diagonal elements (aka state variance)
     if (PDiag != 0) {
         for (i = 0; i < NUMX; i++) {
-            PDiag[i] = ekf.P[i][i];
+            PDiag[i] = ins->P[PUPPER(i, i)];
         }
     }
 }
-void INSSetState(const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], __attribute__((unused)) const float accel_bias[3])
+
+void ins_get_innovation_stats(const insgps_context *ins, float NIS[NUMV], float RMS[NUMV])
+{
+    uint8_t i;
+
+    for (i = 0; i < NUMV; i++) {
+        if (NIS != 0) {
+            NIS[i] = ins->innovation.nis[i];
+        }
+        if (RMS != 0) {
+            RMS[i] = sqrtf(ins->innovation.sq[i]);
+        }
+    }
+}
+
+void ins_reset_innovation_stats(insgps_context *ins)
+{
+    memset(&ins->innovation, 0, sizeof(ins->innovation));
+}
+void ins_set_state(insgps_context *ins, const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], __attribute__((unused)) const float accel_bias[3])
 {
     /* Note: accel_bias not used in 13 state INS */
-    ekf.X[0]  = pos[0];
-    ekf.X[1]  = pos[1];
-    ekf.X[2]  = pos[2];
-    ekf.X[3]  = vel[0];
-    ekf.X[4]  = vel[1];
-    ekf.X[5]  = vel[2];
-    ekf.X[6]  = q[0];
-    ekf.X[7]  = q[1];
-    ekf.X[8]  = q[2];
-    ekf.X[9]  = q[3];
-    ekf.X[10] = gyro_bias[0];
-    ekf.X[11] = gyro_bias[1];
-    ekf.X[12] = gyro_bias[2];
+    ins->X[0]  = pos[0];
+    ins->X[1]  = pos[1];
+    ins->X[2]  = pos[2];
+    ins->X[3]  = vel[0];
+    ins->X[4]  = vel[1];
+    ins->X[5]  = vel[2];
+    ins->X[6]  = q[0];
+    ins->X[7]  = q[1];
+    ins->X[8]  = q[2];
+    ins->X[9]  = q[3];
+    ins->X[10] = gyro_bias[0];
+    ins->X[11] = gyro_bias[1];
+    ins->X[12] = gyro_bias[2];
 }
 
-void INSPosVelReset(const float pos[3], const float vel[3])
+void ins_pos_vel_reset(insgps_context *ins, const float pos[3], const float vel[3])
 {
     for (int i = 0; i < 6; i++) {
         for (int j = i; j < NUMX; j++) {
-            ekf.P[i][j] = 0; // zero the first 6 rows and columns
-            ekf.P[j][i] = 0;
+            ins->P[PUPPER(i, j)] = 0; // zero the first 6 rows and columns
         }
     }
 
-    ekf.P[0][0] = ekf.P[1][1] = ekf.P[2][2] = 25; // initial position variance (m^2)
-    ekf.P[3][3] = ekf.P[4][4] = ekf.P[5][5] = 5; // initial velocity variance (m/s)^2
+    ins->P[PUPPER(0, 0)] = ins->P[PUPPER(1, 1)] = ins->P[PUPPER(2, 2)] = 25; // initial position variance (m^2)
+    ins->P[PUPPER(3, 3)] = ins->P[PUPPER(4, 4)] = ins->P[PUPPER(5, 5)] = 5; // initial velocity variance (m/s)^2
 
-    ekf.X[0]    = pos[0];
-    ekf.X[1]    = pos[1];
-    ekf.X[2]    = pos[2];
-    ekf.X[3]    = vel[0];
-    ekf.X[4]    = vel[1];
-    ekf.X[5]    = vel[2];
+    ins->X[0]    = pos[0];
+    ins->X[1]    = pos[1];
+    ins->X[2]    = pos[2];
+    ins->X[3]    = vel[0];
+    ins->X[4]    = vel[1];
+    ins->X[5]    = vel[2];
 }
 
-void INSSetPosVelVar(const float PosVar[3], const float VelVar[3])
+void ins_set_pos_vel_var(insgps_context *ins, const float PosVar[3], const float VelVar[3])
 {
-    ekf.R[0] = PosVar[0];
-    ekf.R[1] = PosVar[1];
-    ekf.R[2] = PosVar[2];
-    ekf.R[3] = VelVar[0];
-    ekf.R[4] = VelVar[1];
-    ekf.R[5] = VelVar[2];
+    ins->R[0] = PosVar[0];
+    ins->R[1] = PosVar[1];
+    ins->R[2] = PosVar[2];
+    ins->R[3] = VelVar[0];
+    ins->R[4] = VelVar[1];
+    ins->R[5] = VelVar[2];
 }
 
-void INSSetGyroBias(const float gyro_bias[3])
+void ins_set_gyro_bias(insgps_context *ins, const float gyro_bias[3])
 {
-    ekf.X[10] = gyro_bias[0];
-    ekf.X[11] = gyro_bias[1];
-    ekf.X[12] = gyro_bias[2];
+    ins->X[10] = gyro_bias[0];
+    ins->X[11] = gyro_bias[1];
+    ins->X[12] = gyro_bias[2];
 }
 
-void INSSetAccelVar(const float accel_var[3])
+void ins_set_accel_var(insgps_context *ins, const float accel_var[3])
 {
-    ekf.Q[3] = accel_var[0];
-    ekf.Q[4] = accel_var[1];
-    ekf.Q[5] = accel_var[2];
+    ins->Q[3] = accel_var[0];
+    ins->Q[4] = accel_var[1];
+    ins->Q[5] = accel_var[2];
 }
 
-void INSSetGyroVar(const float gyro_var[3])
+void ins_set_gyro_var(insgps_context *ins, const float gyro_var[3])
 {
-    ekf.Q[0] = gyro_var[0];
-    ekf.Q[1] = gyro_var[1];
-    ekf.Q[2] = gyro_var[2];
+    ins->Q[0] = gyro_var[0];
+    ins->Q[1] = gyro_var[1];
+    ins->Q[2] = gyro_var[2];
 }
 
-void INSSetGyroBiasVar(const float gyro_bias_var[3])
+void ins_set_gyro_bias_var(insgps_context *ins, const float gyro_bias_var[3])
 {
-    ekf.Q[6] = gyro_bias_var[0];
-    ekf.Q[7] = gyro_bias_var[1];
-    ekf.Q[8] = gyro_bias_var[2];
+    ins->Q[6] = gyro_bias_var[0];
+    ins->Q[7] = gyro_bias_var[1];
+    ins->Q[8] = gyro_bias_var[2];
 }
 
 // must be called AFTER SetMagNorth
-void INSSetMagVar(const float mag_var[3])
+void ins_set_mag_var(insgps_context *ins, const float mag_var[3])
 {
-    ekf.R[6] = mag_var[0] * ekf.BeScaleFactor;
-    ekf.R[7] = mag_var[1] * ekf.BeScaleFactor;
-    ekf.R[8] = mag_var[2] * ekf.BeScaleFactor;
+    ins->R[6] = mag_var[0] * ins->BeScaleFactor;
+    ins->R[7] = mag_var[1] * ins->BeScaleFactor;
+    ins->R[8] = mag_var[2] * ins->BeScaleFactor;
 }
 
-void INSSetBaroVar(float baro_var)
+void ins_set_baro_var(insgps_context *ins, float baro_var)
 {
-    ekf.R[9] = baro_var;
+    ins->R[9] = baro_var;
 }
 
-void INSSetMagNorth(const float B[3])
+void ins_set_mag_north(insgps_context *ins, const float B[3])
 {
-    ekf.BeScaleFactor = invsqrtf(B[0] * B[0] + B[1] * B[1] + B[2] * B[2]);
+    ins->BeScaleFactor = invsqrtf(B[0] * B[0] + B[1] * B[1] + B[2] * B[2]);
 
-    ekf.Be[0] = B[0] * ekf.BeScaleFactor;
-    ekf.Be[1] = B[1] * ekf.BeScaleFactor;
-    ekf.Be[2] = B[2] * ekf.BeScaleFactor;
+    ins->Be[0] = B[0] * ins->BeScaleFactor;
+    ins->Be[1] = B[1] * ins->BeScaleFactor;
+    ins->Be[2] = B[2] * ins->BeScaleFactor;
 }
 
-void INSStatePrediction(const float gyro_data[3], const float accel_data[3], float dT)
+void ins_state_prediction(insgps_context *ins, const float gyro_data[3], const float accel_data[3], float dT)
 {
     float U[6];
     float invqmag;
@@ -319,34 +380,195 @@ void INSStatePrediction(const float gyro_data[3], const float accel_data[3], flo
     U[5] = accel_data[2];
 
     // EKF prediction step
-    LinearizeFG(ekf.X, U, ekf.F, ekf.G);
-    RungeKutta(ekf.X, U, dT);
-    invqmag   = invsqrtf(ekf.X[6] * ekf.X[6] + ekf.X[7] * ekf.X[7] + ekf.X[8] * ekf.X[8] + ekf.X[9] * ekf.X[9]);
-    ekf.X[6] *= invqmag;
-    ekf.X[7] *= invqmag;
-    ekf.X[8] *= invqmag;
-    ekf.X[9] *= invqmag;
-    // CovariancePrediction(ekf.F,ekf.G,ekf.Q,dT,ekf.P);
+    LinearizeFG(ins->X, U, ins->F, ins->G);
+    RungeKutta(ins->X, U, dT);
+    invqmag   = invsqrtf(ins->X[6] * ins->X[6] + ins->X[7] * ins->X[7] + ins->X[8] * ins->X[8] + ins->X[9] * ins->X[9]);
+    ins->X[6] *= invqmag;
+    ins->X[7] *= invqmag;
+    ins->X[8] *= invqmag;
+    ins->X[9] *= invqmag;
+    // CovariancePrediction(ins->F,ins->G,ins->Q,dT,ins->P);
 
     // Update Nav solution structure
-    Nav.Pos[0] = ekf.X[0];
-    Nav.Pos[1] = ekf.X[1];
-    Nav.Pos[2] = ekf.X[2];
-    Nav.Vel[0] = ekf.X[3];
-    Nav.Vel[1] = ekf.X[4];
-    Nav.Vel[2] = ekf.X[5];
-    Nav.q[0]   = ekf.X[6];
-    Nav.q[1]   = ekf.X[7];
-    Nav.q[2]   = ekf.X[8];
-    Nav.q[3]   = ekf.X[9];
-    Nav.gyro_bias[0] = ekf.X[10];
-    Nav.gyro_bias[1] = ekf.X[11];
-    Nav.gyro_bias[2] = ekf.X[12];
+    ins->nav.Pos[0] = ins->X[0];
+    ins->nav.Pos[1] = ins->X[1];
+    ins->nav.Pos[2] = ins->X[2];
+    ins->nav.Vel[0] = ins->X[3];
+    ins->nav.Vel[1] = ins->X[4];
+    ins->nav.Vel[2] = ins->X[5];
+    ins->nav.q[0]   = ins->X[6];
+    ins->nav.q[1]   = ins->X[7];
+    ins->nav.q[2]   = ins->X[8];
+    ins->nav.q[3]   = ins->X[9];
+    ins->nav.gyro_bias[0] = ins->X[10];
+    ins->nav.gyro_bias[1] = ins->X[11];
+    ins->nav.gyro_bias[2] = ins->X[12];
+}
+
+void ins_covariance_prediction(insgps_context *ins, float dT)
+{
+    CovariancePrediction(ins->F, ins->G, ins->Q, dT, ins->P);
+}
+
+void ins_correction(insgps_context *ins, const float mag_data[3], const float Pos[3], const float Vel[3],
+                    const float BaroAlt, uint16_t SensorsUsed)
+{
+    float Z[10] = { 0 };
+    float Y[10] = { 0 };
+
+    // GPS Position in meters and in local NED frame
+    Z[0] = Pos[0];
+    Z[1] = Pos[1];
+    Z[2] = Pos[2];
+
+    // GPS Velocity in meters and in local NED frame
+    Z[3] = Vel[0];
+    Z[4] = Vel[1];
+    Z[5] = Vel[2];
+    // magnetometer data in any units (use unit vector) and in body frame
+
+
+    if (SensorsUsed & MAG_SENSORS) {
+        // magnetometer data in any units (use unit vector) and in body frame
+        float invBmag = invsqrtf(mag_data[0] * mag_data[0] + mag_data[1] * mag_data[1] + mag_data[2] * mag_data[2]);
+        Z[6] = mag_data[0] * invBmag;
+        Z[7] = mag_data[1] * invBmag;
+        Z[8] = mag_data[2] * invBmag;
+    }
+
+    // barometric altimeter in meters and in local NED frame
+    Z[9] = BaroAlt;
+
+    // EKF correction step
+    LinearizeH(ins->X, ins->Be, ins->H);
+    MeasurementEq(ins->X, ins->Be, Y);
+    SerialUpdate(ins->H, ins->R, Z, Y, ins->P, ins->X, SensorsUsed, &ins->innovation);
+
+    float invqmag = invsqrtf(ins->X[6] * ins->X[6] + ins->X[7] * ins->X[7] + ins->X[8] * ins->X[8] + ins->X[9] * ins->X[9]);
+    ins->X[6]  *= invqmag;
+    ins->X[7]  *= invqmag;
+    ins->X[8]  *= invqmag;
+    ins->X[9]  *= invqmag;
+    // Update Nav solution structure
+    ins->nav.Pos[0] = ins->X[0];
+    ins->nav.Pos[1] = ins->X[1];
+    ins->nav.Pos[2] = ins->X[2];
+    ins->nav.Vel[0] = ins->X[3];
+    ins->nav.Vel[1] = ins->X[4];
+    ins->nav.Vel[2] = ins->X[5];
+    ins->nav.q[0]   = ins->X[6];
+    ins->nav.q[1]   = ins->X[7];
+    ins->nav.q[2]   = ins->X[8];
+    ins->nav.q[3]   = ins->X[9];
+    ins->nav.gyro_bias[0] = ins->X[10];
+    ins->nav.gyro_bias[1] = ins->X[11];
+    ins->nav.gyro_bias[2] = ins->X[12];
+}
+
+// *************  Compatibility wrapper ************
+// The INS* interface runs a single filter instance
+// and publishes its solution in Nav
+// *************************************************
+
+static insgps_context ekf;
+struct NavStruct Nav;
+
+void INSGPSInit()
+{
+    ins_init(&ekf);
+}
+
+void INSSetArmed(bool armed)
+{
+    ins_set_armed(&ekf, armed);
+}
+
+void INSResetP(const float PDiag[NUMX])
+{
+    ins_reset_p(&ekf, PDiag);
+}
+
+void INSGetVariance(float PDiag[NUMX])
+{
+    ins_get_variance(&ekf, PDiag);
+}
+
+void INSGetInnovationStats(float NIS[NUMV], float RMS[NUMV])
+{
+    ins_get_innovation_stats(&ekf, NIS, RMS);
+}
+
+void INSResetInnovationStats()
+{
+    ins_reset_innovation_stats(&ekf);
+}
+
+void INSSetState(const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3])
+{
+    ins_set_state(&ekf, pos, vel, q, gyro_bias, accel_bias);
+}
+
+void INSPosVelReset(const float pos[3], const float vel[3])
+{
+    ins_pos_vel_reset(&ekf, pos, vel);
+}
+
+void INSSetPosVelVar(const float PosVar[3], const float VelVar[3])
+{
+    ins_set_pos_vel_var(&ekf, PosVar, VelVar);
+}
+
+void INSSetGyroBias(const float gyro_bias[3])
+{
+    ins_set_gyro_bias(&ekf, gyro_bias);
+}
+
+void INSSetAccelVar(const float accel_var[3])
+{
+    ins_set_accel_var(&ekf, accel_var);
+}
+
+void INSSetGyroVar(const float gyro_var[3])
+{
+    ins_set_gyro_var(&ekf, gyro_var);
+}
+
+void INSSetGyroBiasVar(const float gyro_bias_var[3])
+{
+    ins_set_gyro_bias_var(&ekf, gyro_bias_var);
+}
+
+void INSSetMagVar(const float mag_var[3])
+{
+    ins_set_mag_var(&ekf, mag_var);
+}
+
+void INSSetBaroVar(float baro_var)
+{
+    ins_set_baro_var(&ekf, baro_var);
+}
+
+void INSSetMagNorth(const float B[3])
+{
+    ins_set_mag_north(&ekf, B);
+}
+
+void INSStatePrediction(const float gyro_data[3], const float accel_data[3], float dT)
+{
+    ins_state_prediction(&ekf, gyro_data, accel_data, dT);
+    Nav = ekf.nav;
 }
 
 void INSCovariancePrediction(float dT)
 {
-    CovariancePrediction(ekf.F, ekf.G, ekf.Q, dT, ekf.P);
+    ins_covariance_prediction(&ekf, dT);
+}
+
+void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[3],
+                   const float BaroAlt, uint16_t SensorsUsed)
+{
+    ins_correction(&ekf, mag_data, Pos, Vel, BaroAlt, SensorsUsed);
+    Nav = ekf.nav;
 }
 
 float zeros[3] = { 0, 0, 0 };
@@ -387,61 +609,6 @@ void VelBaroCorrection(float Vel[3], float BaroAlt)
                   HORIZ_SENSORS | VERT_SENSORS | BARO_SENSOR);
 }
 
-void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[3],
-                   const float BaroAlt, uint16_t SensorsUsed)
-{
-    float Z[10] = { 0 };
-    float Y[10] = { 0 };
-
-    // GPS Position in meters and in local NED frame
-    Z[0] = Pos[0];
-    Z[1] = Pos[1];
-    Z[2] = Pos[2];
-
-    // GPS Velocity in meters and in local NED frame
-    Z[3] = Vel[0];
-    Z[4] = Vel[1];
-    Z[5] = Vel[2];
-    // magnetometer data in any units (use unit vector) and in body frame
-
-
-    if (SensorsUsed & MAG_SENSORS) {
-        // magnetometer data in any units (use unit vector) and in body frame
-        float invBmag = invsqrtf(mag_data[0] * mag_data[0] + mag_data[1] * mag_data[1] + mag_data[2] * mag_data[2]);
-        Z[6] = mag_data[0] * invBmag;
-        Z[7] = mag_data[1] * invBmag;
-        Z[8] = mag_data[2] * invBmag;
-    }
-
-    // barometric altimeter in meters and in local NED frame
-    Z[9] = BaroAlt;
-
-    // EKF correction step
-    LinearizeH(ekf.X, ekf.Be, ekf.H);
-    MeasurementEq(ekf.X, ekf.Be, Y);
-    SerialUpdate(ekf.H, ekf.R, Z, Y, ekf.P, ekf.X, SensorsUsed);
-
-    float invqmag = invsqrtf(ekf.X[6] * ekf.X[6] + ekf.X[7] * ekf.X[7] + ekf.X[8] * ekf.X[8] + ekf.X[9] * ekf.X[9]);
-    ekf.X[6]  *= invqmag;
-    ekf.X[7]  *= invqmag;
-    ekf.X[8]  *= invqmag;
-    ekf.X[9]  *= invqmag;
-    // Update Nav solution structure
-    Nav.Pos[0] = ekf.X[0];
-    Nav.Pos[1] = ekf.X[1];
-    Nav.Pos[2] = ekf.X[2];
-    Nav.Vel[0] = ekf.X[3];
-    Nav.Vel[1] = ekf.X[4];
-    Nav.Vel[2] = ekf.X[5];
-    Nav.q[0]   = ekf.X[6];
-    Nav.q[1]   = ekf.X[7];
-    Nav.q[2]   = ekf.X[8];
-    Nav.q[3]   = ekf.X[9];
-    Nav.gyro_bias[0] = ekf.X[10];
-    Nav.gyro_bias[1] = ekf.X[11];
-    Nav.gyro_bias[2] = ekf.X[12];
-}
-
 // *************  CovariancePrediction *************
 // Does the prediction step of the Kalman filter for the covariance matrix
 // Output, Pnew, overwrites P, the input covariance
@@ -449,88 +616,99 @@ void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[
 // Q is the discrete time covariance of process noise
 // Q is vector of the diagonal for a square matrix with
 // dimensions equal to the number of disturbance noise variables
-// The General Method is very inefficient,not taking advantage of the sparse F and G
-// The first Method is very specific to this implementation
+// The products are expanded per block of states, position (0-2), velocity
+// (3-5), attitude quaternion (6-9) and gyro bias (a-c), following the
+// sparsity of F and G above, so every loop has constant bounds.
+// With A = I+F*T, row i of Pnew = A*P*A' only needs the rows >= i of P,
+// except within the quaternion block, so Pnew is written over P row by row
+// and only the quaternion rows of A*P are kept aside.
 // ************************************************
 
-void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
-                          float Q[NUMW], float dT, float P[NUMX][NUMX])
+// Element j of x*A', for row j of A = I+F*T and a row x of P or A*P
+static inline float RowTimesAt(float F[NUMX][NUMX], const float x[NUMX], int8_t j, float dT)
 {
-    // Pnew = (I+F*T)*P*(I+F*T)' + (T^2)*G*Q*G' = (T^2)[(P/T + F*P)*(I/T + F') + G*Q*G')]
+    float sum = 0.0f;
+    int8_t k;
+
+    if (j < 3) { // position, from velocity
+        sum = F[j][j + 3] * x[j + 3];
+    } else if (j < 6) { // velocity, from quaternion
+        for (k = 6; k < 10; k++) {
+            sum += F[j][k] * x[k];
+        }
+    } else if (j < 10) { // quaternion, from quaternion and gyro bias
+        for (k = 6; k < NUMX; k++) {
+            sum += F[j][k] * x[k];
+        }
+    } // gyro bias is constant
+    return x[j] + sum * dT;
+}
 
-    const float dT1  = 1.0f / dT; // multiplication is faster than division on fpu.
+void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
+                          float Q[NUMW], float dT, float P[NUMP])
+{
     const float dTsq = dT * dT;
 
-    float Dummy[NUMX][NUMX];
+    float AP[NUMX]; // row i of A*P
+    float APq[4][NUMX]; // quaternion rows of A*P
     int8_t i;
+    int8_t j;
     int8_t k;
 
-    for (i = 0; i < NUMX; i++) { // Calculate Dummy = (P/T +F*P)
-        float *Firow = F[i];
-        float *Pirow = P[i];
-        float *Dirow = Dummy[i];
-        const int8_t Fistart = FrowMin[i];
-        const int8_t Fiend   = FrowMax[i];
-        int8_t j;
-
-        for (j = 0; j < NUMX; j++) {
-            Dirow[j] = Pirow[j] * dT1; // Dummy = P / T ...
+    for (i = 0; i < 3; i++) { // position rows
+        for (j = i; j < NUMX; j++) {
+            AP[j] = P[PUPPER(i, j)] + F[i][i + 3] * dT * P[PINDEX(i + 3, j)];
         }
-        for (k = Fistart; k <= Fiend; k++) {
-            for (j = 0; j < NUMX; j++) {
-                Dirow[j] += Firow[k] * P[k][j]; // [] + F * P
-            }
+        for (j = i; j < NUMX; j++) {
+            P[PUPPER(i, j)] = RowTimesAt(F, AP, j, dT);
         }
     }
-    for (i = 0; i < NUMX; i++) { // Calculate Pnew = (T^2) [Dummy/T + Dummy*F' + G*Qw*G']
-        float *Dirow = Dummy[i];
-        float *Girow = G[i];
-        float *Pirow = P[i];
-        const int8_t Gistart = GrowMin[i];
-        const int8_t Giend   = GrowMax[i];
-        int8_t j;
-
-
-        for (j = i; j < NUMX; j++) { // Use symmetry, ie only find upper triangular
-            float Ptmp         = Dirow[j] * dT1; // Pnew = Dummy / T ...
-
-            const float *Fjrow = F[j];
-            int8_t Fjstart     = FrowMin[j];
-            int8_t Fjend       = FrowMax[j];
-            k = Fjstart;
-
-            while (k <= Fjend - 3) {
-                Ptmp += Dirow[k] * Fjrow[k]; // [] + Dummy*F' ...
-                Ptmp += Dirow[k + 1] * Fjrow[k + 1];
-                Ptmp += Dirow[k + 2] * Fjrow[k + 2];
-                Ptmp += Dirow[k + 3] * Fjrow[k + 3];
-                k    += 4;
+
+    for (i = 3; i < 6; i++) { // velocity rows
+        for (j = i; j < NUMX; j++) {
+            float sum = 0.0f;
+            for (k = 6; k < 10; k++) {
+                sum += F[i][k] * P[PINDEX(k, j)];
             }
-            while (k <= Fjend) {
-                Ptmp += Dirow[k] * Fjrow[k];
-                k++;
+            AP[j] = P[PUPPER(i, j)] + sum * dT;
+        }
+        for (j = i; j < 6; j++) { // [] + G*Q*G', velocity noise
+            float GQG = 0.0f;
+            for (k = 3; k < 6; k++) {
+                GQG += G[i][k] * Q[k] * G[j][k];
             }
+            P[PUPPER(i, j)] = RowTimesAt(F, AP, j, dT) + GQG * dTsq;
+        }
+        for (j = 6; j < NUMX; j++) {
+            P[PUPPER(i, j)] = RowTimesAt(F, AP, j, dT);
+        }
+    }
 
-            float *Gjrow = G[j];
-            const int8_t Gjstart = MAX(Gistart, GrowMin[j]);
-            const int8_t Gjend   = MIN(Giend, GrowMax[j]);
-            k = Gjstart;
-            while (k <= Gjend - 2) {
-                Ptmp += Q[k] * Girow[k] * Gjrow[k]; // [] + G*Q*G' ...
-                Ptmp += Q[k + 1] * Girow[k + 1] * Gjrow[k + 1];
-                Ptmp += Q[k + 2] * Girow[k + 2] * Gjrow[k + 2];
-                k    += 3;
+    for (i = 6; i < 10; i++) { // quaternion rows, all of A*P first
+        for (j = 6; j < NUMX; j++) {
+            float sum = 0.0f;
+            for (k = 6; k < NUMX; k++) {
+                sum += F[i][k] * P[PINDEX(k, j)];
             }
-            if (k <= Gjend) {
-                Ptmp += Q[k] * Girow[k] * Gjrow[k];
-                if (k <= Gjend - 1) {
-                    Ptmp += Q[k + 1] * Girow[k + 1] * Gjrow[k + 1];
-                }
+            APq[i - 6][j] = P[PINDEX(i, j)] + sum * dT;
+        }
+    }
+    for (i = 6; i < 10; i++) {
+        for (j = i; j < 10; j++) { // [] + G*Q*G', gyro noise
+            float GQG = 0.0f;
+            for (k = 0; k < 3; k++) {
+                GQG += G[i][k] * Q[k] * G[j][k];
             }
-
-            P[j][i] = Pirow[j] = Ptmp * dTsq; // [] * (T^2)
+            P[PUPPER(i, j)] = RowTimesAt(F, APq[i - 6], j, dT) + GQG * dTsq;
+        }
+        for (j = 10; j < NUMX; j++) {
+            P[PUPPER(i, j)] = APq[i - 6][j];
         }
     }
+
+    for (i = 10; i < NUMX; i++) { // gyro bias rows, random walk only
+        P[PUPPER(i, i)] += G[i][i - 4] * Q[i - 4] * G[i][i - 4] * dTsq;
+    }
 }
 
 // *************  SerialUpdate *******************
@@ -549,10 +727,10 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
 // should be used in the update.
 // ************************************************
 void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
-                  float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
-                  uint16_t SensorsUsed)
+                  float Y[NUMV], float P[NUMP], float X[NUMX],
+                  uint16_t SensorsUsed, struct InnovationStats *Stats)
 {
-    float HP[NUMX], HPHR, Error;
+    float HP[NUMX], HPHR, Error, ErrorSq;
     uint8_t i, j, k, m;
     float Km[NUMX];
 
@@ -563,8 +741,13 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
             }
 
             for (k = HrowMin[m]; k <= HrowMax[m]; k++) {
-                for (j = 0; j < NUMX; j++) { // Find Hp = H*P
-                    HP[j] += H[m][k] * P[k][j];
+                const float Hmk = H[m][k];
+                for (j = 0; j < k; j++) { // Find Hp = H*P, column k above ...
+                    HP[j] += Hmk * P[PUPPER(j, k)];
+                }
+                const float *Pkrow = &P[PUPPER(k, k)];
+                for (j = k; j < NUMX; j++) { // ... and row k from the diagonal
+                    HP[j] += Hmk * Pkrow[j - k];
                 }
             }
             HPHR = R[m]; // Find  HPHR = H*P*H' + R
@@ -575,13 +758,23 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
             for (k = 0; k < NUMX; k++) {
                 Km[k] = HP[k] * invHPHR; // find K = HP/HPHR
             }
+            float *Pij = P;
             for (i = 0; i < NUMX; i++) { // Find P(m)= P(m-1) + K*HP
                 for (j = i; j < NUMX; j++) {
-                    P[i][j] = P[j][i] = P[i][j] - Km[i] * HP[j];
+                    *Pij++ -= Km[i] * HP[j];
                 }
             }
 
             Error = Z[m] - Y[m];
+            ErrorSq = Error * Error;
+            if (Stats->seeded[m]) {
+                Stats->nis[m] += (ErrorSq * invHPHR - Stats->nis[m]) * INNOVATION_ALPHA;
+                Stats->sq[m]  += (ErrorSq - Stats->sq[m]) * INNOVATION_ALPHA;
+            } else {
+                Stats->nis[m]    = ErrorSq * invHPHR;
+                Stats->sq[m]     = ErrorSq;
+                Stats->seeded[m] = 1;
+            }
             for (i = 0; i < NUMX; i++) { // Find X(m)= X(m-1) + K*Error
                 X[i] = X[i] + Km[i] * Error;
             }
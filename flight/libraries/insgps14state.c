@@ -34,6 +34,7 @@
 #include "insgps.h"
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 #include <stdbool.h>
 #include <pios_math.h>
 #include <mathmisc.h>
@@ -45,12 +46,22 @@
 #define NUMV 10 // number of measurements, v is the measurement noise vector
 #define NUMU 6 // number of deterministic inputs, U is the input vector
 #pragma GCC optimize "O3"
+// Exponential moving averages of the innovations of each measurement, over
+// about the last 1 / INNOVATION_ALPHA of them so that they follow the sensors
+// through a flight
+#define INNOVATION_ALPHA (1.0f / 128.0f)
+struct InnovationStats {
+    uint8_t seeded[NUMV]; // the first measurement starts the averages
+    float   nis[NUMV]; // normalized innovation squared, Error^2 / (H*P*H' + R)
+    float   sq[NUMV]; // Error^2
+};
+
 // Private functions
 void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
                           float Q[NUMW], float dT, float P[NUMX][NUMX]);
 static void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
                          float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
-                         uint16_t SensorsUsed);
+                         uint16_t SensorsUsed, struct InnovationStats *Stats);
 static void RungeKutta(float X[NUMX], float U[NUMU], float dT);
 static void StateEq(float X[NUMX], float U[NUMU], float Xdot[NUMX]);
 static void LinearizeFG(float X[NUMX], float U[NUMU], float F[NUMX][NUMX],
@@ -90,7 +101,7 @@ static int8_t GrowMax[NUMX] = { -1, -1, -1, 5, 5, 5, 2, 2, 2, 2, -1, -1, -1, -1
 static int8_t HrowMin[NUMV] = { 0, 1, 2, 3, 4, 5, 6, 6, 6, 2 };
 static int8_t HrowMax[NUMV] = { 0, 1, 2, 3, 4, 5, 9, 9, 9, 2 };
 
-static struct EKFData {
+struct insgps_context {
     float F[NUMX][NUMX];
     float G[NUMX][NUMW];
     float H[NUMV][NUMX]; // linearized system matrices
@@ -101,10 +112,9 @@ static struct EKFData {
     float Q[NUMW];
     float R[NUMV]; // input noise and measurement noise variances
     float K[NUMX][NUMV]; // feedback gain matrix
-} ekf;
-
-// Global variables
-struct NavStruct Nav;
+    struct InnovationStats innovation;
+    struct NavStruct nav; // current solution
+};
 
 // *************  Exposed Functions ****************
 // *************************************************
@@ -114,74 +124,87 @@ uint16_t ins_get_num_states()
     return NUMX;
 }
 
-void INSGPSInit()
+size_t ins_context_size()
 {
-    ekf.Be[0] = 1.0f;
-    ekf.Be[1] = 0;
-    ekf.Be[2] = 0; // local magnetic unit vector
+    return sizeof(insgps_context);
+}
+
+const struct NavStruct *ins_get_nav(const insgps_context *ins)
+{
+    return &ins->nav;
+}
+
+void ins_init(insgps_context *ins)
+{
+    ins_reset_innovation_stats(ins);
+    memset(&ins->nav, 0, sizeof(ins->nav));
+
+    ins->Be[0] = 1.0f;
+    ins->Be[1] = 0;
+    ins->Be[2] = 0; // local magnetic unit vector
 
     for (int i = 0; i < NUMX; i++) {
         for (int j = 0; j < NUMX; j++) {
-            ekf.P[i][j] = 0.0f; // zero all terms
-            ekf.F[i][j] = 0.0f;
+            ins->P[i][j] = 0.0f; // zero all terms
+            ins->F[i][j] = 0.0f;
         }
 
         for (int j = 0; j < NUMW; j++) {
-            ekf.G[i][j] = 0.0f;
+            ins->G[i][j] = 0.0f;
         }
 
         for (int j = 0; j < NUMV; j++) {
-            ekf.H[j][i] = 0.0f;
-            ekf.K[i][j] = 0.0f;
+            ins->H[j][i] = 0.0f;
+            ins->K[i][j] = 0.0f;
         }
 
-        ekf.X[i] = 0.0f;
+        ins->X[i] = 0.0f;
     }
     for (int i = 0; i < NUMW; i++) {
-        ekf.Q[i] = 0.0f;
+        ins->Q[i] = 0.0f;
     }
     for (int i = 0; i < NUMV; i++) {
-        ekf.R[i] = 0.0f;
+        ins->R[i] = 0.0f;
     }
 
-    ekf.P[0][0]   = ekf.P[1][1] = ekf.P[2][2] = 25.0f;        // initial position variance (m^2)
-    ekf.P[3][3]   = ekf.P[4][4] = ekf.P[5][5] = 5.0f; // initial velocity variance (m/s)^2
-    ekf.P[6][6]   = ekf.P[7][7] = ekf.P[8][8] = ekf.P[9][9] = 1e-5f;  // initial quaternion variance
-    ekf.P[10][10] = ekf.P[11][11] = ekf.P[12][12] = 1e-6f; // initial gyro bias variance (rad/s)^2
-    ekf.P[13][13] = 1e-5f; // initial accel bias variance (deg/s)^2
-
-    ekf.X[0]  = ekf.X[1] = ekf.X[2] = ekf.X[3] = ekf.X[4] = ekf.X[5] = 0.0f; // initial pos and vel (m)
-    ekf.X[6]  = 1.0f;
-    ekf.X[7]  = ekf.X[8] = ekf.X[9] = 0.0f;      // initial quaternion (level and North) (m/s)
-    ekf.X[10] = ekf.X[11] = ekf.X[12] = 0.0f; // initial gyro bias (rad/s)
-    ekf.X[13] = 0.0f; // initial accel bias
-
-    ekf.Q[0]  = ekf.Q[1] = ekf.Q[2] = 1e-5f;     // gyro noise variance (rad/s)^2
-    ekf.Q[3]  = ekf.Q[4] = ekf.Q[5] = 1e-5f;     // accelerometer noise variance (m/s^2)^2
-    ekf.Q[6]  = ekf.Q[7] = 1e-6f;         // gyro x and y bias random walk variance (rad/s^2)^2
-    ekf.Q[8]  = 1e-6f;     // gyro z bias random walk variance (rad/s^2)^2
-    ekf.Q[9]  = 5e-4f;                       // accel bias random walk variance (m/s^3)^2
-
-    ekf.R[0]  = ekf.R[1] = 0.004f;   // High freq GPS horizontal position noise variance (m^2)
-    ekf.R[2]  = 0.036f;              // High freq GPS vertical position noise variance (m^2)
-    ekf.R[3]  = ekf.R[4] = 0.004f;   // High freq GPS horizontal velocity noise variance (m/s)^2
-    ekf.R[5]  = 0.004f;              // High freq GPS vertical velocity noise variance (m/s)^2
-    ekf.R[6]  = ekf.R[7] = ekf.R[8] = 0.005f;        // magnetometer unit vector noise variance
-    ekf.R[9]  = .05f;                // High freq altimeter noise variance (m^2)
+    ins->P[0][0]   = ins->P[1][1] = ins->P[2][2] = 25.0f;        // initial position variance (m^2)
+    ins->P[3][3]   = ins->P[4][4] = ins->P[5][5] = 5.0f; // initial velocity variance (m/s)^2
+    ins->P[6][6]   = ins->P[7][7] = ins->P[8][8] = ins->P[9][9] = 1e-5f;  // initial quaternion variance
+    ins->P[10][10] = ins->P[11][11] = ins->P[12][12] = 1e-6f; // initial gyro bias variance (rad/s)^2
+    ins->P[13][13] = 1e-5f; // initial accel bias variance (deg/s)^2
+
+    ins->X[0]  = ins->X[1] = ins->X[2] = ins->X[3] = ins->X[4] = ins->X[5] = 0.0f; // initial pos and vel (m)
+    ins->X[6]  = 1.0f;
+    ins->X[7]  = ins->X[8] = ins->X[9] = 0.0f;      // initial quaternion (level and North) (m/s)
+    ins->X[10] = ins->X[11] = ins->X[12] = 0.0f; // initial gyro bias (rad/s)
+    ins->X[13] = 0.0f; // initial accel bias
+
+    ins->Q[0]  = ins->Q[1] = ins->Q[2] = 1e-5f;     // gyro noise variance (rad/s)^2
+    ins->Q[3]  = ins->Q[4] = ins->Q[5] = 1e-5f;     // accelerometer noise variance (m/s^2)^2
+    ins->Q[6]  = ins->Q[7] = 1e-6f;         // gyro x and y bias random walk variance (rad/s^2)^2
+    ins->Q[8]  = 1e-6f;     // gyro z bias random walk variance (rad/s^2)^2
+    ins->Q[9]  = 5e-4f;                       // accel bias random walk variance (m/s^3)^2
+
+    ins->R[0]  = ins->R[1] = 0.004f;   // High freq GPS horizontal position noise variance (m^2)
+    ins->R[2]  = 0.036f;              // High freq GPS vertical position noise variance (m^2)
+    ins->R[3]  = ins->R[4] = 0.004f;   // High freq GPS horizontal velocity noise variance (m/s)^2
+    ins->R[5]  = 0.004f;              // High freq GPS vertical velocity noise variance (m/s)^2
+    ins->R[6]  = ins->R[7] = ins->R[8] = 0.005f;        // magnetometer unit vector noise variance
+    ins->R[9]  = .05f;                // High freq altimeter noise variance (m^2)
 }
 
 // ! Set the current flight state
-void INSSetArmed(bool armed)
+void ins_set_armed(insgps_context *ins, bool armed)
 {
     return;
 
     // Speed up convergence of accel and gyro bias when not armed
     if (armed) {
-        ekf.Q[9] = 1e-4f;
-        ekf.Q[8] = 2e-9f;
+        ins->Q[9] = 1e-4f;
+        ins->Q[8] = 2e-9f;
     } else {
-        ekf.Q[9] = 1e-2f;
-        ekf.Q[8] = 2e-8f;
+        ins->Q[9] = 1e-2f;
+        ins->Q[8] = 2e-8f;
     }
 }
 
@@ -193,37 +216,37 @@ void INSSetArmed(bool armed)
  * @param[out] gyros_bias Estimate of gyro bias (rad/s)
  * @param[out] accel_bias Estiamte of the accel bias (m/s^2)
  */
-void INSGetState(float *pos, float *vel, float *attitude, float *gyro_bias, float *accel_bias)
+void ins_get_state(const insgps_context *ins, float *pos, float *vel, float *attitude, float *gyro_bias, float *accel_bias)
 {
     if (pos) {
-        pos[0] = ekf.X[0];
-        pos[1] = ekf.X[1];
-        pos[2] = ekf.X[2];
+        pos[0] = ins->X[0];
+        pos[1] = ins->X[1];
+        pos[2] = ins->X[2];
     }
 
     if (vel) {
-        vel[0] = ekf.X[3];
-        vel[1] = ekf.X[4];
-        vel[2] = ekf.X[5];
+        vel[0] = ins->X[3];
+        vel[1] = ins->X[4];
+        vel[2] = ins->X[5];
     }
 
     if (attitude) {
-        attitude[0] = ekf.X[6];
-        attitude[1] = ekf.X[7];
-        attitude[2] = ekf.X[8];
-        attitude[3] = ekf.X[9];
+        attitude[0] = ins->X[6];
+        attitude[1] = ins->X[7];
+        attitude[2] = ins->X[8];
+        attitude[3] = ins->X[9];
     }
 
     if (gyro_bias) {
-        gyro_bias[0] = ekf.X[10];
-        gyro_bias[1] = ekf.X[11];
-        gyro_bias[2] = ekf.X[12];
+        gyro_bias[0] = ins->X[10];
+        gyro_bias[1] = ins->X[11];
+        gyro_bias[2] = ins->X[12];
     }
 
     if (accel_bias) {
         accel_bias[0] = 0.0f;
         accel_bias[1] = 0.0f;
-        accel_bias[2] = ekf.X[13];
+        accel_bias[2] = ins->X[13];
     }
 }
 
@@ -231,14 +254,33 @@ void INSGetState(float *pos, float *vel, float *attitude, float *gyro_bias, floa
  * Get the variance, for visualizing the filter performance
  * @param[out var_out The variances
  */
-void INSGetVariance(float *var_out)
+void ins_get_variance(const insgps_context *ins, float *var_out)
 {
     for (uint32_t i = 0; i < NUMX; i++) {
-        var_out[i] = ekf.P[i][i];
+        var_out[i] = ins->P[i][i];
     }
 }
 
-void INSResetP(const float *PDiag)
+void ins_get_innovation_stats(const insgps_context *ins, float NIS[NUMV], float RMS[NUMV])
+{
+    uint8_t i;
+
+    for (i = 0; i < NUMV; i++) {
+        if (NIS != 0) {
+            NIS[i] = ins->innovation.nis[i];
+        }
+        if (RMS != 0) {
+            RMS[i] = sqrtf(ins->innovation.sq[i]);
+        }
+    }
+}
+
+void ins_reset_innovation_stats(insgps_context *ins)
+{
+    memset(&ins->innovation, 0, sizeof(ins->innovation));
+}
+
+void ins_reset_p(insgps_context *ins, const float *PDiag)
 {
     uint8_t i, j;
 
@@ -246,135 +288,135 @@ void INSResetP(const float *PDiag)
     for (i = 0; i < NUMX; i++) {
         if (PDiag != 0) {
             for (j = 0; j < NUMX; j++) {
-                ekf.P[i][j] = ekf.P[j][i] = 0.0f;
+                ins->P[i][j] = ins->P[j][i] = 0.0f;
             }
-            ekf.P[i][i] = PDiag[i];
+            ins->P[i][i] = PDiag[i];
         }
     }
 }
 
-void INSSetState(const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3])
+void ins_set_state(insgps_context *ins, const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3])
 {
-    ekf.X[0]  = pos[0];
-    ekf.X[1]  = pos[1];
-    ekf.X[2]  = pos[2];
-    ekf.X[3]  = vel[0];
-    ekf.X[4]  = vel[1];
-    ekf.X[5]  = vel[2];
-    ekf.X[6]  = q[0];
-    ekf.X[7]  = q[1];
-    ekf.X[8]  = q[2];
-    ekf.X[9]  = q[3];
-    ekf.X[10] = gyro_bias[0];
-    ekf.X[11] = gyro_bias[1];
-    ekf.X[12] = gyro_bias[2];
-    ekf.X[13] = accel_bias[2];
+    ins->X[0]  = pos[0];
+    ins->X[1]  = pos[1];
+    ins->X[2]  = pos[2];
+    ins->X[3]  = vel[0];
+    ins->X[4]  = vel[1];
+    ins->X[5]  = vel[2];
+    ins->X[6]  = q[0];
+    ins->X[7]  = q[1];
+    ins->X[8]  = q[2];
+    ins->X[9]  = q[3];
+    ins->X[10] = gyro_bias[0];
+    ins->X[11] = gyro_bias[1];
+    ins->X[12] = gyro_bias[2];
+    ins->X[13] = accel_bias[2];
 }
 
-void INSPosVelReset(const float pos[3], const float vel[3])
+void ins_pos_vel_reset(insgps_context *ins, const float pos[3], const float vel[3])
 {
     for (int i = 0; i < 6; i++) {
         for (int j = i; j < NUMX; j++) {
-            ekf.P[i][j] = 0.0f; // zero the first 6 rows and columns
-            ekf.P[j][i] = 0.0f;
+            ins->P[i][j] = 0.0f; // zero the first 6 rows and columns
+            ins->P[j][i] = 0.0f;
         }
     }
 
-    ekf.P[0][0] = ekf.P[1][1] = ekf.P[2][2] = 25.0f; // initial position variance (m^2)
-    ekf.P[3][3] = ekf.P[4][4] = ekf.P[5][5] = 5.0f; // initial velocity variance (m/s)^2
+    ins->P[0][0] = ins->P[1][1] = ins->P[2][2] = 25.0f; // initial position variance (m^2)
+    ins->P[3][3] = ins->P[4][4] = ins->P[5][5] = 5.0f; // initial velocity variance (m/s)^2
 
-    ekf.X[0]    = pos[0];
-    ekf.X[1]    = pos[1];
-    ekf.X[2]    = pos[2];
-    ekf.X[3]    = vel[0];
-    ekf.X[4]    = vel[1];
-    ekf.X[5]    = vel[2];
+    ins->X[0]    = pos[0];
+    ins->X[1]    = pos[1];
+    ins->X[2]    = pos[2];
+    ins->X[3]    = vel[0];
+    ins->X[4]    = vel[1];
+    ins->X[5]    = vel[2];
 }
-void INSSetPosVelVar(const float PosVar[3], const float VelVar[3])
+void ins_set_pos_vel_var(insgps_context *ins, const float PosVar[3], const float VelVar[3])
 {
-    ekf.R[0] = PosVar[0];
-    ekf.R[1] = PosVar[1];
-    ekf.R[2] = PosVar[2];
-    ekf.R[3] = VelVar[0];
-    ekf.R[4] = VelVar[1];
-    ekf.R[5] = VelVar[2]; // Don't change vertical velocity, not measured
+    ins->R[0] = PosVar[0];
+    ins->R[1] = PosVar[1];
+    ins->R[2] = PosVar[2];
+    ins->R[3] = VelVar[0];
+    ins->R[4] = VelVar[1];
+    ins->R[5] = VelVar[2]; // Don't change vertical velocity, not measured
 }
 
-void INSSetGyroBias(const float gyro_bias[3])
+void ins_set_gyro_bias(insgps_context *ins, const float gyro_bias[3])
 {
-    ekf.X[10] = gyro_bias[0];
-    ekf.X[11] = gyro_bias[1];
-    ekf.X[12] = gyro_bias[2];
+    ins->X[10] = gyro_bias[0];
+    ins->X[11] = gyro_bias[1];
+    ins->X[12] = gyro_bias[2];
 }
 
-void INSSetAccelBias(const float accel_bias[3])
+void ins_set_accel_bias(insgps_context *ins, const float accel_bias[3])
 {
-    ekf.X[13] = accel_bias[2];
+    ins->X[13] = accel_bias[2];
 }
 
-void INSSetAccelVar(const float accel_var[3])
+void ins_set_accel_var(insgps_context *ins, const float accel_var[3])
 {
-    ekf.Q[3] = accel_var[0];
-    ekf.Q[4] = accel_var[1];
-    ekf.Q[5] = accel_var[2];
+    ins->Q[3] = accel_var[0];
+    ins->Q[4] = accel_var[1];
+    ins->Q[5] = accel_var[2];
 }
 
-void INSSetGyroVar(const float gyro_var[3])
+void ins_set_gyro_var(insgps_context *ins, const float gyro_var[3])
 {
-    ekf.Q[0] = gyro_var[0];
-    ekf.Q[1] = gyro_var[1];
-    ekf.Q[2] = gyro_var[2];
+    ins->Q[0] = gyro_var[0];
+    ins->Q[1] = gyro_var[1];
+    ins->Q[2] = gyro_var[2];
 }
 
-void INSSetGyroBiasVar(const float gyro_bias_var[3])
+void ins_set_gyro_bias_var(insgps_context *ins, const float gyro_bias_var[3])
 {
-    ekf.Q[6] = gyro_bias_var[0];
-    ekf.Q[7] = gyro_bias_var[1];
-    ekf.Q[8] = gyro_bias_var[2];
+    ins->Q[6] = gyro_bias_var[0];
+    ins->Q[7] = gyro_bias_var[1];
+    ins->Q[8] = gyro_bias_var[2];
 }
 
-void INSSetMagVar(const float scaled_mag_var[3])
+void ins_set_mag_var(insgps_context *ins, const float scaled_mag_var[3])
 {
-    ekf.R[6] = scaled_mag_var[0];
-    ekf.R[7] = scaled_mag_var[1];
-    ekf.R[8] = scaled_mag_var[2];
+    ins->R[6] = scaled_mag_var[0];
+    ins->R[7] = scaled_mag_var[1];
+    ins->R[8] = scaled_mag_var[2];
 }
 
-void INSSetBaroVar(const float baro_var)
+void ins_set_baro_var(insgps_context *ins, const float baro_var)
 {
-    ekf.R[9] = baro_var;
+    ins->R[9] = baro_var;
 }
 
-void INSSetMagNorth(const float B[3])
+void ins_set_mag_north(insgps_context *ins, const float B[3])
 {
-    ekf.Be[0] = B[0];
-    ekf.Be[1] = B[1];
-    ekf.Be[2] = B[2];
+    ins->Be[0] = B[0];
+    ins->Be[1] = B[1];
+    ins->Be[2] = B[2];
 }
 
-void INSLimitBias()
+static void ins_limit_bias(insgps_context *ins)
 {
     // The Z accel bias should never wander too much. This helps ensure the filter
     // remains stable.
-    if (ekf.X[13] > 0.1f) {
-        ekf.X[13] = 0.1f;
-    } else if (ekf.X[13] < -0.1f) {
-        ekf.X[13] = -0.1f;
+    if (ins->X[13] > 0.1f) {
+        ins->X[13] = 0.1f;
+    } else if (ins->X[13] < -0.1f) {
+        ins->X[13] = -0.1f;
     }
 
     // Make sure no gyro bias gets to more than 10 deg / s. This should be more than
     // enough for well behaving sensors.
     const float GYRO_BIAS_LIMIT = DEG2RAD(10);
     for (int i = 10; i < 13; i++) {
-        if (ekf.X[i] < -GYRO_BIAS_LIMIT) {
-            ekf.X[i] = -GYRO_BIAS_LIMIT;
-        } else if (ekf.X[i] > GYRO_BIAS_LIMIT) {
-            ekf.X[i] = GYRO_BIAS_LIMIT;
+        if (ins->X[i] < -GYRO_BIAS_LIMIT) {
+            ins->X[i] = -GYRO_BIAS_LIMIT;
+        } else if (ins->X[i] > GYRO_BIAS_LIMIT) {
+            ins->X[i] = GYRO_BIAS_LIMIT;
         }
     }
 }
 
-void INSStatePrediction(const float gyro_data[3], const float accel_data[3], float dT)
+void ins_state_prediction(insgps_context *ins, const float gyro_data[3], const float accel_data[3], float dT)
 {
     float U[6];
     float invqmag;
@@ -390,40 +432,40 @@ void INSStatePrediction(const float gyro_data[3], const float accel_data[3], flo
     U[5] = accel_data[2];
 
     // EKF prediction step
-    LinearizeFG(ekf.X, U, ekf.F, ekf.G);
-    RungeKutta(ekf.X, U, dT);
-    invqmag    = invsqrtf(ekf.X[6] * ekf.X[6] + ekf.X[7] * ekf.X[7] + ekf.X[8] * ekf.X[8] + ekf.X[9] * ekf.X[9]);
-    ekf.X[6]  *= invqmag;
-    ekf.X[7]  *= invqmag;
-    ekf.X[8]  *= invqmag;
-    ekf.X[9]  *= invqmag;
+    LinearizeFG(ins->X, U, ins->F, ins->G);
+    RungeKutta(ins->X, U, dT);
+    invqmag    = invsqrtf(ins->X[6] * ins->X[6] + ins->X[7] * ins->X[7] + ins->X[8] * ins->X[8] + ins->X[9] * ins->X[9]);
+    ins->X[6]  *= invqmag;
+    ins->X[7]  *= invqmag;
+    ins->X[8]  *= invqmag;
+    ins->X[9]  *= invqmag;
 
     // Update Nav solution structure
-    Nav.Pos[0] = ekf.X[0];
-    Nav.Pos[1] = ekf.X[1];
-    Nav.Pos[2] = ekf.X[2];
-    Nav.Vel[0] = ekf.X[3];
-    Nav.Vel[1] = ekf.X[4];
-    Nav.Vel[2] = ekf.X[5];
-    Nav.q[0]   = ekf.X[6];
-    Nav.q[1]   = ekf.X[7];
-    Nav.q[2]   = ekf.X[8];
-    Nav.q[3]   = ekf.X[9];
-    Nav.gyro_bias[0]  = ekf.X[10];
-    Nav.gyro_bias[1]  = ekf.X[11];
-    Nav.gyro_bias[2]  = ekf.X[12];
-    Nav.accel_bias[0] = 0.0f;
-    Nav.accel_bias[1] = 0.0f;
-    Nav.accel_bias[2] = ekf.X[13];
+    ins->nav.Pos[0] = ins->X[0];
+    ins->nav.Pos[1] = ins->X[1];
+    ins->nav.Pos[2] = ins->X[2];
+    ins->nav.Vel[0] = ins->X[3];
+    ins->nav.Vel[1] = ins->X[4];
+    ins->nav.Vel[2] = ins->X[5];
+    ins->nav.q[0]   = ins->X[6];
+    ins->nav.q[1]   = ins->X[7];
+    ins->nav.q[2]   = ins->X[8];
+    ins->nav.q[3]   = ins->X[9];
+    ins->nav.gyro_bias[0]  = ins->X[10];
+    ins->nav.gyro_bias[1]  = ins->X[11];
+    ins->nav.gyro_bias[2]  = ins->X[12];
+    ins->nav.accel_bias[0] = 0.0f;
+    ins->nav.accel_bias[1] = 0.0f;
+    ins->nav.accel_bias[2] = ins->X[13];
 }
 
-void INSCovariancePrediction(float dT)
+void ins_covariance_prediction(insgps_context *ins, float dT)
 {
-    CovariancePrediction(ekf.F, ekf.G, ekf.Q, dT, ekf.P);
+    CovariancePrediction(ins->F, ins->G, ins->Q, dT, ins->P);
 }
 
-void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[3],
-                   const float BaroAlt, uint16_t SensorsUsed)
+void ins_correction(insgps_context *ins, const float mag_data[3], const float Pos[3], const float Vel[3],
+                    const float BaroAlt, uint16_t SensorsUsed)
 {
     float Z[10], Y[10];
     float invqmag;
@@ -441,10 +483,10 @@ void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[
     if (SensorsUsed & MAG_SENSORS) {
         // magnetometer data in any units (use unit vector) and in body frame
         float Rbe_a[3][3];
-        float q0 = ekf.X[6];
-        float q1 = ekf.X[7];
-        float q2 = ekf.X[8];
-        float q3 = ekf.X[9];
+        float q0 = ins->X[6];
+        float q1 = ins->X[7];
+        float q2 = ins->X[8];
+        float q3 = ins->X[9];
         float k1 = 1.0f / sqrtf(powf(q0 * q1 * 2.0f + q2 * q3 * 2.0f, 2.0f) + powf(q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3, 2.0f));
         float k2 = sqrtf(-powf(q0 * q2 * 2.0f - q1 * q3 * 2.0f, 2.0f) + 1.0f);
 
@@ -470,16 +512,131 @@ void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[
     Z[9] = BaroAlt;
 
     // EKF correction step
-    LinearizeH(ekf.X, ekf.Be, ekf.H);
-    MeasurementEq(ekf.X, ekf.Be, Y);
-    SerialUpdate(ekf.H, ekf.R, Z, Y, ekf.P, ekf.X, SensorsUsed);
-    invqmag   = invsqrtf(ekf.X[6] * ekf.X[6] + ekf.X[7] * ekf.X[7] + ekf.X[8] * ekf.X[8] + ekf.X[9] * ekf.X[9]);
-    ekf.X[6] *= invqmag;
-    ekf.X[7] *= invqmag;
-    ekf.X[8] *= invqmag;
-    ekf.X[9] *= invqmag;
+    LinearizeH(ins->X, ins->Be, ins->H);
+    MeasurementEq(ins->X, ins->Be, Y);
+    SerialUpdate(ins->H, ins->R, Z, Y, ins->P, ins->X, SensorsUsed, &ins->innovation);
+    invqmag   = invsqrtf(ins->X[6] * ins->X[6] + ins->X[7] * ins->X[7] + ins->X[8] * ins->X[8] + ins->X[9] * ins->X[9]);
+    ins->X[6] *= invqmag;
+    ins->X[7] *= invqmag;
+    ins->X[8] *= invqmag;
+    ins->X[9] *= invqmag;
+
+    ins_limit_bias(ins);
+}
+
+// *************  Compatibility wrapper ************
+// The INS* interface runs a single filter instance
+// and publishes its solution in Nav
+// *************************************************
+
+static insgps_context ekf;
+struct NavStruct Nav;
 
-    INSLimitBias();
+void INSGPSInit()
+{
+    ins_init(&ekf);
+}
+
+void INSSetArmed(bool armed)
+{
+    ins_set_armed(&ekf, armed);
+}
+
+void INSGetState(float *pos, float *vel, float *attitude, float *gyro_bias, float *accel_bias)
+{
+    ins_get_state(&ekf, pos, vel, attitude, gyro_bias, accel_bias);
+}
+
+void INSGetVariance(float *var_out)
+{
+    ins_get_variance(&ekf, var_out);
+}
+
+void INSGetInnovationStats(float NIS[NUMV], float RMS[NUMV])
+{
+    ins_get_innovation_stats(&ekf, NIS, RMS);
+}
+
+void INSResetInnovationStats()
+{
+    ins_reset_innovation_stats(&ekf);
+}
+
+void INSResetP(const float *PDiag)
+{
+    ins_reset_p(&ekf, PDiag);
+}
+
+void INSSetState(const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3])
+{
+    ins_set_state(&ekf, pos, vel, q, gyro_bias, accel_bias);
+}
+
+void INSPosVelReset(const float pos[3], const float vel[3])
+{
+    ins_pos_vel_reset(&ekf, pos, vel);
+}
+
+void INSSetPosVelVar(const float PosVar[3], const float VelVar[3])
+{
+    ins_set_pos_vel_var(&ekf, PosVar, VelVar);
+}
+
+void INSSetGyroBias(const float gyro_bias[3])
+{
+    ins_set_gyro_bias(&ekf, gyro_bias);
+}
+
+void INSSetAccelBias(const float accel_bias[3])
+{
+    ins_set_accel_bias(&ekf, accel_bias);
+}
+
+void INSSetAccelVar(const float accel_var[3])
+{
+    ins_set_accel_var(&ekf, accel_var);
+}
+
+void INSSetGyroVar(const float gyro_var[3])
+{
+    ins_set_gyro_var(&ekf, gyro_var);
+}
+
+void INSSetGyroBiasVar(const float gyro_bias_var[3])
+{
+    ins_set_gyro_bias_var(&ekf, gyro_bias_var);
+}
+
+void INSSetMagVar(const float scaled_mag_var[3])
+{
+    ins_set_mag_var(&ekf, scaled_mag_var);
+}
+
+void INSSetBaroVar(const float baro_var)
+{
+    ins_set_baro_var(&ekf, baro_var);
+}
+
+void INSSetMagNorth(const float B[3])
+{
+    ins_set_mag_north(&ekf, B);
+}
+
+void INSStatePrediction(const float gyro_data[3], const float accel_data[3], float dT)
+{
+    ins_state_prediction(&ekf, gyro_data, accel_data, dT);
+    Nav = ekf.nav;
+}
+
+void INSCovariancePrediction(float dT)
+{
+    ins_covariance_prediction(&ekf, dT);
+}
+
+void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[3],
+                   const float BaroAlt, uint16_t SensorsUsed)
+{
+    ins_correction(&ekf, mag_data, Pos, Vel, BaroAlt, SensorsUsed);
 }
 
 // *************  CovariancePrediction *************
@@ -590,9 +747,9 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
 // ************************************************
 void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
                   float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
-                  uint16_t SensorsUsed)
+                  uint16_t SensorsUsed, struct InnovationStats *Stats)
 {
-    float HP[NUMX], HPHR, Error;
+    float HP[NUMX], HPHR, Error, ErrorSq;
     uint8_t i, j, k, m;
     float Km[NUMX];
 
@@ -624,6 +781,15 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
             }
 
             Error = Z[m] - Y[m];
+            ErrorSq = Error * Error;
+            if (Stats->seeded[m]) {
+                Stats->nis[m] += (ErrorSq * invHPHR - Stats->nis[m]) * INNOVATION_ALPHA;
+                Stats->sq[m]  += (ErrorSq - Stats->sq[m]) * INNOVATION_ALPHA;
+            } else {
+                Stats->nis[m]    = ErrorSq * invHPHR;
+                Stats->sq[m]     = ErrorSq;
+                Stats->seeded[m] = 1;
+            }
             for (i = 0; i < NUMX; i++) { // Find X(m)= X(m-1) + K*Error
                 X[i] = X[i] + Km[i] * Error;
             }
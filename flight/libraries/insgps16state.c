@@ -32,6 +32,7 @@
 #include "insgps.h"
 #include <math.h>
 #include <stdint.h>
+#include <string.h>
 
 // constants/macros/typdefs
 #define NUMX 16 // number of states, X is the state vector
@@ -45,12 +46,22 @@
 #define COVARIANCE_PREDICTION_GENERAL
 #endif
 
+// Exponential moving averages of the innovations of each measurement, over
+// about the last 1 / INNOVATION_ALPHA of them so that they follow the sensors
+// through a flight
+#define INNOVATION_ALPHA (1.0f / 128.0f)
+struct InnovationStats {
+    uint8_t seeded[NUMV]; // the first measurement starts the averages
+    float   nis[NUMV]; // normalized innovation squared, Error^2 / (H*P*H' + R)
+    float   sq[NUMV]; // Error^2
+};
+
 // Private functions
 void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
                           float Q[NUMW], float dT, float P[NUMX][NUMX]);
 void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
                   float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
-                  uint16_t SensorsUsed);
+                  uint16_t SensorsUsed, struct InnovationStats *Stats);
 void RungeKutta(float X[NUMX], float U[NUMU], float dT);
 void StateEq(float X[NUMX], float U[NUMU], float Xdot[NUMX]);
 void LinearizeFG(float X[NUMX], float U[NUMU], float F[NUMX][NUMX],
@@ -59,12 +70,15 @@ void MeasurementEq(float X[NUMX], float Be[3], float Y[NUMV]);
 void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX]);
 
 // Private variables
-float F[NUMX][NUMX], G[NUMX][NUMW], H[NUMV][NUMX]; // linearized system matrices
-// global to init to zero and maintain zero elements
-float Be[3]; // local magnetic unit vector in NED frame
-float P[NUMX][NUMX], X[NUMX]; // covariance matrix and state vector
-float Q[NUMW], R[NUMV]; // input noise and measurement noise variances
-float K[NUMX][NUMV]; // feedback gain matrix
+struct insgps_context {
+    float F[NUMX][NUMX], G[NUMX][NUMW], H[NUMV][NUMX]; // linearized system matrices
+    // global to init to zero and maintain zero elements
+    float Be[3]; // local magnetic unit vector in NED frame
+    float P[NUMX][NUMX], X[NUMX]; // covariance matrix and state vector
+    float Q[NUMW], R[NUMV]; // input noise and measurement noise variances
+    struct InnovationStats innovation;
+    struct NavStruct nav; // current solution
+};
 
 // *************  Exposed Functions ****************
 // *************************************************
@@ -74,42 +88,55 @@ uint16_t ins_get_num_states()
     return NUMX;
 }
 
-void INSGPSInit() // pretty much just a place holder for now
+size_t ins_context_size()
+{
+    return sizeof(insgps_context);
+}
+
+const struct NavStruct *ins_get_nav(const insgps_context *ins)
+{
+    return &ins->nav;
+}
+
+void ins_init(insgps_context *ins) // pretty much just a place holder for now
 {
-    Be[0] = 1.0f;
-    Be[1] = 0;
-    Be[2] = 0; // local magnetic unit vector
+    ins_reset_innovation_stats(ins);
+    memset(&ins->nav, 0, sizeof(ins->nav));
+
+    ins->Be[0] = 1.0f;
+    ins->Be[1] = 0;
+    ins->Be[2] = 0; // local magnetic unit vector
 
     for (int i = 0; i < NUMX; i++) {
         for (int j = 0; j < NUMX; j++) {
-            P[i][j] = 0.0f; // zero all terms
+            ins->P[i][j] = 0.0f; // zero all terms
         }
     }
 
-    P[0][0]   = P[1][1] = P[2][2] = 25.0f;    // initial position variance (m^2)
-    P[3][3]   = P[4][4] = P[5][5] = 5.0f;     // initial velocity variance (m/s)^2
-    P[6][6]   = P[7][7] = P[8][8] = P[9][9] = 1e-5f;  // initial quaternion variance
-    P[10][10] = P[11][11] = P[12][12] = 1e-5f; // initial gyro bias variance (rad/s)^2
-
-    X[0]  = X[1] = X[2] = X[3] = X[4] = X[5] = 0.0f; // initial pos and vel (m)
-    X[6]  = 1.0f;
-    X[7]  = X[8] = X[9] = 0.0f;      // initial quaternion (level and North) (m/s)
-    X[10] = X[11] = X[12] = 0.0f; // initial gyro bias (rad/s)
-
-    Q[0]  = Q[1] = Q[2] = 50e-8f;    // gyro noise variance (rad/s)^2
-    Q[3]  = Q[4] = Q[5] = 0.01f;     // accelerometer noise variance (m/s^2)^2
-    Q[6]  = Q[7] = Q[8] = 2e-9f;     // gyro bias random walk variance (rad/s^2)^2
-    Q[9]  = Q[10] = Q[11] = 2e-20f;  // accel bias random walk variance (m/s^3)^2
-
-    R[0]  = R[1] = 0.004f;   // High freq GPS horizontal position noise variance (m^2)
-    R[2]  = 0.036f;          // High freq GPS vertical position noise variance (m^2)
-    R[3]  = R[4] = 0.004f;   // High freq GPS horizontal velocity noise variance (m/s)^2
-    R[5]  = 100.0f;          // High freq GPS vertical velocity noise variance (m/s)^2
-    R[6]  = R[7] = R[8] = 0.005f;    // magnetometer unit vector noise variance
-    R[9]  = .05f;            // High freq altimeter noise variance (m^2)
+    ins->P[0][0]   = ins->P[1][1] = ins->P[2][2] = 25.0f;    // initial position variance (m^2)
+    ins->P[3][3]   = ins->P[4][4] = ins->P[5][5] = 5.0f;     // initial velocity variance (m/s)^2
+    ins->P[6][6]   = ins->P[7][7] = ins->P[8][8] = ins->P[9][9] = 1e-5f;  // initial quaternion variance
+    ins->P[10][10] = ins->P[11][11] = ins->P[12][12] = 1e-5f; // initial gyro bias variance (rad/s)^2
+
+    ins->X[0]  = ins->X[1] = ins->X[2] = ins->X[3] = ins->X[4] = ins->X[5] = 0.0f; // initial pos and vel (m)
+    ins->X[6]  = 1.0f;
+    ins->X[7]  = ins->X[8] = ins->X[9] = 0.0f;      // initial quaternion (level and North) (m/s)
+    ins->X[10] = ins->X[11] = ins->X[12] = 0.0f; // initial gyro bias (rad/s)
+
+    ins->Q[0]  = ins->Q[1] = ins->Q[2] = 50e-8f;    // gyro noise variance (rad/s)^2
+    ins->Q[3]  = ins->Q[4] = ins->Q[5] = 0.01f;     // accelerometer noise variance (m/s^2)^2
+    ins->Q[6]  = ins->Q[7] = ins->Q[8] = 2e-9f;     // gyro bias random walk variance (rad/s^2)^2
+    ins->Q[9]  = ins->Q[10] = ins->Q[11] = 2e-20f;  // accel bias random walk variance (m/s^3)^2
+
+    ins->R[0]  = ins->R[1] = 0.004f;   // High freq GPS horizontal position noise variance (m^2)
+    ins->R[2]  = 0.036f;          // High freq GPS vertical position noise variance (m^2)
+    ins->R[3]  = ins->R[4] = 0.004f;   // High freq GPS horizontal velocity noise variance (m/s)^2
+    ins->R[5]  = 100.0f;          // High freq GPS vertical velocity noise variance (m/s)^2
+    ins->R[6]  = ins->R[7] = ins->R[8] = 0.005f;    // magnetometer unit vector noise variance
+    ins->R[9]  = .05f;            // High freq altimeter noise variance (m^2)
 }
 
-void INSResetP(float PDiag[NUMX])
+void ins_reset_p(insgps_context *ins, const float PDiag[NUMX])
 {
     uint8_t i, j;
 
@@ -117,99 +144,140 @@ void INSResetP(float PDiag[NUMX])
     for (i = 0; i < NUMX; i++) {
         if (PDiag != 0) {
             for (j = 0; j < NUMX; j++) {
-                P[i][j] = P[j][i] = 0.0f;
+                ins->P[i][j] = ins->P[j][i] = 0.0f;
             }
-            P[i][i] = PDiag[i];
+            ins->P[i][i] = PDiag[i];
         }
     }
 }
 
-void INSSetState(float pos[3], float vel[3], float q[4], float gyro_bias[3], float accel_bias[3])
+void ins_set_state(insgps_context *ins, const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3])
 {
-    Nav.Pos[0] = X[0] = pos[0];
-    Nav.Pos[1] = X[1] = pos[1];
-    Nav.Pos[2] = X[2] = pos[2];
-    Nav.Vel[0] = X[3] = vel[0];
-    Nav.Vel[1] = X[4] = vel[1];
-    Nav.Vel[2] = X[5] = vel[2];
-    Nav.q[0]   = X[6] = q[0];
-    Nav.q[1]   = X[7] = q[1];
-    Nav.q[2]   = X[8] = q[2];
-    Nav.q[3]   = X[9] = q[3];
-    Nav.gyro_bias[0]  = X[10] = gyro_bias[0];
-    Nav.gyro_bias[1]  = X[11] = gyro_bias[1];
-    Nav.gyro_bias[2]  = X[12] = gyro_bias[2];
-    Nav.accel_bias[0] = X[13] = accel_bias[0];
-    Nav.accel_bias[1] = X[14] = accel_bias[1];
-    Nav.accel_bias[2] = X[15] = accel_bias[2];
+    ins->nav.Pos[0] = ins->X[0] = pos[0];
+    ins->nav.Pos[1] = ins->X[1] = pos[1];
+    ins->nav.Pos[2] = ins->X[2] = pos[2];
+    ins->nav.Vel[0] = ins->X[3] = vel[0];
+    ins->nav.Vel[1] = ins->X[4] = vel[1];
+    ins->nav.Vel[2] = ins->X[5] = vel[2];
+    ins->nav.q[0]   = ins->X[6] = q[0];
+    ins->nav.q[1]   = ins->X[7] = q[1];
+    ins->nav.q[2]   = ins->X[8] = q[2];
+    ins->nav.q[3]   = ins->X[9] = q[3];
+    ins->nav.gyro_bias[0]  = ins->X[10] = gyro_bias[0];
+    ins->nav.gyro_bias[1]  = ins->X[11] = gyro_bias[1];
+    ins->nav.gyro_bias[2]  = ins->X[12] = gyro_bias[2];
+    ins->nav.accel_bias[0] = ins->X[13] = accel_bias[0];
+    ins->nav.accel_bias[1] = ins->X[14] = accel_bias[1];
+    ins->nav.accel_bias[2] = ins->X[15] = accel_bias[2];
 }
 
-void INSPosVelReset(float pos[3], float vel[3])
+void ins_pos_vel_reset(insgps_context *ins, const float pos[3], const float vel[3])
 {
     for (int i = 0; i < 6; i++) {
         for (int j = i; j < NUMX; j++) {
-            P[i][j] = 0.0f; // zero the first 6 rows and columns
-            P[j][i] = 0.0f;
+            ins->P[i][j] = 0.0f; // zero the first 6 rows and columns
+            ins->P[j][i] = 0.0f;
         }
     }
 
-    P[0][0] = P[1][1] = P[2][2] = 25.0f; // initial position variance (m^2)
-    P[3][3] = P[4][4] = P[5][5] = 5.0f; // initial velocity variance (m/s)^2
+    ins->P[0][0] = ins->P[1][1] = ins->P[2][2] = 25.0f; // initial position variance (m^2)
+    ins->P[3][3] = ins->P[4][4] = ins->P[5][5] = 5.0f; // initial velocity variance (m/s)^2
+
+    ins->X[0]    = pos[0];
+    ins->X[1]    = pos[1];
+    ins->X[2]    = pos[2];
+    ins->X[3]    = vel[0];
+    ins->X[4]    = vel[1];
+    ins->X[5]    = vel[2];
+}
+
+void ins_set_pos_vel_var(insgps_context *ins, const float PosVar[3], const float VelVar[3])
+{
+    ins->R[0] = PosVar[0];
+    ins->R[1] = PosVar[1];
+    ins->R[2] = PosVar[2];
+    ins->R[3] = VelVar[0];
+    ins->R[4] = VelVar[1];
+    ins->R[5] = VelVar[2];
+}
 
-    X[0]    = pos[0];
-    X[1]    = pos[1];
-    X[2]    = pos[2];
-    X[3]    = vel[0];
-    X[4]    = vel[1];
-    X[5]    = vel[2];
+void ins_set_gyro_bias(insgps_context *ins, const float gyro_bias[3])
+{
+    ins->X[10] = gyro_bias[0];
+    ins->X[11] = gyro_bias[1];
+    ins->X[12] = gyro_bias[2];
 }
 
-void INSSetPosVelVar(float PosVar, float VelVar)
+void ins_set_accel_var(insgps_context *ins, const float accel_var[3])
 {
-    R[0] = PosVar;
-    R[1] = PosVar;
-    R[2] = PosVar;
-    R[3] = VelVar;
-    R[4] = VelVar;
-    R[5] = PosVar; // Don't change vertical velocity, not measured
+    ins->Q[3] = accel_var[0];
+    ins->Q[4] = accel_var[1];
+    ins->Q[5] = accel_var[2];
 }
 
-void INSSetGyroBias(float gyro_bias[3])
+void ins_set_gyro_var(insgps_context *ins, const float gyro_var[3])
 {
-    X[10] = gyro_bias[0];
-    X[11] = gyro_bias[1];
-    X[12] = gyro_bias[2];
+    ins->Q[0] = gyro_var[0];
+    ins->Q[1] = gyro_var[1];
+    ins->Q[2] = gyro_var[2];
 }
 
-void INSSetAccelVar(float accel_var[3])
+void ins_set_gyro_bias_var(insgps_context *ins, const float gyro_bias_var[3])
 {
-    Q[3] = accel_var[0];
-    Q[4] = accel_var[1];
-    Q[5] = accel_var[2];
+    ins->Q[6] = gyro_bias_var[0];
+    ins->Q[7] = gyro_bias_var[1];
+    ins->Q[8] = gyro_bias_var[2];
 }
 
-void INSSetGyroVar(float gyro_var[3])
+void ins_set_mag_var(insgps_context *ins, const float scaled_mag_var[3])
 {
-    Q[0] = gyro_var[0];
-    Q[1] = gyro_var[1];
-    Q[2] = gyro_var[2];
+    ins->R[6] = scaled_mag_var[0];
+    ins->R[7] = scaled_mag_var[1];
+    ins->R[8] = scaled_mag_var[2];
 }
 
-void INSSetMagVar(float scaled_mag_var[3])
+void ins_set_baro_var(insgps_context *ins, const float baro_var)
 {
-    R[6] = scaled_mag_var[0];
-    R[7] = scaled_mag_var[1];
-    R[8] = scaled_mag_var[2];
+    ins->R[9] = baro_var;
 }
 
-void INSSetMagNorth(float B[3])
+void ins_set_armed(__attribute__((unused)) insgps_context *ins, __attribute__((unused)) bool armed)
+{}
+
+void ins_get_variance(const insgps_context *ins, float PDiag[NUMX])
 {
-    Be[0] = B[0];
-    Be[1] = B[1];
-    Be[2] = B[2];
+    for (uint8_t i = 0; i < NUMX; i++) {
+        PDiag[i] = ins->P[i][i];
+    }
 }
 
-void INSStatePrediction(float gyro_data[3], float accel_data[3], float dT)
+void ins_get_innovation_stats(const insgps_context *ins, float NIS[NUMV], float RMS[NUMV])
+{
+    uint8_t i;
+
+    for (i = 0; i < NUMV; i++) {
+        if (NIS != 0) {
+            NIS[i] = ins->innovation.nis[i];
+        }
+        if (RMS != 0) {
+            RMS[i] = sqrtf(ins->innovation.sq[i]);
+        }
+    }
+}
+
+void ins_reset_innovation_stats(insgps_context *ins)
+{
+    memset(&ins->innovation, 0, sizeof(ins->innovation));
+}
+
+void ins_set_mag_north(insgps_context *ins, const float B[3])
+{
+    ins->Be[0] = B[0];
+    ins->Be[1] = B[1];
+    ins->Be[2] = B[2];
+}
+
+void ins_state_prediction(insgps_context *ins, const float gyro_data[3], const float accel_data[3], float dT)
 {
     float U[6];
     float qmag;
@@ -225,34 +293,197 @@ void INSStatePrediction(float gyro_data[3], float accel_data[3], float dT)
     U[5] = accel_data[2];
 
     // EKF prediction step
-    LinearizeFG(X, U, F, G);
-    RungeKutta(X, U, dT);
-    qmag  = sqrt(X[6] * X[6] + X[7] * X[7] + X[8] * X[8] + X[9] * X[9]);
-    X[6] /= qmag;
-    X[7] /= qmag;
-    X[8] /= qmag;
-    X[9] /= qmag;
+    LinearizeFG(ins->X, U, ins->F, ins->G);
+    RungeKutta(ins->X, U, dT);
+    qmag  = sqrt(ins->X[6] * ins->X[6] + ins->X[7] * ins->X[7] + ins->X[8] * ins->X[8] + ins->X[9] * ins->X[9]);
+    ins->X[6] /= qmag;
+    ins->X[7] /= qmag;
+    ins->X[8] /= qmag;
+    ins->X[9] /= qmag;
     // CovariancePrediction(F,G,Q,dT,P);
 
     // Update Nav solution structure
-    Nav.Pos[0] = X[0];
-    Nav.Pos[1] = X[1];
-    Nav.Pos[2] = X[2];
-    Nav.Vel[0] = X[3];
-    Nav.Vel[1] = X[4];
-    Nav.Vel[2] = X[5];
-    Nav.q[0]   = X[6];
-    Nav.q[1]   = X[7];
-    Nav.q[2]   = X[8];
-    Nav.q[3]   = X[9];
-    Nav.gyro_bias[0] = X[10];
-    Nav.gyro_bias[1] = X[11];
-    Nav.gyro_bias[2] = X[12];
+    ins->nav.Pos[0] = ins->X[0];
+    ins->nav.Pos[1] = ins->X[1];
+    ins->nav.Pos[2] = ins->X[2];
+    ins->nav.Vel[0] = ins->X[3];
+    ins->nav.Vel[1] = ins->X[4];
+    ins->nav.Vel[2] = ins->X[5];
+    ins->nav.q[0]   = ins->X[6];
+    ins->nav.q[1]   = ins->X[7];
+    ins->nav.q[2]   = ins->X[8];
+    ins->nav.q[3]   = ins->X[9];
+    ins->nav.gyro_bias[0] = ins->X[10];
+    ins->nav.gyro_bias[1] = ins->X[11];
+    ins->nav.gyro_bias[2] = ins->X[12];
+}
+
+void ins_covariance_prediction(insgps_context *ins, float dT)
+{
+    CovariancePrediction(ins->F, ins->G, ins->Q, dT, ins->P);
+}
+
+void ins_correction(insgps_context *ins, const float mag_data[3], const float Pos[3], const float Vel[3],
+                    float BaroAlt, uint16_t SensorsUsed)
+{
+    float Z[10], Y[10];
+    float Bmag, qmag;
+
+    // GPS Position in meters and in local NED frame
+    Z[0] = Pos[0];
+    Z[1] = Pos[1];
+    Z[2] = Pos[2];
+
+    // GPS Velocity in meters and in local NED frame
+    Z[3] = Vel[0];
+    Z[4] = Vel[1];
+    Z[5] = Vel[2];
+
+    // magnetometer data in any units (use unit vector) and in body frame
+    Bmag =
+        sqrt(mag_data[0] * mag_data[0] + mag_data[1] * mag_data[1] +
+             mag_data[2] * mag_data[2]);
+    Z[6] = mag_data[0] / Bmag;
+    Z[7] = mag_data[1] / Bmag;
+    Z[8] = mag_data[2] / Bmag;
+
+    // barometric altimeter in meters and in local NED frame
+    Z[9] = BaroAlt;
+
+    // EKF correction step
+    LinearizeH(ins->X, ins->Be, ins->H);
+    MeasurementEq(ins->X, ins->Be, Y);
+    SerialUpdate(ins->H, ins->R, Z, Y, ins->P, ins->X, SensorsUsed, &ins->innovation);
+    qmag  = sqrt(ins->X[6] * ins->X[6] + ins->X[7] * ins->X[7] + ins->X[8] * ins->X[8] + ins->X[9] * ins->X[9]);
+    ins->X[6] /= qmag;
+    ins->X[7] /= qmag;
+    ins->X[8] /= qmag;
+    ins->X[9] /= qmag;
+
+    // Update Nav solution structure
+    ins->nav.Pos[0] = ins->X[0];
+    ins->nav.Pos[1] = ins->X[1];
+    ins->nav.Pos[2] = ins->X[2];
+    ins->nav.Vel[0] = ins->X[3];
+    ins->nav.Vel[1] = ins->X[4];
+    ins->nav.Vel[2] = ins->X[5];
+    ins->nav.q[0]   = ins->X[6];
+    ins->nav.q[1]   = ins->X[7];
+    ins->nav.q[2]   = ins->X[8];
+    ins->nav.q[3]   = ins->X[9];
+    ins->nav.gyro_bias[0]  = ins->X[10];
+    ins->nav.gyro_bias[1]  = ins->X[11];
+    ins->nav.gyro_bias[2]  = ins->X[12];
+    ins->nav.accel_bias[0] = ins->X[13];
+    ins->nav.accel_bias[1] = ins->X[14];
+    ins->nav.accel_bias[2] = ins->X[15];
+}
+
+// *************  Compatibility wrapper ************
+// The INS* interface runs a single filter instance
+// and publishes its solution in Nav
+// *************************************************
+
+static insgps_context ekf;
+struct NavStruct Nav;
+
+void INSGPSInit()
+{
+    ins_init(&ekf);
+}
+
+void INSResetP(const float PDiag[NUMX])
+{
+    ins_reset_p(&ekf, PDiag);
+}
+
+void INSGetVariance(float PDiag[NUMX])
+{
+    ins_get_variance(&ekf, PDiag);
+}
+
+void INSGetInnovationStats(float NIS[NUMV], float RMS[NUMV])
+{
+    ins_get_innovation_stats(&ekf, NIS, RMS);
+}
+
+void INSResetInnovationStats()
+{
+    ins_reset_innovation_stats(&ekf);
+}
+
+void INSSetState(const float pos[3], const float vel[3], const float q[4], const float gyro_bias[3], const float accel_bias[3])
+{
+    ins_set_state(&ekf, pos, vel, q, gyro_bias, accel_bias);
+    Nav = ekf.nav;
+}
+
+void INSPosVelReset(const float pos[3], const float vel[3])
+{
+    ins_pos_vel_reset(&ekf, pos, vel);
+}
+
+void INSSetPosVelVar(const float PosVar[3], const float VelVar[3])
+{
+    ins_set_pos_vel_var(&ekf, PosVar, VelVar);
+}
+
+void INSSetGyroBias(const float gyro_bias[3])
+{
+    ins_set_gyro_bias(&ekf, gyro_bias);
+}
+
+void INSSetAccelVar(const float accel_var[3])
+{
+    ins_set_accel_var(&ekf, accel_var);
+}
+
+void INSSetGyroVar(const float gyro_var[3])
+{
+    ins_set_gyro_var(&ekf, gyro_var);
+}
+
+void INSSetGyroBiasVar(const float gyro_bias_var[3])
+{
+    ins_set_gyro_bias_var(&ekf, gyro_bias_var);
+}
+
+void INSSetMagVar(const float scaled_mag_var[3])
+{
+    ins_set_mag_var(&ekf, scaled_mag_var);
+}
+
+void INSSetBaroVar(const float baro_var)
+{
+    ins_set_baro_var(&ekf, baro_var);
+}
+
+void INSSetArmed(bool armed)
+{
+    ins_set_armed(&ekf, armed);
+}
+
+void INSSetMagNorth(const float B[3])
+{
+    ins_set_mag_north(&ekf, B);
+}
+
+void INSStatePrediction(const float gyro_data[3], const float accel_data[3], float dT)
+{
+    ins_state_prediction(&ekf, gyro_data, accel_data, dT);
+    Nav = ekf.nav;
 }
 
 void INSCovariancePrediction(float dT)
 {
-    CovariancePrediction(F, G, Q, dT, P);
+    ins_covariance_prediction(&ekf, dT);
+}
+
+void INSCorrection(const float mag_data[3], const float Pos[3], const float Vel[3],
+                   float BaroAlt, uint16_t SensorsUsed)
+{
+    ins_correction(&ekf, mag_data, Pos, Vel, BaroAlt, SensorsUsed);
+    Nav = ekf.nav;
 }
 
 float zeros[3] = { 0.0f, 0.0f, 0.0f };
@@ -293,62 +524,6 @@ void VelBaroCorrection(float Vel[3], float BaroAlt)
                   HORIZ_SENSORS | VERT_SENSORS | BARO_SENSOR);
 }
 
-void INSCorrection(float mag_data[3], float Pos[3], float Vel[3],
-                   float BaroAlt, uint16_t SensorsUsed)
-{
-    float Z[10], Y[10];
-    float Bmag, qmag;
-
-    // GPS Position in meters and in local NED frame
-    Z[0] = Pos[0];
-    Z[1] = Pos[1];
-    Z[2] = Pos[2];
-
-    // GPS Velocity in meters and in local NED frame
-    Z[3] = Vel[0];
-    Z[4] = Vel[1];
-    Z[5] = Vel[2];
-
-    // magnetometer data in any units (use unit vector) and in body frame
-    Bmag =
-        sqrt(mag_data[0] * mag_data[0] + mag_data[1] * mag_data[1] +
-             mag_data[2] * mag_data[2]);
-    Z[6] = mag_data[0] / Bmag;
-    Z[7] = mag_data[1] / Bmag;
-    Z[8] = mag_data[2] / Bmag;
-
-    // barometric altimeter in meters and in local NED frame
-    Z[9] = BaroAlt;
-
-    // EKF correction step
-    LinearizeH(X, Be, H);
-    MeasurementEq(X, Be, Y);
-    SerialUpdate(H, R, Z, Y, P, X, SensorsUsed);
-    qmag  = sqrt(X[6] * X[6] + X[7] * X[7] + X[8] * X[8] + X[9] * X[9]);
-    X[6] /= qmag;
-    X[7] /= qmag;
-    X[8] /= qmag;
-    X[9] /= qmag;
-
-    // Update Nav solution structure
-    Nav.Pos[0] = X[0];
-    Nav.Pos[1] = X[1];
-    Nav.Pos[2] = X[2];
-    Nav.Vel[0] = X[3];
-    Nav.Vel[1] = X[4];
-    Nav.Vel[2] = X[5];
-    Nav.q[0]   = X[6];
-    Nav.q[1]   = X[7];
-    Nav.q[2]   = X[8];
-    Nav.q[3]   = X[9];
-    Nav.gyro_bias[0]  = X[10];
-    Nav.gyro_bias[1]  = X[11];
-    Nav.gyro_bias[2]  = X[12];
-    Nav.accel_bias[0] = X[13];
-    Nav.accel_bias[1] = X[14];
-    Nav.accel_bias[2] = X[15];
-}
-
 // *************  CovariancePrediction *************
 // Does the prediction step of the Kalman filter for the covariance matrix
 // Output, Pnew, overwrites P, the input covariance
@@ -571,10 +746,11 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
 
 void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
                   float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
-                  uint16_t SensorsUsed)
+                  uint16_t SensorsUsed, struct InnovationStats *Stats)
 {
-    float HP[NUMX], HPHR, Error;
+    float HP[NUMX], HPHR, Error, ErrorSq;
     uint8_t i, j, k, m;
+    float Km[NUMX];
 
     for (m = 0; m < NUMV; m++) {
         if (SensorsUsed & (0x01 << m)) { // use this sensor for update
@@ -590,18 +766,27 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
             }
 
             for (k = 0; k < NUMX; k++) {
-                K[k][m] = HP[k] / HPHR; // find K = HP/HPHR
+                Km[k] = HP[k] / HPHR; // find K = HP/HPHR
             }
             for (i = 0; i < NUMX; i++) { // Find P(m)= P(m-1) + K*HP
                 for (j = i; j < NUMX; j++) {
                     P[i][j] = P[j][i] =
-                                  P[i][j] - K[i][m] * HP[j];
+                                  P[i][j] - Km[i] * HP[j];
                 }
             }
 
             Error = Z[m] - Y[m];
+            ErrorSq = Error * Error;
+            if (Stats->seeded[m]) {
+                Stats->nis[m] += (ErrorSq / HPHR - Stats->nis[m]) * INNOVATION_ALPHA;
+                Stats->sq[m]  += (ErrorSq - Stats->sq[m]) * INNOVATION_ALPHA;
+            } else {
+                Stats->nis[m]    = ErrorSq / HPHR;
+                Stats->sq[m]     = ErrorSq;
+                Stats->seeded[m] = 1;
+            }
             for (i = 0; i < NUMX; i++) { // Find X(m)= X(m-1) + K*Error
-                X[i] = X[i] + K[i][m] * Error;
+                X[i] = X[i] + Km[i] * Error;
             }
         }
     }
@@ -125,6 +125,7 @@ static void ControlUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
     DebugLogControlGet(&control);
     if (control.Operation == DEBUGLOGCONTROL_OPERATION_RETRIEVE) {
+        // not borrowed in place, the flash read may block for a logfs erase
         memset(entry, 0, sizeof(DebugLogEntryData));
         if (PIOS_DEBUGLOG_Read(entry, control.Flight, control.Entry) != 0) {
             // reading from log failed, mark as non existent in output
@@ -97,6 +97,9 @@ static void telemRadioRxTask(void *parameters);
 static void PPMInputTask(void *parameters);
 static int32_t UAVTalkSendHandler(uint8_t *buf, int32_t length);
 static int32_t RadioSendHandler(uint8_t *buf, int32_t length);
+static int32_t UAVTalkRelayHandler(const UAVTalkFragment *fragments, uint8_t count);
+static int32_t RadioRelayHandler(const UAVTalkFragment *fragments, uint8_t count);
+static int32_t SendFragments(uint32_t outputPort, const UAVTalkFragment *fragments, uint8_t count);
 static void ProcessTelemetryStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t *rxbuffer, uint8_t count);
 static void ProcessRadioStream(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle, uint8_t *rxbuffer, uint8_t count);
 static void objectPersistenceUpdatedCb(UAVObjEvent *objEv);
@@ -227,6 +230,10 @@ static int32_t RadioComBridgeInitialize(void)
     data->telemUAVTalkCon    = UAVTalkInitialize(&UAVTalkSendHandler);
     data->radioUAVTalkCon    = UAVTalkInitialize(&RadioSendHandler);
 
+    // Relayed packets go straight from the receive buffers to the com ports
+    UAVTalkSetRelayStream(data->telemUAVTalkCon, &UAVTalkRelayHandler);
+    UAVTalkSetRelayStream(data->radioUAVTalkCon, &RadioRelayHandler);
+
     // Initialize the queues.
     data->uavtalkEventQueue  = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(UAVObjEvent));
     data->radioEventQueue    = xQueueCreate(EVENT_QUEUE_SIZE, sizeof(UAVObjEvent));
@@ -532,6 +539,80 @@ static int32_t RadioSendHandler(uint8_t *buf, int32_t length)
     }
 }
 
+/**
+ * @brief Pass a packet relayed from the radio through to the GCS port.
+ *
+ * @param[in] fragments Pieces of the packet
+ * @param[in] count Number of pieces
+ * @return -1 on failure
+ * @return number of bytes transmitted on success
+ */
+static int32_t UAVTalkRelayHandler(const UAVTalkFragment *fragments, uint8_t count)
+{
+    uint32_t outputPort = PIOS_COM_GCS;
+
+#if defined(PIOS_INCLUDE_USB)
+    // Determine output port (USB takes priority over telemetry port)
+    if (PIOS_COM_HID && PIOS_COM_Available(PIOS_COM_HID)) {
+        outputPort = PIOS_COM_HID;
+    }
+#endif /* PIOS_INCLUDE_USB */
+    if (outputPort) {
+        return SendFragments(outputPort, fragments, count);
+    }
+    return -1;
+}
+
+/**
+ * @brief Pass a packet relayed from the GCS through to the radio port.
+ *
+ * @param[in] fragments Pieces of the packet
+ * @param[in] count Number of pieces
+ * @return -1 on failure
+ * @return number of bytes transmitted on success
+ */
+static int32_t RadioRelayHandler(const UAVTalkFragment *fragments, uint8_t count)
+{
+    uint32_t outputPort = PIOS_COM_GCS_OUT;
+
+    // Don't send any data unless the radio port is available.
+    if (outputPort && PIOS_COM_Available(outputPort)) {
+        return SendFragments(outputPort, fragments, count);
+    }
+    return -1;
+}
+
+/**
+ * @brief Put the pieces of a packet into the transmit buffer of a port in one go.
+ *
+ * @param[in] outputPort The com port
+ * @param[in] fragments Pieces of the packet, at most three
+ * @param[in] count Number of pieces
+ * @return -1 on failure
+ * @return number of bytes transmitted on success
+ */
+static int32_t SendFragments(uint32_t outputPort, const UAVTalkFragment *fragments, uint8_t count)
+{
+    struct pios_com_vector vector[3];
+
+    if (count > NELEMENTS(vector)) {
+        return -1;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        vector[i].data = fragments[i].data;
+        vector[i].len  = fragments[i].length;
+    }
+
+    // Following call can fail with -2 error code (buffer full) or -3 error code (could not acquire send mutex)
+    // It is the caller responsibility to retry in such cases...
+    int32_t ret   = -2;
+    uint8_t tries = 5;
+    while (tries-- > 0 && ret < -1) {
+        ret = PIOS_COM_SendVectorNonBlocking(outputPort, vector, count);
+    }
+    return ret;
+}
+
 /**
  * @brief Process a byte of data received on the telemetry stream
  *
@@ -620,7 +701,8 @@ static void ProcessRadioStream(UAVTalkConnection inConnectionHandle, UAVTalkConn
                 UAVTalkReceiveObject(inConnectionHandle);
                 break;
             default:
-                // all other packets are relayed to the telemetry port
+                // all other packets are relayed to the telemetry port, the flight side
+                // never puts the objects above into multi-object or delta frames
                 UAVTalkRelayPacket(inConnectionHandle, outConnectionHandle);
                 break;
             }
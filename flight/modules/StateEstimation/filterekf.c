@@ -59,6 +59,7 @@
 
 // Private types
 struct data {
+    insgps_context       *ins;
     EKFConfigurationData ekfConfiguration;
     HomeLocationData     homeLocation;
 
@@ -91,6 +92,7 @@ static int32_t globalInit(stateFilter *handle, bool usePos, bool navOnly)
     handle->filter    = &filter;
     handle->localdata = pios_malloc(sizeof(struct data));
     struct data *this = (struct data *)handle->localdata;
+    this->ins         = NULL;
     this->usePos      = usePos;
     this->navOnly     = navOnly;
     EKFConfigurationInitialize();
@@ -137,6 +139,14 @@ static int32_t init(stateFilter *self)
 {
     struct data *this = (struct data *)self->localdata;
 
+    // the filter state is only allocated once its chain is selected, every filter instance gets its own
+    if (!this->ins) {
+        this->ins = pios_malloc(ins_context_size());
+        if (!this->ins) {
+            return 2;
+        }
+    }
+
     this->inited       = false;
     this->init_stage   = 0;
     this->work.updated = 0;
@@ -186,6 +196,7 @@ static int32_t init(stateFilter *self)
 static filterResult filter(stateFilter *self, stateEstimation *state)
 {
     struct data *this    = (struct data *)self->localdata;
+    const struct NavStruct *nav = ins_get_nav(this->ins);
 
     const float zeros[3] = { 0.0f, 0.0f, 0.0f };
 
@@ -193,8 +204,8 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
     float dT;
     uint16_t sensors = 0;
 
-    INSSetArmed(state->armed);
-    INSSetMagNorth(this->homeLocation.Be);
+    ins_set_armed(this->ins, state->armed);
+    ins_set_mag_north(this->ins, this->homeLocation.Be);
     state->navUsed      = (this->usePos || this->navOnly);
     this->work.updated |= state->updated;
     // check magnetometer alarm, discard any magnetometer readings if not OK
@@ -233,29 +244,29 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
         // Don't initialize until all sensors are read
         if (this->init_stage == 0) {
             // Reset the INS algorithm
-            INSGPSInit();
+            ins_init(this->ins);
             // variance is measured in mGaus, but internally the EKF works with a normalized  vector. Scale down by Be^2
-            INSSetMagVar((float[3]) { this->ekfConfiguration.R.MagX,
-                                      this->ekfConfiguration.R.MagY,
-                                      this->ekfConfiguration.R.MagZ }
-                         );
-            INSSetAccelVar((float[3]) { this->ekfConfiguration.Q.AccelX,
-                                        this->ekfConfiguration.Q.AccelY,
-                                        this->ekfConfiguration.Q.AccelZ }
-                           );
-            INSSetGyroVar((float[3]) { this->ekfConfiguration.Q.GyroX,
-                                       this->ekfConfiguration.Q.GyroY,
-                                       this->ekfConfiguration.Q.GyroZ }
-                          );
-            INSSetGyroBiasVar((float[3]) { this->ekfConfiguration.Q.GyroDriftX,
-                                           this->ekfConfiguration.Q.GyroDriftY,
-                                           this->ekfConfiguration.Q.GyroDriftZ }
-                              );
-            INSSetBaroVar(this->ekfConfiguration.R.BaroZ);
+            ins_set_mag_var(this->ins, (float[3]) { this->ekfConfiguration.R.MagX,
+                                                    this->ekfConfiguration.R.MagY,
+                                                    this->ekfConfiguration.R.MagZ }
+                                       );
+            ins_set_accel_var(this->ins, (float[3]) { this->ekfConfiguration.Q.AccelX,
+                                                      this->ekfConfiguration.Q.AccelY,
+                                                      this->ekfConfiguration.Q.AccelZ }
+                                         );
+            ins_set_gyro_var(this->ins, (float[3]) { this->ekfConfiguration.Q.GyroX,
+                                                     this->ekfConfiguration.Q.GyroY,
+                                                     this->ekfConfiguration.Q.GyroZ }
+                                        );
+            ins_set_gyro_bias_var(this->ins, (float[3]) { this->ekfConfiguration.Q.GyroDriftX,
+                                                          this->ekfConfiguration.Q.GyroDriftY,
+                                                          this->ekfConfiguration.Q.GyroDriftZ }
+                                             );
+            ins_set_baro_var(this->ins, this->ekfConfiguration.R.BaroZ);
 
             // Initialize the gyro bias
             float gyro_bias[3] = { 0.0f, 0.0f, 0.0f };
-            INSSetGyroBias(gyro_bias);
+            ins_set_gyro_bias(this->ins, gyro_bias);
 
             AttitudeStateData attitudeState;
             AttitudeStateGet(&attitudeState);
@@ -285,33 +296,33 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
 
             RPY2Quaternion(&attitudeState.Roll, this->work.attitude);
 
-            INSSetState(this->work.pos, (float *)zeros, this->work.attitude, (float *)zeros, (float *)zeros);
+            ins_set_state(this->ins, this->work.pos, (float *)zeros, this->work.attitude, (float *)zeros, (float *)zeros);
 
-            INSResetP(EKFConfigurationPToArray(this->ekfConfiguration.P));
+            ins_reset_p(this->ins, EKFConfigurationPToArray(this->ekfConfiguration.P));
         } else {
             // Run prediction a bit before any corrections
 
             float gyros[3] = { DEG2RAD(this->work.gyro[0]), DEG2RAD(this->work.gyro[1]), DEG2RAD(this->work.gyro[2]) };
-            INSStatePrediction(gyros, this->work.accel, dT);
+            ins_state_prediction(this->ins, gyros, this->work.accel, dT);
 
             // Copy the attitude into the state
             // NOTE: updating gyr correctly is valid, because this code is reached only when SENSORUPDATES_gyro is already true
             if (!this->navOnly) {
-                state->attitude[0] = Nav.q[0];
-                state->attitude[1] = Nav.q[1];
-                state->attitude[2] = Nav.q[2];
-                state->attitude[3] = Nav.q[3];
-
-                state->gyro[0]    -= RAD2DEG(Nav.gyro_bias[0]);
-                state->gyro[1]    -= RAD2DEG(Nav.gyro_bias[1]);
-                state->gyro[2]    -= RAD2DEG(Nav.gyro_bias[2]);
+                state->attitude[0] = nav->q[0];
+                state->attitude[1] = nav->q[1];
+                state->attitude[2] = nav->q[2];
+                state->attitude[3] = nav->q[3];
+
+                state->gyro[0]    -= RAD2DEG(nav->gyro_bias[0]);
+                state->gyro[1]    -= RAD2DEG(nav->gyro_bias[1]);
+                state->gyro[2]    -= RAD2DEG(nav->gyro_bias[2]);
             }
-            state->pos[0]   = Nav.Pos[0];
-            state->pos[1]   = Nav.Pos[1];
-            state->pos[2]   = Nav.Pos[2];
-            state->vel[0]   = Nav.Vel[0];
-            state->vel[1]   = Nav.Vel[1];
-            state->vel[2]   = Nav.Vel[2];
+            state->pos[0]   = nav->Pos[0];
+            state->pos[1]   = nav->Pos[1];
+            state->pos[2]   = nav->Pos[2];
+            state->vel[0]   = nav->Vel[0];
+            state->vel[1]   = nav->Vel[1];
+            state->vel[2]   = nav->Vel[2];
             state->updated |= SENSORUPDATES_attitude | SENSORUPDATES_pos | SENSORUPDATES_vel;
         }
 
@@ -331,34 +342,34 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
     float gyros[3] = { DEG2RAD(this->work.gyro[0]), DEG2RAD(this->work.gyro[1]), DEG2RAD(this->work.gyro[2]) };
 
     // Advance the state estimate
-    INSStatePrediction(gyros, this->work.accel, dT);
+    ins_state_prediction(this->ins, gyros, this->work.accel, dT);
 
     // Copy the attitude into the state
     // NOTE: updating gyr correctly is valid, because this code is reached only when SENSORUPDATES_gyro is already true
     if (!this->navOnly) {
-        state->attitude[0] = Nav.q[0];
-        state->attitude[1] = Nav.q[1];
-        state->attitude[2] = Nav.q[2];
-        state->attitude[3] = Nav.q[3];
-        state->gyro[0]    -= RAD2DEG(Nav.gyro_bias[0]);
-        state->gyro[1]    -= RAD2DEG(Nav.gyro_bias[1]);
-        state->gyro[2]    -= RAD2DEG(Nav.gyro_bias[2]);
+        state->attitude[0] = nav->q[0];
+        state->attitude[1] = nav->q[1];
+        state->attitude[2] = nav->q[2];
+        state->attitude[3] = nav->q[3];
+        state->gyro[0]    -= RAD2DEG(nav->gyro_bias[0]);
+        state->gyro[1]    -= RAD2DEG(nav->gyro_bias[1]);
+        state->gyro[2]    -= RAD2DEG(nav->gyro_bias[2]);
     }
     {
         float tmp[3];
-        Quaternion2RPY(Nav.q, tmp);
+        Quaternion2RPY(nav->q, tmp);
         state->debugNavYaw = tmp[2];
     }
-    state->pos[0]   = Nav.Pos[0];
-    state->pos[1]   = Nav.Pos[1];
-    state->pos[2]   = Nav.Pos[2];
-    state->vel[0]   = Nav.Vel[0];
-    state->vel[1]   = Nav.Vel[1];
-    state->vel[2]   = Nav.Vel[2];
+    state->pos[0]   = nav->Pos[0];
+    state->pos[1]   = nav->Pos[1];
+    state->pos[2]   = nav->Pos[2];
+    state->vel[0]   = nav->Vel[0];
+    state->vel[1]   = nav->Vel[1];
+    state->vel[2]   = nav->Vel[2];
     state->updated |= SENSORUPDATES_attitude | SENSORUPDATES_pos | SENSORUPDATES_vel;
 
     // Advance the covariance estimate
-    INSCovariancePrediction(dT);
+    ins_covariance_prediction(this->ins, dT);
 
     if (IS_SET(this->work.updated, SENSORUPDATES_mag)) {
         sensors |= MAG_SENSORS;
@@ -369,7 +380,7 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
             float R[3][3];
 
             // 1. rotate down vector into body frame
-            Quaternion2R(Nav.q, R);
+            Quaternion2R(nav->q, R);
             float local_down[3];
             rot_mult(R, (float[3]) { 0, 0, 1 }, local_down);
             // 2. create a rotation vector that is perpendicular to rotated down vector, magnetic field vector and of size magLockAlpha
@@ -403,22 +414,22 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
 
     if (!this->usePos) {
         // position and velocity variance used in indoor mode
-        INSSetPosVelVar((float[3]) { this->ekfConfiguration.FakeR.FakeGPSPosIndoor,
-                                     this->ekfConfiguration.FakeR.FakeGPSPosIndoor,
-                                     this->ekfConfiguration.FakeR.FakeGPSPosIndoor },
-                        (float[3]) { this->ekfConfiguration.FakeR.FakeGPSVelIndoor,
-                                     this->ekfConfiguration.FakeR.FakeGPSVelIndoor,
-                                     this->ekfConfiguration.FakeR.FakeGPSVelIndoor }
-                        );
+        ins_set_pos_vel_var(this->ins, (float[3]) { this->ekfConfiguration.FakeR.FakeGPSPosIndoor,
+                                                    this->ekfConfiguration.FakeR.FakeGPSPosIndoor,
+                                                    this->ekfConfiguration.FakeR.FakeGPSPosIndoor },
+                                       (float[3]) { this->ekfConfiguration.FakeR.FakeGPSVelIndoor,
+                                                    this->ekfConfiguration.FakeR.FakeGPSVelIndoor,
+                                                    this->ekfConfiguration.FakeR.FakeGPSVelIndoor }
+                                       );
     } else {
         // position and velocity variance used in outdoor mode
-        INSSetPosVelVar((float[3]) { this->ekfConfiguration.R.GPSPosNorth,
-                                     this->ekfConfiguration.R.GPSPosEast,
-                                     this->ekfConfiguration.R.GPSPosDown },
-                        (float[3]) { this->ekfConfiguration.R.GPSVelNorth,
-                                     this->ekfConfiguration.R.GPSVelEast,
-                                     this->ekfConfiguration.R.GPSVelDown }
-                        );
+        ins_set_pos_vel_var(this->ins, (float[3]) { this->ekfConfiguration.R.GPSPosNorth,
+                                                    this->ekfConfiguration.R.GPSPosEast,
+                                                    this->ekfConfiguration.R.GPSPosDown },
+                                       (float[3]) { this->ekfConfiguration.R.GPSVelNorth,
+                                                    this->ekfConfiguration.R.GPSVelEast,
+                                                    this->ekfConfiguration.R.GPSVelDown }
+                                       );
     }
 
     if (IS_SET(this->work.updated, SENSORUPDATES_pos)) {
@@ -432,16 +443,16 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
     if (IS_SET(this->work.updated, SENSORUPDATES_airspeed) && ((!IS_SET(this->work.updated, SENSORUPDATES_vel) && !IS_SET(this->work.updated, SENSORUPDATES_pos)) | !this->usePos)) {
         // HACK: feed airspeed into EKF as velocity, treat wind as 1e2 variance
         sensors |= HORIZ_SENSORS | VERT_SENSORS;
-        INSSetPosVelVar((float[3]) { this->ekfConfiguration.FakeR.FakeGPSPosIndoor,
-                                     this->ekfConfiguration.FakeR.FakeGPSPosIndoor,
-                                     this->ekfConfiguration.FakeR.FakeGPSPosIndoor },
-                        (float[3]) { this->ekfConfiguration.FakeR.FakeGPSVelAirspeed,
-                                     this->ekfConfiguration.FakeR.FakeGPSVelAirspeed,
-                                     this->ekfConfiguration.FakeR.FakeGPSVelAirspeed }
-                        );
+        ins_set_pos_vel_var(this->ins, (float[3]) { this->ekfConfiguration.FakeR.FakeGPSPosIndoor,
+                                                    this->ekfConfiguration.FakeR.FakeGPSPosIndoor,
+                                                    this->ekfConfiguration.FakeR.FakeGPSPosIndoor },
+                                       (float[3]) { this->ekfConfiguration.FakeR.FakeGPSVelAirspeed,
+                                                    this->ekfConfiguration.FakeR.FakeGPSVelAirspeed,
+                                                    this->ekfConfiguration.FakeR.FakeGPSVelAirspeed }
+                                       );
         // rotate airspeed vector into NED frame - airspeed is measured in X axis only
         float R[3][3];
-        Quaternion2R(Nav.q, R);
+        Quaternion2R(nav->q, R);
         float vtas[3] = { this->work.airspeed[1], 0.0f, 0.0f };
         rot_mult(R, vtas, this->work.vel);
     }
@@ -451,17 +462,18 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
      * although probably should occur within INS itself
      */
     if (sensors) {
-        INSCorrection(this->work.mag, this->work.pos, this->work.vel, this->work.baro[0], sensors);
+        ins_correction(this->ins, this->work.mag, this->work.pos, this->work.vel, this->work.baro[0], sensors);
     }
 
     EKFStateVarianceData vardata;
     EKFStateVarianceGet(&vardata);
-    INSGetVariance(EKFStateVariancePToArray(vardata.P));
+    ins_get_variance(this->ins, EKFStateVariancePToArray(vardata.P));
+    ins_get_innovation_stats(this->ins, EKFStateVarianceNISToArray(vardata.NIS), EKFStateVarianceInnovationRMSToArray(vardata.InnovationRMS));
     EKFStateVarianceSet(&vardata);
     int t;
     for (t = 0; t < EKFSTATEVARIANCE_P_NUMELEM; t++) {
         if (!IS_REAL(EKFStateVariancePToArray(vardata.P)[t]) || EKFStateVariancePToArray(vardata.P)[t] <= 0.0f) {
-            INSResetP(EKFConfigurationPToArray(this->ekfConfiguration.P));
+            ins_reset_p(this->ins, EKFConfigurationPToArray(this->ekfConfiguration.P));
             this->init_stage = -1;
             break;
         }
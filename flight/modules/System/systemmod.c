@@ -57,6 +57,7 @@
 #include <taskinfo.h>
 #include <watchdogstatus.h>
 #include <callbackinfo.h>
+#include <callbacktiming.h>
 #include <hwsettings.h>
 #include <pios_flashfs.h>
 #include <pios_notify.h>
@@ -114,6 +115,7 @@ static void checkSettingsUpdatedCb(UAVObjEvent *ev);
 #ifdef DIAG_TASKS
 static void taskMonitorForEachCallback(uint16_t task_id, const struct pios_task_info *task_info, void *context);
 static void callbackSchedulerForEachCallback(int16_t callback_id, const struct pios_callback_info *callback_info, void *context);
+static void callbackSchedulerForEachCallbackTiming(int16_t callback_id, const struct pios_callback_timing *timing, void *context);
 #endif
 static void updateStats();
 static void updateSystemAlarms();
@@ -166,6 +168,7 @@ int32_t SystemModInitialize(void)
 #ifdef DIAG_TASKS
     TaskInfoInitialize();
     CallbackInfoInitialize();
+    CallbackTimingInitialize();
 #endif
 #ifdef DIAG_I2C_WDG_STATS
     I2CStatsInitialize();
@@ -274,6 +277,8 @@ static void systemTask(__attribute__((unused)) void *parameters)
         // Update the callback status object
         PIOS_CALLBACKSCHEDULER_ForEachCallback(callbackSchedulerForEachCallback, &callbackInfoData);
         CallbackInfoSet(&callbackInfoData);
+        // Update the callback timing instances
+        PIOS_CALLBACKSCHEDULER_ForEachCallbackTiming(callbackSchedulerForEachCallbackTiming, NULL);
 #endif
 
         UAVObjEvent ev;
@@ -512,6 +517,30 @@ static void callbackSchedulerForEachCallback(int16_t callback_id, const struct p
     ((uint32_t *)&callbackData->RunningTime)[callback_id]   = callback_info->running_time_count;
     ((int16_t *)&callbackData->StackRemaining)[callback_id] = callback_info->stack_remaining;
 }
+
+static void callbackSchedulerForEachCallbackTiming(int16_t callback_id, const struct pios_callback_timing *timing, __attribute__((unused)) void *context)
+{
+    CallbackTimingData timingData;
+
+    if (callback_id < 0) {
+        return;
+    }
+    // Same mapping as for CallbackInfo, one CallbackTiming instance per callback_id
+    uint16_t numInstances;
+    while ((numInstances = UAVObjGetNumInstances(CallbackTimingHandle())) <= callback_id) {
+        CallbackTimingCreateInstance();
+        if (UAVObjGetNumInstances(CallbackTimingHandle()) == numInstances) {
+            return; // out of memory
+        }
+    }
+    PIOS_STATIC_ASSERT(CALLBACKTIMING_LATENCYHISTOGRAM_NUMELEM == PIOS_CALLBACKSCHEDULER_HISTOGRAM_BINS);
+    memcpy(timingData.LatencyHistogram, timing->latency_histogram, sizeof(timingData.LatencyHistogram));
+    memcpy(timingData.ExecutionHistogram, timing->execution_histogram, sizeof(timingData.ExecutionHistogram));
+    timingData.LatencyMax     = timing->latency_max;
+    timingData.ExecutionMax   = timing->execution_max;
+    timingData.DeadlineMisses = timing->deadline_misses;
+    CallbackTimingInstSet(callback_id, &timingData);
+}
 #endif /* ifdef DIAG_TASKS */
 
 /**
@@ -711,12 +740,20 @@ static void updateSystemAlarms()
         AlarmsClear(SYSTEMALARMS_ALARM_EVENTSYSTEM);
     }
 
+    SystemStatsData sysStats;
+    SystemStatsGet(&sysStats);
+    SystemStatsData oldStats = sysStats;
     if (objStats.lastCallbackErrorID || objStats.lastQueueErrorID || evStats.lastErrorID) {
-        SystemStatsData sysStats;
-        SystemStatsGet(&sysStats);
         sysStats.EventSystemWarningID    = evStats.lastErrorID;
         sysStats.ObjectManagerCallbackID = objStats.lastCallbackErrorID;
         sysStats.ObjectManagerQueueID    = objStats.lastQueueErrorID;
+    }
+    // How late the periodic events were dispatched since the last update
+    sysStats.EventSystemMaxLateness   = (evStats.latenessMaxMs > 0xFFFF) ? 0xFFFF : evStats.latenessMaxMs;
+    sysStats.EventSystemLateID        = evStats.latenessMaxID;
+    sysStats.EventSystemMissedPeriods = evStats.missedPeriods;
+    // Only publish when something changed, to not cause needless updates
+    if (memcmp(&oldStats, &sysStats, sizeof(SystemStatsData)) != 0) {
         SystemStatsSet(&sysStats);
     }
 
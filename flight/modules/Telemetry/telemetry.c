@@ -4,7 +4,7 @@
  * @{
  * @addtogroup TelemetryModule Telemetry Module
  * @brief Main telemetry module
- * Starts three tasks (RX, TX, and priority TX) that watch event queues
+ * Starts the RX and TX tasks that watch event queues
  * and handle all the telemetry of the UAVobjects
  * @{
  *
@@ -49,15 +49,43 @@
  * Associated with each instance is a transmit routine which will send data
  * to the appropriate port.
  *
- * Data is passed on the telemetry channels using queues. If
- * PIOS_TELEM_PRIORITY_QUEUE is defined then two queues are created, one normal
- * priority and the other high priority.
+ * Data is passed on the telemetry channels using queues, one per priority
+ * class (UAVObjTelemetryClass) if PIOS_TELEM_PRIORITY_QUEUE is defined and a
+ * single one otherwise. The class of an object comes from its metadata, or
+ * from its type when the metadata leave it to the default: settings, meta
+ * and manually updated objects are bulk, priority objects high and all the
+ * others normal.
  *
- * The "Tx" tasks read events first from the priority queue and then from
- * the normal queue, passing each event to processObjEvent() which ultimately
+ * The "Tx" tasks serve the queues in strict priority order, except that a
+ * lower class which waited longer than its aging limit gets one event through
+ * ahead of the others, passing each event to processObjEvent() which ultimately
  * passes each event to the UAVTalk library which results in the appropriate
  * transmit routine being called to send the data back to the recipient on
- * the "local" or "radio" link.
+ * the "local" or "radio" link. The high and normal classes hold at most one
+ * pending event per object instance and type, later updates are merged into
+ * it as the data are only read when the event is processed, and when their
+ * queue is full they drop their oldest event, the freshest state being the
+ * one that matters. Bulk transfers keep every event and drop the new one
+ * when full, the requester retries it.
+ *
+ * Each channel keeps a transmit budget, a token bucket refilled at the link
+ * rate estimated from the transmit buffer of its port. The periodic updates
+ * of objects that are neither priority nor acked are skipped when they would
+ * eat into the last quarter of the budget, so that they give way first when
+ * the link is saturated. TelemetrySchedulerStats reports the outcome.
+ *
+ * When the GCS supports timestamped packets, each "Tx" task sends a
+ * TelemetryProbe once per second with the tick count in its UAVTalk header,
+ * and the GCS answers with a TelemetryProbeEcho carrying the timestamp back.
+ * The echoes give the round trip time and the uplink jitter and reordering,
+ * the GCS measures the downlink ones, and TelemetryLinkStats reports them
+ * along with the queue depths of both sides.
+ *
+ * Each channel can follow a telemetry profile selected in TelemetrySettings,
+ * a preset of update periods that overrides the metadata of the objects it
+ * lists and can stop the periodic updates of the others. The "Tx" task of
+ * the channel switches to a new profile between two events, reconnecting
+ * all the objects in one pass.
  */
 
 #include <openpilot.h>
@@ -66,8 +94,30 @@
 
 #include "flighttelemetrystats.h"
 #include "gcstelemetrystats.h"
+#include "gcstelemetryfeatures.h"
+#include "telemetryschedulerstats.h"
+#include "telemetrylinkstats.h"
+#include "telemetryprobe.h"
+#include "telemetryprobeecho.h"
+#include "telemetrysettings.h"
 #include "hwsettings.h"
 #include "taskinfo.h"
+#include "oplinkreceiver.h"
+#include "oplinksettings.h"
+#include "oplinkstatus.h"
+// Objects of the telemetry profiles
+#include "actuatorcommand.h"
+#include "actuatordesired.h"
+#include "attitudestate.h"
+#include "flightbatterystate.h"
+#include "gpspositionsensor.h"
+#include "gyrostate.h"
+#include "manualcontrolcommand.h"
+#include "positionstate.h"
+#include "stabilizationdesired.h"
+#include "systemalarms.h"
+#include "systemstats.h"
+#include "velocitystate.h"
 
 #include <pios_board_io.h>
 
@@ -98,28 +148,153 @@
 #define MAX_RETRIES               2
 #define STATS_UPDATE_PERIOD_MS    4000
 #define CONNECTION_TIMEOUT_MS     8000
+// Packets that fit in one receive buffer are parsed in one go by UAVTalk
+#ifdef PIOS_TELEM_RX_BUFFER_SIZE
+#define RX_BUFFER_SIZE            PIOS_TELEM_RX_BUFFER_SIZE
+#elif defined(STM32F10X)
+#define RX_BUFFER_SIZE            16
+#else
+#define RX_BUFFER_SIZE            64
+#endif
+
+// Transmit budget, see budgetRefill()
+#define BUDGET_ESTIMATE_PERIOD_MS 250
+#define BUDGET_BURST_MS           250
+#define BUDGET_MIN_BURST          256
+#define BUDGET_MIN_RATE           100
+#define BUDGET_MAX_RATE           64000
+// Header and checksum of a single object packet
+#define BUDGET_PACKET_OVERHEAD    13
+#define MAX_DEGRADED_OBJECTS      TELEMETRYSCHEDULERSTATS_OBJECTID_NUMELEM
+
+// Round trip probes, see probeSend()
+#define PROBE_PERIOD_MS           1000
+#define PROBE_INSTANCE_RADIO      0
+#define PROBE_INSTANCE_LOCAL      1
 
 #ifdef PIOS_INCLUDE_RFM22B
 #define HAS_RADIO
 #endif
 
+// Transmit queues, see classQueue()
+#ifdef PIOS_TELEM_PRIORITY_QUEUE
+#define NUM_CLASSES               (TELEMETRYCLASS_BULK - TELEMETRYCLASS_HIGH + 1)
+#else
+#define NUM_CLASSES               1
+#endif
+
 // Private types
+
+// Transmit budget of a channel, a token bucket refilled at the estimated link rate
+typedef struct {
+    // Port the estimate applies to
+    uint32_t port;
+    // Bytes that may be sent now, goes negative by up to one packet
+    int32_t  tokens;
+    // Estimated link rate in bytes/s
+    uint32_t rate;
+    // Fraction of a token left over by the last refill, in 1/1000 bytes
+    uint32_t refillCarry;
+    uint32_t refillTime;
+    uint32_t estimateTime;
+    // Bytes handed to the port since the last estimate
+    uint32_t written;
+    // Bytes waiting in the transmit buffer at the last estimate
+    uint16_t backlog;
+    // Updates were skipped since the last estimate
+    bool     limited;
+    // Totals since the last stats update
+    uint32_t sentBytes;
+    uint32_t skippedBytes;
+    uint32_t skippedUpdates;
+} channelBudget;
+
+// Periodic updates of an object that were skipped, counted from the first skip
+typedef struct {
+    UAVObjHandle obj;
+    uint32_t     since;
+    uint16_t     requested;
+    uint16_t     sent;
+} degradedObject;
+
+// Round trip probes of a channel, the echoes are handled by probeEchoReceived()
+typedef struct {
+    // TelemetryProbe/TelemetryProbeEcho instance of the channel
+    uint16_t instId;
+    uint16_t sequence;
+    uint32_t sendTime;
+    // Highest sequence echoed
+    uint16_t echoSequence;
+    // Transit time of the last echo, flight clock minus GCS clock
+    uint16_t uplinkTransit;
+    // RFC 3550 interarrival jitter estimate of the echoes, in 1/16 ms
+    uint32_t uplinkJitter;
+    // Totals since the last stats update
+    uint32_t rttSum;
+    uint16_t rttCount;
+    uint16_t rttMin;
+    uint16_t rttMax;
+    uint32_t uplinkReordered;
+    uint32_t lost;
+    // Counted by the GCS since the connection, see probeStats()
+    uint32_t downlinkReordered;
+    uint32_t downlinkReorderedReported;
+} channelProbe;
+
+// Update period of an object in a telemetry profile
+typedef struct {
+    uint32_t objId;
+    // 0 disables the telemetry updates of the object
+    uint16_t periodMs;
+} profileEntry;
+
+// Telemetry profile, see profileOverride()
+typedef struct {
+    const profileEntry *entries;
+    uint8_t numEntries;
+    // The periodic updates of the objects not listed are disabled
+    bool    periodicOff;
+} telemetryProfile;
+
+// Service of a priority class
+typedef struct {
+    // Longest wait before the class is served ahead of the higher ones
+    uint16_t maxWaitMs;
+    // What to drop when the queue is full
+    UAVObjDropPolicy dropPolicy;
+    // Merge the updates of an object instance while one is pending
+    bool coalesce;
+} classPolicy;
+
 typedef struct {
     // Determine port on which to communicate telemetry information
     uint32_t (*getPort)();
-    // Main telemetry queue
-    xQueueHandle queue;
-
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-    // Priority telemetry queue
-    xQueueHandle priorityQueue;
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
+    // Telemetry queues, one per priority class, highest first
+    xQueueHandle queue[NUM_CLASSES];
+    // Object events of the queues are batched
+    UAVObjBatchHandle batch[NUM_CLASSES];
+    // Last time each class was served or found empty, see nextEvent()
+    uint32_t servedTime[NUM_CLASSES];
+    // Queue counters at the last stats update, see queueStats()
+    uint32_t superseded;
+    uint32_t overflows;
 
     // Transmit/receive task handles
     xTaskHandle txTaskHandle;
     xTaskHandle rxTaskHandle;
     // Telemetry stream
     UAVTalkConnection uavTalkCon;
+    // Transmit budget of the link, guarded by budgetLock as the "Rx" task
+    // sends too (acks and object replies)
+    channelBudget budget;
+    xSemaphoreHandle budgetLock;
+    // Objects whose periodic updates were skipped since the last stats update
+    degradedObject degraded[MAX_DEGRADED_OBJECTS];
+    // Round trip probes of the link
+    channelProbe probe;
+    // Profile in use and the one selected in TelemetrySettings, see profileApply()
+    const telemetryProfile *profile;
+    volatile uint8_t profileSelected;
 } channelContext;
 
 #ifdef HAS_RADIO
@@ -139,11 +314,60 @@ static void registerRadioObject(UAVObjHandle obj);
 static uint32_t radioPort();
 static uint32_t radio_port;
 
+#ifdef PIOS_TELEM_PRIORITY_QUEUE
+static const classPolicy classPolicies[NUM_CLASSES] = {
+    { .maxWaitMs = 0,   .dropPolicy = UAVOBJ_DROP_OLDEST, .coalesce = true  }, // TELEMETRYCLASS_HIGH
+    { .maxWaitMs = 100, .dropPolicy = UAVOBJ_DROP_OLDEST, .coalesce = true  }, // TELEMETRYCLASS_NORMAL
+    { .maxWaitMs = 500, .dropPolicy = UAVOBJ_DROP_NEWEST, .coalesce = false }, // TELEMETRYCLASS_BULK
+};
+#else
+static const classPolicy classPolicies[NUM_CLASSES] = {
+    { .maxWaitMs = 0,   .dropPolicy = UAVOBJ_DROP_NEWEST, .coalesce = false },
+};
+#endif
+
+static const profileEntry tuningEntries[] = {
+    { ATTITUDESTATE_OBJID,        50  },
+    { GYROSTATE_OBJID,            50  },
+    { STABILIZATIONDESIRED_OBJID, 50  },
+    { ACTUATORDESIRED_OBJID,      50  },
+    { ACTUATORCOMMAND_OBJID,      100 },
+    { MANUALCONTROLCOMMAND_OBJID, 100 },
+};
+
+static const profileEntry cruiseEntries[] = {
+    { ATTITUDESTATE_OBJID,      250  },
+    { POSITIONSTATE_OBJID,      500  },
+    { VELOCITYSTATE_OBJID,      500  },
+    { GPSPOSITIONSENSOR_OBJID,  1000 },
+    { FLIGHTBATTERYSTATE_OBJID, 1000 },
+};
+
+// Alarms and the connection state only raise EV_UPDATED, they must stay periodic
+static const profileEntry minimalEntries[] = {
+    { ATTITUDESTATE_OBJID,        1000  },
+    { POSITIONSTATE_OBJID,        2000  },
+    { GPSPOSITIONSENSOR_OBJID,    5000  },
+    { FLIGHTBATTERYSTATE_OBJID,   5000  },
+    { SYSTEMSTATS_OBJID,          10000 },
+    { SYSTEMALARMS_OBJID,         1000  },
+    { FLIGHTTELEMETRYSTATS_OBJID, 5000  },
+};
+
+// Indexed by TelemetrySettingsProfileOptions
+static const telemetryProfile telemetryProfiles[] = {
+    [TELEMETRYSETTINGS_PROFILE_METADATA] = { .entries = NULL,           .numEntries = 0,                          .periodicOff = false },
+    [TELEMETRYSETTINGS_PROFILE_TUNING]   = { .entries = tuningEntries,  .numEntries = NELEMENTS(tuningEntries),  .periodicOff = false },
+    [TELEMETRYSETTINGS_PROFILE_CRUISE]   = { .entries = cruiseEntries,  .numEntries = NELEMENTS(cruiseEntries),  .periodicOff = false },
+    [TELEMETRYSETTINGS_PROFILE_MINIMAL]  = { .entries = minimalEntries, .numEntries = NELEMENTS(minimalEntries), .periodicOff = true  },
+};
 
 // Telemetry stats
 static uint32_t txErrors;
 static uint32_t txRetries;
 static uint32_t timeOfLastObjectUpdate;
+static uint32_t timeOfLastSchedulerStats;
+static bool probing;
 
 static void telemetryTxTask(void *parameters);
 static void telemetryRxTask(void *parameters);
@@ -157,13 +381,38 @@ static void processObjEvent(
 static int32_t setUpdatePeriod(
     channelContext *channel,
     UAVObjHandle obj,
+    uint8_t queueIdx,
     int32_t updatePeriodMs);
 static int32_t setLoggingPeriod(
     channelContext *channel,
     UAVObjHandle obj,
+    uint8_t queueIdx,
+    int32_t updatePeriodMs);
+static int32_t setPeriod(
+    channelContext *channel,
+    UAVObjEvent *ev,
+    uint8_t queueIdx,
     int32_t updatePeriodMs);
 static void updateTelemetryStats();
+static void updateSchedulerStats();
 static void gcsTelemetryStatsUpdated();
+static void budgetRefill(channelContext *channel);
+static bool budgetSkip(channelContext *channel, UAVObjHandle obj, UAVObjMetadata *metadata);
+static void budgetCharge(channelContext *channel, int32_t length);
+static void degradedStats(channelContext *channel, uint32_t timeNow, TelemetrySchedulerStatsData *stats, uint8_t *numObjects);
+static uint8_t classQueue(UAVObjHandle obj, const UAVObjMetadata *metadata);
+static bool modemObject(UAVObjHandle obj);
+static bool nextEvent(channelContext *channel, UAVObjEvent *ev);
+static bool receiveEvent(xQueueHandle queue, UAVObjBatchHandle batch, UAVObjEvent *ev, portTickType timeout);
+static void queueStats(channelContext *channel, uint32_t *superseded, uint32_t *overflows);
+static uint16_t queueHighWater(channelContext *channel);
+static void probeSend(channelContext *channel);
+static void probeEchoReceived(UAVObjEvent *ev);
+static void probeStats(channelContext *channel, TelemetryLinkStatsData *stats, uint8_t element);
+static void updateLinkStats();
+static void telemetrySettingsUpdated(UAVObjEvent *ev);
+static void profileApply(channelContext *channel);
+static void profileOverride(channelContext *channel, UAVObjHandle obj, UAVObjMetadata *metadata);
 
 /**
  * Initialise the telemetry module
@@ -178,11 +427,7 @@ int32_t TelemetryStart(void)
         UAVObjIterate(&registerLocalObject);
 
         // Listen to objects of interest
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-        GCSTelemetryStatsConnectQueue(localChannel.priorityQueue);
-#else /* PIOS_TELEM_PRIORITY_QUEUE */
-        GCSTelemetryStatsConnectQueue(localChannel.queue);
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
+        GCSTelemetryStatsConnectQueue(localChannel.queue[0]);
         // Start telemetry tasks
         xTaskCreate(telemetryTxTask,
                     "TelTx",
@@ -207,11 +452,7 @@ int32_t TelemetryStart(void)
     UAVObjIterate(&registerRadioObject);
 
     // Listen to objects of interest
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-    GCSTelemetryStatsConnectQueue(radioChannel.priorityQueue);
-#else /* PIOS_TELEM_PRIORITY_QUEUE */
-    GCSTelemetryStatsConnectQueue(radioChannel.queue);
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
+    GCSTelemetryStatsConnectQueue(radioChannel.queue[0]);
 
     xTaskCreate(telemetryTxTask,
                 "RadioTx",
@@ -237,27 +478,32 @@ int32_t TelemetryStart(void)
 void TelemetryInitializeChannel(channelContext *channel)
 {
     // Create object queues
-    channel->queue = xQueueCreate(MAX_QUEUE_SIZE,
-                                  sizeof(UAVObjEvent));
+    for (uint8_t i = 0; i < NUM_CLASSES; i++) {
+        channel->queue[i] = xQueueCreate(MAX_QUEUE_SIZE,
+                                         sizeof(UAVObjEvent));
+        channel->batch[i] = UAVObjBatchCreate(channel->queue[i], MAX_QUEUE_SIZE);
+        PIOS_Assert(channel->batch[i]);
+        UAVObjBatchSetDropPolicy(channel->batch[i], classPolicies[i].dropPolicy);
+        UAVObjBatchSetCoalescing(channel->batch[i], classPolicies[i].coalesce);
+    }
 
-#if defined(PIOS_TELEM_PRIORITY_QUEUE)
-    channel->priorityQueue = xQueueCreate(MAX_QUEUE_SIZE,
-                                          sizeof(UAVObjEvent));
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
+    // The transmit budget starts at the configured baud rate if any, see updateSettings()
+    if (channel->budget.rate == 0) {
+        channel->budget.rate = BUDGET_MAX_RATE;
+    }
+    channel->budget.tokens       = BUDGET_MIN_BURST;
+    channel->budget.refillTime   = xTaskGetTickCount() * portTICK_RATE_MS;
+    channel->budget.estimateTime = channel->budget.refillTime;
+    channel->budgetLock = xSemaphoreCreateMutex();
+    PIOS_Assert(channel->budgetLock);
 
     // Create periodic event that will be used to update the telemetry stats
     UAVObjEvent ev;
     memset(&ev, 0, sizeof(UAVObjEvent));
 
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
     EventPeriodicQueueCreate(&ev,
-                             channel->priorityQueue,
+                             channel->queue[0],
                              STATS_UPDATE_PERIOD_MS);
-#else /* PIOS_TELEM_PRIORITY_QUEUE */
-    EventPeriodicQueueCreate(&ev,
-                             channel->queue,
-                             STATS_UPDATE_PERIOD_MS);
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
 }
 
 /**
@@ -286,6 +532,12 @@ int32_t TelemetryInitialize(void)
 
     FlightTelemetryStatsInitialize();
     GCSTelemetryStatsInitialize();
+    GCSTelemetryFeaturesInitialize();
+    TelemetrySchedulerStatsInitialize();
+    TelemetryLinkStatsInitialize();
+    TelemetryProbeInitialize();
+    TelemetryProbeEchoInitialize();
+    TelemetrySettingsInitialize();
 
     // Initialize vars
     timeOfLastObjectUpdate = 0;
@@ -293,6 +545,7 @@ int32_t TelemetryInitialize(void)
     // Reset link stats
     txErrors  = 0;
     txRetries = 0;
+    probing   = false;
 
 #ifdef HAS_RADIO
     // Set channel port handlers
@@ -307,6 +560,10 @@ int32_t TelemetryInitialize(void)
         TelemetryInitializeChannel(&localChannel);
         // Initialise UAVTalk
         localChannel.uavTalkCon = UAVTalkInitialize(&transmitLocalData);
+        // The local channel probes with its own instance
+        TelemetryProbeCreateInstance();
+        TelemetryProbeEchoCreateInstance();
+        localChannel.probe.instId = PROBE_INSTANCE_LOCAL;
     }
 #endif /* ifdef HAS_RADIO */
 
@@ -320,6 +577,18 @@ int32_t TelemetryInitialize(void)
     TelemetryInitializeChannel(&radioChannel);
     // Initialise UAVTalk
     radioChannel.uavTalkCon = UAVTalkInitialize(&transmitRadioData);
+    radioChannel.probe.instId = PROBE_INSTANCE_RADIO;
+
+    // Echoes are timed as they are unpacked, in the receive task
+    UAVObjConnectCallback(TelemetryProbeEchoHandle(), probeEchoReceived, EV_UNPACKED, true);
+
+    // The profiles apply from the start, the objects are registered with them
+    telemetrySettingsUpdated(NULL);
+#ifdef HAS_RADIO
+    localChannel.profile = &telemetryProfiles[localChannel.profileSelected];
+#endif
+    radioChannel.profile = &telemetryProfiles[radioChannel.profileSelected];
+    TelemetrySettingsConnectCallback(&telemetrySettingsUpdated);
 
     return 0;
 }
@@ -336,11 +605,7 @@ static void registerLocalObject(UAVObjHandle obj)
 {
     if (UAVObjIsMetaobject(obj)) {
         // Only connect change notifications for meta objects.  No periodic updates
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-        UAVObjConnectQueue(obj, localChannel.priorityQueue, EV_MASK_ALL_UPDATES);
-#else /* PIOS_TELEM_PRIORITY_QUEUE */
-        UAVObjConnectQueue(obj, localChannel.queue, EV_MASK_ALL_UPDATES);
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
+        UAVObjConnectQueue(obj, localChannel.queue[classQueue(obj, NULL)], EV_MASK_ALL_UPDATES);
     } else {
         // Setup object for periodic updates
         updateObject(
@@ -355,11 +620,7 @@ static void registerRadioObject(UAVObjHandle obj)
 {
     if (UAVObjIsMetaobject(obj)) {
         // Only connect change notifications for meta objects.  No periodic updates
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-        UAVObjConnectQueue(obj, radioChannel.priorityQueue, EV_MASK_ALL_UPDATES);
-#else /* PIOS_TELEM_PRIORITY_QUEUE */
-        UAVObjConnectQueue(obj, radioChannel.queue, EV_MASK_ALL_UPDATES);
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
+        UAVObjConnectQueue(obj, radioChannel.queue[classQueue(obj, NULL)], EV_MASK_ALL_UPDATES);
     } else {
         // Setup object for periodic updates
         updateObject(
@@ -382,6 +643,7 @@ static void updateObject(
     UAVObjMetadata metadata;
     UAVObjUpdateMode updateMode, loggingMode;
     int32_t eventMask;
+    uint8_t queueIdx;
 
     if (UAVObjIsMetaobject(obj)) {
         // This function updates the periodic updates for the object.
@@ -392,8 +654,10 @@ static void updateObject(
 
     // Get metadata
     UAVObjGetMetadata(obj, &metadata);
+    profileOverride(channel, obj, &metadata);
     updateMode  = UAVObjGetTelemetryUpdateMode(&metadata);
     loggingMode = UAVObjGetLoggingUpdateMode(&metadata);
+    queueIdx    = classQueue(obj, &metadata);
 
     // Setup object depending on update mode
     eventMask   = 0;
@@ -402,13 +666,14 @@ static void updateObject(
         // Set update period
         setUpdatePeriod(channel,
                         obj,
+                        queueIdx,
                         metadata.telemetryUpdatePeriod);
         // Connect queue
         eventMask |= EV_UPDATED_PERIODIC | EV_UPDATED_MANUAL | EV_UPDATE_REQ;
         break;
     case UPDATEMODE_ONCHANGE:
         // Set update period
-        setUpdatePeriod(channel, obj, 0);
+        setUpdatePeriod(channel, obj, queueIdx, 0);
         // Connect queue
         eventMask |= EV_UPDATED | EV_UPDATED_MANUAL | EV_UPDATE_REQ;
         break;
@@ -420,6 +685,7 @@ static void updateObject(
             if (eventType == EV_NONE) {
                 setUpdatePeriod(channel,
                                 obj,
+                                queueIdx,
                                 metadata.telemetryUpdatePeriod);
             }
         } else {
@@ -429,7 +695,7 @@ static void updateObject(
         break;
     case UPDATEMODE_MANUAL:
         // Set update period
-        setUpdatePeriod(channel, obj, 0);
+        setUpdatePeriod(channel, obj, queueIdx, 0);
         // Connect queue
         eventMask |= EV_UPDATED_MANUAL | EV_UPDATE_REQ;
         break;
@@ -437,13 +703,13 @@ static void updateObject(
     switch (loggingMode) {
     case UPDATEMODE_PERIODIC:
         // Set update period
-        setLoggingPeriod(channel, obj, metadata.loggingUpdatePeriod);
+        setLoggingPeriod(channel, obj, queueIdx, metadata.loggingUpdatePeriod);
         // Connect queue
         eventMask |= EV_LOGGING_PERIODIC | EV_LOGGING_MANUAL;
         break;
     case UPDATEMODE_ONCHANGE:
         // Set update period
-        setLoggingPeriod(channel, obj, 0);
+        setLoggingPeriod(channel, obj, queueIdx, 0);
         // Connect queue
         eventMask |= EV_UPDATED | EV_LOGGING_MANUAL;
         break;
@@ -455,6 +721,7 @@ static void updateObject(
             if (eventType == EV_NONE) {
                 setLoggingPeriod(channel,
                                  obj,
+                                 queueIdx,
                                  metadata.loggingUpdatePeriod);
             }
         } else {
@@ -464,20 +731,20 @@ static void updateObject(
         break;
     case UPDATEMODE_MANUAL:
         // Set update period
-        setLoggingPeriod(channel, obj, 0);
+        setLoggingPeriod(channel, obj, queueIdx, 0);
         // Connect queue
         eventMask |= EV_LOGGING_MANUAL;
         break;
     }
 
-    // note that all setting objects have implicitly IsPriority=true
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-    if (UAVObjIsPriority(obj)) {
-        UAVObjConnectQueue(obj, channel->priorityQueue, eventMask);
-    } else
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
-
-    UAVObjConnectQueue(obj, channel->queue, eventMask);
+    // Connect the queue of the object's class, the class may have changed with the metadata
+    for (uint8_t i = 0; i < NUM_CLASSES; i++) {
+        if (i == queueIdx) {
+            UAVObjConnectQueue(obj, channel->queue[i], eventMask);
+        } else if (eventType == EV_NONE) {
+            UAVObjDisconnectQueue(obj, channel->queue[i]);
+        }
+    }
 }
 
 
@@ -500,21 +767,37 @@ static void processObjEvent(
     } else {
         // Get object metadata
         UAVObjGetMetadata(ev->obj, &metadata);
+        profileOverride(channel, ev->obj, &metadata);
         updateMode = UAVObjGetTelemetryUpdateMode(&metadata);
 
         // Act on event
         retries    = 0;
         success    = -1;
-        if ((ev->event == EV_UPDATED && (updateMode == UPDATEMODE_ONCHANGE || updateMode == UPDATEMODE_THROTTLED))
+        if (ev->event == EV_UPDATED_PERIODIC && updateMode == UPDATEMODE_PERIODIC
+            && budgetSkip(channel, ev->obj, &metadata)) {
+            // Over the budget of the link, the update waits for the next period
+        } else if ((ev->event == EV_UPDATED && (updateMode == UPDATEMODE_ONCHANGE || updateMode == UPDATEMODE_THROTTLED))
             || ev->event == EV_UPDATED_MANUAL
             || (ev->event == EV_UPDATED_PERIODIC && updateMode != UPDATEMODE_THROTTLED)) {
             // Send update to GCS (with retries)
             while (retries < MAX_RETRIES && success == -1) {
-                // call blocks until ack is received or timeout
-                success = UAVTalkSendObject(channel->uavTalkCon,
-                                            ev->obj,
-                                            ev->instId,
-                                            UAVObjGetTelemetryAcked(&metadata), REQ_TIMEOUT_MS);
+                if (UAVObjGetTelemetryAcked(&metadata)) {
+                    // does not wait for the ack, UAVTalkProcessTransactions() handles the timeouts
+                    success = UAVTalkSendObjectPipelined(channel->uavTalkCon,
+                                                         ev->obj,
+                                                         ev->instId,
+                                                         REQ_TIMEOUT_MS, MAX_RETRIES - 1);
+                } else if (modemObject(ev->obj)) {
+                    success = UAVTalkSendObject(channel->uavTalkCon,
+                                                ev->obj,
+                                                ev->instId,
+                                                0, 0);
+                } else {
+                    // packed with other objects when the GCS supports it, see telemetryTxTask()
+                    success = UAVTalkSendObjectAggregated(channel->uavTalkCon,
+                                                          ev->obj,
+                                                          ev->instId);
+                }
                 if (success == -1) {
                     ++retries;
                 }
@@ -527,11 +810,11 @@ static void processObjEvent(
         } else if (ev->event == EV_UPDATE_REQ) {
             // Request object update from GCS (with retries)
             while (retries < MAX_RETRIES && success == -1) {
-                // call blocks until update is received or timeout
-                success = UAVTalkSendObjectRequest(channel->uavTalkCon,
-                                                   ev->obj,
-                                                   ev->instId,
-                                                   REQ_TIMEOUT_MS);
+                // does not wait for the update, UAVTalkProcessTransactions() handles the timeouts
+                success = UAVTalkSendObjectRequestPipelined(channel->uavTalkCon,
+                                                            ev->obj,
+                                                            ev->instId,
+                                                            REQ_TIMEOUT_MS, MAX_RETRIES - 1);
                 if (success == -1) {
                     ++retries;
                 }
@@ -599,35 +882,138 @@ static void telemetryTxTask(void *parameters)
 
     // Loop forever
     while (1) {
-        /**
-         * Tries to empty the high priority queue before handling any standard priority item
-         */
+        // Resend the acked objects and requests that timed out
+        UAVTalkProcessTransactions(channel->uavTalkCon);
 
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-        // empty priority queue, non-blocking
-        while (xQueueReceive(channel->priorityQueue, &ev, 0) == pdTRUE) {
-            // Process event
-            processObjEvent(channel, &ev);
+        if (probing) {
+            probeSend(channel);
         }
-        // check regular queue and process update - non-blocking
-        if (xQueueReceive(channel->queue, &ev, 0) == pdTRUE) {
-            // Process event
-            processObjEvent(channel, &ev);
-            // if both queues are empty, wait on priority queue for updates (1 tick) then repeat cycle
-        } else if (xQueueReceive(channel->priorityQueue, &ev, 1) == pdTRUE) {
-            // Process event
-            processObjEvent(channel, &ev);
+
+        // Switch to a newly selected profile before anything else is sent
+        if (channel->profile != &telemetryProfiles[channel->profileSelected]) {
+            profileApply(channel);
         }
-#else
-        // wait on queue for updates (1 tick) then repeat cycle
-        if (xQueueReceive(channel->queue, &ev, 1) == pdTRUE) {
+
+        // check the queues by priority and process update - non-blocking
+        if (nextEvent(channel, &ev)) {
             // Process event
             processObjEvent(channel, &ev);
+        } else {
+            // all queues are empty, send the aggregated objects before waiting
+            UAVTalkFlushAggregated(channel->uavTalkCon);
+            // wait on the highest priority queue for updates (1 tick) then repeat cycle
+            if (receiveEvent(channel->queue[0], channel->batch[0], &ev, 1)) {
+                // Process event
+                processObjEvent(channel, &ev);
+            }
         }
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
     }
 }
 
+/**
+ * Map an object to the queue of its telemetry priority class, see UAVObjTelemetryClass.
+ * \param[in] obj The object
+ * \param[in] metadata The metadata of the object, NULL for meta objects
+ * \return The queue index, 0 being the highest priority
+ */
+static uint8_t classQueue(UAVObjHandle obj, const UAVObjMetadata *metadata)
+{
+    UAVObjTelemetryClass telemetryClass = TELEMETRYCLASS_BULK;
+
+    if (metadata) {
+        telemetryClass = UAVObjGetTelemetryClass(metadata);
+    }
+    if (telemetryClass == TELEMETRYCLASS_DEFAULT) {
+        // note that all setting objects have implicitly IsPriority=true, check them first
+        if (UAVObjIsSettings(obj) || UAVObjGetTelemetryUpdateMode(metadata) == UPDATEMODE_MANUAL) {
+            telemetryClass = TELEMETRYCLASS_BULK;
+        } else if (UAVObjIsPriority(obj)) {
+            telemetryClass = TELEMETRYCLASS_HIGH;
+        } else {
+            telemetryClass = TELEMETRYCLASS_NORMAL;
+        }
+    }
+    uint8_t queueIdx = telemetryClass - TELEMETRYCLASS_HIGH;
+    // Without enough queues the lowest classes share the last one
+    return (queueIdx < NUM_CLASSES) ? queueIdx : NUM_CLASSES - 1;
+}
+
+/**
+ * Objects that an OPLink modem picks out of the radio stream by the object ID
+ * of the frame. They must not go into multi-object or delta frames, which the
+ * modem relays to the other side whole.
+ * \param[in] obj The object
+ * \return true if the object is always sent in a frame of its own
+ */
+static bool modemObject(UAVObjHandle obj)
+{
+    switch (UAVObjGetID(obj)) {
+    case OPLINKSTATUS_OBJID:
+    case OPLINKSETTINGS_OBJID:
+    case OPLINKRECEIVER_OBJID:
+    case MetaObjectId(OPLINKSTATUS_OBJID):
+    case MetaObjectId(OPLINKSETTINGS_OBJID):
+    case MetaObjectId(OPLINKRECEIVER_OBJID):
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * Get the next event to transmit, strict priority with aging: the highest
+ * class with events pending is served, unless a lower class was kept waiting
+ * longer than its classPolicies limit, in which case it goes first once.
+ * \return true if an event was received
+ */
+static bool nextEvent(channelContext *channel, UAVObjEvent *ev)
+{
+    uint32_t now = xTaskGetTickCount() * portTICK_RATE_MS;
+    uint8_t i;
+
+    for (i = 1; i < NUM_CLASSES; i++) {
+        if (now - channel->servedTime[i] >= classPolicies[i].maxWaitMs) {
+            // An empty queue restarts the wait as well
+            channel->servedTime[i] = now;
+            if (receiveEvent(channel->queue[i], channel->batch[i], ev, 0)) {
+                return true;
+            }
+        }
+    }
+    for (i = 0; i < NUM_CLASSES; i++) {
+        if (receiveEvent(channel->queue[i], channel->batch[i], ev, 0)) {
+            channel->servedTime[i] = now;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Get the next event of a telemetry queue. Object events are taken from the
+ * batch first, the queue itself carries the batch wake up messages as well
+ * as the periodic events.
+ * \return true if an event was received
+ */
+static bool receiveEvent(xQueueHandle queue, UAVObjBatchHandle batch, UAVObjEvent *ev, portTickType timeout)
+{
+    if (UAVObjBatchReceive(batch, ev)) {
+        return true;
+    }
+    while (xQueueReceive(queue, ev, timeout) == pdTRUE) {
+        if (ev->event != EV_BATCH_READY) {
+            return true;
+        }
+        if (UAVObjBatchReceive(batch, ev)) {
+            return true;
+        }
+        // Stale wake up, the batch was drained already
+        timeout = 0;
+    }
+    return false;
+}
 
 /**
  * Telemetry receive task. Processes queue events and periodic updates.
@@ -647,7 +1033,7 @@ static void telemetryRxTask(void *parameters)
 
         if (inputPort) {
             // Block until data are available
-            uint8_t serial_data[16];
+            uint8_t serial_data[RX_BUFFER_SIZE];
             uint16_t bytes_to_process;
 
             bytes_to_process = PIOS_COM_ReceiveBuffer(inputPort, serial_data, sizeof(serial_data), 500);
@@ -703,7 +1089,11 @@ static int32_t transmitLocalData(uint8_t *data, int32_t length)
     uint32_t outputPort = localChannel.getPort();
 
     if (outputPort) {
-        return PIOS_COM_SendBuffer(outputPort, data, length);
+        int32_t ret = PIOS_COM_SendBuffer(outputPort, data, length);
+        if (ret >= 0) {
+            budgetCharge(&localChannel, length);
+        }
+        return ret;
     }
 
     return -1;
@@ -722,7 +1112,11 @@ static int32_t transmitRadioData(uint8_t *data, int32_t length)
     uint32_t outputPort = radioChannel.getPort();
 
     if (outputPort) {
-        return PIOS_COM_SendBuffer(outputPort, data, length);
+        int32_t ret = PIOS_COM_SendBuffer(outputPort, data, length);
+        if (ret >= 0) {
+            budgetCharge(&radioChannel, length);
+        }
+        return ret;
     }
 
     return -1;
@@ -732,6 +1126,7 @@ static int32_t transmitRadioData(uint8_t *data, int32_t length)
  * Set update period of object (it must be already setup for periodic updates)
  * \param[in] telemetry channel context
  * \param[in] obj The object to update
+ * \param[in] queueIdx The queue of the object's class
  * \param[in] updatePeriodMs The update period in ms, if zero then periodic updates are disabled
  * \return 0 Success
  * \return -1 Failure
@@ -739,10 +1134,10 @@ static int32_t transmitRadioData(uint8_t *data, int32_t length)
 static int32_t setUpdatePeriod(
     channelContext *channel,
     UAVObjHandle obj,
+    uint8_t queueIdx,
     int32_t updatePeriodMs)
 {
     UAVObjEvent ev;
-    int32_t ret;
 
     // Add or update object for periodic updates
     ev.obj    = obj;
@@ -750,24 +1145,14 @@ static int32_t setUpdatePeriod(
     ev.event  = EV_UPDATED_PERIODIC;
     ev.lowPriority = true;
 
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-    xQueueHandle targetQueue = UAVObjIsPriority(obj) ? channel->priorityQueue :
-                               channel->queue;
-#else /* PIOS_TELEM_PRIORITY_QUEUE */
-    xQueueHandle targetQueue = channel->queue;
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
-
-    ret = EventPeriodicQueueUpdate(&ev, targetQueue, updatePeriodMs);
-    if (ret == -1) {
-        ret = EventPeriodicQueueCreate(&ev, targetQueue, updatePeriodMs);
-    }
-    return ret;
+    return setPeriod(channel, &ev, queueIdx, updatePeriodMs);
 }
 
 /**
  * Set logging update period of object (it must be already setup for periodic updates)
  * \param[in] telemetry channel context
  * \param[in] obj The object to update
+ * \param[in] queueIdx The queue of the object's class
  * \param[in] updatePeriodMs The update period in ms, if zero then periodic updates are disabled
  * \return 0 Success
  * \return -1 Failure
@@ -775,10 +1160,10 @@ static int32_t setUpdatePeriod(
 static int32_t setLoggingPeriod(
     channelContext *channel,
     UAVObjHandle obj,
+    uint8_t queueIdx,
     int32_t updatePeriodMs)
 {
     UAVObjEvent ev;
-    int32_t ret;
 
     // Add or update object for periodic updates
     ev.obj    = obj;
@@ -786,16 +1171,36 @@ static int32_t setLoggingPeriod(
     ev.event  = EV_LOGGING_PERIODIC;
     ev.lowPriority = true;
 
-#ifdef PIOS_TELEM_PRIORITY_QUEUE
-    xQueueHandle targetQueue = UAVObjIsPriority(obj) ? channel->priorityQueue :
-                               channel->queue;
-#else /* PIOS_TELEM_PRIORITY_QUEUE */
-    xQueueHandle targetQueue = channel->queue;
-#endif /* PIOS_TELEM_PRIORITY_QUEUE */
+    return setPeriod(channel, &ev, queueIdx, updatePeriodMs);
+}
 
-    ret = EventPeriodicQueueUpdate(&ev, targetQueue, updatePeriodMs);
-    if (ret == -1) {
-        ret = EventPeriodicQueueCreate(&ev, targetQueue, updatePeriodMs);
+/**
+ * Set the period of a periodic event on the queue of the object's class
+ * \param[in] telemetry channel context
+ * \param[in] ev The periodic event
+ * \param[in] queueIdx The queue of the object's class
+ * \param[in] updatePeriodMs The update period in ms, if zero then periodic updates are disabled
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t setPeriod(
+    channelContext *channel,
+    UAVObjEvent *ev,
+    uint8_t queueIdx,
+    int32_t updatePeriodMs)
+{
+    int32_t ret = -1;
+
+    for (uint8_t i = 0; i < NUM_CLASSES; i++) {
+        if (i == queueIdx) {
+            ret = EventPeriodicQueueUpdate(ev, channel->queue[i], updatePeriodMs);
+            if (ret == -1) {
+                ret = EventPeriodicQueueCreate(ev, channel->queue[i], updatePeriodMs);
+            }
+        } else {
+            // Left over from an earlier class of the object, if any
+            EventPeriodicQueueUpdate(ev, channel->queue[i], 0);
+        }
     }
     return ret;
 }
@@ -825,8 +1230,12 @@ static void updateTelemetryStats()
     UAVTalkStats utalkStats;
     FlightTelemetryStatsData flightStats;
     GCSTelemetryStatsData gcsStats;
+    uint8_t oldStatus;
+    uint8_t features;
     uint8_t forceUpdate;
     uint8_t connectionTimeout;
+    bool aggregate;
+    bool delta;
     uint32_t timeNow;
 
     // Get stats
@@ -844,8 +1253,8 @@ static void updateTelemetryStats()
     if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
         flightStats.TxDataRate    = (float)utalkStats.txBytes / ((float)STATS_UPDATE_PERIOD_MS / 1000.0f);
         flightStats.TxBytes      += utalkStats.txBytes;
-        flightStats.TxFailures   += txErrors;
-        flightStats.TxRetries    += txRetries;
+        flightStats.TxFailures   += txErrors + utalkStats.txTransactionsFailed;
+        flightStats.TxRetries    += txRetries + utalkStats.txRetries;
 
         flightStats.RxDataRate    = (float)utalkStats.rxBytes / ((float)STATS_UPDATE_PERIOD_MS / 1000.0f);
         flightStats.RxBytes      += utalkStats.rxBytes;
@@ -880,6 +1289,7 @@ static void updateTelemetryStats()
 
     // Update connection state
     forceUpdate = 1;
+    oldStatus   = flightStats.Status;
     if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED) {
         // Wait for connection request
         if (gcsStats.Status == GCSTELEMETRYSTATS_STATUS_HANDSHAKEREQ) {
@@ -908,8 +1318,35 @@ static void updateTelemetryStats()
         AlarmsClear(SYSTEMALARMS_ALARM_TELEMETRY);
     }
 
+    // Forget the features of the last GCS when the connection drops, a GCS
+    // that does not know GCSTelemetryFeatures never sends it
+    GCSTelemetryFeaturesFeaturesGet(&features);
+    if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED && oldStatus != FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED) {
+        features = 0;
+        GCSTelemetryFeaturesFeaturesSet(&features);
+    }
+
+    // Use the protocol features both sides support once connected
+    features &= UAVTALK_FEATURES;
+    aggregate = flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED
+                && (features & UAVTALK_FEATURE_MULTI_OBJECT);
+    UAVTalkSetAggregation(radioChannel.uavTalkCon, aggregate);
+#ifdef HAS_RADIO
+    UAVTalkSetAggregation(localChannel.uavTalkCon, aggregate);
+#endif
+    delta = flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED
+            && (features & UAVTALK_FEATURE_DELTA);
+    UAVTalkSetDeltaEncoding(radioChannel.uavTalkCon, delta);
+#ifdef HAS_RADIO
+    UAVTalkSetDeltaEncoding(localChannel.uavTalkCon, delta);
+#endif
+    probing = flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED
+              && (features & UAVTALK_FEATURE_TIMESTAMP);
+
     // Update object
     FlightTelemetryStatsSet(&flightStats);
+    updateSchedulerStats();
+    updateLinkStats();
 
     // Force telemetry update if not connected
     if (forceUpdate) {
@@ -934,30 +1371,476 @@ static void updateSettings(channelContext *channel)
         HwSettingsTelemetrySpeedGet(&speed);
 
         // Set port speed
+        uint32_t baud = 0;
         switch (speed) {
         case HWSETTINGS_TELEMETRYSPEED_2400:
-            PIOS_COM_ChangeBaud(port, 2400);
+            baud = 2400;
             break;
         case HWSETTINGS_TELEMETRYSPEED_4800:
-            PIOS_COM_ChangeBaud(port, 4800);
+            baud = 4800;
             break;
         case HWSETTINGS_TELEMETRYSPEED_9600:
-            PIOS_COM_ChangeBaud(port, 9600);
+            baud = 9600;
             break;
         case HWSETTINGS_TELEMETRYSPEED_19200:
-            PIOS_COM_ChangeBaud(port, 19200);
+            baud = 19200;
             break;
         case HWSETTINGS_TELEMETRYSPEED_38400:
-            PIOS_COM_ChangeBaud(port, 38400);
+            baud = 38400;
             break;
         case HWSETTINGS_TELEMETRYSPEED_57600:
-            PIOS_COM_ChangeBaud(port, 57600);
+            baud = 57600;
             break;
         case HWSETTINGS_TELEMETRYSPEED_115200:
-            PIOS_COM_ChangeBaud(port, 115200);
+            baud = 115200;
+            break;
+        }
+        if (baud) {
+            PIOS_COM_ChangeBaud(port, baud);
+            // First guess of the link rate, 10 bits per byte
+            channel->budget.rate = baud / 10;
+        }
+    }
+}
+
+/**
+ * Size of the bucket, enough for BUDGET_BURST_MS at the link rate
+ */
+static int32_t budgetBurst(channelBudget *budget)
+{
+    return MAX(budget->rate * BUDGET_BURST_MS / 1000, (uint32_t)BUDGET_MIN_BURST);
+}
+
+/**
+ * Refill the transmit budget of a channel and every BUDGET_ESTIMATE_PERIOD_MS
+ * re-estimate the link rate from the transmit buffer of its port. While the
+ * buffer keeps a backlog the port drains at the link rate. When it does not
+ * the link could take more, and the estimate is raised if updates had to be
+ * skipped in the meantime.
+ */
+static void budgetRefill(channelContext *channel)
+{
+    channelBudget *budget = &channel->budget;
+    uint32_t timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    uint32_t elapsed = timeNow - budget->refillTime;
+    int32_t burst    = budgetBurst(budget);
+
+    if (elapsed > 0) {
+        // A full second refills any burst and keeps the product in range
+        budget->refillCarry += budget->rate * MIN(elapsed, 1000);
+        budget->tokens      += budget->refillCarry / 1000;
+        budget->refillCarry %= 1000;
+        if (budget->tokens >= burst) {
+            budget->tokens = burst;
+            budget->refillCarry = 0;
+        }
+        budget->refillTime = timeNow;
+    }
+
+    elapsed = timeNow - budget->estimateTime;
+    if (elapsed < BUDGET_ESTIMATE_PERIOD_MS) {
+        return;
+    }
+
+    uint32_t port    = channel->getPort();
+    uint16_t size    = 0;
+    int32_t headroom = port ? PIOS_COM_TxHeadroom(port, &size) : -1;
+
+    if (headroom >= 0 && port == budget->port) {
+        uint16_t backlog  = size - headroom;
+        int32_t drained   = (int32_t)(budget->written + budget->backlog) - backlog;
+        uint32_t measured = (uint32_t)MAX(drained, 0) * 1000 / elapsed;
+
+        if (budget->backlog * 4 > size && backlog * 4 > size) {
+            // Busy throughout, the port drained at the link rate
+            budget->rate = (budget->rate + measured) / 2;
+        } else if (budget->limited) {
+            // Room to spare while updates were skipped, probe for more
+            budget->rate = MAX(budget->rate, measured) + budget->rate / 8;
+        }
+        budget->rate    = MIN(MAX(budget->rate, BUDGET_MIN_RATE), BUDGET_MAX_RATE);
+        budget->backlog = backlog;
+    } else {
+        // New port, or one without transmit buffer, start over
+        budget->port    = headroom >= 0 ? port : 0;
+        budget->backlog = headroom >= 0 ? size - headroom : 0;
+    }
+    budget->written = 0;
+    budget->limited = false;
+    budget->estimateTime = timeNow;
+}
+
+/**
+ * Decide whether a periodic update is skipped to stay within the budget of
+ * the channel. Only the objects that are neither priority nor acked are
+ * skipped, once less than a quarter of a burst is left.
+ * \return true if the update is to be skipped
+ */
+static bool budgetSkip(channelContext *channel, UAVObjHandle obj, UAVObjMetadata *metadata)
+{
+    channelBudget *budget = &channel->budget;
+    degradedObject *entry  = NULL;
+    degradedObject *unused = NULL;
+    bool skip;
+
+    if (UAVObjIsPriority(obj) || UAVObjGetTelemetryAcked(metadata)) {
+        return false;
+    }
+
+    xSemaphoreTake(channel->budgetLock, portMAX_DELAY);
+
+    budgetRefill(channel);
+    skip = budget->tokens * 4 < budgetBurst(budget);
+
+    // Follow the objects that were skipped since the last stats update
+    for (uint8_t n = 0; n < MAX_DEGRADED_OBJECTS; n++) {
+        if (channel->degraded[n].obj == obj) {
+            entry = &channel->degraded[n];
             break;
+        } else if (!channel->degraded[n].obj && !unused) {
+            unused = &channel->degraded[n];
         }
     }
+    if (!entry && skip && unused) {
+        entry = unused;
+        entry->since     = budget->refillTime;
+        entry->requested = 0;
+        entry->sent      = 0;
+        entry->obj       = obj;
+    }
+    if (entry) {
+        entry->requested++;
+        entry->sent += skip ? 0 : 1;
+    }
+
+    if (skip) {
+        budget->limited = true;
+        budget->skippedUpdates++;
+        budget->skippedBytes += (UAVObjGetNumBytes(obj) + BUDGET_PACKET_OVERHEAD) * UAVObjGetNumInstances(obj);
+    }
+
+    xSemaphoreGive(channel->budgetLock);
+    return skip;
+}
+
+/**
+ * Take the bytes handed to the port of a channel from its budget
+ */
+static void budgetCharge(channelContext *channel, int32_t length)
+{
+    xSemaphoreTake(channel->budgetLock, portMAX_DELAY);
+    channel->budget.tokens    -= length;
+    channel->budget.written   += length;
+    channel->budget.sentBytes += length;
+    xSemaphoreGive(channel->budgetLock);
+}
+
+/**
+ * Move the objects a channel skipped since the last stats update into the
+ * scheduler stats, after those already there, and start over. Called with
+ * the budget lock of the channel held.
+ * \param[in] channel The channel
+ * \param[in] timeNow Time of the stats update in ms
+ * \param[in,out] stats The scheduler stats
+ * \param[in,out] numObjects Number of objects in the stats
+ */
+static void degradedStats(channelContext *channel, uint32_t timeNow, TelemetrySchedulerStatsData *stats, uint8_t *numObjects)
+{
+    for (uint8_t n = 0; n < MAX_DEGRADED_OBJECTS; n++) {
+        degradedObject *entry = &channel->degraded[n];
+
+        if (entry->obj && *numObjects < MAX_DEGRADED_OBJECTS) {
+            float since = (float)MAX(timeNow - entry->since, 1u) / 1000.0f;
+            stats->ObjectID[*numObjects] = UAVObjGetID(entry->obj);
+            stats->ObjectRequestedRate[*numObjects] = (float)entry->requested / since;
+            stats->ObjectAchievedRate[*numObjects]  = (float)entry->sent / since;
+            ++*numObjects;
+        }
+        entry->obj = NULL;
+    }
+}
+
+/**
+ * Publish the requested and achieved rates of the channels and the objects
+ * skipped since the last call, and start over.
+ */
+static void updateSchedulerStats()
+{
+    TelemetrySchedulerStatsData stats;
+    uint32_t superseded, overflows;
+    uint32_t timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    float period     = (float)MAX(timeNow - timeOfLastSchedulerStats, 1u) / 1000.0f;
+    uint8_t numObjects = 0;
+
+    memset(&stats, 0, sizeof(stats));
+
+    queueStats(&radioChannel, &superseded, &overflows);
+    stats.SupersededUpdates.Radio = superseded;
+    stats.QueueOverflows.Radio    = overflows;
+    xSemaphoreTake(radioChannel.budgetLock, portMAX_DELAY);
+    stats.LinkRate.Radio       = radioChannel.budget.rate;
+    stats.AchievedRate.Radio   = (float)radioChannel.budget.sentBytes / period;
+    stats.RequestedRate.Radio  = (float)(radioChannel.budget.sentBytes + radioChannel.budget.skippedBytes) / period;
+    stats.SkippedUpdates.Radio = radioChannel.budget.skippedUpdates;
+    radioChannel.budget.sentBytes      = 0;
+    radioChannel.budget.skippedBytes   = 0;
+    radioChannel.budget.skippedUpdates = 0;
+    degradedStats(&radioChannel, timeNow, &stats, &numObjects);
+    xSemaphoreGive(radioChannel.budgetLock);
+#ifdef HAS_RADIO
+    // The local channel is only set up when its port is enabled
+    if (localChannel.budgetLock) {
+        queueStats(&localChannel, &superseded, &overflows);
+        stats.SupersededUpdates.Local = superseded;
+        stats.QueueOverflows.Local    = overflows;
+        xSemaphoreTake(localChannel.budgetLock, portMAX_DELAY);
+        stats.LinkRate.Local       = localChannel.budget.rate;
+        stats.AchievedRate.Local   = (float)localChannel.budget.sentBytes / period;
+        stats.RequestedRate.Local  = (float)(localChannel.budget.sentBytes + localChannel.budget.skippedBytes) / period;
+        stats.SkippedUpdates.Local = localChannel.budget.skippedUpdates;
+        localChannel.budget.sentBytes      = 0;
+        localChannel.budget.skippedBytes   = 0;
+        localChannel.budget.skippedUpdates = 0;
+        degradedStats(&localChannel, timeNow, &stats, &numObjects);
+        xSemaphoreGive(localChannel.budgetLock);
+    }
+#endif
+    timeOfLastSchedulerStats = timeNow;
+
+    TelemetrySchedulerStatsSet(&stats);
+}
+
+/**
+ * Count the events of the channel queues merged into pending ones or dropped
+ * since the last call.
+ */
+static void queueStats(channelContext *channel, uint32_t *superseded, uint32_t *overflows)
+{
+    UAVObjListenerStats listenerStats;
+    uint32_t supersededTotal = 0;
+    uint32_t overflowsTotal  = 0;
+
+    for (uint8_t i = 0; i < NUM_CLASSES; i++) {
+        if (UAVObjGetListenerStats(channel->queue[i], &listenerStats) == 0) {
+            supersededTotal += listenerStats.superseded;
+            overflowsTotal  += listenerStats.overflows;
+        }
+    }
+    // The counters restart from zero when the System module clears the object stats
+    *superseded = (supersededTotal >= channel->superseded) ? supersededTotal - channel->superseded : supersededTotal;
+    *overflows  = (overflowsTotal >= channel->overflows) ? overflowsTotal - channel->overflows : overflowsTotal;
+    channel->superseded = supersededTotal;
+    channel->overflows  = overflowsTotal;
+}
+
+/**
+ * Called when TelemetrySettings change, or with NULL on startup. The "Tx"
+ * tasks pick up the profiles selected, see profileApply().
+ */
+static void telemetrySettingsUpdated(__attribute__((unused)) UAVObjEvent *ev)
+{
+    TelemetrySettingsProfileData profile;
+
+    TelemetrySettingsProfileGet(&profile);
+    radioChannel.profileSelected = (profile.Radio < NELEMENTS(telemetryProfiles)) ? profile.Radio : TELEMETRYSETTINGS_PROFILE_METADATA;
+#ifdef HAS_RADIO
+    localChannel.profileSelected = (profile.Local < NELEMENTS(telemetryProfiles)) ? profile.Local : TELEMETRYSETTINGS_PROFILE_METADATA;
+#endif
+}
+
+/**
+ * Switch the channel to the profile selected, reconnecting all the objects
+ * in one pass so that the new update periods take effect together.
+ */
+static void profileApply(channelContext *channel)
+{
+    channel->profile = &telemetryProfiles[channel->profileSelected];
+
+#ifdef HAS_RADIO
+    if (channel == &localChannel) {
+        UAVObjIterate(&registerLocalObject);
+        return;
+    }
+#endif
+    UAVObjIterate(&registerRadioObject);
+}
+
+/**
+ * Apply the profile of the channel to the metadata of an object: the objects
+ * listed get the update period of the profile, periodic or disabled, and the
+ * periodic updates of the others may be disabled.
+ * \param[in] channel The channel
+ * \param[in] obj The object
+ * \param[in,out] metadata The metadata of the object, overridden in place
+ */
+static void profileOverride(channelContext *channel, UAVObjHandle obj, UAVObjMetadata *metadata)
+{
+    const telemetryProfile *profile = channel->profile;
+
+    if (!profile || (profile->numEntries == 0 && !profile->periodicOff) || UAVObjIsMetaobject(obj)) {
+        return;
+    }
+
+    uint32_t objId = UAVObjGetID(obj);
+    for (uint8_t i = 0; i < profile->numEntries; i++) {
+        if (profile->entries[i].objId == objId) {
+            uint16_t periodMs = profile->entries[i].periodMs;
+            UAVObjSetTelemetryUpdateMode(metadata, periodMs ? UPDATEMODE_PERIODIC : UPDATEMODE_MANUAL);
+            metadata->telemetryUpdatePeriod = periodMs;
+            return;
+        }
+    }
+    if (profile->periodicOff && UAVObjGetTelemetryUpdateMode(metadata) == UPDATEMODE_PERIODIC) {
+        UAVObjSetTelemetryUpdateMode(metadata, UPDATEMODE_MANUAL);
+    }
+}
+
+/**
+ * Highest number of events the channel queues held since the object stats
+ * were last cleared.
+ */
+static uint16_t queueHighWater(channelContext *channel)
+{
+    UAVObjListenerStats listenerStats;
+    uint16_t highWater = 0;
+
+    for (uint8_t i = 0; i < NUM_CLASSES; i++) {
+        if (UAVObjGetListenerStats(channel->queue[i], &listenerStats) == 0) {
+            highWater = MAX(highWater, listenerStats.highWater);
+        }
+    }
+    return highWater;
+}
+
+/**
+ * Send a round trip probe on the channel if one is due. It goes to UAVTalk
+ * directly rather than through the queues, so the round trip includes the
+ * transmit buffer of the port but not the scheduling of the objects.
+ */
+static void probeSend(channelContext *channel)
+{
+    channelProbe *probe = &channel->probe;
+    TelemetryProbeData data;
+    uint32_t timeNow    = xTaskGetTickCount() * portTICK_RATE_MS;
+
+    if (timeNow - probe->sendTime < PROBE_PERIOD_MS) {
+        return;
+    }
+    probe->sendTime = timeNow;
+
+    data.Sequence   = ++probe->sequence;
+    TelemetryProbeInstSet(probe->instId, &data);
+    // UAVTalk puts the tick count in the header, the echo carries it back
+    UAVTalkSendObjectTimestamped(channel->uavTalkCon, TelemetryProbeHandle(), probe->instId, 0, 0);
+}
+
+/**
+ * Account for a TelemetryProbeEcho, called by the receive task as the echo
+ * is unpacked so that its arrival time is not delayed by the scheduling.
+ */
+static void probeEchoReceived(UAVObjEvent *ev)
+{
+    uint16_t ticksNow = (uint16_t)xTaskGetTickCount();
+    channelProbe *probe;
+    TelemetryProbeEchoData echo;
+
+#ifdef HAS_RADIO
+    probe = (ev->instId == PROBE_INSTANCE_LOCAL) ? &localChannel.probe : &radioChannel.probe;
+#else
+    probe = &radioChannel.probe;
+#endif
+    if (ev->instId != probe->instId || TelemetryProbeEchoInstGet(ev->instId, &echo) != 0) {
+        return;
+    }
+
+    // The 16 bit clocks wrap, only the differences matter
+    uint16_t rtt     = (uint16_t)(ticksNow - echo.ProbeTimestamp) * portTICK_RATE_MS;
+    rtt = (rtt > echo.HoldTime) ? rtt - echo.HoldTime : 0;
+    probe->rttSum   += rtt;
+    probe->rttMin    = (probe->rttCount == 0) ? rtt : MIN(probe->rttMin, rtt);
+    probe->rttMax    = (probe->rttCount == 0) ? rtt : MAX(probe->rttMax, rtt);
+    probe->rttCount++;
+
+    // RFC 3550 A.8: J += (|D| - J) / 16, kept scaled by 16
+    uint16_t transit = (uint16_t)(ticksNow * portTICK_RATE_MS) - echo.EchoTime;
+    int16_t delta    = (int16_t)(transit - probe->uplinkTransit);
+    probe->uplinkTransit = transit;
+    if (probe->echoSequence != 0) {
+        probe->uplinkJitter += (uint32_t)((delta < 0) ? -delta : delta) - ((probe->uplinkJitter + 8) >> 4);
+    }
+
+    // Echoes come back in sequence unless the uplink reordered them, a
+    // repeated sequence number is a duplicate
+    int16_t gap = (int16_t)(echo.Sequence - probe->echoSequence);
+    if (gap > 0) {
+        probe->lost += gap - 1;
+        probe->echoSequence = echo.Sequence;
+    } else if (gap < 0) {
+        probe->uplinkReordered++;
+        // It was counted as lost when the later one arrived
+        if (probe->lost > 0) {
+            probe->lost--;
+        }
+    }
+
+    probe->downlinkReordered = echo.Reordered;
+}
+
+/**
+ * Fill one element of TelemetryLinkStats with the probes of the channel
+ * since the last call, and start over.
+ */
+static void probeStats(channelContext *channel, TelemetryLinkStatsData *stats, uint8_t element)
+{
+    channelProbe *probe = &channel->probe;
+    TelemetryProbeEchoData echo;
+    uint32_t downlinkReordered;
+
+    TelemetryProbeEchoInstGet(probe->instId, &echo);
+    // The GCS counts from zero again on each connection
+    downlinkReordered = (probe->downlinkReordered >= probe->downlinkReorderedReported) ?
+                        probe->downlinkReordered - probe->downlinkReorderedReported : probe->downlinkReordered;
+
+    TelemetryLinkStatsRoundTripTimeToArray(stats->RoundTripTime)[element]       = probe->rttCount ? (float)probe->rttSum / probe->rttCount : 0.0f;
+    TelemetryLinkStatsRoundTripTimeMinToArray(stats->RoundTripTimeMin)[element] = probe->rttMin;
+    TelemetryLinkStatsRoundTripTimeMaxToArray(stats->RoundTripTimeMax)[element] = probe->rttMax;
+    TelemetryLinkStatsUplinkJitterToArray(stats->UplinkJitter)[element]     = (float)probe->uplinkJitter / 16.0f;
+    TelemetryLinkStatsDownlinkJitterToArray(stats->DownlinkJitter)[element] = echo.Jitter;
+    TelemetryLinkStatsUplinkReorderedToArray(stats->UplinkReordered)[element]     = probe->uplinkReordered;
+    TelemetryLinkStatsDownlinkReorderedToArray(stats->DownlinkReordered)[element] = downlinkReordered;
+    TelemetryLinkStatsProbesLostToArray(stats->ProbesLost)[element] = probe->lost;
+    TelemetryLinkStatsUplinkQueueHighWaterToArray(stats->UplinkQueueHighWater)[element]     = echo.QueueHighWater;
+    TelemetryLinkStatsDownlinkQueueHighWaterToArray(stats->DownlinkQueueHighWater)[element] = queueHighWater(channel);
+
+    probe->downlinkReorderedReported = probe->downlinkReordered;
+    probe->rttSum          = 0;
+    probe->rttCount        = 0;
+    probe->rttMin          = 0;
+    probe->rttMax          = 0;
+    probe->uplinkReordered = 0;
+    probe->lost            = 0;
+}
+
+/**
+ * Publish the round trip measurements of the channels.
+ */
+static void updateLinkStats()
+{
+    TelemetryLinkStatsData stats;
+
+    if (!probing) {
+        return;
+    }
+    memset(&stats, 0, sizeof(stats));
+
+    probeStats(&radioChannel, &stats, TELEMETRYLINKSTATS_ROUNDTRIPTIME_RADIO);
+#ifdef HAS_RADIO
+    if (localPort()) {
+        probeStats(&localChannel, &stats, TELEMETRYLINKSTATS_ROUNDTRIPTIME_LOCAL);
+    }
+#endif
+
+    TelemetryLinkStatsSet(&stats);
 }
 
 /**
@@ -66,6 +66,11 @@ struct DelayedCallbackInfoStruct {
     uint16_t stackSafetyCount;
     uint16_t currentSafetyCount;
     uint32_t runCount;
+#ifdef DIAG_TASKS
+    uint32_t volatile dispatchtime; // raw time of the pending dispatch
+    bool volatile     dispatched;
+    struct pios_callback_timing timing;
+#endif
     struct DelayedCallbackTaskStruct *task;
     struct DelayedCallbackInfoStruct *next;
 };
@@ -79,6 +84,11 @@ static bool schedulerStarted;
 // Private functions
 static void CallbackSchedulerTask(void *task);
 static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+#ifdef DIAG_TASKS
+static void markDispatch(DelayedCallbackInfo *cbinfo);
+static void accountLatency(DelayedCallbackInfo *current, int32_t lateTicks);
+static void accountExecution(DelayedCallbackInfo *current, uint32_t startTime);
+#endif
 
 /**
  * Initialize the scheduler
@@ -207,6 +217,9 @@ int32_t PIOS_CALLBACKSCHEDULER_Dispatch(DelayedCallbackInfo *cbinfo)
 {
     PIOS_Assert(cbinfo);
 
+#ifdef DIAG_TASKS
+    markDispatch(cbinfo);
+#endif
     // no semaphore needed for the callback
     cbinfo->waiting = true;
     // but the scheduler as a whole needs to be notified
@@ -231,6 +244,9 @@ int32_t PIOS_CALLBACKSCHEDULER_DispatchFromISR(DelayedCallbackInfo *cbinfo, long
 {
     PIOS_Assert(cbinfo);
 
+#ifdef DIAG_TASKS
+    markDispatch(cbinfo);
+#endif
     // no semaphore needed for the callback
     cbinfo->waiting = true;
     // but the scheduler as a whole needs to be notified
@@ -346,6 +362,10 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
     info->stackFree          = 0;
     info->stackSafetyCount   = STACK_SAFETYCOUNT;
     info->currentSafetyCount = 0;
+#ifdef DIAG_TASKS
+    info->dispatched         = false;
+    memset(&info->timing, 0, sizeof(info->timing));
+#endif
 
     // add to scheduling queue
     LL_APPEND(task->callbackQueue[priority], info);
@@ -387,6 +407,105 @@ void PIOS_CALLBACKSCHEDULER_ForEachCallback(CallbackSchedulerCallbackInfoCallbac
     }
 }
 
+/**
+ * Iterator. Iterates over all callbacks and retrieves their timing statistics
+ *
+ * @param[in] callback  Callback function to receive the data - will be called in same task context as the caller
+ * @param     context   Context information optionally provided to the callback.
+ */
+void PIOS_CALLBACKSCHEDULER_ForEachCallbackTiming(__attribute__((unused)) CallbackSchedulerCallbackTimingCallback callback, __attribute__((unused)) void *context)
+{
+#ifdef DIAG_TASKS
+    if (!callback) {
+        return;
+    }
+
+    struct pios_callback_timing timing;
+
+    struct DelayedCallbackTaskStruct *task = NULL;
+    LL_FOREACH(schedulerTasks, task) {
+        int prio;
+
+        for (prio = 0; prio < (CALLBACK_PRIORITY_LOW + 1); prio++) {
+            struct DelayedCallbackInfoStruct *cbinfo;
+            LL_FOREACH(task->callbackQueue[prio], cbinfo) {
+                // the counters are updated by the scheduler task without locking, a torn read only affects a single sample
+                memcpy(&timing, &cbinfo->timing, sizeof(timing));
+                callback(cbinfo->callbackID, &timing, context);
+            }
+        }
+    }
+#endif /* DIAG_TASKS */
+}
+
+#ifdef DIAG_TASKS
+/**
+ * Remember when a callback got dispatched, only the first dispatch counts if it is
+ * dispatched several times before it runs. Safe to call from ISR.
+ */
+static void markDispatch(DelayedCallbackInfo *cbinfo)
+{
+    if (!cbinfo->dispatched) {
+        cbinfo->dispatchtime = PIOS_DELAY_GetRaw();
+        cbinfo->dispatched   = true;
+    }
+}
+
+/**
+ * Histogram bin of a duration, see PIOS_CALLBACKSCHEDULER_HISTOGRAM_BINS
+ */
+static inline uint8_t histogramBin(uint32_t us)
+{
+    if (us < 32) {
+        return 0;
+    }
+    uint8_t bin = 32 - __builtin_clz(us) - 5;
+    return (bin < PIOS_CALLBACKSCHEDULER_HISTOGRAM_BINS) ? bin : PIOS_CALLBACKSCHEDULER_HISTOGRAM_BINS - 1;
+}
+
+/**
+ * Account the queueing latency of a callback that is about to run
+ * \param[in] current The callback
+ * \param[in] lateTicks Ticks past the schedule time, negative if it was not started by its schedule
+ */
+static void accountLatency(DelayedCallbackInfo *current, int32_t lateTicks)
+{
+    uint32_t latency;
+
+    if (current->dispatched) {
+        latency = PIOS_DELAY_DiffuS(current->dispatchtime);
+        current->dispatched = false; // the callback may dispatch itself again while running
+    } else if (lateTicks >= 0) {
+        latency = lateTicks * portTICK_RATE_MS * 1000;
+    } else {
+        latency = 0;
+    }
+    if (lateTicks > 0) {
+        current->timing.deadline_misses++;
+    }
+
+    current->timing.latency_histogram[histogramBin(latency)]++;
+    if (latency > current->timing.latency_max) {
+        current->timing.latency_max = latency;
+    }
+}
+
+/**
+ * Account the execution time of a callback that just ran
+ * \param[in] current The callback
+ * \param[in] startTime Raw time the callback was started
+ */
+static void accountExecution(DelayedCallbackInfo *current, uint32_t startTime)
+{
+    uint32_t execution = PIOS_DELAY_DiffuS(startTime);
+
+    current->timing.execution_histogram[histogramBin(execution)]++;
+    if (execution > current->timing.execution_max) {
+        current->timing.execution_max = execution;
+    }
+}
+#endif /* DIAG_TASKS */
+
 /**
  * Stack magic, find how much stack is being used without affecting performance
  */
@@ -480,6 +599,9 @@ static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCa
 
     DelayedCallbackInfo *current = task->queueCursor[priority];
     DelayedCallbackInfo *next;
+#ifdef DIAG_TASKS
+    int32_t lateTicks;
+#endif
     do {
         if (current == NULL) {
             next = task->callbackQueue[priority]; // loop around the end of the list
@@ -496,9 +618,15 @@ static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCa
         } else {
             next = current->next;
             xSemaphoreTakeRecursive(mutex, portMAX_DELAY); // access to scheduletime should be mutex protected
+#ifdef DIAG_TASKS
+            lateTicks = -1;
+#endif
             if (current->scheduletime) {
                 diff = current->scheduletime - xTaskGetTickCount();
                 if (diff <= 0) {
+#ifdef DIAG_TASKS
+                    lateTicks = -diff;
+#endif
                     current->waiting = true;
                 } else if (diff < result) {
                     result = diff; // adjust sleep time
@@ -513,7 +641,14 @@ static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCa
                 /* callback gets invoked here - check stack sizes */
                 markStack(current);
 
+#ifdef DIAG_TASKS
+                accountLatency(current, lateTicks);
+                uint32_t startTime = PIOS_DELAY_GetRaw();
+#endif
                 current->cb(); // call the callback
+#ifdef DIAG_TASKS
+                accountExecution(current, startTime);
+#endif
 
                 checkStack(current);
 
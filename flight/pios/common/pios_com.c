@@ -456,10 +456,16 @@ int32_t PIOS_COM_ASYNC_RegisterTxCallback(uint32_t com_id, pios_com_callback tx_
     return 0;
 }
 
-static int32_t PIOS_COM_SendBufferNonBlockingInternal(struct pios_com_dev *com_dev, const uint8_t *buffer, uint16_t len)
+static int32_t PIOS_COM_SendVectorNonBlockingInternal(struct pios_com_dev *com_dev, const struct pios_com_vector *vector, uint8_t count)
 {
     PIOS_Assert(com_dev);
     PIOS_Assert(com_dev->has_tx);
+
+    uint32_t len = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        len += vector[i].len;
+    }
+
     if (com_dev->driver->available && !(com_dev->driver->available(com_dev->lower_id) & COM_AVAILABLE_TX)) {
         /*
          * Underlying device is down/unconnected.
@@ -477,7 +483,10 @@ static int32_t PIOS_COM_SendBufferNonBlockingInternal(struct pios_com_dev *com_d
         return -2;
     }
 
-    uint16_t bytes_into_fifo = fifoBuf_putData(&com_dev->tx, buffer, len);
+    uint32_t bytes_into_fifo = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        bytes_into_fifo += fifoBuf_putData(&com_dev->tx, vector[i].data, vector[i].len);
+    }
 
     if (bytes_into_fifo > 0) {
         /* More data has been put in the tx buffer, make sure the tx is started */
@@ -489,6 +498,13 @@ static int32_t PIOS_COM_SendBufferNonBlockingInternal(struct pios_com_dev *com_d
     return bytes_into_fifo;
 }
 
+static int32_t PIOS_COM_SendBufferNonBlockingInternal(struct pios_com_dev *com_dev, const uint8_t *buffer, uint16_t len)
+{
+    const struct pios_com_vector fragment = { .data = buffer, .len = len };
+
+    return PIOS_COM_SendVectorNonBlockingInternal(com_dev, &fragment, 1);
+}
+
 /**
  * Sends a package over given port
  * \param[in] port COM port
@@ -522,6 +538,41 @@ int32_t PIOS_COM_SendBufferNonBlocking(uint32_t com_id, const uint8_t *buffer, u
     return ret;
 }
 
+/**
+ * Sends a package made of several fragments over given port, straight into
+ * the transmit buffer and all or nothing, so that it is not interleaved
+ * with other packages
+ * \param[in] port COM port
+ * \param[in] vector fragments of the package
+ * \param[in] count number of fragments
+ * \return -1 if port not available
+ * \return -2 if non-blocking mode activated: buffer is full
+ *            caller should retry until buffer is free again
+ * \return -3 another thread is already sending, caller should
+ *            retry until com is available again
+ * \return number of bytes transmitted on success
+ */
+int32_t PIOS_COM_SendVectorNonBlocking(uint32_t com_id, const struct pios_com_vector *vector, uint8_t count)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+    if (!PIOS_COM_validate(com_dev)) {
+        /* Undefined COM port for this board (see pios_board.c) */
+        return -1;
+    }
+    PIOS_Assert(com_dev->has_tx);
+#if defined(PIOS_INCLUDE_FREERTOS)
+    if (xSemaphoreTake(com_dev->sendbuffer_sem, 0) != pdTRUE) {
+        return -3;
+    }
+#endif /* PIOS_INCLUDE_FREERTOS */
+    int32_t ret = PIOS_COM_SendVectorNonBlockingInternal(com_dev, vector, count);
+#if defined(PIOS_INCLUDE_FREERTOS)
+    xSemaphoreGive(com_dev->sendbuffer_sem);
+#endif /* PIOS_INCLUDE_FREERTOS */
+    return ret;
+}
+
 
 /**
  * Sends a package over given port
@@ -773,6 +824,30 @@ uint32_t PIOS_COM_Available(uint32_t com_id)
     return (com_dev->driver->available)(com_dev->lower_id);
 }
 
+/**
+ * Query the free space in the transmit buffer of a com port. Callers
+ * sending at a higher rate than the port drains can use it to pace
+ * themselves instead of blocking in PIOS_COM_SendBuffer().
+ * \param[in] com_id COM port
+ * \param[out] tx_buffer_len size of the transmit buffer, may be NULL
+ * \return -1 if the port is not valid or has no transmit buffer
+ * \return number of bytes that can be queued without blocking
+ */
+int32_t PIOS_COM_TxHeadroom(uint32_t com_id, uint16_t *tx_buffer_len)
+{
+    struct pios_com_dev *com_dev = (struct pios_com_dev *)com_id;
+
+    if (!PIOS_COM_validate(com_dev) || !com_dev->has_tx) {
+        return -1;
+    }
+
+    if (tx_buffer_len) {
+        *tx_buffer_len = fifoBuf_getSize(&com_dev->tx);
+    }
+
+    return fifoBuf_getFree(&com_dev->tx);
+}
+
 /*
  * Set available callback
  * \param[in] port COM port
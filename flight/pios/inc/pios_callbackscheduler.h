@@ -216,4 +216,44 @@ typedef void (*CallbackSchedulerCallbackInfoCallback)(int16_t task_id, const str
  */
 void PIOS_CALLBACKSCHEDULER_ForEachCallback(CallbackSchedulerCallbackInfoCallback callback, void *context);
 
+/**
+ * Number of bins of the timing histograms. Bin n counts the durations below
+ * (32 << n) us that did not fit in a lower bin, the last bin counts everything
+ * of 2048 us and above.
+ */
+#define PIOS_CALLBACKSCHEDULER_HISTOGRAM_BINS 8
+
+/**
+ * Timing statistics of a callback, only gathered with DIAG_TASKS.
+ */
+struct pios_callback_timing {
+    /** Queueing latency, from dispatch or schedule time to callback start */
+    uint32_t latency_histogram[PIOS_CALLBACKSCHEDULER_HISTOGRAM_BINS];
+    /** Execution time of the callback */
+    uint32_t execution_histogram[PIOS_CALLBACKSCHEDULER_HISTOGRAM_BINS];
+    /** Worst queueing latency in us */
+    uint32_t latency_max;
+    /** Worst execution time in us */
+    uint32_t execution_max;
+    /** Count of scheduled runs started in a later tick than requested */
+    uint32_t deadline_misses;
+};
+
+/**
+ * Iterator callback, called for each callback by PIOS_CALLBACKSCHEDULER_ForEachCallbackTiming().
+ *
+ * @param callback_id The id of the callback the timing refers to.
+ * @param timing      Timing statistics of the callback identified by callback_id.
+ * @param context     Context information optionally provided by the caller
+ */
+typedef void (*CallbackSchedulerCallbackTimingCallback)(int16_t callback_id, const struct pios_callback_timing *timing, void *context);
+
+/**
+ * Iterator. Iterates over all callbacks and retrieves their timing statistics
+ *
+ * @param[in] callback  Callback function to receive the data - will be called in same task context as the caller
+ * @param     context   Context information optionally provided to the callback.
+ */
+void PIOS_CALLBACKSCHEDULER_ForEachCallbackTiming(CallbackSchedulerCallbackTimingCallback callback, void *context);
+
 #endif // PIOS_CALLBACKSCHEDULER_H
@@ -84,6 +84,12 @@ struct pios_com_driver {
     int32_t  (*ioctl)(uint32_t id, uint32_t ctl, void *param);
 };
 
+/* One fragment of a package, see PIOS_COM_SendVectorNonBlocking() */
+struct pios_com_vector {
+    const uint8_t *data;
+    uint16_t len;
+};
+
 /* Control line definitions */
 #define COM_CTRL_LINE_DTR_MASK 0x01
 #define COM_CTRL_LINE_RTS_MASK 0x02
@@ -99,12 +105,14 @@ extern int32_t PIOS_COM_SendCharNonBlocking(uint32_t com_id, char c);
 extern int32_t PIOS_COM_SendChar(uint32_t com_id, char c);
 extern int32_t PIOS_COM_SendBufferNonBlocking(uint32_t com_id, const uint8_t *buffer, uint16_t len);
 extern int32_t PIOS_COM_SendBuffer(uint32_t com_id, const uint8_t *buffer, uint16_t len);
+extern int32_t PIOS_COM_SendVectorNonBlocking(uint32_t com_id, const struct pios_com_vector *vector, uint8_t count);
 extern int32_t PIOS_COM_SendStringNonBlocking(uint32_t com_id, const char *str);
 extern int32_t PIOS_COM_SendString(uint32_t com_id, const char *str);
 extern int32_t PIOS_COM_SendFormattedStringNonBlocking(uint32_t com_id, const char *format, ...);
 extern int32_t PIOS_COM_SendFormattedString(uint32_t com_id, const char *format, ...);
 extern uint16_t PIOS_COM_ReceiveBuffer(uint32_t com_id, uint8_t *buf, uint16_t buf_len, uint32_t timeout_ms);
 extern uint32_t PIOS_COM_Available(uint32_t com_id);
+extern int32_t PIOS_COM_TxHeadroom(uint32_t com_id, uint16_t *tx_buffer_len);
 extern int32_t PIOS_COM_RegisterAvailableCallback(uint32_t com_id, pios_com_callback_available, uint32_t context);
 
 /* Event driven asynchronous API */
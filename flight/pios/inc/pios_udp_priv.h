@@ -69,6 +69,7 @@ typedef struct {
 } pios_udp_dev;
 
 extern int32_t PIOS_UDP_Init(uint32_t *udp_id, const struct pios_udp_cfg *cfg);
+extern void PIOS_UDP_SetPortOffset(uint16_t offset);
 
 extern const struct pios_com_driver pios_udp_com_driver;
 
@@ -321,6 +321,55 @@ int32_t PIOS_COM_SendBufferNonBlocking(uint32_t com_id, const uint8_t *buffer, u
     return 0;
 }
 
+/**
+ * Sends a package made of several fragments over given port, straight into
+ * the transmit buffer and all or nothing
+ * \param[in] port COM port
+ * \param[in] vector fragments of the package
+ * \param[in] count number of fragments
+ * \return -1 if port not available
+ * \return -2 if non-blocking mode activated: buffer is full
+ *            caller should retry until buffer is free again
+ * \return number of bytes transmitted on success
+ */
+int32_t PIOS_COM_SendVectorNonBlocking(uint32_t com_id, const struct pios_com_vector *vector, uint8_t count)
+{
+    struct pios_com_dev *com_dev = PIOS_COM_find_dev(com_id);
+    uint32_t len = 0;
+
+    if (!PIOS_COM_validate(com_dev)) {
+        /* Undefined COM port for this board (see pios_board.c) */
+        return -1;
+    }
+
+    PIOS_Assert(com_dev->has_tx);
+
+    for (uint8_t i = 0; i < count; i++) {
+        len += vector[i].len;
+    }
+
+    if (len >= fifoBuf_getFree(&com_dev->tx)) {
+        /* Buffer cannot accept all requested bytes (retry) */
+        return -2;
+    }
+
+    PIOS_IRQ_Disable();
+    for (uint8_t i = 0; i < count; i++) {
+        fifoBuf_putData(&com_dev->tx, vector[i].data, vector[i].len);
+    }
+    PIOS_IRQ_Enable();
+
+    if (len > 0) {
+        /* More data has been put in the tx buffer, make sure the tx is started */
+        if (com_dev->driver->tx_start) {
+            com_dev->driver->tx_start(com_dev->lower_id,
+                                      fifoBuf_getUsed(&com_dev->tx));
+        }
+    }
+
+    return len;
+}
+
 /**
  * Sends a package over given port
  * (blocking function)
@@ -534,6 +583,30 @@ uint32_t PIOS_COM_Available(uint32_t com_id)
     return (com_dev->driver->available)(com_dev->lower_id);
 }
 
+/**
+ * Query the free space in the transmit buffer of a com port. Callers
+ * sending at a higher rate than the port drains can use it to pace
+ * themselves instead of blocking in PIOS_COM_SendBuffer().
+ * \param[in] com_id COM port
+ * \param[out] tx_buffer_len size of the transmit buffer, may be NULL
+ * \return -1 if the port is not valid or has no transmit buffer
+ * \return number of bytes that can be queued without blocking
+ */
+int32_t PIOS_COM_TxHeadroom(uint32_t com_id, uint16_t *tx_buffer_len)
+{
+    struct pios_com_dev *com_dev = PIOS_COM_find_dev(com_id);
+
+    if (!PIOS_COM_validate(com_dev) || !com_dev->has_tx) {
+        return -1;
+    }
+
+    if (tx_buffer_len) {
+        *tx_buffer_len = fifoBuf_getSize(&com_dev->tx);
+    }
+
+    return fifoBuf_getFree(&com_dev->tx);
+}
+
 #endif /* if defined(PIOS_INCLUDE_COM) */
 
 /**
@@ -42,6 +42,9 @@ static int8_t pios_udp_num_devices = 0;
 
 static pios_udp_dev pios_udp_devices[PIOS_UDP_MAX_DEV];
 
+/* Added to all configured ports, lets several simulator instances run side by side */
+static uint16_t pios_udp_port_offset = 0;
+
 
 /* Provide a COM driver */
 static void PIOS_UDP_ChangeBaud(uint32_t udp_id, uint32_t baud);
@@ -112,6 +115,15 @@ void *PIOS_UDP_RxThread(void *udp_dev_n)
 }
 
 
+/**
+ * Offset all UDP ports opened afterwards
+ * \param[in] offset Value added to the configured port numbers
+ */
+void PIOS_UDP_SetPortOffset(uint16_t offset)
+{
+    pios_udp_port_offset = offset;
+}
+
 /**
  * Open UDP socket
  */
@@ -133,7 +145,7 @@ int32_t PIOS_UDP_Init(uint32_t *udp_id, const struct pios_udp_cfg *cfg)
     memset(&udp_dev->client, 0, sizeof(udp_dev->client));
     udp_dev->server.sin_family = AF_INET;
     udp_dev->server.sin_addr.s_addr = inet_addr(udp_dev->cfg->ip);
-    udp_dev->server.sin_port   = htons(udp_dev->cfg->port);
+    udp_dev->server.sin_port   = htons(udp_dev->cfg->port + pios_udp_port_offset);
     int res = bind(udp_dev->socket, (struct sockaddr *)&udp_dev->server, sizeof(udp_dev->server));
 
     /* Create transmit thread for this connection */
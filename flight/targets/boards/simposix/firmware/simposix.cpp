@@ -37,8 +37,14 @@ extern "C" {
 #include <systemmod.h>
 #include <uavobjectsinit.h>
 #include <systemmod.h>
+#include <pios_udp_priv.h>
 }
 
+/* UDP ports of instance n are offset by n times this value */
+#define INSTANCE_PORT_STRIDE 10
+/* Keeps the offset ports clear of the top of the port range */
+#define INSTANCE_MAX         1000
+
 /**
  * OpenPilot Main function:
  *
@@ -47,9 +53,27 @@ extern "C" {
  * Start FreeRTOS Scheduler (vTaskStartScheduler)<BR>
  * If something goes wrong, blink LED1 and LED2 every 100ms
  *
+ * Usage: simposix [-i instance]
+ * Each instance uses its own set of UDP ports, so that several simulated
+ * vehicles can run in parallel (each from its own working directory, which
+ * holds the settings).
  */
-int main()
+int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-i")) {
+            const char *arg = (i + 1 < argc) ? argv[++i] : "";
+            char *end;
+            long instance   = strtol(arg, &end, 10);
+            if (end == arg || *end != '\0' || instance < 0 || instance >= INSTANCE_MAX) {
+                fprintf(stderr, "simposix: instance must be a number from 0 to %i\n", INSTANCE_MAX - 1);
+                return 1;
+            }
+            PIOS_UDP_SetPortOffset((uint16_t)(instance * INSTANCE_PORT_STRIDE));
+            printf("simulator instance %li\n", instance);
+        }
+    }
+
     /* Brings up System using CMSIS functions, enables the LEDs. */
     PIOS_SYS_Init();
 
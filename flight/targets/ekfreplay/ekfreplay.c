@@ -0,0 +1,192 @@
+/**
+ ******************************************************************************
+ * @addtogroup EKFReplay Offline state estimation replay
+ * @{
+ *
+ * @file       ekfreplay.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2017.
+ * @brief      Replays a flight log through the StateEstimation filters and
+ *             writes the resulting states as CSV, to tune EKFConfiguration
+ *             and RevoSettings without flying.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "replay.h"
+
+#include <getopt.h>
+#include <time.h>
+#include <revosettings.h>
+#include <attitudestate.h>
+#include <positionstate.h>
+#include <velocitystate.h>
+
+// Private functions
+static void usage(void);
+static void writeState(uint64_t timeUs, void *context);
+static double wallTime(void);
+
+int main(int argc, char *argv[])
+{
+    ReplayOptions options;
+    ReplayLogFormat format = REPLAYLOG_FORMAT_AUTO;
+    const char *outputPath = NULL;
+    bool list = false;
+    int opt;
+
+    memset(&options, 0, sizeof(options));
+    options.fusionAlgorithm = -1;
+
+    if (ReplayInitialize() != 0) {
+        fprintf(stderr, "ekfreplay: failed to initialize the state estimation\n");
+        return 1;
+    }
+
+    while ((opt = getopt(argc, argv, "a:f:lo:p:s")) != -1) {
+        switch (opt) {
+        case 'a':
+            options.fusionAlgorithm = atoi(optarg);
+            if (options.fusionAlgorithm < 0 || options.fusionAlgorithm > REVOSETTINGS_FUSIONALGORITHM_TESTINGINSINDOORCF) {
+                usage();
+                return 1;
+            }
+            break;
+        case 'f':
+            if (!strcmp(optarg, "opl")) {
+                format = REPLAYLOG_FORMAT_OPL;
+            } else if (!strcmp(optarg, "debuglog")) {
+                format = REPLAYLOG_FORMAT_DEBUGLOG;
+            } else {
+                usage();
+                return 1;
+            }
+            break;
+        case 'l':
+            list = true;
+            break;
+        case 'o':
+            outputPath = optarg;
+            break;
+        case 'p':
+            if (ReplayAddOverride(&options, optarg) != 0) {
+                fprintf(stderr, "ekfreplay: bad override '%s', see -l for the settings\n", optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            options.ignoreSettings = true;
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    if (list) {
+        for (uint8_t i = 0; i < ReplayGetNumParameters(); i++) {
+            printf("%s=%g\n", ReplayGetParameterName(i), (double)ReplayGetParameter(i));
+        }
+        return 0;
+    }
+
+    if (optind != argc - 1) {
+        usage();
+        return 1;
+    }
+
+    ReplayLog *log = ReplayLogOpen(argv[optind], format);
+    if (!log) {
+        fprintf(stderr, "ekfreplay: cannot read log %s\n", argv[optind]);
+        return 1;
+    }
+
+    FILE *output = stdout;
+    if (outputPath) {
+        output = fopen(outputPath, "w");
+        if (!output) {
+            fprintf(stderr, "ekfreplay: cannot write %s\n", outputPath);
+            ReplayLogClose(log);
+            return 1;
+        }
+    }
+    fprintf(output, "time,q1,q2,q3,q4,roll,pitch,yaw,north,east,down,vnorth,veast,vdown\n");
+
+    ReplayStats stats;
+    double start = wallTime();
+    ReplayRun(log, &options, &writeState, output, &stats);
+    double elapsed = wallTime() - start;
+
+    if (output != stdout) {
+        fclose(output);
+    }
+    ReplayLogClose(log);
+
+    fprintf(stderr, "%u updates, %u replayed, %u estimations, %u states, %.1fs of log in %.2fs\n",
+            (unsigned)stats.updates, (unsigned)stats.replayed, (unsigned)stats.estimations, (unsigned)stats.outputs,
+            stats.durationUs * 1e-6, elapsed);
+
+    return 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: ekfreplay [options] <log>\n"
+            "Replays a GCS .opl log or an onboard DebugLogEntry dump through the\n"
+            "state estimation and writes the states as CSV.\n"
+            "  -o <file>        write the states to a file instead of stdout\n"
+            "  -a <n>           force RevoSettings.FusionAlgorithm: 0 None, 1 Basic (Complementary),\n"
+            "                   2 Complementary+Mag, 3 Complementary+Mag+GPSOutdoor, 4 INS13Indoor,\n"
+            "                   5 GPS Navigation (INS13), 6 GPS Navigation (INS13+CF), 7 Testing (INS Indoor+CF)\n"
+            "  -s               ignore the settings in the log, replay sensors only\n"
+            "  -p <name>=<val>  override a setting, may be repeated\n"
+            "  -l               list the settings -p takes with their defaults\n"
+            "  -f opl|debuglog  log format, .opl files are GCS logs by default\n");
+}
+
+static void writeState(uint64_t timeUs, void *context)
+{
+    FILE *output = context;
+    AttitudeStateData attitude;
+    PositionStateData position;
+    VelocityStateData velocity;
+
+    AttitudeStateGet(&attitude);
+    PositionStateGet(&position);
+    VelocityStateGet(&velocity);
+
+    fprintf(output, "%.6f,%.7f,%.7f,%.7f,%.7f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+            timeUs * 1e-6,
+            (double)attitude.q1, (double)attitude.q2, (double)attitude.q3, (double)attitude.q4,
+            (double)attitude.Roll, (double)attitude.Pitch, (double)attitude.Yaw,
+            (double)position.North, (double)position.East, (double)position.Down,
+            (double)velocity.North, (double)velocity.East, (double)velocity.Down);
+}
+
+static double wallTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,496 @@
+/**
+ ******************************************************************************
+ * @addtogroup EKFReplay Offline state estimation replay
+ * @{
+ *
+ * @file       ekfsweep.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2017.
+ * @brief      Replays one flight log against a grid or random search of
+ *             EKFConfiguration and RevoSettings values, on all CPUs, and
+ *             ranks the sets by innovation consistency and GPS agreement.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "replay.h"
+
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <revosettings.h>
+#include <ekfstatevariance.h>
+
+// Private constants
+#define SWEEP_MAX_PARAMETERS  16
+#define SWEEP_MAX_RUNS        100000
+#define SWEEP_DEFAULT_STEPS   5
+#define SWEEP_DEFAULT_BEST    10
+#define SWEEP_GPS_MEASUREMENTS 6 // GPSPos and GPSVel North, East and Down come first
+
+// Private types
+typedef struct {
+    uint8_t param;
+    float   min;
+    float   max;
+    uint32_t steps;
+} SweepRange;
+
+typedef struct {
+    uint32_t run;
+    bool     valid; // the EKF ran corrections
+    float    score; // lower is better
+    float    consistency; // mean |ln(NIS)| of the measurements used, 0 when the noise settings match
+    float    gpsRMS; // RMS innovation of the GPS measurements
+} SweepResult;
+
+// Innovation statistics summed over the outputs of a run, the EKF only keeps moving averages
+typedef struct {
+    uint32_t samples;
+    double   nis[EKFSTATEVARIANCE_NIS_NUMELEM];
+    double   sq[EKFSTATEVARIANCE_NIS_NUMELEM];
+} SweepInnovations;
+
+// Private variables
+static SweepRange ranges[SWEEP_MAX_PARAMETERS];
+static uint8_t numRanges;
+static float *values; // numRuns rows of numRanges values
+static uint32_t numRuns;
+static float gpsWeight = 1.0f;
+
+// Private functions
+static void usage(void);
+static int32_t parseRange(const char *arg);
+static float rangeValue(const SweepRange *range, float position);
+static void makeGrid(void);
+static void makeRandom(uint32_t runs);
+static int32_t runAll(ReplayLog *log, const ReplayOptions *options, uint32_t jobs, SweepResult *results);
+static void runOne(ReplayLog *log, const ReplayOptions *options, uint32_t run, SweepResult *result);
+static void sampleInnovations(uint64_t timeUs, void *context);
+static int compareResults(const void *a, const void *b);
+static double wallTime(void);
+
+int main(int argc, char *argv[])
+{
+    ReplayOptions options;
+    ReplayLogFormat format = REPLAYLOG_FORMAT_AUTO;
+    uint32_t randomRuns    = 0;
+    uint32_t best = SWEEP_DEFAULT_BEST;
+    long jobs     = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    memset(&options, 0, sizeof(options));
+    options.fusionAlgorithm = -1;
+
+    if (ReplayInitialize() != 0) {
+        fprintf(stderr, "ekfsweep: failed to initialize the state estimation\n");
+        return 1;
+    }
+
+    while ((opt = getopt(argc, argv, "a:b:f:j:n:p:r:sw:")) != -1) {
+        switch (opt) {
+        case 'a':
+            options.fusionAlgorithm = atoi(optarg);
+            if (options.fusionAlgorithm < 0 || options.fusionAlgorithm > REVOSETTINGS_FUSIONALGORITHM_TESTINGINSINDOORCF) {
+                usage();
+                return 1;
+            }
+            break;
+        case 'b':
+            best = strtoul(optarg, NULL, 10);
+            break;
+        case 'f':
+            if (!strcmp(optarg, "opl")) {
+                format = REPLAYLOG_FORMAT_OPL;
+            } else if (!strcmp(optarg, "debuglog")) {
+                format = REPLAYLOG_FORMAT_DEBUGLOG;
+            } else {
+                usage();
+                return 1;
+            }
+            break;
+        case 'j':
+            jobs = atol(optarg);
+            break;
+        case 'n':
+            randomRuns = strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            if (ReplayAddOverride(&options, optarg) != 0) {
+                fprintf(stderr, "ekfsweep: bad override '%s', see ekfreplay -l for the settings\n", optarg);
+                return 1;
+            }
+            break;
+        case 'r':
+            if (parseRange(optarg) != 0) {
+                fprintf(stderr, "ekfsweep: bad range '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            options.ignoreSettings = true;
+            break;
+        case 'w':
+            gpsWeight = strtof(optarg, NULL);
+            break;
+        default:
+            usage();
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1 || numRanges == 0) {
+        usage();
+        return 1;
+    }
+    if (options.numOverrides + numRanges > REPLAY_MAX_OVERRIDES) {
+        fprintf(stderr, "ekfsweep: too many overrides\n");
+        return 1;
+    }
+    if (jobs < 1) {
+        jobs = 1;
+    }
+
+    if (randomRuns) {
+        makeRandom(randomRuns);
+    } else {
+        makeGrid();
+    }
+    if (!values) {
+        fprintf(stderr, "ekfsweep: more than %u runs, use fewer steps or -n\n", SWEEP_MAX_RUNS);
+        return 1;
+    }
+
+    ReplayLog *log = ReplayLogOpen(argv[optind], format);
+    if (!log) {
+        fprintf(stderr, "ekfsweep: cannot read log %s\n", argv[optind]);
+        return 1;
+    }
+
+    SweepResult *results = calloc(numRuns, sizeof(SweepResult));
+    if (!results) {
+        ReplayLogClose(log);
+        return 1;
+    }
+
+    fprintf(stderr, "ekfsweep: %u runs on %ld jobs\n", (unsigned)numRuns, jobs);
+    double start  = wallTime();
+    int32_t failed = runAll(log, &options, jobs, results);
+    double elapsed = wallTime() - start;
+    ReplayLogClose(log);
+
+    if (failed < 0) {
+        free(results);
+        free(values);
+        return 1;
+    }
+
+    qsort(results, numRuns, sizeof(SweepResult), &compareResults);
+
+    uint32_t valid = 0;
+    while (valid < numRuns && results[valid].valid) {
+        valid++;
+    }
+    fprintf(stderr, "ekfsweep: %u runs in %.1fs, %u without EKF corrections, %d failed\n",
+            (unsigned)numRuns, elapsed, (unsigned)(numRuns - valid - failed), (int)failed);
+
+    printf("score,consistency,gpsrms");
+    for (uint8_t i = 0; i < numRanges; i++) {
+        printf(",%s", ReplayGetParameterName(ranges[i].param));
+    }
+    printf("\n");
+    for (uint32_t i = 0; i < valid && i < best; i++) {
+        const float *row = &values[results[i].run * numRanges];
+        printf("%g,%g,%g", (double)results[i].score, (double)results[i].consistency, (double)results[i].gpsRMS);
+        for (uint8_t j = 0; j < numRanges; j++) {
+            printf(",%g", (double)row[j]);
+        }
+        printf("\n");
+    }
+
+    if (valid) {
+        const float *row = &values[results[0].run * numRanges];
+        fprintf(stderr, "ekfsweep: best set, to replay it use\n ");
+        for (uint8_t j = 0; j < numRanges; j++) {
+            fprintf(stderr, " -p %s=%g", ReplayGetParameterName(ranges[j].param), (double)row[j]);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    free(results);
+    free(values);
+
+    return valid ? 0 : 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: ekfsweep [options] -r <name>=<min>:<max>[:<steps>] ... <log>\n"
+            "Replays a log once per set of settings and ranks the sets by the\n"
+            "consistency of the EKF innovations (NIS) and their agreement with GPS.\n"
+            "  -r <name>=<min>:<max>[:<steps>]\n"
+            "                   setting to sweep, may be repeated, the names are those\n"
+            "                   of ekfreplay -l. Positive ranges are stepped logarithmically.\n"
+            "                   The grid has %d steps per setting by default\n"
+            "  -n <runs>        random search of that many runs instead of the grid\n"
+            "  -j <jobs>        replays run in parallel, the number of CPUs by default\n"
+            "  -w <weight>      weight of the GPS RMS innovation against the NIS consistency\n"
+            "                   in the score, 1 by default\n"
+            "  -b <count>       number of best sets to print, %d by default\n"
+            "  -a <n>           force RevoSettings.FusionAlgorithm, see ekfreplay\n"
+            "  -s               ignore the settings in the log, replay sensors only\n"
+            "  -p <name>=<val>  fixed override, may be repeated\n"
+            "  -f opl|debuglog  log format, .opl files are GCS logs by default\n",
+            SWEEP_DEFAULT_STEPS, SWEEP_DEFAULT_BEST);
+}
+
+static int32_t parseRange(const char *arg)
+{
+    const char *range = strchr(arg, '=');
+    char name[64];
+    SweepRange *r     = &ranges[numRanges];
+    unsigned steps    = SWEEP_DEFAULT_STEPS;
+
+    if (!range || range - arg >= (int)sizeof(name) || numRanges >= SWEEP_MAX_PARAMETERS) {
+        return -1;
+    }
+    memcpy(name, arg, range - arg);
+    name[range - arg] = '\0';
+
+    int32_t param = ReplayFindParameter(name);
+    if (param < 0 || sscanf(range + 1, "%f:%f:%u", &r->min, &r->max, &steps) < 2 || steps < 1) {
+        return -1;
+    }
+    r->param = param;
+    r->steps = steps;
+    numRanges++;
+
+    return 0;
+}
+
+/**
+ * Value at a position between 0 (min) and 1 (max), noise variances span
+ * decades so positive ranges are interpolated logarithmically
+ */
+static float rangeValue(const SweepRange *range, float position)
+{
+    if (range->min > 0.0f && range->max > 0.0f) {
+        return range->min * powf(range->max / range->min, position);
+    }
+    return range->min + (range->max - range->min) * position;
+}
+
+static void makeGrid(void)
+{
+    numRuns = 1;
+    for (uint8_t i = 0; i < numRanges; i++) {
+        numRuns *= ranges[i].steps;
+        if (numRuns > SWEEP_MAX_RUNS) {
+            return;
+        }
+    }
+
+    values = malloc(numRuns * numRanges * sizeof(float));
+    if (!values) {
+        return;
+    }
+
+    for (uint32_t run = 0; run < numRuns; run++) {
+        uint32_t index = run;
+        for (uint8_t i = 0; i < numRanges; i++) {
+            uint32_t step = index % ranges[i].steps;
+            index /= ranges[i].steps;
+            values[run * numRanges + i] = rangeValue(&ranges[i], ranges[i].steps > 1 ? (float)step / (ranges[i].steps - 1) : 0.0f);
+        }
+    }
+}
+
+static void makeRandom(uint32_t runs)
+{
+    if (runs > SWEEP_MAX_RUNS) {
+        return;
+    }
+    numRuns = runs;
+    values  = malloc(numRuns * numRanges * sizeof(float));
+    if (!values) {
+        return;
+    }
+
+    srand(time(NULL));
+    for (uint32_t i = 0; i < numRuns * numRanges; i++) {
+        values[i] = rangeValue(&ranges[i % numRanges], (float)rand() / RAND_MAX);
+    }
+}
+
+/**
+ * The filters keep their state in static variables, so every run is a
+ * process forked from the initialized one. The log and the parameter table
+ * are shared with the children, each reports its result through a pipe.
+ * \return number of runs that crashed, -1 on failure
+ */
+static int32_t runAll(ReplayLog *log, const ReplayOptions *options, uint32_t jobs, SweepResult *results)
+{
+    int pipefd[2];
+    uint32_t next    = 0;
+    uint32_t running = 0;
+    int32_t failed   = 0;
+
+    if (pipe(pipefd) != 0) {
+        perror("ekfsweep: pipe");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < numRuns; i++) {
+        results[i].run = i;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    while (next < numRuns || running) {
+        while (running < jobs && next < numRuns) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                SweepResult result;
+                close(pipefd[0]);
+                runOne(log, options, next, &result);
+                // results are smaller than PIPE_BUF, so a write is never interleaved with another child
+                _exit(write(pipefd[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+            }
+            if (pid < 0) {
+                perror("ekfsweep: fork");
+                if (!running) {
+                    close(pipefd[0]);
+                    close(pipefd[1]);
+                    return -1;
+                }
+                break;
+            }
+            next++;
+            running++;
+        }
+
+        int status;
+        if (wait(&status) < 0) {
+            perror("ekfsweep: wait");
+            close(pipefd[0]);
+            close(pipefd[1]);
+            return -1;
+        }
+        running--;
+
+        // a child that exited cleanly has written its result before
+        SweepResult result;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+            read(pipefd[0], &result, sizeof(result)) == sizeof(result) && result.run < numRuns) {
+            results[result.run] = result;
+        } else {
+            failed++;
+        }
+    }
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+
+    return failed;
+}
+
+static void runOne(ReplayLog *log, const ReplayOptions *options, uint32_t run, SweepResult *result)
+{
+    ReplayOptions runOptions = *options;
+    const float *row = &values[run * numRanges];
+
+    for (uint8_t i = 0; i < numRanges; i++) {
+        runOptions.overrides[runOptions.numOverrides].param = ranges[i].param;
+        runOptions.overrides[runOptions.numOverrides].value = row[i];
+        runOptions.numOverrides++;
+    }
+
+    SweepInnovations innovations;
+    memset(&innovations, 0, sizeof(innovations));
+    ReplayRun(log, &runOptions, sampleInnovations, &innovations, NULL);
+
+    uint8_t used = 0;
+    uint8_t gps  = 0;
+    float consistency = 0.0f;
+    float gpsSquares  = 0.0f;
+    for (uint8_t i = 0; i < EKFSTATEVARIANCE_NIS_NUMELEM && innovations.samples > 0; i++) {
+        float nis = (float)(innovations.nis[i] / innovations.samples);
+        if (nis > 0.0f && IS_REAL(nis)) {
+            consistency += fabsf(logf(nis));
+            used++;
+            if (i < SWEEP_GPS_MEASUREMENTS) {
+                gpsSquares += (float)(innovations.sq[i] / innovations.samples);
+                gps++;
+            }
+        }
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->run   = run;
+    result->valid = used > 0;
+    if (result->valid) {
+        result->consistency = consistency / used;
+        result->gpsRMS = gps ? sqrtf(gpsSquares / gps) : 0.0f;
+        result->score  = result->consistency + gpsWeight * result->gpsRMS;
+    }
+}
+
+// add up the innovation averages of the EKF at each output, over the whole log
+static void sampleInnovations(__attribute__((unused)) uint64_t timeUs, void *context)
+{
+    SweepInnovations *innovations = context;
+    EKFStateVarianceData variance;
+
+    EKFStateVarianceGet(&variance);
+    const float *nis = EKFStateVarianceNISToArray(variance.NIS);
+    const float *rms = EKFStateVarianceInnovationRMSToArray(variance.InnovationRMS);
+    for (uint8_t i = 0; i < EKFSTATEVARIANCE_NIS_NUMELEM; i++) {
+        innovations->nis[i] += nis[i];
+        innovations->sq[i]  += rms[i] * rms[i];
+    }
+    innovations->samples++;
+}
+
+// valid results first, best score first
+static int compareResults(const void *a, const void *b)
+{
+    const SweepResult *ra = a;
+    const SweepResult *rb = b;
+
+    if (ra->valid != rb->valid) {
+        return ra->valid ? -1 : 1;
+    }
+    if (ra->score != rb->score) {
+        return ra->score < rb->score ? -1 : 1;
+    }
+    return (ra->run > rb->run) - (ra->run < rb->run);
+}
+
+static double wallTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,53 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+/* The replay is single threaded, the kernel objects it needs are stubs */
+#define pvPortMalloc(xSize) (malloc(xSize))
+#define vPortFree(pv)       (free(pv))
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       0xffffffff
+#define portTICK_RATE_MS    1
+#define tskIDLE_PRIORITY    0
+
+typedef uint32_t portTickType;
+typedef void *xQueueHandle;
+typedef void *xSemaphoreHandle;
+
+static inline xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    return (xSemaphoreHandle)1;
+}
+
+static inline int xSemaphoreTakeRecursive(__attribute__((unused)) xSemaphoreHandle sem, __attribute__((unused)) unsigned int timeout)
+{
+    return pdTRUE;
+}
+
+static inline int xSemaphoreGiveRecursive(__attribute__((unused)) xSemaphoreHandle sem)
+{
+    return pdTRUE;
+}
+
+static inline int xSemaphoreTake(__attribute__((unused)) xSemaphoreHandle sem, __attribute__((unused)) unsigned int timeout)
+{
+    return pdFALSE;
+}
+
+static inline int xSemaphoreGive(__attribute__((unused)) xSemaphoreHandle sem)
+{
+    return pdTRUE;
+}
+
+#define vSemaphoreCreateBinary(sem) do { (sem) = xSemaphoreCreateRecursiveMutex(); } while (0)
+
+/* Ticks follow the log time, see replay.c */
+portTickType xTaskGetTickCount(void);
+
+int xQueueSend(xQueueHandle queue, const void *item, unsigned int timeout);
+
+#endif /* FREERTOS_H */
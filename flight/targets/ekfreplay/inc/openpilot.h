@@ -0,0 +1,16 @@
+#ifndef OPENPILOT_H
+#define OPENPILOT_H
+
+/* PIOS Includes */
+#include <pios.h>
+
+/* OpenPilot Libraries */
+#include <utlist.h>
+#include <uavobjectmanager.h>
+#include <eventdispatcher.h>
+#include <uavtalk.h>
+
+#include "alarms.h"
+#include <mathmisc.h>
+
+#endif /* OPENPILOT_H */
@@ -0,0 +1,35 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pios_config.h"
+#include "FreeRTOS.h"
+
+#define PIOS_Assert(test) \
+    if (!(test)) { fprintf(stderr, "%s:%d: assertion failed\n", __FILE__, __LINE__); abort(); \
+    }
+#define PIOS_DEBUG_Assert(test)  PIOS_Assert(test)
+#define PIOS_STATIC_ASSERT(test) ((void)sizeof(int[1 - 2 * !(test)]))
+
+/* Modules are initialized explicitly by the replay */
+#define MODULE_INITCALL(ifn, sfn)
+
+#include "pios_mem.h"
+#include <pios_helpers.h>
+#include <pios_crc.h>
+#include <pios_math.h>
+#include <pios_deltatime.h>
+#include <pios_callbackscheduler.h>
+#include <pios_notify.h>
+
+/* The replay clock stands in for the delay timer, see replay.c */
+uint32_t PIOS_DELAY_GetRaw(void);
+uint32_t PIOS_DELAY_GetuS(void);
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw);
+
+#endif /* PIOS_H */
@@ -0,0 +1,7 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+/* Filters are initialized with the Revolution sensor rate */
+#define PIOS_SENSOR_RATE 500.0f
+
+#endif /* PIOS_CONFIG_H */
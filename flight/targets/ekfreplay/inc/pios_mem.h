@@ -0,0 +1,10 @@
+#ifndef PIOS_MEM_H
+#define PIOS_MEM_H
+
+#include <stdlib.h>
+
+#define pios_fastheapmalloc(size) (malloc(size))
+#define pios_malloc(size)         (malloc(size))
+#define pios_free(p)              (free(p))
+
+#endif /* PIOS_MEM_H */
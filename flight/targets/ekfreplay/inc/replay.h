@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * @addtogroup EKFReplay Offline state estimation replay
+ * @{
+ *
+ * @file       replay.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2017.
+ * @brief      Runs the StateEstimation module on the host against a flight log
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <openpilot.h>
+#include "replaylog.h"
+
+#define REPLAY_MAX_OVERRIDES 64
+
+typedef struct {
+    int8_t  fusionAlgorithm; // RevoSettings.FusionAlgorithm to force, -1 keeps the logged one
+    bool    ignoreSettings; // replay sensors only, on top of the default settings
+    uint8_t numOverrides;
+    struct {
+        uint8_t param; // see ReplayFindParameter()
+        float   value;
+    } overrides[REPLAY_MAX_OVERRIDES];
+} ReplayOptions;
+
+typedef struct {
+    uint32_t updates; // object updates read from the log
+    uint32_t replayed; // updates passed on to the filters
+    uint32_t estimations; // StateEstimation runs
+    uint32_t outputs; // attitude updates reported
+    uint64_t durationUs; // log time covered
+} ReplayStats;
+
+// Called after each StateEstimation run that updated AttitudeState, the states are read from the UAVOs
+typedef void (*ReplayOutput)(uint64_t timeUs, void *context);
+
+int32_t ReplayInitialize(void);
+int32_t ReplayRun(ReplayLog *log, const ReplayOptions *options, ReplayOutput output, void *context, ReplayStats *stats);
+
+uint8_t ReplayGetNumParameters(void);
+int32_t ReplayFindParameter(const char *name);
+int32_t ReplayAddOverride(ReplayOptions *options, const char *arg);
+const char *ReplayGetParameterName(uint8_t param);
+float ReplayGetParameter(uint8_t param);
+
+#endif /* REPLAY_H */
+
+/**
+ * @}
+ */
@@ -0,0 +1,58 @@
+/**
+ ******************************************************************************
+ * @addtogroup EKFReplay Offline state estimation replay
+ * @{
+ *
+ * @file       replaylog.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2017.
+ * @brief      Readers for the flight logs the replay is fed from
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef REPLAYLOG_H
+#define REPLAYLOG_H
+
+#include <openpilot.h>
+
+typedef enum {
+    REPLAYLOG_FORMAT_AUTO = 0, // .opl files are GCS logs, anything else a DebugLogEntry dump
+    REPLAYLOG_FORMAT_OPL,      // GCS log: records of a uint32 ms timestamp, an int64 size and UAVTalk bytes
+    REPLAYLOG_FORMAT_DEBUGLOG  // onboard log: packed DebugLogEntry objects as stored in flash
+} ReplayLogFormat;
+
+struct ReplayLogStruct;
+typedef struct ReplayLogStruct ReplayLog;
+
+// One object update found in the log
+typedef struct {
+    uint64_t timeUs; // log time of the update
+    uint32_t objId;
+} ReplayLogUpdate;
+
+ReplayLog *ReplayLogOpen(const char *path, ReplayLogFormat format);
+void ReplayLogClose(ReplayLog *log);
+void ReplayLogRewind(ReplayLog *log);
+bool ReplayLogNext(ReplayLog *log, ReplayLogUpdate *update);
+int32_t ReplayLogApply(ReplayLog *log);
+
+#endif /* REPLAYLOG_H */
+
+/**
+ * @}
+ */
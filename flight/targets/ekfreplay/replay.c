@@ -0,0 +1,480 @@
+/**
+ ******************************************************************************
+ * @addtogroup EKFReplay Offline state estimation replay
+ * @{
+ *
+ * @file       replay.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2017.
+ * @brief      Runs the StateEstimation module on the host against a flight log.
+ *             The logged sensor objects are unpacked into the real UAVOs in log
+ *             order and the module callback runs after each of them, on a clock
+ *             that follows the log time instead of the wall clock. The filter
+ *             chains are the ones the firmware builds, so the states are the
+ *             ones the flight controller would have computed with the same
+ *             settings.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "replay.h"
+
+#include <uavobjectsinit.h>
+#include <gyrosensor.h>
+#include <accelsensor.h>
+#include <magsensor.h>
+#include <auxmagsensor.h>
+#include <barosensor.h>
+#include <airspeedsensor.h>
+#include <gpspositionsensor.h>
+#include <gpsvelocitysensor.h>
+#include <flightstatus.h>
+#include <attitudestate.h>
+#include <revosettings.h>
+#include <ekfconfiguration.h>
+
+// Private types
+struct DelayedCallbackInfoStruct {
+    DelayedCallback cb;
+    uint64_t scheduleUs; // 0 when not scheduled
+    bool     waiting;
+    struct DelayedCallbackInfoStruct *next;
+};
+
+typedef struct {
+    const char   *name;
+    UAVObjHandle (*handle)();
+    uint16_t     offset;
+} ReplayParameter;
+
+// Private variables
+static uint64_t clockUs;
+static DelayedCallbackInfo *callbacks;
+static bool attitudeUpdated;
+static ReplayStats runStats;
+static ReplayOutput runOutput;
+static void *runContext;
+
+// Objects the filters take as input, settings are replayed unless ignored
+static const uint32_t sensorObjects[] = {
+    GYROSENSOR_OBJID,
+    ACCELSENSOR_OBJID,
+    MAGSENSOR_OBJID,
+    AUXMAGSENSOR_OBJID,
+    BAROSENSOR_OBJID,
+    AIRSPEEDSENSOR_OBJID,
+    GPSPOSITIONSENSOR_OBJID,
+    GPSVELOCITYSENSOR_OBJID,
+    FLIGHTSTATUS_OBJID,
+};
+
+#define EKF_PARAMETER(field, elem) { "EKFConfiguration." #field "." #elem, &EKFConfigurationHandle, offsetof(EKFConfigurationData, field.elem) }
+#define REVO_PARAMETER(field)      { "RevoSettings." #field, &RevoSettingsHandle, offsetof(RevoSettingsData, field) }
+
+// Settings that can be overridden, all floats
+static const ReplayParameter parameters[] = {
+    EKF_PARAMETER(P, PositionNorth),
+    EKF_PARAMETER(P, PositionEast),
+    EKF_PARAMETER(P, PositionDown),
+    EKF_PARAMETER(P, VelocityNorth),
+    EKF_PARAMETER(P, VelocityEast),
+    EKF_PARAMETER(P, VelocityDown),
+    EKF_PARAMETER(P, AttitudeQ1),
+    EKF_PARAMETER(P, AttitudeQ2),
+    EKF_PARAMETER(P, AttitudeQ3),
+    EKF_PARAMETER(P, AttitudeQ4),
+    EKF_PARAMETER(P, GyroDriftX),
+    EKF_PARAMETER(P, GyroDriftY),
+    EKF_PARAMETER(P, GyroDriftZ),
+    EKF_PARAMETER(Q, GyroX),
+    EKF_PARAMETER(Q, GyroY),
+    EKF_PARAMETER(Q, GyroZ),
+    EKF_PARAMETER(Q, AccelX),
+    EKF_PARAMETER(Q, AccelY),
+    EKF_PARAMETER(Q, AccelZ),
+    EKF_PARAMETER(Q, GyroDriftX),
+    EKF_PARAMETER(Q, GyroDriftY),
+    EKF_PARAMETER(Q, GyroDriftZ),
+    EKF_PARAMETER(R, GPSPosNorth),
+    EKF_PARAMETER(R, GPSPosEast),
+    EKF_PARAMETER(R, GPSPosDown),
+    EKF_PARAMETER(R, GPSVelNorth),
+    EKF_PARAMETER(R, GPSVelEast),
+    EKF_PARAMETER(R, GPSVelDown),
+    EKF_PARAMETER(R, MagX),
+    EKF_PARAMETER(R, MagY),
+    EKF_PARAMETER(R, MagZ),
+    EKF_PARAMETER(R, BaroZ),
+    EKF_PARAMETER(FakeR, FakeGPSPosIndoor),
+    EKF_PARAMETER(FakeR, FakeGPSVelIndoor),
+    EKF_PARAMETER(FakeR, FakeGPSVelAirspeed),
+    REVO_PARAMETER(BaroGPSOffsetCorrectionAlpha),
+    REVO_PARAMETER(MagnetometerMaxDeviation.Warning),
+    REVO_PARAMETER(MagnetometerMaxDeviation.Error),
+    REVO_PARAMETER(VelocityPostProcessingLowPassAlpha),
+};
+
+// Private functions
+static bool replayObject(uint32_t objId, const ReplayOptions *options);
+static void applyOverrides(UAVObjHandle obj, const ReplayOptions *options);
+static void advanceClock(uint64_t timeUs);
+static void runCallbacks(void);
+static void attitudeUpdatedCb(UAVObjEvent *ev);
+
+// The module has no header, its init call is made from here
+int32_t StateEstimationInitialize(void);
+int32_t StateEstimationStart(void);
+
+/**
+ * Register all objects and start the StateEstimation module on default settings.
+ * The filters keep their state in static variables, so there is one replay per process.
+ * \return 0 on success, -1 on failure
+ */
+int32_t ReplayInitialize(void)
+{
+    clockUs = 0;
+
+    if (UAVObjInitialize() != 0) {
+        return -1;
+    }
+    UAVObjectsInitializeAll();
+    AlarmsInitialize();
+
+    if (StateEstimationInitialize() != 0 || StateEstimationStart() != 0) {
+        return -1;
+    }
+
+    AttitudeStateConnectCallback(&attitudeUpdatedCb);
+
+    return 0;
+}
+
+/**
+ * Replay a log through the StateEstimation module as fast as possible
+ * \param[in] log to replay from its current position
+ * \param[in] options settings to force on top of the logged ones
+ * \param[in] output called on every attitude update, may be NULL
+ * \param[in] context passed to output
+ * \param[out] stats of the run, may be NULL
+ * \return 0 on success, -1 on failure
+ */
+int32_t ReplayRun(ReplayLog *log, const ReplayOptions *options, ReplayOutput output, void *context, ReplayStats *stats)
+{
+    ReplayLogUpdate update;
+    bool first = true;
+    uint64_t startUs = 0;
+
+    memset(&runStats, 0, sizeof(runStats));
+    runOutput  = output;
+    runContext = context;
+
+    applyOverrides(NULL, options);
+    runCallbacks();
+
+    while (ReplayLogNext(log, &update)) {
+        runStats.updates++;
+        if (first) {
+            // the clock starts with the log, so nothing times out before the first sample
+            clockUs = update.timeUs;
+            startUs = update.timeUs;
+            first   = false;
+        }
+        if (!replayObject(update.objId, options)) {
+            continue;
+        }
+
+        advanceClock(update.timeUs);
+        if (ReplayLogApply(log) != 0) {
+            continue;
+        }
+        runStats.replayed++;
+
+        UAVObjHandle obj = UAVObjGetByID(update.objId);
+        if (UAVObjIsSettings(obj)) {
+            applyOverrides(obj, options);
+        }
+
+        runCallbacks();
+    }
+    runStats.durationUs = clockUs - startUs;
+
+    if (stats) {
+        *stats = runStats;
+    }
+
+    return 0;
+}
+
+/**
+ * Number of settings that can be overridden
+ */
+uint8_t ReplayGetNumParameters(void)
+{
+    return NELEMENTS(parameters);
+}
+
+/**
+ * Look up a setting by its name, e.g. EKFConfiguration.Q.GyroX
+ * \return the parameter index or -1 if unknown
+ */
+int32_t ReplayFindParameter(const char *name)
+{
+    for (uint8_t i = 0; i < NELEMENTS(parameters); i++) {
+        if (!strcasecmp(name, parameters[i].name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Add an override given as "Name=value"
+ * \param[in] arg override, the name as listed by ReplayGetParameterName()
+ * \return 0 on success, -1 if the setting is unknown, the value is no number or there are too many overrides
+ */
+int32_t ReplayAddOverride(ReplayOptions *options, const char *arg)
+{
+    const char *value = strchr(arg, '=');
+    char name[64];
+
+    if (!value || value - arg >= (int)sizeof(name) || options->numOverrides >= REPLAY_MAX_OVERRIDES) {
+        return -1;
+    }
+    memcpy(name, arg, value - arg);
+    name[value - arg] = '\0';
+    value++;
+
+    int32_t param = ReplayFindParameter(name);
+    char *end;
+    float number  = strtof(value, &end);
+    if (param < 0 || end == value || *end) {
+        return -1;
+    }
+
+    options->overrides[options->numOverrides].param = param;
+    options->overrides[options->numOverrides].value = number;
+    options->numOverrides++;
+
+    return 0;
+}
+
+const char *ReplayGetParameterName(uint8_t param)
+{
+    PIOS_Assert(param < NELEMENTS(parameters));
+    return parameters[param].name;
+}
+
+/**
+ * Current value of a setting, the default one until a log is replayed
+ */
+float ReplayGetParameter(uint8_t param)
+{
+    float value;
+
+    PIOS_Assert(param < NELEMENTS(parameters));
+    UAVObjGetDataField(parameters[param].handle(), &value, parameters[param].offset, sizeof(value));
+    return value;
+}
+
+static bool replayObject(uint32_t objId, const ReplayOptions *options)
+{
+    for (uint8_t i = 0; i < NELEMENTS(sensorObjects); i++) {
+        if (objId == sensorObjects[i]) {
+            return true;
+        }
+    }
+
+    UAVObjHandle obj = UAVObjGetByID(objId);
+    return obj && UAVObjIsSettings(obj) && !options->ignoreSettings;
+}
+
+/**
+ * Force the overridden settings of an object again after the log changed it,
+ * or of all objects when obj is NULL
+ */
+static void applyOverrides(UAVObjHandle obj, const ReplayOptions *options)
+{
+    if (options->fusionAlgorithm >= 0 && (!obj || obj == RevoSettingsHandle())) {
+        RevoSettingsFusionAlgorithmOptions fusionAlgorithm = options->fusionAlgorithm;
+        RevoSettingsFusionAlgorithmSet(&fusionAlgorithm);
+    }
+
+    for (uint8_t i = 0; i < options->numOverrides; i++) {
+        const ReplayParameter *param = &parameters[options->overrides[i].param];
+        if (!obj || obj == param->handle()) {
+            UAVObjSetDataField(param->handle(), &options->overrides[i].value, param->offset, sizeof(float));
+        }
+    }
+}
+
+/**
+ * Move the clock forward to the time of the next update, running the
+ * callbacks that are scheduled on the way at their own time
+ */
+static void advanceClock(uint64_t timeUs)
+{
+    while (true) {
+        DelayedCallbackInfo *next = NULL;
+        for (DelayedCallbackInfo *cbinfo = callbacks; cbinfo; cbinfo = cbinfo->next) {
+            if (cbinfo->scheduleUs && cbinfo->scheduleUs <= timeUs &&
+                (!next || cbinfo->scheduleUs < next->scheduleUs)) {
+                next = cbinfo;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        if (next->scheduleUs > clockUs) {
+            clockUs = next->scheduleUs;
+        }
+        runCallbacks();
+    }
+
+    // the log time can step back a little between records, the clock does not
+    if (timeUs > clockUs) {
+        clockUs = timeUs;
+    }
+}
+
+/**
+ * Run every dispatched or due callback, until none is left, and report
+ * the attitude updates they made
+ */
+static void runCallbacks(void)
+{
+    bool ran;
+
+    do {
+        ran = false;
+        for (DelayedCallbackInfo *cbinfo = callbacks; cbinfo; cbinfo = cbinfo->next) {
+            if (cbinfo->scheduleUs && cbinfo->scheduleUs <= clockUs) {
+                cbinfo->waiting = true;
+            }
+            if (cbinfo->waiting) {
+                cbinfo->scheduleUs = 0; // any schedules are reset
+                cbinfo->waiting    = false;
+                cbinfo->cb();
+                runStats.estimations++;
+                ran = true;
+
+                if (attitudeUpdated) {
+                    attitudeUpdated = false;
+                    runStats.outputs++;
+                    if (runOutput) {
+                        runOutput(clockUs, runContext);
+                    }
+                }
+            }
+        }
+    } while (ran);
+}
+
+static void attitudeUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
+{
+    attitudeUpdated = true;
+}
+
+/*
+ * PIOS and FreeRTOS services the module uses, driven by the replay clock.
+ * Object callbacks are dispatched immediately, scheduler callbacks are run
+ * by runCallbacks() after each update.
+ */
+
+uint32_t PIOS_DELAY_GetRaw(void)
+{
+    return (uint32_t)clockUs;
+}
+
+uint32_t PIOS_DELAY_GetuS(void)
+{
+    return (uint32_t)clockUs;
+}
+
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+    return (uint32_t)clockUs - raw;
+}
+
+portTickType xTaskGetTickCount(void)
+{
+    return (portTickType)(clockUs / 1000);
+}
+
+int xQueueSend(__attribute__((unused)) xQueueHandle queue, __attribute__((unused)) const void *item, __attribute__((unused)) unsigned int timeout)
+{
+    return pdTRUE;
+}
+
+int32_t EventCallbackDispatch(UAVObjEvent *ev, UAVObjEventCallback cb)
+{
+    cb(ev);
+    return 0;
+}
+
+void PIOS_NOTIFY_StartNotification(__attribute__((unused)) pios_notify_notification notification, __attribute__((unused)) pios_notify_priority priority)
+{}
+
+DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(DelayedCallback cb, __attribute__((unused)) DelayedCallbackPriority priority,
+                                                   __attribute__((unused)) DelayedCallbackPriorityTask priorityTask,
+                                                   __attribute__((unused)) int16_t callbackID, __attribute__((unused)) uint32_t stacksize)
+{
+    DelayedCallbackInfo *cbinfo = calloc(1, sizeof(DelayedCallbackInfo));
+
+    if (cbinfo) {
+        cbinfo->cb = cb;
+        LL_APPEND(callbacks, cbinfo);
+    }
+    return cbinfo;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Dispatch(DelayedCallbackInfo *cbinfo)
+{
+    PIOS_Assert(cbinfo);
+    cbinfo->waiting = true;
+    return 1;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Schedule(DelayedCallbackInfo *cbinfo, int32_t milliseconds, DelayedCallbackUpdateMode updatemode)
+{
+    int32_t result = 0;
+
+    PIOS_Assert(cbinfo);
+
+    if (milliseconds <= 0) {
+        milliseconds = 0;
+    }
+
+    // on tick boundaries, as the firmware scheduler
+    uint64_t scheduleUs = (clockUs / 1000 + milliseconds) * 1000;
+    if (!scheduleUs) {
+        scheduleUs = 1;
+    }
+
+    if (!cbinfo->scheduleUs
+        || ((updatemode & CALLBACK_UPDATEMODE_SOONER) && scheduleUs < cbinfo->scheduleUs)
+        || ((updatemode & CALLBACK_UPDATEMODE_LATER) && scheduleUs > cbinfo->scheduleUs)) {
+        result = cbinfo->scheduleUs ? 2 : 1;
+        cbinfo->scheduleUs = scheduleUs;
+    }
+
+    return result;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,314 @@
+/**
+ ******************************************************************************
+ * @addtogroup EKFReplay Offline state estimation replay
+ * @{
+ *
+ * @file       replaylog.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2017.
+ * @brief      Readers for GCS .opl logs and onboard DebugLogEntry dumps.
+ *             Both are read to memory once and can be replayed again after
+ *             a rewind. GCS logs are parsed with the flight UAVTalk code, so
+ *             every frame type the flight side accepts replays.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "replaylog.h"
+#include <debuglogentry.h>
+
+// Private constants
+#define OPL_HEADER_LENGTH      (sizeof(uint32_t) + sizeof(int64_t))
+#define DEBUGLOG_ENTRY_LENGTH  sizeof(DebugLogEntryDataPacked)
+#define DEBUGLOG_DATA_LENGTH   sizeof(((DebugLogEntryDataPacked *)0)->Data)
+#define DEBUGLOG_HEADER_LENGTH (DEBUGLOG_ENTRY_LENGTH - DEBUGLOG_DATA_LENGTH)
+#define DEBUGLOG_FLIGHT_GAP_US 1000000
+
+// Private types
+struct ReplayLogStruct {
+    ReplayLogFormat format;
+    uint8_t *data;
+    size_t   length;
+    size_t   offset; // next record (opl) or entry (debuglog)
+    uint64_t timeUs;
+
+    // opl
+    UAVTalkConnection connection;
+    uint8_t *record;
+    size_t   recordLength;
+    size_t   recordPosition;
+
+    // debuglog
+    uint32_t subOffset; // next object inside the current entry, 0 for the entry itself
+    uint32_t lastFlightTime;
+    uint16_t lastFlight;
+    bool     timeValid;
+    DebugLogEntryData current; // header of the last update, the data follows it in the log
+    const uint8_t *currentData;
+};
+
+// Private functions
+static bool oplNext(ReplayLog *log, ReplayLogUpdate *update);
+static bool debugLogNext(ReplayLog *log, ReplayLogUpdate *update);
+static int32_t debugLogApply(ReplayLog *log);
+static int32_t nullOutputStream(uint8_t *data, int32_t length);
+
+/**
+ * Read a log to memory
+ * \param[in] path file to read
+ * \param[in] format of the file, REPLAYLOG_FORMAT_AUTO picks it from the extension
+ * \return the log or NULL on error
+ */
+ReplayLog *ReplayLogOpen(const char *path, ReplayLogFormat format)
+{
+    FILE *file = fopen(path, "rb");
+
+    if (!file) {
+        return NULL;
+    }
+
+    ReplayLog *log = calloc(1, sizeof(ReplayLog));
+    if (!log) {
+        fclose(file);
+        return NULL;
+    }
+
+    if (format == REPLAYLOG_FORMAT_AUTO) {
+        const char *extension = strrchr(path, '.');
+        format = (extension && !strcasecmp(extension, ".opl")) ? REPLAYLOG_FORMAT_OPL : REPLAYLOG_FORMAT_DEBUGLOG;
+    }
+    log->format = format;
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length > 0) {
+        log->data = malloc(length);
+    }
+    if (!log->data || fread(log->data, 1, length, file) != (size_t)length) {
+        fclose(file);
+        ReplayLogClose(log);
+        return NULL;
+    }
+    fclose(file);
+    log->length = length;
+
+    if (format == REPLAYLOG_FORMAT_OPL) {
+        log->connection = UAVTalkInitialize(&nullOutputStream);
+        if (!log->connection) {
+            ReplayLogClose(log);
+            return NULL;
+        }
+    } else if (log->length % DEBUGLOG_ENTRY_LENGTH) {
+        // not a dump of whole entries, or written with another DebugLogEntry definition
+        ReplayLogClose(log);
+        return NULL;
+    }
+
+    ReplayLogRewind(log);
+
+    return log;
+}
+
+/**
+ * Free a log. The UAVTalk connection of an .opl log is not released, the
+ * flight UAVTalk code has no way to do so.
+ */
+void ReplayLogClose(ReplayLog *log)
+{
+    if (log) {
+        free(log->data);
+        free(log);
+    }
+}
+
+/**
+ * Start over from the first update of the log
+ */
+void ReplayLogRewind(ReplayLog *log)
+{
+    log->offset         = 0;
+    log->timeUs         = 0;
+    log->record         = NULL;
+    log->recordLength   = 0;
+    log->recordPosition = 0;
+    log->subOffset      = 0;
+    log->timeValid      = false;
+    log->currentData    = NULL;
+}
+
+/**
+ * Find the next object update in the log
+ * \param[out] update time and object of the update
+ * \return false at the end of the log
+ */
+bool ReplayLogNext(ReplayLog *log, ReplayLogUpdate *update)
+{
+    if (log->format == REPLAYLOG_FORMAT_OPL) {
+        return oplNext(log, update);
+    }
+    return debugLogNext(log, update);
+}
+
+/**
+ * Unpack the update returned by the last ReplayLogNext() into its object,
+ * the object update callbacks run from here.
+ * \return 0 on success, -1 if the object is unknown or does not match
+ */
+int32_t ReplayLogApply(ReplayLog *log)
+{
+    if (log->format == REPLAYLOG_FORMAT_OPL) {
+        return UAVTalkReceiveObject(log->connection);
+    }
+    return debugLogApply(log);
+}
+
+/**
+ * Parse the UAVTalk stream of the log record by record. The UAVTalk parser
+ * takes at most 255 bytes at a time, a frame that spans two of those chunks
+ * or two records goes through its byte state machine.
+ */
+static bool oplNext(ReplayLog *log, ReplayLogUpdate *update)
+{
+    while (true) {
+        if (log->recordPosition >= log->recordLength) {
+            uint32_t timestamp;
+            int64_t size;
+
+            if (log->offset + OPL_HEADER_LENGTH > log->length) {
+                return false;
+            }
+            memcpy(&timestamp, &log->data[log->offset], sizeof(timestamp));
+            memcpy(&size, &log->data[log->offset + sizeof(timestamp)], sizeof(size));
+            log->offset += OPL_HEADER_LENGTH;
+            if (size < 0 || (uint64_t)size > log->length - log->offset) {
+                // truncated log
+                return false;
+            }
+            log->timeUs         = (uint64_t)timestamp * 1000;
+            log->record         = &log->data[log->offset];
+            log->recordLength   = size;
+            log->recordPosition = 0;
+            log->offset        += size;
+            continue;
+        }
+
+        size_t remaining = log->recordLength - log->recordPosition;
+        uint8_t length   = (remaining > 255) ? 255 : remaining;
+        uint8_t position = 0;
+        UAVTalkRxState state = UAVTalkProcessInputStreamQuiet(log->connection, &log->record[log->recordPosition], length, &position);
+
+        // the parser always consumes something, do not get stuck if it did not
+        log->recordPosition += position ? position : 1;
+
+        if (state == UAVTALK_STATE_COMPLETE) {
+            update->timeUs = log->timeUs;
+            update->objId  = UAVTalkGetPacketObjId(log->connection);
+            return true;
+        }
+    }
+}
+
+/**
+ * Walk the entries of the dump, and the objects packed behind the first one
+ * in entries of type MultipleUAVObjects, the same way the GCS flight log
+ * download does. Unused space in an entry is 0xFF, which ends the walk as the
+ * size read from there does not fit.
+ */
+static bool debugLogNext(ReplayLog *log, ReplayLogUpdate *update)
+{
+    while (log->offset + DEBUGLOG_ENTRY_LENGTH <= log->length) {
+        const uint8_t *entry = &log->data[log->offset];
+        DebugLogEntryData header;
+
+        memcpy(&header, entry, DEBUGLOG_HEADER_LENGTH);
+
+        if (header.Type != DEBUGLOGENTRY_TYPE_UAVOBJECT && header.Type != DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS) {
+            log->offset += DEBUGLOG_ENTRY_LENGTH;
+            log->subOffset = 0;
+            continue;
+        }
+
+        const uint8_t *data = &entry[DEBUGLOG_HEADER_LENGTH];
+        if (log->subOffset == 0) {
+            // the object stored in the entry itself
+            if (header.Size > DEBUGLOG_DATA_LENGTH) {
+                log->offset += DEBUGLOG_ENTRY_LENGTH;
+                continue;
+            }
+            log->subOffset = header.Size;
+        } else if (header.Type == DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS &&
+                   log->subOffset + DEBUGLOG_HEADER_LENGTH + 1 < DEBUGLOG_DATA_LENGTH) {
+            uint32_t start = log->subOffset;
+            memcpy(&header, &data[start], DEBUGLOG_HEADER_LENGTH);
+            log->subOffset += DEBUGLOG_HEADER_LENGTH + header.Size;
+            if (log->subOffset > DEBUGLOG_DATA_LENGTH) {
+                continue;
+            }
+            data = &data[start + DEBUGLOG_HEADER_LENGTH];
+        } else {
+            log->offset   += DEBUGLOG_ENTRY_LENGTH;
+            log->subOffset = 0;
+            continue;
+        }
+
+        // FlightTime is the 32 bit microsecond clock, it wraps every 71 minutes
+        if (!log->timeValid) {
+            log->timeValid = true;
+        } else if (header.Flight != log->lastFlight) {
+            // flights are replayed back to back
+            log->timeUs += DEBUGLOG_FLIGHT_GAP_US;
+        } else {
+            log->timeUs += (uint32_t)(header.FlightTime - log->lastFlightTime);
+        }
+        log->lastFlight     = header.Flight;
+        log->lastFlightTime = header.FlightTime;
+
+        log->current     = header;
+        log->currentData = data;
+
+        update->timeUs   = log->timeUs;
+        update->objId    = header.ObjectID;
+        return true;
+    }
+
+    return false;
+}
+
+static int32_t debugLogApply(ReplayLog *log)
+{
+    if (!log->currentData) {
+        return -1;
+    }
+
+    UAVObjHandle obj = UAVObjGetByID(log->current.ObjectID);
+    if (!obj || UAVObjGetNumBytes(obj) != log->current.Size) {
+        return -1;
+    }
+
+    return UAVObjUnpack(obj, log->current.InstanceID, log->currentData);
+}
+
+static int32_t nullOutputStream(__attribute__((unused)) uint8_t *data, int32_t length)
+{
+    return length;
+}
+
+/**
+ * @}
+ */
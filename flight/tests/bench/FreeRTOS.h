@@ -0,0 +1,66 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define pvPortMalloc(xSize) (malloc(xSize))
+#define vPortFree(pv)       (free(pv))
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       0xffffffff
+#define portTICK_RATE_MS    1
+
+typedef uint32_t portTickType;
+typedef pthread_mutex_t *xSemaphoreHandle;
+typedef void *xQueueHandle;
+
+static inline xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    pthread_mutexattr_t attr;
+    xSemaphoreHandle sem = (xSemaphoreHandle)malloc(sizeof(pthread_mutex_t));
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(sem, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return sem;
+}
+
+static inline int xSemaphoreTakeRecursive(xSemaphoreHandle sem, __attribute__((unused)) unsigned int timeout)
+{
+    return pthread_mutex_lock(sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline int xSemaphoreGiveRecursive(xSemaphoreHandle sem)
+{
+    return pthread_mutex_unlock(sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+/* The benchmarks never wait on a response, binary semaphores never block */
+#define vSemaphoreCreateBinary(sem) ((sem) = xSemaphoreCreateRecursiveMutex())
+
+static inline int xSemaphoreTake(__attribute__((unused)) xSemaphoreHandle sem, __attribute__((unused)) unsigned int timeout)
+{
+    return pdFALSE;
+}
+
+static inline int xSemaphoreGive(__attribute__((unused)) xSemaphoreHandle sem)
+{
+    return pdTRUE;
+}
+
+static inline portTickType xTaskGetTickCount(void)
+{
+    return 0;
+}
+
+/* Nobody listens to the benchmark objects */
+static inline int xQueueSend(__attribute__((unused)) xQueueHandle queue, __attribute__((unused)) const void *item, __attribute__((unused)) unsigned int timeout)
+{
+    return pdTRUE;
+}
+
+#endif /* FREERTOS_H */
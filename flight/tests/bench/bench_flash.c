@@ -0,0 +1,74 @@
+/*
+ * A RAM backed NOR flash so that the logfs benchmark measures the filesystem
+ * and not the host's file I/O.  Like real NOR, writes can only clear bits.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "pios.h"
+#include "pios_flashfs_logfs_priv.h"
+#include "bench_flash.h"
+
+#define BENCH_FLASH_SIZE  0x00100000 /* 1M bytes */
+#define BENCH_SECTOR_SIZE 0x00010000 /* 64K bytes */
+
+static uint8_t *bench_flash;
+
+static int32_t bench_flash_start_transaction(__attribute__((unused)) uintptr_t flash_id)
+{
+    return 0;
+}
+
+static int32_t bench_flash_end_transaction(__attribute__((unused)) uintptr_t flash_id)
+{
+    return 0;
+}
+
+static int32_t bench_flash_erase_sector(__attribute__((unused)) uintptr_t flash_id, uint32_t addr)
+{
+    memset(&bench_flash[addr & ~(BENCH_SECTOR_SIZE - 1)], 0xFF, BENCH_SECTOR_SIZE);
+    return 0;
+}
+
+static int32_t bench_flash_write_data(__attribute__((unused)) uintptr_t flash_id, uint32_t addr, uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        bench_flash[addr + i] &= data[i];
+    }
+    return 0;
+}
+
+static int32_t bench_flash_read_data(__attribute__((unused)) uintptr_t flash_id, uint32_t addr, uint8_t *data, uint16_t len)
+{
+    memcpy(data, &bench_flash[addr], len);
+    return 0;
+}
+
+const struct pios_flash_driver bench_flash_driver = {
+    .start_transaction = bench_flash_start_transaction,
+    .end_transaction   = bench_flash_end_transaction,
+    .erase_sector      = bench_flash_erase_sector,
+    .write_data        = bench_flash_write_data,
+    .read_data         = bench_flash_read_data,
+};
+
+const struct flashfs_logfs_cfg bench_flashfs_config = {
+    .fs_magic      = 0x89abceef,
+    .total_fs_size = BENCH_FLASH_SIZE, /* 1M bytes (16 sectors) */
+    .arena_size    = 0x00010000, /* 256 * slot size */
+    .slot_size     = 0x00000100, /* 256 bytes */
+
+    .start_offset  = 0,          /* start at the beginning of the chip */
+    .sector_size   = BENCH_SECTOR_SIZE,
+    .page_size     = 0x00000100, /* 256 bytes */
+};
+
+int32_t bench_flash_init(uintptr_t *fs_id)
+{
+    if (!bench_flash) {
+        bench_flash = malloc(BENCH_FLASH_SIZE);
+    }
+    memset(bench_flash, 0xFF, BENCH_FLASH_SIZE);
+
+    return PIOS_FLASHFS_Logfs_Init(fs_id, &bench_flashfs_config, &bench_flash_driver, 0);
+}
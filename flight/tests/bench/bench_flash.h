@@ -0,0 +1,9 @@
+#ifndef BENCH_FLASH_H
+#define BENCH_FLASH_H
+
+#include <stdint.h>
+
+/* Erase the RAM flash and mount a fresh logfs on it */
+int32_t bench_flash_init(uintptr_t *fs_id);
+
+#endif /* BENCH_FLASH_H */
@@ -0,0 +1,10 @@
+#include "openpilot.h"
+#include "bench_objects.h"
+
+/* Handle slots for the benchmark objects, laid out like the generated UAVO code does */
+UAVObjHandle bench_handles[BENCH_NUM_OBJECTS] __attribute__((section("_uavo_handles")));
+
+int32_t EventCallbackDispatch(__attribute__((unused)) UAVObjEvent *ev, __attribute__((unused)) UAVObjEventCallback cb)
+{
+    return pdTRUE;
+}
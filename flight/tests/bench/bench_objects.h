@@ -0,0 +1,9 @@
+#ifndef BENCH_OBJECTS_H
+#define BENCH_OBJECTS_H
+
+/* Roughly the number of objects linked into a full firmware */
+#define BENCH_NUM_OBJECTS 200
+
+extern UAVObjHandle bench_handles[BENCH_NUM_OBJECTS];
+
+#endif /* BENCH_OBJECTS_H */
@@ -0,0 +1,452 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <time.h> /* clock_gettime */
+
+extern "C" {
+#include "openpilot.h"
+#include "bench_objects.h"
+#include "bench_flash.h"
+#include "pios_flashfs_logfs_priv.h"
+#include "insgps.h"
+#include "pid.h"
+
+uint8_t bytewise_CRC_updateCRC(uint8_t crc, const uint8_t *data, int32_t length);
+uint16_t bytewise_CRC16_updateCRC(uint16_t crc, const uint8_t *data, int32_t length);
+uint32_t bytewise_CRC32_updateCRC(uint32_t crc, const uint8_t *data, int32_t length);
+}
+
+/*
+ * Microbenchmarks of the flight hot paths, built for the host.
+ *
+ * Every benchmark prints one line
+ *   BENCH <name> <iterations> <ns/op>
+ * to stdout and records <name> = <ns/op> as a test property, so
+ * "make ut_bench_xml" leaves the numbers in the JUnit XML report where
+ * a CI job can compare them against a previous run.
+ */
+
+#define BENCH_ITERATIONS   200000
+#define BENCH_OBJECT_BYTES 64
+#define BENCH_CRC_BYTES    256
+
+static double bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, uint32_t iterations, double start_ns)
+{
+    double ns_per_op = (bench_now_ns() - start_ns) / iterations;
+    char value[32];
+
+    printf("BENCH %s %u %.1f\n", name, iterations, ns_per_op);
+    snprintf(value, sizeof(value), "%.1f", ns_per_op);
+    testing::Test::RecordProperty(name, value);
+    EXPECT_GT(ns_per_op, 0.0);
+}
+
+static uint32_t bench_object_id(uint32_t n)
+{
+    /* Spread the IDs over the whole range like the generator's hashes do */
+    return (n * 2654435761u) ^ 0x5A5AA5A5u;
+}
+
+/* UAVTalk output goes into a buffer so that the parse benchmark can replay it */
+static uint8_t bench_stream[2 * BENCH_OBJECT_BYTES];
+static int32_t bench_stream_len;
+
+static int32_t bench_output(uint8_t *data, int32_t length)
+{
+    if (length <= (int32_t)sizeof(bench_stream)) {
+        memcpy(bench_stream, data, length);
+        bench_stream_len = length;
+    }
+    return length;
+}
+
+class UAVObjectBench : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(0, UAVObjInitialize());
+
+        for (uint32_t i = 0; i < BENCH_NUM_OBJECTS; i++) {
+            bench_handles[i] = UAVObjRegister(bench_object_id(i), true, false, false, BENCH_OBJECT_BYTES, 0, NULL);
+            ASSERT_TRUE(bench_handles[i] != NULL);
+        }
+    }
+};
+
+TEST_F(UAVObjectBench, GetByID) {
+    volatile UAVObjHandle sink;
+    double start = bench_now_ns();
+
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        sink = UAVObjGetByID(bench_object_id(i % BENCH_NUM_OBJECTS));
+    }
+    bench_report("UAVObjGetByID", BENCH_ITERATIONS, start);
+    EXPECT_EQ(bench_handles[(BENCH_ITERATIONS - 1) % BENCH_NUM_OBJECTS], sink);
+}
+
+TEST_F(UAVObjectBench, SetInstanceData) {
+    uint8_t data[BENCH_OBJECT_BYTES];
+    double start = bench_now_ns();
+
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        data[0] = i;
+        UAVObjSetInstanceData(bench_handles[i % BENCH_NUM_OBJECTS], 0, data);
+    }
+    bench_report("UAVObjSetInstanceData", BENCH_ITERATIONS, start);
+}
+
+TEST_F(UAVObjectBench, UAVTalkPack) {
+    UAVTalkConnection conn = UAVTalkInitialize(bench_output);
+
+    ASSERT_TRUE(conn != NULL);
+
+    double start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        UAVTalkSendObject(conn, bench_handles[i % BENCH_NUM_OBJECTS], 0, 0, 0);
+    }
+    bench_report("UAVTalkPack", BENCH_ITERATIONS, start);
+    /* 10 bytes header, 1 byte checksum */
+    EXPECT_EQ(BENCH_OBJECT_BYTES + 10 + 1, bench_stream_len);
+}
+
+TEST_F(UAVObjectBench, UAVTalkParse) {
+    UAVTalkConnection conn = UAVTalkInitialize(bench_output);
+    UAVTalkStats stats;
+
+    ASSERT_TRUE(conn != NULL);
+    ASSERT_EQ(0, UAVTalkSendObject(conn, bench_handles[0], 0, 0, 0));
+
+    uint8_t packet[sizeof(bench_stream)];
+    int32_t packet_len = bench_stream_len;
+    memcpy(packet, bench_stream, packet_len);
+
+    UAVTalkResetStats(conn);
+    double start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        UAVTalkProcessInputStream(conn, packet, packet_len);
+    }
+    bench_report("UAVTalkParse", BENCH_ITERATIONS, start);
+
+    UAVTalkGetStats(conn, &stats, false);
+    EXPECT_EQ((uint32_t)BENCH_ITERATIONS, stats.rxObjects);
+    EXPECT_EQ(0u, stats.rxErrors);
+}
+
+class INSGPSBench : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        INSGPSInit();
+    }
+
+    const float gyro[3]  = { 0.01f, -0.02f, 0.03f };
+    const float accel[3] = { 0.1f, -0.1f, -9.81f };
+};
+
+TEST_F(INSGPSBench, StatePrediction) {
+    double start = bench_now_ns();
+
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        INSStatePrediction(gyro, accel, 0.002f);
+    }
+    bench_report("INSStatePrediction", BENCH_ITERATIONS, start);
+}
+
+TEST_F(INSGPSBench, CovariancePrediction) {
+    INSStatePrediction(gyro, accel, 0.002f);
+
+    double start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        INSCovariancePrediction(0.002f);
+    }
+    bench_report("INSCovariancePrediction", BENCH_ITERATIONS / 10, start);
+}
+
+TEST_F(INSGPSBench, Correction) {
+    const float mag[3] = { 1.0f, 0.0f, 0.0f };
+    const float pos[3] = { 0.0f, 0.0f, 0.0f };
+
+    INSStatePrediction(gyro, accel, 0.002f);
+
+    /* Paired with a prediction so that P stays in its normal range */
+    double start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        INSCovariancePrediction(0.002f);
+        INSCorrection(mag, pos, pos, 0.0f, FULL_SENSORS);
+    }
+    bench_report("INSCovariancePrediction+INSCorrection", BENCH_ITERATIONS / 10, start);
+}
+
+/* Dense A*P*A' + T^2*G*Q*G' with A = I+F*T, the textbook form of the prediction */
+static void dense_covariance_prediction(float F[13][13], float G[13][9], float Q[9], float dT, float P[13][13])
+{
+    float AP[13][13];
+
+    for (int i = 0; i < 13; i++) {
+        for (int j = 0; j < 13; j++) {
+            float sum = P[i][j];
+            for (int k = 0; k < 13; k++) {
+                sum += dT * F[i][k] * P[k][j];
+            }
+            AP[i][j] = sum;
+        }
+    }
+    for (int i = 0; i < 13; i++) {
+        for (int j = 0; j < 13; j++) {
+            float sum = AP[i][j];
+            for (int k = 0; k < 13; k++) {
+                sum += dT * AP[i][k] * F[j][k];
+            }
+            for (int k = 0; k < 9; k++) {
+                sum += dT * dT * G[i][k] * Q[k] * G[j][k];
+            }
+            P[i][j] = sum;
+        }
+    }
+}
+
+TEST_F(INSGPSBench, CovariancePredictionMatchesDense) {
+    insgps_context *ins = (insgps_context *)malloc(ins_context_size());
+    const float mag[3]  = { 200.0f, 10.0f, 400.0f };
+    const float pos[3]  = { 1.0f, -2.0f, 3.0f };
+    const float vel[3]  = { 0.5f, 0.2f, -0.1f };
+    float F[13][13], G[13][9], Q[9], P[13][13], Pnew[13][13], Pdense[13][13];
+
+    ASSERT_TRUE(ins != NULL);
+    ins_init(ins);
+    ins_set_mag_north(ins, mag);
+
+    /* Correlate all the states before comparing */
+    for (uint32_t i = 0; i < 500; i++) {
+        ins_state_prediction(ins, gyro, accel, 0.002f);
+        ins_covariance_prediction(ins, 0.002f);
+        if (i % 10 == 0) {
+            ins_correction(ins, mag, pos, vel, pos[2], FULL_SENSORS);
+        }
+    }
+
+    ins_get_system(ins, F, G, Q, P);
+    memcpy(Pdense, P, sizeof(P));
+    dense_covariance_prediction(F, G, Q, 0.002f, Pdense);
+    ins_covariance_prediction(ins, 0.002f);
+    ins_get_system(ins, F, G, Q, Pnew);
+
+    for (int i = 0; i < 13; i++) {
+        for (int j = 0; j < 13; j++) {
+            float scale = sqrtf(Pdense[i][i] * Pdense[j][j]);
+            EXPECT_NEAR(Pdense[i][j], Pnew[i][j], 1e-5f * scale) << "P[" << i << "][" << j << "]";
+        }
+    }
+
+    double start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        dense_covariance_prediction(F, G, Q, 0.002f, P);
+    }
+    bench_report("DenseCovariancePrediction", BENCH_ITERATIONS / 10, start);
+    free(ins);
+}
+
+TEST_F(INSGPSBench, ContextsAreIndependent) {
+    insgps_context *shadow = (insgps_context *)malloc(ins_context_size());
+    const float still[3]   = { 0.0f, 0.0f, 0.0f };
+
+    ASSERT_TRUE(shadow != NULL);
+    ins_init(shadow);
+
+    /* The shadow filter must neither disturb nor follow the wrapped one */
+    for (uint32_t i = 0; i < 100; i++) {
+        INSStatePrediction(gyro, accel, 0.002f);
+        ins_state_prediction(shadow, still, accel, 0.002f);
+    }
+    EXPECT_NE(Nav.q[1], ins_get_nav(shadow)->q[1]);
+    EXPECT_FLOAT_EQ(1.0f, ins_get_nav(shadow)->q[0]);
+
+    ins_init(shadow);
+    INSGPSInit();
+    for (uint32_t i = 0; i < 100; i++) {
+        INSStatePrediction(gyro, accel, 0.002f);
+        ins_state_prediction(shadow, gyro, accel, 0.002f);
+    }
+    EXPECT_EQ(0, memcmp(&Nav, ins_get_nav(shadow), sizeof(Nav)));
+    free(shadow);
+}
+
+TEST_F(INSGPSBench, InnovationStats) {
+    const float still[3] = { 0.0f, 0.0f, 0.0f };
+    const float level[3] = { 0.0f, 0.0f, -9.81f };
+    float nis[10], rms[10];
+    float nisSum = 0.0f, rmsSum = 0.0f;
+    uint32_t seed = 1;
+
+    INSGetInnovationStats(nis, rms);
+    EXPECT_EQ(0.0f, nis[9]);
+
+    /* Baro noise that matches its variance must give an average NIS close to 1 */
+    INSSetBaroVar(0.25f);
+    for (uint32_t i = 0; i < 6000; i++) {
+        float u1, u2;
+        seed = seed * 1664525u + 1013904223u;
+        u1   = ((seed >> 8) + 1) / 16777217.0f;
+        seed = seed * 1664525u + 1013904223u;
+        u2   = (seed >> 8) / 16777216.0f;
+        /* Twice the noise for the last 1000, the averages must follow */
+        float sigma = (i < 5000) ? 0.5f : 1.0f;
+        float noise = sigma * sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+
+        INSStatePrediction(still, level, 0.002f);
+        INSCovariancePrediction(0.002f);
+        INSCorrection(still, still, still, noise, BARO_SENSOR);
+        /* A single moving average spreads by about 0.1, look at it over a while */
+        if (i >= 3000 && i < 5000) {
+            INSGetInnovationStats(nis, rms);
+            nisSum += nis[9];
+            rmsSum += rms[9];
+        }
+    }
+    EXPECT_NEAR(1.0f, nisSum / 2000, 0.1f);
+    EXPECT_NEAR(0.5f, rmsSum / 2000, 0.05f);
+    INSGetInnovationStats(nis, rms);
+    EXPECT_NEAR(4.0f, nis[9], 1.2f);
+    EXPECT_NEAR(1.0f, rms[9], 0.2f);
+    for (uint32_t i = 0; i < 9; i++) {
+        EXPECT_EQ(0.0f, nis[i]);
+        EXPECT_EQ(0.0f, rms[i]);
+    }
+
+    INSResetInnovationStats();
+    INSGetInnovationStats(nis, rms);
+    EXPECT_EQ(0.0f, nis[9]);
+}
+
+TEST(PIDBench, ApplySetpoint) {
+    struct pid pid;
+    pid_scaler scaler = { 1.0f, 1.0f, 1.0f };
+    volatile float sink = 0.0f;
+
+    pid_configure_derivative(25.0f, 1.0f);
+    pid_configure(&pid, 0.003f, 0.006f, 0.00003f, 0.3f);
+
+    double start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        sink = pid_apply_setpoint(&pid, &scaler, 10.0f, sink, 0.002f, (i & 1) != 0);
+    }
+    bench_report("pid_apply_setpoint", BENCH_ITERATIONS, start);
+}
+
+class CRCBench : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        for (uint32_t i = 0; i < sizeof(data); i++) {
+            data[i] = i * 7;
+        }
+    }
+
+    uint8_t data[BENCH_CRC_BYTES];
+};
+
+TEST_F(CRCBench, CRC8) {
+    volatile uint8_t crc = 0;
+    double start = bench_now_ns();
+
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        crc = PIOS_CRC_updateCRC(crc, data, sizeof(data));
+    }
+    bench_report("PIOS_CRC_updateCRC_256", BENCH_ITERATIONS / 10, start);
+
+    /* The byte at a time loop the slicing kernels replace */
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        crc = bytewise_CRC_updateCRC(crc, data, sizeof(data));
+    }
+    bench_report("PIOS_CRC_updateCRC_bytewise_256", BENCH_ITERATIONS / 10, start);
+}
+
+TEST_F(CRCBench, CRC16) {
+    volatile uint16_t crc = 0;
+    double start = bench_now_ns();
+
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        crc = PIOS_CRC16_updateCRC(crc, data, sizeof(data));
+    }
+    bench_report("PIOS_CRC16_updateCRC_256", BENCH_ITERATIONS / 10, start);
+
+    /* The byte at a time loop the slicing kernels replace */
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        crc = bytewise_CRC16_updateCRC(crc, data, sizeof(data));
+    }
+    bench_report("PIOS_CRC16_updateCRC_bytewise_256", BENCH_ITERATIONS / 10, start);
+}
+
+TEST_F(CRCBench, CRC32) {
+    volatile uint32_t crc = 0;
+    double start = bench_now_ns();
+
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        crc = PIOS_CRC32_updateCRC(crc, data, sizeof(data));
+    }
+    bench_report("PIOS_CRC32_updateCRC_256", BENCH_ITERATIONS / 10, start);
+
+    /* The byte at a time loop the slicing kernels replace */
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 10; i++) {
+        crc = bytewise_CRC32_updateCRC(crc, data, sizeof(data));
+    }
+    bench_report("PIOS_CRC32_updateCRC_bytewise_256", BENCH_ITERATIONS / 10, start);
+}
+
+class LogfsBench : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(0, bench_flash_init(&fs_id));
+        for (uint32_t i = 0; i < sizeof(obj); i++) {
+            obj[i] = 0x10 + (i % 10);
+        }
+    }
+
+    virtual void TearDown()
+    {
+        PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    }
+
+    uintptr_t fs_id;
+    uint8_t obj[BENCH_OBJECT_BYTES];
+};
+
+TEST_F(LogfsBench, ObjSave) {
+    /* Enough saves to wrap the arena a few times and include the compactions */
+    double start = bench_now_ns();
+
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 100; i++) {
+        obj[0] = i;
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, bench_object_id(i % 16), 0, obj, sizeof(obj)));
+    }
+    bench_report("PIOS_FLASHFS_ObjSave", BENCH_ITERATIONS / 100, start);
+}
+
+TEST_F(LogfsBench, ObjLoad) {
+    uint8_t loaded[BENCH_OBJECT_BYTES];
+
+    for (uint32_t i = 0; i < 16; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, bench_object_id(i), 0, obj, sizeof(obj)));
+    }
+
+    double start = bench_now_ns();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS / 100; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, bench_object_id(i % 16), 0, loaded, sizeof(loaded)));
+    }
+    bench_report("PIOS_FLASHFS_ObjLoad", BENCH_ITERATIONS / 100, start);
+    EXPECT_EQ(0, memcmp(obj, loaded, sizeof(obj)));
+}
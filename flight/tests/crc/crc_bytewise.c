@@ -0,0 +1,10 @@
+/* Byte-wise build of the CRC kernels, checked against the default build */
+#define PIOS_CRC_SLICES       1
+#define PIOS_CRC_updateByte   bytewise_CRC_updateByte
+#define PIOS_CRC_updateCRC    bytewise_CRC_updateCRC
+#define PIOS_CRC16_updateByte bytewise_CRC16_updateByte
+#define PIOS_CRC16_updateCRC  bytewise_CRC16_updateCRC
+#define PIOS_CRC32_updateByte bytewise_CRC32_updateByte
+#define PIOS_CRC32_updateCRC  bytewise_CRC32_updateCRC
+
+#include "pios_crc.c"
@@ -0,0 +1,10 @@
+/* Slicing-by-4 build of the CRC kernels, checked against the default build */
+#define PIOS_CRC_SLICES       4
+#define PIOS_CRC_updateByte   slice4_CRC_updateByte
+#define PIOS_CRC_updateCRC    slice4_CRC_updateCRC
+#define PIOS_CRC16_updateByte slice4_CRC16_updateByte
+#define PIOS_CRC16_updateCRC  slice4_CRC16_updateCRC
+#define PIOS_CRC32_updateByte slice4_CRC32_updateByte
+#define PIOS_CRC32_updateCRC  slice4_CRC32_updateCRC
+
+#include "pios_crc.c"
@@ -0,0 +1,8 @@
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdint.h>
+
+#include <pios_crc.h>
+
+#endif /* PIOS_H */
@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+
+extern "C" {
+#include "pios.h"
+
+uint8_t bytewise_CRC_updateCRC(uint8_t crc, const uint8_t *data, int32_t length);
+uint16_t bytewise_CRC16_updateCRC(uint16_t crc, const uint8_t *data, int32_t length);
+uint32_t bytewise_CRC32_updateCRC(uint32_t crc, const uint8_t *data, int32_t length);
+
+uint8_t slice4_CRC_updateCRC(uint8_t crc, const uint8_t *data, int32_t length);
+uint16_t slice4_CRC16_updateCRC(uint16_t crc, const uint8_t *data, int32_t length);
+uint32_t slice4_CRC32_updateCRC(uint32_t crc, const uint8_t *data, int32_t length);
+}
+
+#define CRC_MAX_LENGTH 80
+#define CRC_MAX_OFFSET 8
+
+static const uint8_t check_string[] = "123456789";
+
+// To use a test fixture, derive a class from testing::Test.
+class CrcTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        srand(1234);
+        for (uint32_t i = 0; i < sizeof(buffer); i++) {
+            buffer[i] = rand();
+        }
+    }
+
+    uint8_t buffer[CRC_MAX_LENGTH + CRC_MAX_OFFSET];
+};
+
+TEST_F(CrcTest, CheckValues) {
+    /* CRC-8 */
+    EXPECT_EQ(0xf4, PIOS_CRC_updateCRC(0, check_string, 9));
+    /* CRC-16/X-25 without the final inversion */
+    EXPECT_EQ(0x906e ^ 0xffff, PIOS_CRC16_updateCRC(0xffff, check_string, 9));
+    /* CRC-32/MPEG-2 */
+    EXPECT_EQ(0x0376e6e7u, PIOS_CRC32_updateCRC(0xffffffff, check_string, 9));
+}
+
+TEST_F(CrcTest, CRC8MatchesByteWise) {
+    for (uint32_t offset = 0; offset < CRC_MAX_OFFSET; offset++) {
+        for (int32_t length = 0; length <= CRC_MAX_LENGTH; length++) {
+            uint8_t seed = rand();
+            uint8_t crc  = seed;
+
+            for (int32_t i = 0; i < length; i++) {
+                crc = PIOS_CRC_updateByte(crc, buffer[offset + i]);
+            }
+            ASSERT_EQ(crc, bytewise_CRC_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+            ASSERT_EQ(crc, slice4_CRC_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+            ASSERT_EQ(crc, PIOS_CRC_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+        }
+    }
+}
+
+TEST_F(CrcTest, CRC16MatchesByteWise) {
+    for (uint32_t offset = 0; offset < CRC_MAX_OFFSET; offset++) {
+        for (int32_t length = 0; length <= CRC_MAX_LENGTH; length++) {
+            uint16_t seed = rand();
+            uint16_t crc  = seed;
+
+            for (int32_t i = 0; i < length; i++) {
+                crc = PIOS_CRC16_updateByte(crc, buffer[offset + i]);
+            }
+            ASSERT_EQ(crc, bytewise_CRC16_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+            ASSERT_EQ(crc, slice4_CRC16_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+            ASSERT_EQ(crc, PIOS_CRC16_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+        }
+    }
+}
+
+TEST_F(CrcTest, CRC32MatchesByteWise) {
+    for (uint32_t offset = 0; offset < CRC_MAX_OFFSET; offset++) {
+        for (int32_t length = 0; length <= CRC_MAX_LENGTH; length++) {
+            uint32_t seed = ((uint32_t)rand() << 16) ^ rand();
+            uint32_t crc  = seed;
+
+            for (int32_t i = 0; i < length; i++) {
+                crc = PIOS_CRC32_updateByte(crc, buffer[offset + i]);
+            }
+            ASSERT_EQ(crc, bytewise_CRC32_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+            ASSERT_EQ(crc, slice4_CRC32_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+            ASSERT_EQ(crc, PIOS_CRC32_updateCRC(seed, &buffer[offset], length)) << offset << "/" << length;
+        }
+    }
+}
+
+TEST_F(CrcTest, SplitBuffersChain) {
+    /* A CRC computed in pieces must match the one computed at once, as UAVTalk does while parsing */
+    for (int32_t split = 0; split <= CRC_MAX_LENGTH; split++) {
+        uint8_t crc8 = PIOS_CRC_updateCRC(0, buffer, split);
+        crc8 = PIOS_CRC_updateCRC(crc8, &buffer[split], CRC_MAX_LENGTH - split);
+        EXPECT_EQ(PIOS_CRC_updateCRC(0, buffer, CRC_MAX_LENGTH), crc8);
+
+        uint32_t crc32 = PIOS_CRC32_updateCRC(0xffffffff, buffer, split);
+        crc32 = PIOS_CRC32_updateCRC(crc32, &buffer[split], CRC_MAX_LENGTH - split);
+        EXPECT_EQ(PIOS_CRC32_updateCRC(0xffffffff, buffer, CRC_MAX_LENGTH), crc32);
+    }
+}
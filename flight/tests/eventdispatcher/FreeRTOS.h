@@ -0,0 +1,42 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define pvPortMalloc(xSize)      (malloc(xSize))
+#define vPortFree(pv)            (free(pv))
+
+#define pdTRUE                   1
+#define pdFALSE                  0
+#define portMAX_DELAY            0xffffffff
+#define portTICK_RATE_MS         1
+#define tskIDLE_PRIORITY         0
+#define configMINIMAL_STACK_SIZE 128
+
+typedef void *xSemaphoreHandle;
+typedef void *xQueueHandle;
+
+/* Single threaded test, the locks are no-ops */
+static inline xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    return (xSemaphoreHandle)1;
+}
+
+static inline int xSemaphoreTakeRecursive(__attribute__((unused)) xSemaphoreHandle sem, __attribute__((unused)) unsigned int timeout)
+{
+    return pdTRUE;
+}
+
+static inline int xSemaphoreGiveRecursive(__attribute__((unused)) xSemaphoreHandle sem)
+{
+    return pdTRUE;
+}
+
+/* Time and queues are simulated by the unit test */
+uint32_t xTaskGetTickCount(void);
+xQueueHandle xQueueCreate(unsigned int length, unsigned int itemSize);
+int xQueueSend(xQueueHandle queue, const void *item, unsigned int timeout);
+int xQueueReceive(xQueueHandle queue, void *item, unsigned int timeout);
+
+#endif /* FREERTOS_H */
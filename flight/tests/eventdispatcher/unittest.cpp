@@ -0,0 +1,204 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <deque>
+#include <map>
+
+extern "C" {
+#include "openpilot.h"
+}
+
+#define UT_NUM_EVENTS 64
+
+/* Simulated system time */
+static uint32_t ut_ticks = 1000;
+
+/* Simulated queues, one deque of events per queue handle */
+static std::map<xQueueHandle, std::deque<UAVObjEvent> > ut_queues;
+static std::map<UAVObjHandle, uint32_t> ut_sent;
+
+static DelayedCallback ut_event_task;
+
+extern "C" {
+uint32_t xTaskGetTickCount(void)
+{
+    return ut_ticks;
+}
+
+xQueueHandle xQueueCreate(__attribute__((unused)) unsigned int length, __attribute__((unused)) unsigned int itemSize)
+{
+    /* The dispatcher queue itself is never used by these tests */
+    return (xQueueHandle)&ut_queues;
+}
+
+int xQueueSend(xQueueHandle queue, const void *item, __attribute__((unused)) unsigned int timeout)
+{
+    const UAVObjEvent *ev = (const UAVObjEvent *)item;
+
+    ut_queues[queue].push_back(*ev);
+    ++ut_sent[ev->obj];
+    return pdTRUE;
+}
+
+int xQueueReceive(xQueueHandle queue, void *item, __attribute__((unused)) unsigned int timeout)
+{
+    if (ut_queues[queue].empty()) {
+        return pdFALSE;
+    }
+    memcpy(item, &ut_queues[queue].front(), sizeof(UAVObjEvent));
+    ut_queues[queue].pop_front();
+    return pdTRUE;
+}
+
+DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(DelayedCallback cb, __attribute__((unused)) DelayedCallbackPriority priority,
+                                                   __attribute__((unused)) DelayedCallbackPriorityTask priorityTask,
+                                                   __attribute__((unused)) int16_t callbackID, __attribute__((unused)) uint32_t stacksize)
+{
+    ut_event_task = cb;
+    return (DelayedCallbackInfo *)&ut_event_task;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Dispatch(__attribute__((unused)) DelayedCallbackInfo *cbinfo)
+{
+    return 1;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Schedule(__attribute__((unused)) DelayedCallbackInfo *cbinfo, __attribute__((unused)) int32_t milliseconds,
+                                        __attribute__((unused)) DelayedCallbackUpdateMode updatemode)
+{
+    return 1;
+}
+
+uint32_t UAVObjGetID(UAVObjHandle obj)
+{
+    return (uint32_t)(uintptr_t)obj;
+}
+}
+
+/* Run the event task once per simulated millisecond */
+static void ut_run_ms(uint32_t ms)
+{
+    for (uint32_t n = 0; n < ms; n++) {
+        ut_ticks++;
+        ut_event_task();
+    }
+}
+
+static UAVObjHandle ut_obj(uint32_t n)
+{
+    return (UAVObjHandle)(uintptr_t)(0x1000 + n);
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class EventDispatcherTest : public testing::Test {
+protected:
+    xQueueHandle queue;
+
+    virtual void SetUp()
+    {
+        ASSERT_EQ(0, EventDispatcherInitialize());
+        ASSERT_TRUE(ut_event_task != NULL);
+        queue = (xQueueHandle)&queue;
+        ut_queues.clear();
+        ut_sent.clear();
+        /* Flush the deadline the event task keeps from earlier tests */
+        ut_run_ms(2000);
+    }
+
+    int32_t createPeriodic(uint32_t n, uint16_t periodMs)
+    {
+        UAVObjEvent ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.obj   = ut_obj(n);
+        ev.event = EV_UPDATED_PERIODIC;
+        return EventPeriodicQueueCreate(&ev, queue, periodMs);
+    }
+
+    int32_t updatePeriodic(uint32_t n, uint16_t periodMs)
+    {
+        UAVObjEvent ev;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.obj   = ut_obj(n);
+        ev.event = EV_UPDATED_PERIODIC;
+        return EventPeriodicQueueUpdate(&ev, queue, periodMs);
+    }
+};
+
+TEST_F(EventDispatcherTest, PeriodsAreMet) {
+    EventStats stats;
+
+    for (uint32_t n = 0; n < UT_NUM_EVENTS; n++) {
+        ASSERT_EQ(0, createPeriodic(n, 10 + n * 7));
+    }
+    ASSERT_EQ(-1, createPeriodic(0, 10));
+
+    EventClearStats();
+    ut_run_ms(10000);
+
+    for (uint32_t n = 0; n < UT_NUM_EVENTS; n++) {
+        uint32_t period = 10 + n * 7;
+        /* The first dispatch comes right away, with a random phase after it */
+        EXPECT_GE(ut_sent[ut_obj(n)], 10000 / period) << "event " << n;
+        EXPECT_LE(ut_sent[ut_obj(n)], 10000 / period + 2) << "event " << n;
+    }
+
+    EventGetStats(&stats);
+    EXPECT_EQ(0u, stats.lateDispatches);
+    EXPECT_EQ(0u, stats.missedPeriods);
+    EXPECT_EQ(0u, stats.eventErrors);
+}
+
+TEST_F(EventDispatcherTest, LatenessIsAccounted) {
+    EventStats stats;
+
+    ASSERT_EQ(0, createPeriodic(1, 10));
+    ut_run_ms(100);
+    EventClearStats();
+
+    /* Stall the event task for three and a half periods */
+    ut_ticks += 35;
+    ut_run_ms(1);
+
+    EventGetStats(&stats);
+    EXPECT_EQ(1u, stats.periodicDispatches);
+    EXPECT_EQ(1u, stats.lateDispatches);
+    EXPECT_GE(stats.latenessMaxMs, 26u);
+    EXPECT_LE(stats.latenessMaxMs, 36u);
+    EXPECT_EQ(UAVObjGetID(ut_obj(1)), stats.latenessMaxID);
+    EXPECT_EQ(stats.latenessMaxMs / 10, stats.missedPeriods);
+
+    /* Back on schedule afterwards */
+    EventClearStats();
+    ut_run_ms(100);
+    EventGetStats(&stats);
+    EXPECT_EQ(10u, stats.periodicDispatches);
+    EXPECT_EQ(0u, stats.lateDispatches);
+}
+
+TEST_F(EventDispatcherTest, UpdateChangesPeriod) {
+    ASSERT_EQ(0, createPeriodic(2, 10));
+    ASSERT_EQ(0, createPeriodic(3, 10));
+    ut_run_ms(100);
+
+    /* Disable one, slow down the other */
+    ASSERT_EQ(0, updatePeriodic(2, 0));
+    ASSERT_EQ(0, updatePeriodic(3, 50));
+    ASSERT_EQ(-1, updatePeriodic(4, 50));
+    ut_sent.clear();
+    ut_run_ms(1000);
+
+    EXPECT_EQ(0u, ut_sent[ut_obj(2)]);
+    EXPECT_GE(ut_sent[ut_obj(3)], 20u);
+    EXPECT_LE(ut_sent[ut_obj(3)], 21u);
+
+    /* And enable it again */
+    ASSERT_EQ(0, updatePeriodic(2, 20));
+    ut_sent.clear();
+    ut_run_ms(1000);
+    EXPECT_GE(ut_sent[ut_obj(2)], 50u);
+    EXPECT_LE(ut_sent[ut_obj(2)], 51u);
+}
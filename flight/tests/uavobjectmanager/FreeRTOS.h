@@ -0,0 +1,42 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#define pvPortMalloc(xSize) (malloc(xSize))
+#define vPortFree(pv)       (free(pv))
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       0xffffffff
+
+typedef pthread_mutex_t *xSemaphoreHandle;
+typedef void *xQueueHandle;
+
+static inline xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    pthread_mutexattr_t attr;
+    xSemaphoreHandle sem = (xSemaphoreHandle)malloc(sizeof(pthread_mutex_t));
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(sem, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return sem;
+}
+
+static inline int xSemaphoreTakeRecursive(xSemaphoreHandle sem, __attribute__((unused)) unsigned int timeout)
+{
+    return pthread_mutex_lock(sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+static inline int xSemaphoreGiveRecursive(xSemaphoreHandle sem)
+{
+    return pthread_mutex_unlock(sem) == 0 ? pdTRUE : pdFALSE;
+}
+
+/* Event queues are counted by the unit test */
+int xQueueSend(xQueueHandle queue, const void *item, unsigned int timeout);
+
+#endif /* FREERTOS_H */
@@ -0,0 +1,501 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <time.h> /* clock_gettime */
+#include <pthread.h> /* pthread_create */
+
+extern "C" {
+#include "openpilot.h"
+#include "unittest_objects.h"
+}
+
+#define LOOKUP_ITERATIONS 200000
+#define SEQLOCK_WRITES    20000
+
+static uint32_t ut_object_id(uint32_t n)
+{
+    /* Spread the IDs over the whole range like the generator's hashes do */
+    return (n * 2654435761u) ^ 0x5A5AA5A5u;
+}
+
+static double ut_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVObjectManagerTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(0, UAVObjInitialize());
+
+        for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+            ut_handles[i] = UAVObjRegister(ut_object_id(i), (i % 4) != 0, false, false, 16 + (i % 8) * 4, 0, NULL);
+            ASSERT_TRUE(ut_handles[i] != NULL);
+        }
+    }
+};
+
+TEST_F(UAVObjectManagerTest, LookupFindsAllObjects) {
+    for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+        EXPECT_EQ(ut_handles[i], UAVObjGetByID(ut_object_id(i)));
+        EXPECT_EQ(ut_object_id(i), UAVObjGetID(ut_handles[i]));
+    }
+}
+
+TEST_F(UAVObjectManagerTest, LookupFindsMetaObjects) {
+    for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+        UAVObjHandle meta = UAVObjGetByID(MetaObjectId(ut_object_id(i)));
+
+        ASSERT_TRUE(meta != NULL);
+        EXPECT_TRUE(UAVObjIsMetaobject(meta));
+        EXPECT_EQ(UAVObjGetLinkedObj(ut_handles[i]), meta);
+    }
+}
+
+TEST_F(UAVObjectManagerTest, LookupUnknownID) {
+    EXPECT_TRUE(UAVObjGetByID(ut_object_id(UT_NUM_OBJECTS)) == NULL);
+    EXPECT_TRUE(UAVObjGetByID(MetaObjectId(MetaObjectId(ut_object_id(0)))) == NULL);
+}
+
+TEST_F(UAVObjectManagerTest, DuplicateRegistrationRejected) {
+    EXPECT_TRUE(UAVObjRegister(ut_object_id(7), true, false, false, 4, 0, NULL) == NULL);
+}
+
+TEST_F(UAVObjectManagerTest, RegistrationFailsWhenIndexFull) {
+    /* Every handle slot linked into the image is already in use */
+    EXPECT_TRUE(UAVObjRegister(ut_object_id(UT_NUM_OBJECTS), true, false, false, 4, 0, NULL) == NULL);
+}
+
+TEST_F(UAVObjectManagerTest, LookupMatchesLinearSearch) {
+    for (uint32_t i = 0; i < 2 * UT_NUM_OBJECTS; i++) {
+        uint32_t id = ut_object_id(i / 2) + (i % 2);
+        EXPECT_EQ(ut_linear_get_by_id(id), UAVObjGetByID(id));
+    }
+}
+
+TEST_F(UAVObjectManagerTest, LookupBenchmark) {
+    volatile UAVObjHandle sink;
+    double start;
+
+    start = ut_now_ns();
+    for (uint32_t i = 0; i < LOOKUP_ITERATIONS; i++) {
+        sink = ut_linear_get_by_id(ut_object_id(i % UT_NUM_OBJECTS));
+    }
+    double linear_ns = (ut_now_ns() - start) / LOOKUP_ITERATIONS;
+
+    start = ut_now_ns();
+    for (uint32_t i = 0; i < LOOKUP_ITERATIONS; i++) {
+        sink = UAVObjGetByID(ut_object_id(i % UT_NUM_OBJECTS));
+    }
+    double index_ns = (ut_now_ns() - start) / LOOKUP_ITERATIONS;
+    (void)sink;
+
+    printf("UAVObjGetByID with %d objects: linear %.1f ns, index %.1f ns\n", UT_NUM_OBJECTS, linear_ns, index_ns);
+    EXPECT_LT(index_ns, linear_ns);
+}
+
+TEST_F(UAVObjectManagerTest, FieldAccess) {
+    uint8_t data[16];
+    uint8_t field[4] = { 1, 2, 3, 4 };
+
+    memset(data, 0, sizeof(data));
+    ASSERT_EQ(0, UAVObjSetData(ut_handles[0], data));
+    ASSERT_EQ(0, UAVObjSetDataField(ut_handles[0], field, 8, sizeof(field)));
+    ASSERT_EQ(0, UAVObjGetData(ut_handles[0], data));
+    EXPECT_EQ(0, memcmp(&data[8], field, sizeof(field)));
+
+    memset(field, 0, sizeof(field));
+    ASSERT_EQ(0, UAVObjGetDataField(ut_handles[0], field, 8, sizeof(field)));
+    EXPECT_EQ(0, memcmp(&data[8], field, sizeof(field)));
+
+    /* Out of range accesses are rejected */
+    EXPECT_EQ(-1, UAVObjGetDataField(ut_handles[0], field, 14, sizeof(field)));
+    EXPECT_EQ(-1, UAVObjGetInstanceData(ut_handles[0], 1, data));
+}
+
+TEST_F(UAVObjectManagerTest, MetadataFieldAccess) {
+    UAVObjMetadata meta;
+    UAVObjHandle metaHandle = UAVObjGetLinkedObj(ut_handles[0]);
+    uint16_t period = 0;
+
+    memset(&meta, 0, sizeof(meta));
+    meta.telemetryUpdatePeriod = 1234;
+    ASSERT_EQ(0, UAVObjSetMetadata(ut_handles[0], &meta));
+    ASSERT_EQ(0, UAVObjGetDataField(metaHandle, &period, offsetof(UAVObjMetadata, telemetryUpdatePeriod), sizeof(period)));
+    EXPECT_EQ(1234, period);
+}
+
+TEST_F(UAVObjectManagerTest, TelemetryClassFlags) {
+    UAVObjMetadata meta;
+
+    memset(&meta, 0, sizeof(meta));
+    UAVObjSetLoggingUpdateMode(&meta, UPDATEMODE_THROTTLED);
+    EXPECT_EQ(TELEMETRYCLASS_DEFAULT, UAVObjGetTelemetryClass(&meta));
+
+    /* The class has bits of its own, the neighbouring modes are left alone */
+    UAVObjSetTelemetryClass(&meta, TELEMETRYCLASS_BULK);
+    EXPECT_EQ(TELEMETRYCLASS_BULK, UAVObjGetTelemetryClass(&meta));
+    EXPECT_EQ(UPDATEMODE_THROTTLED, UAVObjGetLoggingUpdateMode(&meta));
+    UAVObjSetTelemetryClass(&meta, TELEMETRYCLASS_HIGH);
+    EXPECT_EQ(TELEMETRYCLASS_HIGH, UAVObjGetTelemetryClass(&meta));
+    EXPECT_EQ(UPDATEMODE_THROTTLED, UAVObjGetLoggingUpdateMode(&meta));
+    EXPECT_EQ(0, meta.flags & 0xF000);
+}
+
+static void *ut_seqlock_writer(void *arg)
+{
+    UAVObjHandle obj = (UAVObjHandle)arg;
+    uint8_t data[16];
+
+    for (uint32_t i = 0; i < SEQLOCK_WRITES; i++) {
+        memset(data, i & 0xFF, sizeof(data));
+        UAVObjSetData(obj, data);
+    }
+    return NULL;
+}
+
+TEST_F(UAVObjectManagerTest, ConcurrentReadsAreConsistent) {
+    pthread_t writer;
+    uint8_t data[16];
+    uint32_t torn = 0;
+
+    ASSERT_EQ(16u, UAVObjGetNumBytes(ut_handles[0]));
+    ASSERT_EQ(0, pthread_create(&writer, NULL, ut_seqlock_writer, ut_handles[0]));
+    for (uint32_t i = 0; i < SEQLOCK_WRITES; i++) {
+        ASSERT_EQ(0, UAVObjGetData(ut_handles[0], data));
+        for (uint32_t n = 1; n < sizeof(data); n++) {
+            if (data[n] != data[0]) {
+                ++torn;
+                break;
+            }
+        }
+    }
+    pthread_join(writer, NULL);
+
+    EXPECT_EQ(0u, torn);
+}
+
+TEST_F(UAVObjectManagerTest, BorrowSeesTheData) {
+    uint8_t data[16];
+
+    memset(data, 0x42, sizeof(data));
+    ASSERT_EQ(0, UAVObjSetData(ut_handles[0], data));
+
+    const uint8_t *borrowed = (const uint8_t *)UAVObjBorrowInstanceData(ut_handles[0], 0);
+    ASSERT_TRUE(borrowed != NULL);
+    EXPECT_EQ(0, memcmp(borrowed, data, sizeof(data)));
+    UAVObjReleaseInstanceData(ut_handles[0], 0);
+
+    /* Missing instances can not be borrowed */
+    EXPECT_TRUE(UAVObjBorrowInstanceData(ut_handles[0], 1) == NULL);
+}
+
+TEST_F(UAVObjectManagerTest, DeltaPackAndUnpack) {
+    /* Two floats, two uint16 and four uint8 */
+    static const UAVObjFieldInfo layout[] = { { 2, 4 }, { 2, 2 }, { 4, 1 }, { 0, 0 } };
+    static const UAVObjFieldInfo wrong[]  = { { 2, 4 }, { 0, 0 } };
+    uint8_t data[16], reference[16], delta[16 + 1];
+
+    EXPECT_EQ(-1, UAVObjPackDelta(ut_handles[0], 0, reference, delta));
+    EXPECT_EQ(-1, UAVObjSetFieldInfo(ut_handles[0], wrong));
+    ASSERT_EQ(0, UAVObjSetFieldInfo(ut_handles[0], layout));
+    EXPECT_EQ(layout, UAVObjGetFieldInfo(ut_handles[0]));
+
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = i;
+    }
+    ASSERT_EQ(0, UAVObjSetData(ut_handles[0], data));
+    memcpy(reference, data, sizeof(reference));
+
+    /* Nothing changed, only the bitmap of the eight elements */
+    EXPECT_EQ(1, UAVObjPackDelta(ut_handles[0], 0, reference, delta));
+    EXPECT_EQ(0, delta[0]);
+
+    /* One byte of the second float and the last uint8 */
+    data[5]  = 0x55;
+    data[15] = 0x77;
+    ASSERT_EQ(0, UAVObjSetData(ut_handles[0], data));
+    EXPECT_EQ(1 + 4 + 1, UAVObjPackDelta(ut_handles[0], 0, reference, NULL));
+    ASSERT_EQ(1 + 4 + 1, UAVObjPackDelta(ut_handles[0], 0, reference, delta));
+    EXPECT_EQ(0x82, delta[0]);
+    EXPECT_EQ(0, memcmp(&delta[1], &data[4], 4));
+    EXPECT_EQ(0x77, delta[5]);
+    EXPECT_EQ(0, memcmp(reference, data, sizeof(data)));
+
+    /* Applied to the old data it gives the new one */
+    uint8_t received[16];
+    for (uint32_t i = 0; i < sizeof(received); i++) {
+        received[i] = i;
+    }
+    ASSERT_EQ(0, UAVObjSetData(ut_handles[0], received));
+    ASSERT_EQ(0, UAVObjUnpackDelta(ut_handles[0], 0, delta, 6));
+    ASSERT_EQ(0, UAVObjGetData(ut_handles[0], received));
+    EXPECT_EQ(0, memcmp(received, data, sizeof(data)));
+
+    /* A length that does not match the bitmap or a missing instance is rejected */
+    EXPECT_EQ(-1, UAVObjUnpackDelta(ut_handles[0], 0, delta, 5));
+    EXPECT_EQ(-1, UAVObjUnpackDelta(ut_handles[0], 1, delta, 6));
+}
+
+TEST_F(UAVObjectManagerTest, PlainQueueListenerStats) {
+    xQueueHandle queue = (xQueueHandle)&queue;
+    UAVObjListenerStats lstats;
+
+    EXPECT_EQ(-1, UAVObjGetListenerStats(queue, &lstats));
+    ASSERT_EQ(0, UAVObjConnectQueue(ut_handles[0], queue, EV_MASK_ALL_UPDATES));
+
+    ut_queue_sends = 0;
+    UAVObjUpdated(ut_handles[0]);
+    ut_queue_full  = true;
+    UAVObjUpdated(ut_handles[0]);
+    ut_queue_full  = false;
+    EXPECT_EQ(1u, ut_queue_sends);
+
+    ASSERT_EQ(0, UAVObjGetListenerStats(queue, &lstats));
+    EXPECT_EQ(1u, lstats.events);
+    EXPECT_EQ(1u, lstats.overflows);
+    EXPECT_EQ(UAVObjGetID(ut_handles[0]), lstats.lastOverflowID);
+    EXPECT_EQ(0, UAVObjDisconnectQueue(ut_handles[0], queue));
+}
+
+TEST_F(UAVObjectManagerTest, BatchCoalescesWakeups) {
+    xQueueHandle queue = (xQueueHandle)&queue;
+    UAVObjListenerStats lstats;
+    UAVObjEvent ev;
+
+    UAVObjBatchHandle batch = UAVObjBatchCreate(queue, 16);
+    ASSERT_TRUE(batch != NULL);
+    for (uint32_t i = 0; i < 8; i++) {
+        ASSERT_EQ(0, UAVObjConnectQueue(ut_handles[i], queue, EV_MASK_ALL_UPDATES));
+    }
+
+    /* A burst over several objects posts a single wake up */
+    ut_queue_sends = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+        UAVObjUpdated(ut_handles[i]);
+    }
+    EXPECT_EQ(1u, ut_queue_sends);
+    EXPECT_EQ(EV_BATCH_READY, ut_last_queued.event);
+    EXPECT_TRUE(ut_last_queued.obj == NULL);
+
+    for (uint32_t i = 0; i < 8; i++) {
+        ASSERT_TRUE(UAVObjBatchReceive(batch, &ev));
+        EXPECT_TRUE(ev.obj == ut_handles[i]);
+        EXPECT_EQ(EV_UPDATED_MANUAL, ev.event);
+    }
+    EXPECT_FALSE(UAVObjBatchReceive(batch, &ev));
+
+    /* Once drained the next event wakes the consumer up again */
+    UAVObjUpdated(ut_handles[3]);
+    EXPECT_EQ(2u, ut_queue_sends);
+    ASSERT_TRUE(UAVObjBatchReceive(batch, &ev));
+    EXPECT_TRUE(ev.obj == ut_handles[3]);
+
+    ASSERT_EQ(0, UAVObjGetListenerStats(queue, &lstats));
+    EXPECT_EQ(9u, lstats.events);
+    EXPECT_EQ(2u, lstats.wakeups);
+    EXPECT_EQ(8u, lstats.highWater);
+    EXPECT_EQ(0u, lstats.overflows);
+}
+
+TEST_F(UAVObjectManagerTest, BatchOverflow) {
+    xQueueHandle queue = (xQueueHandle)&queue;
+    UAVObjListenerStats lstats;
+    UAVObjStats ostats;
+    UAVObjEvent ev;
+
+    UAVObjClearStats();
+    UAVObjBatchHandle batch = UAVObjBatchCreate(queue, 4);
+    ASSERT_TRUE(batch != NULL);
+    ASSERT_EQ(0, UAVObjConnectQueue(ut_handles[5], queue, EV_MASK_ALL_UPDATES));
+
+    for (uint32_t i = 0; i < 6; i++) {
+        UAVObjUpdated(ut_handles[5]);
+    }
+    ASSERT_EQ(0, UAVObjGetListenerStats(queue, &lstats));
+    EXPECT_EQ(4u, lstats.events);
+    EXPECT_EQ(2u, lstats.overflows);
+    EXPECT_EQ(4u, lstats.highWater);
+    EXPECT_EQ(UAVObjGetID(ut_handles[5]), lstats.lastOverflowID);
+
+    UAVObjGetStats(&ostats);
+    EXPECT_EQ(2u, ostats.eventQueueErrors);
+
+    uint32_t received = 0;
+    while (UAVObjBatchReceive(batch, &ev)) {
+        ++received;
+    }
+    EXPECT_EQ(4u, received);
+}
+
+TEST_F(UAVObjectManagerTest, BatchDropOldest) {
+    xQueueHandle queue = (xQueueHandle)&queue;
+    UAVObjListenerStats lstats;
+    UAVObjEvent ev;
+
+    UAVObjClearStats();
+    UAVObjBatchHandle batch = UAVObjBatchCreate(queue, 4);
+    ASSERT_TRUE(batch != NULL);
+    UAVObjBatchSetDropPolicy(batch, UAVOBJ_DROP_OLDEST);
+    for (uint32_t i = 0; i < 6; i++) {
+        ASSERT_EQ(0, UAVObjConnectQueue(ut_handles[i], queue, EV_MASK_ALL_UPDATES));
+    }
+
+    for (uint32_t i = 0; i < 6; i++) {
+        UAVObjUpdated(ut_handles[i]);
+    }
+    ASSERT_EQ(0, UAVObjGetListenerStats(queue, &lstats));
+    EXPECT_EQ(6u, lstats.events);
+    EXPECT_EQ(2u, lstats.overflows);
+    EXPECT_EQ(4u, lstats.highWater);
+    EXPECT_EQ(UAVObjGetID(ut_handles[1]), lstats.lastOverflowID);
+
+    /* The most recent events are kept, in order */
+    for (uint32_t i = 2; i < 6; i++) {
+        ASSERT_TRUE(UAVObjBatchReceive(batch, &ev));
+        EXPECT_TRUE(ev.obj == ut_handles[i]);
+    }
+    EXPECT_FALSE(UAVObjBatchReceive(batch, &ev));
+}
+
+TEST_F(UAVObjectManagerTest, BatchCoalescesPendingEvents) {
+    xQueueHandle queue = (xQueueHandle)&queue;
+    UAVObjListenerStats lstats;
+    UAVObjEvent ev;
+
+    UAVObjClearStats();
+    UAVObjBatchHandle batch = UAVObjBatchCreate(queue, 4);
+    ASSERT_TRUE(batch != NULL);
+    UAVObjBatchSetCoalescing(batch, true);
+    for (uint32_t i = 0; i < 3; i++) {
+        ASSERT_EQ(0, UAVObjConnectQueue(ut_handles[i], queue, EV_MASK_ALL_UPDATES));
+    }
+
+    /* Repeated updates of a pending object keep their first place in the batch */
+    UAVObjUpdated(ut_handles[0]);
+    UAVObjUpdated(ut_handles[1]);
+    UAVObjUpdated(ut_handles[0]);
+    UAVObjUpdated(ut_handles[2]);
+    UAVObjUpdated(ut_handles[0]);
+    UAVObjUpdated(ut_handles[1]);
+    /* Another instance is not merged */
+    UAVObjInstanceUpdated(ut_handles[1], 1);
+
+    ASSERT_EQ(0, UAVObjGetListenerStats(queue, &lstats));
+    EXPECT_EQ(4u, lstats.events);
+    EXPECT_EQ(3u, lstats.superseded);
+    EXPECT_EQ(0u, lstats.overflows);
+
+    ASSERT_TRUE(UAVObjBatchReceive(batch, &ev));
+    EXPECT_TRUE(ev.obj == ut_handles[0]);
+
+    /* Once taken out the next update is queued again */
+    UAVObjUpdated(ut_handles[0]);
+    for (uint32_t i = 1; i < 3; i++) {
+        ASSERT_TRUE(UAVObjBatchReceive(batch, &ev));
+        EXPECT_TRUE(ev.obj == ut_handles[i]);
+        EXPECT_EQ(UAVOBJ_ALL_INSTANCES, ev.instId);
+    }
+    ASSERT_TRUE(UAVObjBatchReceive(batch, &ev));
+    EXPECT_TRUE(ev.obj == ut_handles[1]);
+    EXPECT_EQ(1, ev.instId);
+    ASSERT_TRUE(UAVObjBatchReceive(batch, &ev));
+    EXPECT_TRUE(ev.obj == ut_handles[0]);
+    EXPECT_FALSE(UAVObjBatchReceive(batch, &ev));
+
+    ASSERT_EQ(0, UAVObjGetListenerStats(queue, &lstats));
+    EXPECT_EQ(5u, lstats.events);
+    EXPECT_EQ(3u, lstats.superseded);
+}
+
+TEST_F(UAVObjectManagerTest, BatchBenchmark) {
+    xQueueHandle plainQueue = (xQueueHandle)&plainQueue;
+    xQueueHandle batchQueue = (xQueueHandle)&batchQueue;
+    UAVObjEvent ev;
+
+    UAVObjBatchHandle batch = UAVObjBatchCreate(batchQueue, UT_NUM_OBJECTS);
+    ASSERT_TRUE(batch != NULL);
+    for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+        ASSERT_EQ(0, UAVObjConnectQueue(ut_handles[i], plainQueue, EV_MASK_ALL_UPDATES));
+    }
+
+    /* Queue operations per burst of updates over all objects */
+    ut_queue_sends = 0;
+    for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+        UAVObjUpdated(ut_handles[i]);
+    }
+    uint32_t plainSends = ut_queue_sends;
+
+    for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+        ASSERT_EQ(0, UAVObjDisconnectQueue(ut_handles[i], plainQueue));
+        ASSERT_EQ(0, UAVObjConnectQueue(ut_handles[i], batchQueue, EV_MASK_ALL_UPDATES));
+    }
+    ut_queue_sends = 0;
+    for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+        UAVObjUpdated(ut_handles[i]);
+    }
+    uint32_t batchSends = ut_queue_sends;
+    while (UAVObjBatchReceive(batch, &ev)) {}
+
+    printf("queue sends per %d updates: plain %u batched %u\n", UT_NUM_OBJECTS, plainSends, batchSends);
+    EXPECT_EQ((uint32_t)UT_NUM_OBJECTS, plainSends);
+    EXPECT_EQ(1u, batchSends);
+}
+
+class UAVObjectArenaTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(0, UAVObjInitialize());
+        ut_handles[0] = UAVObjRegister(ut_object_id(0), false, false, false, 21, 8, NULL);
+        ASSERT_TRUE(ut_handles[0] != NULL);
+    }
+};
+
+TEST_F(UAVObjectArenaTest, ArenaInstancesAreContiguous) {
+    for (uint16_t n = 1; n < 8; n++) {
+        EXPECT_EQ(n, UAVObjCreateInstance(ut_handles[0], NULL));
+    }
+
+    const uint8_t *first = (const uint8_t *)UAVObjBorrowInstanceData(ut_handles[0], 0);
+    UAVObjReleaseInstanceData(ut_handles[0], 0);
+    const uint8_t *second = (const uint8_t *)UAVObjBorrowInstanceData(ut_handles[0], 1);
+    UAVObjReleaseInstanceData(ut_handles[0], 1);
+    ptrdiff_t stride = second - first;
+
+    EXPECT_GE(stride, 21);
+    EXPECT_EQ(0, stride % 4);
+    for (uint16_t n = 2; n < 8; n++) {
+        const uint8_t *inst = (const uint8_t *)UAVObjBorrowInstanceData(ut_handles[0], n);
+        UAVObjReleaseInstanceData(ut_handles[0], n);
+        EXPECT_EQ(first + n * stride, inst);
+    }
+}
+
+TEST_F(UAVObjectArenaTest, InstancesBeyondArena) {
+    uint8_t data[21];
+
+    /* Unpacking a high instance creates all the ones before it */
+    memset(data, 0x77, sizeof(data));
+    ASSERT_EQ(0, UAVObjUnpack(ut_handles[0], 11, data));
+    EXPECT_EQ(12, UAVObjGetNumInstances(ut_handles[0]));
+
+    for (uint16_t n = 0; n < 12; n++) {
+        memset(data, n, sizeof(data));
+        ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[0], n, data));
+    }
+    for (uint16_t n = 0; n < 12; n++) {
+        ASSERT_EQ(0, UAVObjGetInstanceData(ut_handles[0], n, data));
+        for (uint32_t i = 0; i < sizeof(data); i++) {
+            EXPECT_EQ(n, data[i]);
+        }
+    }
+    EXPECT_EQ(-1, UAVObjGetInstanceData(ut_handles[0], 12, data));
+}
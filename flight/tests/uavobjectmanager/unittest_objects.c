@@ -0,0 +1,43 @@
+#include "openpilot.h"
+#include "pios_struct_helper.h"
+#include <uavobjectprivate.h>
+#include "unittest_objects.h"
+
+/* Handle slots for the test objects, laid out like the generated UAVO code does */
+UAVObjHandle ut_handles[UT_NUM_OBJECTS] __attribute__((section("_uavo_handles")));
+
+uint32_t ut_queue_sends;
+uint32_t ut_callback_dispatches;
+bool ut_queue_full;
+UAVObjEvent ut_last_queued;
+
+int xQueueSend(__attribute__((unused)) xQueueHandle queue, const void *item, __attribute__((unused)) unsigned int timeout)
+{
+    if (ut_queue_full) {
+        return pdFALSE;
+    }
+    ++ut_queue_sends;
+    memcpy(&ut_last_queued, item, sizeof(UAVObjEvent));
+    return pdTRUE;
+}
+
+int32_t EventCallbackDispatch(UAVObjEvent *ev, UAVObjEventCallback cb)
+{
+    ++ut_callback_dispatches;
+    cb(ev);
+    return pdTRUE;
+}
+
+/* Reference implementation of the former linear UAVObjGetByID() */
+UAVObjHandle ut_linear_get_by_id(uint32_t id)
+{
+    UAVO_LIST_ITERATE(tmp_obj)
+    if (tmp_obj->id == id) {
+        return (UAVObjHandle)tmp_obj;
+    }
+    if (MetaObjectId(tmp_obj->id) == id) {
+        return (UAVObjHandle)&(tmp_obj->metaObj);
+    }
+}
+return NULL;
+}
@@ -0,0 +1,15 @@
+#ifndef UNITTEST_OBJECTS_H
+#define UNITTEST_OBJECTS_H
+
+/* Roughly the number of objects linked into a full firmware */
+#define UT_NUM_OBJECTS 200
+
+extern UAVObjHandle ut_handles[UT_NUM_OBJECTS];
+extern uint32_t ut_queue_sends;
+extern uint32_t ut_callback_dispatches;
+extern bool ut_queue_full;
+extern UAVObjEvent ut_last_queued;
+
+UAVObjHandle ut_linear_get_by_id(uint32_t id);
+
+#endif /* UNITTEST_OBJECTS_H */
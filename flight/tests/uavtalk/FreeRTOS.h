@@ -0,0 +1,49 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define pvPortMalloc(xSize) (malloc(xSize))
+#define vPortFree(pv)       (free(pv))
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define portMAX_DELAY       0xffffffff
+#define portTICK_RATE_MS    1
+
+typedef uint32_t portTickType;
+typedef void *xQueueHandle;
+
+/* The tests are single threaded, only the binary semaphores keep a count */
+typedef struct ut_semaphore {
+    int count;
+} *xSemaphoreHandle;
+
+static inline xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+    return (xSemaphoreHandle)calloc(1, sizeof(struct ut_semaphore));
+}
+
+static inline int xSemaphoreTakeRecursive(__attribute__((unused)) xSemaphoreHandle sem, __attribute__((unused)) unsigned int timeout)
+{
+    return pdTRUE;
+}
+
+static inline int xSemaphoreGiveRecursive(__attribute__((unused)) xSemaphoreHandle sem)
+{
+    return pdTRUE;
+}
+
+#define vSemaphoreCreateBinary(sem) \
+    do { (sem) = xSemaphoreCreateRecursiveMutex(); (sem)->count = 1; } while (0)
+
+/* Blocking on an empty semaphore lets the simulated time pass */
+int xSemaphoreTake(xSemaphoreHandle sem, unsigned int timeout);
+int xSemaphoreGive(xSemaphoreHandle sem);
+
+portTickType xTaskGetTickCount(void);
+
+int xQueueSend(xQueueHandle queue, const void *item, unsigned int timeout);
+
+#endif /* FREERTOS_H */
@@ -0,0 +1,10 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+/* Enable/Disable PiOS modules */
+#define PIOS_INCLUDE_FREERTOS
+
+/* Fewer delta slots than test objects, to see them evicted */
+#define UAVTALK_DELTA_SLOTS 4
+
+#endif /* PIOS_CONFIG_H */
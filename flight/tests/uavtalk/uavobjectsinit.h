@@ -0,0 +1,9 @@
+#ifndef UAVOBJECTSINIT_H
+#define UAVOBJECTSINIT_H
+
+void UAVObjectsInitializeAll();
+
+/* Roughly the largest object of a full firmware */
+#define UAVOBJECTS_LARGEST 1000
+
+#endif // UAVOBJECTSINIT_H
@@ -0,0 +1,852 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <deque>
+#include <vector>
+
+extern "C" {
+#include "openpilot.h"
+#include "unittest_objects.h"
+#include "uavtalk_priv.h" /* UAVTALK_WINDOW_SIZE */
+}
+
+#define UT_OBJECT_BYTES 20
+#define UT_TIMEOUT_MS   100
+
+/* Simulated system time */
+static uint32_t ut_ticks = 1000;
+
+/* Bytes in flight on the link, in both directions */
+static std::deque<uint8_t> ut_to_gcs;
+static std::deque<uint8_t> ut_to_flight;
+
+/* Flight side output fails while set */
+static bool ut_flight_link_down;
+
+extern "C" {
+portTickType xTaskGetTickCount(void)
+{
+    return ut_ticks;
+}
+
+int xSemaphoreTake(xSemaphoreHandle sem, unsigned int timeout)
+{
+    if (sem->count > 0) {
+        --sem->count;
+        return pdTRUE;
+    }
+    ut_ticks += timeout;
+    return pdFALSE;
+}
+
+int xSemaphoreGive(xSemaphoreHandle sem)
+{
+    sem->count = 1;
+    return pdTRUE;
+}
+
+static int32_t ut_flight_output(uint8_t *data, int32_t length)
+{
+    if (ut_flight_link_down) {
+        return -1;
+    }
+    ut_to_gcs.insert(ut_to_gcs.end(), data, data + length);
+    return length;
+}
+
+static int32_t ut_gcs_output(uint8_t *data, int32_t length)
+{
+    ut_to_flight.insert(ut_to_flight.end(), data, data + length);
+    return length;
+}
+}
+
+static uint32_t ut_object_id(uint32_t n)
+{
+    return 0x10203040 + n * 0x01010101;
+}
+
+/* Deliver everything in flight in one direction */
+static void ut_deliver(std::deque<uint8_t> & link, UAVTalkConnection to)
+{
+    std::vector<uint8_t> bytes(link.begin(), link.end());
+
+    link.clear();
+    for (size_t pos = 0; pos < bytes.size(); pos += 255) {
+        uint8_t len = (bytes.size() - pos > 255) ? 255 : bytes.size() - pos;
+        UAVTalkProcessInputStream(to, &bytes[pos], len);
+    }
+}
+
+static uint32_t ut_count_packets(const std::deque<uint8_t> & link, uint8_t type)
+{
+    uint32_t count = 0;
+
+    for (size_t pos = 0; pos + 3 < link.size();) {
+        uint16_t len = link[pos + 2] | (link[pos + 3] << 8);
+        if (link[pos + 1] == type) {
+            ++count;
+        }
+        pos += len + 1;
+    }
+    return count;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVTalkTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(0, UAVObjInitialize());
+        for (uint32_t i = 0; i < UT_NUM_OBJECTS; i++) {
+            ut_handles[i] = UAVObjRegister(ut_object_id(i), true, false, false, UT_OBJECT_BYTES, 0, NULL);
+            ASSERT_TRUE(ut_handles[i] != NULL);
+        }
+        flight = UAVTalkInitialize(ut_flight_output);
+        gcs    = UAVTalkInitialize(ut_gcs_output);
+        ASSERT_TRUE(flight != NULL);
+        ASSERT_TRUE(gcs != NULL);
+        ut_to_gcs.clear();
+        ut_to_flight.clear();
+        ut_flight_link_down = false;
+    }
+
+    /* A NACK as the GCS sends it for an object it does not know */
+    void queueNack(uint32_t objId, uint16_t instId)
+    {
+        uint8_t nack[11] = { 0x3C, 0x24, 10, 0,
+                             (uint8_t)objId, (uint8_t)(objId >> 8), (uint8_t)(objId >> 16), (uint8_t)(objId >> 24),
+                             (uint8_t)instId, (uint8_t)(instId >> 8), 0 };
+
+        nack[10] = PIOS_CRC_updateCRC(0, nack, 10);
+        ut_to_flight.insert(ut_to_flight.end(), nack, nack + sizeof(nack));
+    }
+
+    UAVTalkStats flightStats()
+    {
+        UAVTalkStats stats;
+
+        UAVTalkGetStats(flight, &stats, false);
+        return stats;
+    }
+
+    UAVTalkConnection flight;
+    UAVTalkConnection gcs;
+};
+
+TEST_F(UAVTalkTest, WindowKeepsSeveralInFlight) {
+    for (uint32_t i = 0; i < UAVTALK_WINDOW_SIZE; i++) {
+        ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[i], 0, UT_TIMEOUT_MS, 2));
+    }
+    /* All of them went out without waiting for an ack */
+    EXPECT_EQ(UAVTALK_WINDOW_SIZE, UAVTalkGetPendingTransactions(flight));
+    EXPECT_EQ((uint32_t)UAVTALK_WINDOW_SIZE, ut_count_packets(ut_to_gcs, 0x22));
+
+    ut_deliver(ut_to_gcs, gcs);
+    EXPECT_EQ((uint32_t)UAVTALK_WINDOW_SIZE, ut_count_packets(ut_to_flight, 0x23));
+    ut_deliver(ut_to_flight, flight);
+
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+    EXPECT_EQ(0u, flightStats().txRetries);
+    EXPECT_EQ(0u, flightStats().txTransactionsFailed);
+}
+
+TEST_F(UAVTalkTest, AcksMatchOutOfOrder) {
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 2));
+    ut_deliver(ut_to_gcs, gcs);
+    std::deque<uint8_t> first_ack(ut_to_flight);
+    ut_to_flight.clear();
+
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[1], 0, UT_TIMEOUT_MS, 2));
+    ut_deliver(ut_to_gcs, gcs);
+    ut_deliver(ut_to_flight, flight);
+    EXPECT_EQ(1, UAVTalkGetPendingTransactions(flight));
+
+    ut_deliver(first_ack, flight);
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+}
+
+TEST_F(UAVTalkTest, TimeoutRetriesThenFails) {
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 2));
+    ut_to_gcs.clear();
+
+    /* Nothing happens before the deadline */
+    ut_ticks += UT_TIMEOUT_MS - 1;
+    UAVTalkProcessTransactions(flight);
+    EXPECT_EQ(0u, ut_to_gcs.size());
+
+    for (uint32_t retry = 1; retry <= 2; retry++) {
+        ut_ticks += 1;
+        UAVTalkProcessTransactions(flight);
+        EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x22));
+        EXPECT_EQ(retry, flightStats().txRetries);
+        ut_to_gcs.clear();
+        ut_ticks += UT_TIMEOUT_MS - 1;
+    }
+
+    ut_ticks += 1;
+    UAVTalkProcessTransactions(flight);
+    EXPECT_EQ(0u, ut_to_gcs.size());
+    EXPECT_EQ(1u, flightStats().txTransactionsFailed);
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+}
+
+TEST_F(UAVTalkTest, RetrySucceeds) {
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 2));
+    /* The first copy is lost */
+    ut_to_gcs.clear();
+
+    ut_ticks += UT_TIMEOUT_MS;
+    UAVTalkProcessTransactions(flight);
+    ut_deliver(ut_to_gcs, gcs);
+    ut_deliver(ut_to_flight, flight);
+
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+    EXPECT_EQ(1u, flightStats().txRetries);
+    EXPECT_EQ(0u, flightStats().txTransactionsFailed);
+}
+
+TEST_F(UAVTalkTest, NewerSendFollowsTheAck) {
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 2));
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 2));
+    EXPECT_EQ(1, UAVTalkGetPendingTransactions(flight));
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x22));
+
+    /* The ack of the first copy sends the newer one */
+    ut_deliver(ut_to_gcs, gcs);
+    ut_deliver(ut_to_flight, flight);
+    EXPECT_EQ(1, UAVTalkGetPendingTransactions(flight));
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x22));
+
+    ut_deliver(ut_to_gcs, gcs);
+    ut_deliver(ut_to_flight, flight);
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+    EXPECT_EQ(0u, flightStats().txRetries);
+}
+
+TEST_F(UAVTalkTest, LostNewerCopyIsRetried) {
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 2));
+    ut_deliver(ut_to_gcs, gcs);
+
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 2));
+    ut_deliver(ut_to_flight, flight);
+
+    /* The second copy is lost, the ack of the first one must not end its transaction */
+    ut_to_gcs.clear();
+    EXPECT_EQ(1, UAVTalkGetPendingTransactions(flight));
+
+    ut_ticks += UT_TIMEOUT_MS;
+    UAVTalkProcessTransactions(flight);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x22));
+    ut_deliver(ut_to_gcs, gcs);
+    ut_deliver(ut_to_flight, flight);
+
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+    EXPECT_EQ(1u, flightStats().txRetries);
+    EXPECT_EQ(0u, flightStats().txTransactionsFailed);
+}
+
+TEST_F(UAVTalkTest, NewerSendAfterTimeoutGetsItsRetries) {
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 0));
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[0], 0, UT_TIMEOUT_MS, 1));
+    ut_to_gcs.clear();
+
+    /* The first copy is out of retries, the newer one is sent instead of failing */
+    ut_ticks += UT_TIMEOUT_MS;
+    UAVTalkProcessTransactions(flight);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x22));
+    EXPECT_EQ(0u, flightStats().txTransactionsFailed);
+    ut_to_gcs.clear();
+
+    ut_ticks += UT_TIMEOUT_MS;
+    UAVTalkProcessTransactions(flight);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x22));
+    ut_to_gcs.clear();
+
+    ut_ticks += UT_TIMEOUT_MS;
+    UAVTalkProcessTransactions(flight);
+    EXPECT_EQ(0u, ut_to_gcs.size());
+    EXPECT_EQ(1u, flightStats().txTransactionsFailed);
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+}
+
+TEST_F(UAVTalkTest, NackFailsRightAway) {
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[2], 0, UT_TIMEOUT_MS, 2));
+    queueNack(ut_object_id(2), 0);
+    ut_deliver(ut_to_flight, flight);
+
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+    EXPECT_EQ(1u, flightStats().txTransactionsFailed);
+    EXPECT_EQ(0u, flightStats().txRetries);
+}
+
+TEST_F(UAVTalkTest, RequestCompletedByObject) {
+    ASSERT_EQ(0, UAVTalkSendObjectRequestPipelined(flight, ut_handles[3], 0, UT_TIMEOUT_MS, 2));
+    ASSERT_EQ(0, UAVTalkSendObjectRequestPipelined(flight, ut_handles[4], 0, UT_TIMEOUT_MS, 2));
+    EXPECT_EQ(2, UAVTalkGetPendingTransactions(flight));
+
+    ut_deliver(ut_to_gcs, gcs);
+    EXPECT_EQ(2u, ut_count_packets(ut_to_flight, 0x20));
+    ut_deliver(ut_to_flight, flight);
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+}
+
+TEST_F(UAVTalkTest, FullWindowWaitsForTimeout) {
+    for (uint32_t i = 0; i < UAVTALK_WINDOW_SIZE; i++) {
+        ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[i], 0, UT_TIMEOUT_MS, 0));
+    }
+    ut_to_gcs.clear();
+
+    /* Blocks until the oldest transactions time out and free their slots */
+    uint32_t start = ut_ticks;
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[UAVTALK_WINDOW_SIZE], 0, UT_TIMEOUT_MS, 0));
+    EXPECT_EQ(start + UT_TIMEOUT_MS, ut_ticks);
+    EXPECT_EQ((uint32_t)UAVTALK_WINDOW_SIZE, flightStats().txTransactionsFailed);
+    EXPECT_EQ(1, UAVTalkGetPendingTransactions(flight));
+}
+
+TEST_F(UAVTalkTest, BlockingTransactionStillWorks) {
+    /* The ack is not delivered by this single threaded test, so it times out */
+    uint32_t start = ut_ticks;
+
+    EXPECT_EQ(-1, UAVTalkSendObject(flight, ut_handles[0], 0, 1, UT_TIMEOUT_MS));
+    EXPECT_EQ(start + UT_TIMEOUT_MS, ut_ticks);
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+}
+
+class UAVTalkParseTest : public UAVTalkTest {
+protected:
+    /* Packs object 'n' with a recognisable payload into 'packet' */
+    void packObject(uint32_t n, uint8_t seed, std::vector<uint8_t> & packet)
+    {
+        uint8_t data[UT_OBJECT_BYTES];
+
+        for (uint32_t i = 0; i < sizeof(data); i++) {
+            data[i] = seed + i;
+        }
+        ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[n], 0, data));
+        ASSERT_EQ(0, UAVTalkSendObject(flight, ut_handles[n], 0, 0, 0));
+        packet.assign(ut_to_gcs.begin(), ut_to_gcs.end());
+        ut_to_gcs.clear();
+        /* Forget the value, so that receiving it is visible */
+        memset(data, 0, sizeof(data));
+        ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[n], 0, data));
+    }
+
+    uint8_t objectSeed(uint32_t n)
+    {
+        uint8_t data[UT_OBJECT_BYTES];
+
+        UAVObjGetInstanceData(ut_handles[n], 0, data);
+        for (uint32_t i = 1; i < sizeof(data); i++) {
+            if (data[i] != (uint8_t)(data[0] + i)) {
+                return 0;
+            }
+        }
+        return data[0];
+    }
+
+    UAVTalkStats gcsStats()
+    {
+        UAVTalkStats stats;
+
+        UAVTalkGetStats(gcs, &stats, false);
+        return stats;
+    }
+};
+
+TEST_F(UAVTalkParseTest, WholePacketsInOneBuffer) {
+    std::vector<uint8_t> stream, packet;
+
+    for (uint32_t n = 0; n < 4; n++) {
+        packObject(n, 0x10 * (n + 1), packet);
+        stream.insert(stream.end(), packet.begin(), packet.end());
+    }
+    /* Some line noise in front */
+    stream.insert(stream.begin(), 3, 0x55);
+
+    UAVTalkProcessInputStream(gcs, &stream[0], stream.size());
+    for (uint32_t n = 0; n < 4; n++) {
+        EXPECT_EQ(0x10 * (n + 1), objectSeed(n));
+    }
+    EXPECT_EQ(4u, gcsStats().rxObjects);
+    EXPECT_EQ(4u * UT_OBJECT_BYTES, gcsStats().rxObjectBytes);
+    EXPECT_EQ(stream.size(), gcsStats().rxBytes);
+    EXPECT_EQ(3u, gcsStats().rxSyncErrors);
+    EXPECT_EQ(0u, gcsStats().rxErrors);
+}
+
+TEST_F(UAVTalkParseTest, SplitPacketsMatchWholeOnes) {
+    std::vector<uint8_t> stream, packet;
+
+    for (uint32_t n = 0; n < 3; n++) {
+        packObject(n, 0x20 + n, packet);
+        stream.insert(stream.end(), packet.begin(), packet.end());
+    }
+
+    /* Every split point of the stream, packets straddling buffers take the byte state machine */
+    for (size_t split = 1; split < stream.size(); split++) {
+        UAVTalkResetStats(gcs);
+        UAVTalkProcessInputStream(gcs, &stream[0], split);
+        UAVTalkProcessInputStream(gcs, &stream[split], stream.size() - split);
+        for (uint32_t n = 0; n < 3; n++) {
+            ASSERT_EQ(0x20 + n, objectSeed(n)) << split;
+            uint8_t zero[UT_OBJECT_BYTES] = { 0 };
+            UAVObjSetInstanceData(ut_handles[n], 0, zero);
+        }
+        ASSERT_EQ(3u, gcsStats().rxObjects) << split;
+        ASSERT_EQ(stream.size(), gcsStats().rxBytes) << split;
+        ASSERT_EQ(0u, gcsStats().rxErrors) << split;
+    }
+}
+
+TEST_F(UAVTalkParseTest, BadChecksumIsCounted) {
+    std::vector<uint8_t> stream, packet;
+
+    packObject(0, 0x30, packet);
+    packet.back() ^= 0xff;
+    stream.insert(stream.end(), packet.begin(), packet.end());
+    packObject(1, 0x40, packet);
+    stream.insert(stream.end(), packet.begin(), packet.end());
+
+    UAVTalkProcessInputStream(gcs, &stream[0], stream.size());
+    EXPECT_EQ(0, objectSeed(0));
+    EXPECT_EQ(0x40, objectSeed(1));
+    EXPECT_EQ(1u, gcsStats().rxObjects);
+    EXPECT_EQ(1u, gcsStats().rxCrcErrors);
+}
+
+TEST_F(UAVTalkParseTest, TimestampedPacket) {
+    uint8_t data[UT_OBJECT_BYTES];
+
+    memset(data, 0x5a, sizeof(data));
+    ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[5], 0, data));
+    ut_ticks = 0x1234;
+    ASSERT_EQ(0, UAVTalkSendObjectTimestamped(flight, ut_handles[5], 0, 0, 0));
+
+    uint16_t timestamp = 0;
+    ut_deliver(ut_to_gcs, gcs);
+    UAVTalkGetLastTimestamp(gcs, &timestamp);
+    EXPECT_EQ(0x1234, timestamp);
+    EXPECT_EQ(1u, gcsStats().rxObjects);
+}
+
+class UAVTalkMultiTest : public UAVTalkParseTest {
+protected:
+    virtual void SetUp()
+    {
+        UAVTalkParseTest::SetUp();
+        UAVTalkSetAggregation(flight, true);
+    }
+
+    void setObject(uint32_t n, uint8_t seed)
+    {
+        uint8_t data[UT_OBJECT_BYTES];
+
+        for (uint32_t i = 0; i < sizeof(data); i++) {
+            data[i] = seed + i;
+        }
+        ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[n], 0, data));
+    }
+
+    void clearObject(uint32_t n)
+    {
+        uint8_t data[UT_OBJECT_BYTES] = { 0 };
+
+        ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[n], 0, data));
+    }
+};
+
+TEST_F(UAVTalkMultiTest, DisabledSendsRightAway) {
+    UAVTalkSetAggregation(flight, false);
+    ASSERT_EQ(0, UAVTalkSendObjectAggregated(flight, ut_handles[0], 0));
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x20));
+}
+
+TEST_F(UAVTalkMultiTest, ObjectsShareOneFrame) {
+    for (uint32_t n = 0; n < 4; n++) {
+        setObject(n, 0x10 * (n + 1));
+        ASSERT_EQ(0, UAVTalkSendObjectAggregated(flight, ut_handles[n], 0));
+    }
+    EXPECT_EQ(0u, ut_to_gcs.size());
+
+    ASSERT_EQ(0, UAVTalkFlushAggregated(flight));
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x25));
+    /* One header and checksum for all of them */
+    EXPECT_EQ(10u + 4 * (7 + UT_OBJECT_BYTES) + 1, ut_to_gcs.size());
+    EXPECT_EQ(4u, flightStats().txObjects);
+    EXPECT_EQ(4u * UT_OBJECT_BYTES, flightStats().txObjectBytes);
+
+    for (uint32_t n = 0; n < 4; n++) {
+        clearObject(n);
+    }
+    ut_deliver(ut_to_gcs, gcs);
+    for (uint32_t n = 0; n < 4; n++) {
+        EXPECT_EQ(0x10 * (n + 1), objectSeed(n));
+    }
+    EXPECT_EQ(0u, gcsStats().rxErrors);
+
+    /* Nothing left to flush */
+    ASSERT_EQ(0, UAVTalkFlushAggregated(flight));
+    EXPECT_EQ(0u, ut_to_gcs.size());
+}
+
+TEST_F(UAVTalkMultiTest, FullFrameGoesOut) {
+    /* 27 bytes per record, 9 of them fit in 255 bytes */
+    for (uint32_t i = 0; i < 20; i++) {
+        ASSERT_EQ(0, UAVTalkSendObjectAggregated(flight, ut_handles[i % UT_NUM_OBJECTS], 0));
+    }
+    EXPECT_EQ(2u, ut_count_packets(ut_to_gcs, 0x25));
+    EXPECT_EQ(2u * (10 + 9 * (7 + UT_OBJECT_BYTES) + 1), ut_to_gcs.size());
+
+    UAVTalkFlushAggregated(flight);
+    EXPECT_EQ(3u, ut_count_packets(ut_to_gcs, 0x25));
+    ut_deliver(ut_to_gcs, gcs);
+    EXPECT_EQ(3u, gcsStats().rxObjects);
+    EXPECT_EQ(0u, gcsStats().rxErrors);
+}
+
+TEST_F(UAVTalkMultiTest, OtherPacketsKeepTheOrder) {
+    ASSERT_EQ(0, UAVTalkSendObjectAggregated(flight, ut_handles[0], 0));
+    ASSERT_EQ(0, UAVTalkSendObjectPipelined(flight, ut_handles[1], 0, UT_TIMEOUT_MS, 0));
+
+    /* The pending frame went out before the acked object */
+    ASSERT_EQ(2u, ut_count_packets(ut_to_gcs, 0x25) + ut_count_packets(ut_to_gcs, 0x22));
+    EXPECT_EQ(0x25, ut_to_gcs[1]);
+
+    ut_deliver(ut_to_gcs, gcs);
+    ut_deliver(ut_to_flight, flight);
+    EXPECT_EQ(0, UAVTalkGetPendingTransactions(flight));
+}
+
+TEST_F(UAVTalkMultiTest, UnknownRecordIsSkipped) {
+    setObject(0, 0x40);
+    setObject(1, 0x50);
+    ASSERT_EQ(0, UAVTalkSendObjectAggregated(flight, ut_handles[0], 0));
+    ASSERT_EQ(0, UAVTalkSendObjectAggregated(flight, ut_handles[1], 0));
+    UAVTalkFlushAggregated(flight);
+    clearObject(0);
+    clearObject(1);
+
+    /* Change the object ID of the first record and fix up the checksum */
+    std::vector<uint8_t> frame(ut_to_gcs.begin(), ut_to_gcs.end());
+    ut_to_gcs.clear();
+    frame[10] ^= 0xff;
+    frame.back() = PIOS_CRC_updateCRC(0, &frame[0], frame.size() - 1);
+
+    UAVTalkProcessInputStream(gcs, &frame[0], frame.size());
+    EXPECT_EQ(0, objectSeed(0));
+    EXPECT_EQ(0x50, objectSeed(1));
+}
+
+TEST_F(UAVTalkMultiTest, DisablingFlushes) {
+    ASSERT_EQ(0, UAVTalkSendObjectAggregated(flight, ut_handles[0], 0));
+    EXPECT_EQ(0u, ut_to_gcs.size());
+    UAVTalkSetAggregation(flight, false);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x25));
+}
+
+class UAVTalkDeltaTest : public UAVTalkParseTest {
+protected:
+    virtual void SetUp()
+    {
+        /* Two floats, four uint16 and four uint8 */
+        static const UAVObjFieldInfo layout[] = { { 2, 4 }, { 4, 2 }, { 4, 1 }, { 0, 0 } };
+
+        UAVTalkParseTest::SetUp();
+        for (uint32_t n = 0; n < UT_NUM_OBJECTS - 1; n++) {
+            ASSERT_EQ(0, UAVObjSetFieldInfo(ut_handles[n], layout));
+        }
+        UAVTalkSetDeltaEncoding(flight, true);
+        for (uint32_t i = 0; i < sizeof(data); i++) {
+            data[i] = i;
+        }
+    }
+
+    void sendObject(uint32_t n)
+    {
+        ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[n], 0, data));
+        ASSERT_EQ(0, UAVTalkSendObjectAggregated(flight, ut_handles[n], 0));
+    }
+
+    uint8_t data[UT_OBJECT_BYTES];
+};
+
+TEST_F(UAVTalkDeltaTest, FirstSendIsKeyframe) {
+    sendObject(0);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x20));
+    EXPECT_EQ(10u + UT_OBJECT_BYTES + 1, ut_to_gcs.size());
+}
+
+TEST_F(UAVTalkDeltaTest, OnlyChangedElementsAreSent) {
+    sendObject(0);
+    ut_to_gcs.clear();
+
+    /* One byte of the first uint16 */
+    data[9] = 0xAA;
+    sendObject(0);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x26));
+    /* Two bytes of bitmap for the ten elements and the changed element */
+    EXPECT_EQ(10u + 2 + 2 + 1, ut_to_gcs.size());
+    EXPECT_EQ(2u, flightStats().txObjects);
+
+    /* The receiver still has the keyframe */
+    data[9] = 9;
+    ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[0], 0, data));
+    ut_deliver(ut_to_gcs, gcs);
+
+    uint8_t received[UT_OBJECT_BYTES];
+    UAVObjGetInstanceData(ut_handles[0], 0, received);
+    data[9] = 0xAA;
+    EXPECT_EQ(0, memcmp(data, received, sizeof(data)));
+    EXPECT_EQ(1u, gcsStats().rxObjects);
+    EXPECT_EQ(0u, gcsStats().rxErrors);
+}
+
+TEST_F(UAVTalkDeltaTest, KeyframeAfterInterval) {
+    sendObject(0);
+    for (uint32_t i = 0; i < UAVTALK_DELTA_KEYFRAME_INTERVAL; i++) {
+        data[0] = i;
+        sendObject(0);
+    }
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x20));
+    EXPECT_EQ((uint32_t)UAVTALK_DELTA_KEYFRAME_INTERVAL, ut_count_packets(ut_to_gcs, 0x26));
+
+    sendObject(0);
+    EXPECT_EQ(2u, ut_count_packets(ut_to_gcs, 0x20));
+}
+
+TEST_F(UAVTalkDeltaTest, KeyframeAfterTime) {
+    sendObject(0);
+    sendObject(0);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x26));
+
+    ut_ticks += UAVTALK_DELTA_KEYFRAME_MS;
+    sendObject(0);
+    EXPECT_EQ(2u, ut_count_packets(ut_to_gcs, 0x20));
+}
+
+TEST_F(UAVTalkDeltaTest, WholeObjectWhenShorter) {
+    sendObject(0);
+    ut_to_gcs.clear();
+
+    /* Everything changed, the bitmap would only add to it */
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        data[i] = ~i;
+    }
+    sendObject(0);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x20));
+
+    /* And it is the reference of the next delta */
+    ut_to_gcs.clear();
+    sendObject(0);
+    EXPECT_EQ(10u + 2 + 1, ut_to_gcs.size());
+}
+
+TEST_F(UAVTalkDeltaTest, ObjectWithoutLayoutIsSentWhole) {
+    sendObject(UT_NUM_OBJECTS - 1);
+    sendObject(UT_NUM_OBJECTS - 1);
+    EXPECT_EQ(2u, ut_count_packets(ut_to_gcs, 0x20));
+}
+
+TEST_F(UAVTalkDeltaTest, EnablingStartsWithKeyframes) {
+    sendObject(0);
+    sendObject(0);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x26));
+
+    UAVTalkSetDeltaEncoding(flight, false);
+    UAVTalkSetDeltaEncoding(flight, true);
+    sendObject(0);
+    EXPECT_EQ(2u, ut_count_packets(ut_to_gcs, 0x20));
+}
+
+TEST_F(UAVTalkDeltaTest, WorksWithAggregation) {
+    UAVTalkSetAggregation(flight, true);
+    sendObject(0);
+    sendObject(1);
+    EXPECT_EQ(0u, ut_to_gcs.size());
+
+    /* The pending multi-object frame goes out before the delta */
+    data[0] = 0x55;
+    sendObject(0);
+    ASSERT_EQ(1u, ut_count_packets(ut_to_gcs, 0x25));
+    ASSERT_EQ(1u, ut_count_packets(ut_to_gcs, 0x26));
+    EXPECT_EQ(0x25, ut_to_gcs[1]);
+
+    ut_deliver(ut_to_gcs, gcs);
+    EXPECT_EQ(0u, gcsStats().rxErrors);
+}
+
+TEST_F(UAVTalkDeltaTest, KeyframeInUnsentFrameIsNoReference) {
+    UAVTalkSetAggregation(flight, true);
+    sendObject(0);
+    ut_flight_link_down = true;
+    EXPECT_EQ(-1, UAVTalkFlushAggregated(flight));
+    ut_flight_link_down = false;
+
+    /* The receiver never got the keyframe, so the object goes out whole again */
+    data[0] = 0x55;
+    sendObject(0);
+    UAVTalkFlushAggregated(flight);
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x25));
+    EXPECT_EQ(0u, ut_count_packets(ut_to_gcs, 0x26));
+}
+
+TEST_F(UAVTalkDeltaTest, LeastRecentlySentSlotIsEvicted) {
+    /* Take all slots, then send object 0 again so that 1 is the oldest */
+    for (uint32_t n = 0; n < UAVTALK_DELTA_SLOTS; n++) {
+        sendObject(n);
+        ut_ticks++;
+    }
+    sendObject(0);
+    ut_ticks++;
+    ASSERT_EQ((uint32_t)UAVTALK_DELTA_SLOTS, ut_count_packets(ut_to_gcs, 0x20));
+    ut_to_gcs.clear();
+
+    /* A new object takes the slot of object 1 and gets deltas from then on */
+    sendObject(UAVTALK_DELTA_SLOTS);
+    ut_ticks++;
+    sendObject(UAVTALK_DELTA_SLOTS);
+    ut_ticks++;
+    sendObject(0);
+    ut_ticks++;
+    EXPECT_EQ(1u, ut_count_packets(ut_to_gcs, 0x20));
+    EXPECT_EQ(2u, ut_count_packets(ut_to_gcs, 0x26));
+
+    /* Object 1 lost its reference */
+    sendObject(1);
+    EXPECT_EQ(2u, ut_count_packets(ut_to_gcs, 0x20));
+}
+
+/* Frames passed through by the relay stream, and how they came in pieces */
+static std::deque<uint8_t> ut_relayed;
+static std::vector<uint8_t> ut_relay_counts;
+static int32_t ut_relay_short;
+
+extern "C" {
+static int32_t ut_relay_output(const UAVTalkFragment *fragments, uint8_t count)
+{
+    int32_t length = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        ut_relayed.insert(ut_relayed.end(), fragments[i].data, fragments[i].data + fragments[i].length);
+        length += fragments[i].length;
+    }
+    ut_relay_counts.push_back(count);
+    return length - ut_relay_short;
+}
+}
+
+class UAVTalkRelayTest : public UAVTalkParseTest {
+protected:
+    virtual void SetUp()
+    {
+        UAVTalkParseTest::SetUp();
+        ut_relayed.clear();
+        ut_relay_counts.clear();
+        ut_relay_short = 0;
+        UAVTalkSetRelayStream(flight, ut_relay_output);
+    }
+
+    /* Parse 'length' bytes on the gcs connection and relay every packet to the flight one, as RadioComBridge does */
+    void relay(uint8_t *bytes, uint8_t length)
+    {
+        uint8_t position = 0;
+
+        while (position < length) {
+            if (UAVTalkProcessInputStreamQuiet(gcs, bytes, length, &position) == UAVTALK_STATE_COMPLETE) {
+                UAVTalkRelayPacket(gcs, flight);
+            }
+        }
+    }
+};
+
+TEST_F(UAVTalkRelayTest, WholeFrameIsPassedThrough) {
+    std::vector<uint8_t> packet;
+
+    packObject(0, 0x11, packet);
+    relay(&packet[0], packet.size());
+
+    ASSERT_EQ(1u, ut_relay_counts.size());
+    EXPECT_EQ(1u, ut_relay_counts[0]);
+    EXPECT_TRUE(std::equal(packet.begin(), packet.end(), ut_relayed.begin()));
+    EXPECT_EQ(packet.size(), ut_relayed.size());
+    EXPECT_EQ(0u, ut_to_gcs.size());
+}
+
+TEST_F(UAVTalkRelayTest, SplitFrameIsRebuilt) {
+    std::vector<uint8_t> packet;
+
+    packObject(1, 0x22, packet);
+    for (size_t split = 1; split < packet.size(); split++) {
+        ut_relayed.clear();
+        ut_relay_counts.clear();
+        relay(&packet[0], split);
+        relay(&packet[split], packet.size() - split);
+
+        ASSERT_EQ(1u, ut_relay_counts.size()) << split;
+        EXPECT_EQ(3u, ut_relay_counts[0]) << split;
+        ASSERT_EQ(packet.size(), ut_relayed.size()) << split;
+        EXPECT_TRUE(std::equal(packet.begin(), packet.end(), ut_relayed.begin())) << split;
+    }
+}
+
+TEST_F(UAVTalkRelayTest, TimestampIsKept) {
+    uint8_t data[UT_OBJECT_BYTES];
+
+    memset(data, 0x5a, sizeof(data));
+    ASSERT_EQ(0, UAVObjSetInstanceData(ut_handles[2], 0, data));
+    ut_ticks = 0x4321;
+    ASSERT_EQ(0, UAVTalkSendObjectTimestamped(flight, ut_handles[2], 0, 0, 0));
+    std::vector<uint8_t> packet(ut_to_gcs.begin(), ut_to_gcs.end());
+    ut_to_gcs.clear();
+
+    /* Later than the original timestamp, byte by byte through the state machine */
+    ut_ticks = 0x5000;
+    for (size_t i = 0; i < packet.size(); i++) {
+        relay(&packet[i], 1);
+    }
+    ASSERT_EQ(packet.size(), ut_relayed.size());
+    EXPECT_TRUE(std::equal(packet.begin(), packet.end(), ut_relayed.begin()));
+
+    /* And the relayed frame still parses */
+    std::vector<uint8_t> relayed(ut_relayed.begin(), ut_relayed.end());
+    UAVTalkResetStats(gcs);
+    UAVTalkProcessInputStream(gcs, &relayed[0], relayed.size());
+    EXPECT_EQ(1u, gcsStats().rxObjects);
+    EXPECT_EQ(0u, gcsStats().rxCrcErrors);
+}
+
+TEST_F(UAVTalkRelayTest, StatsAreCounted) {
+    std::vector<uint8_t> packet;
+
+    packObject(3, 0x33, packet);
+    UAVTalkResetStats(flight);
+    relay(&packet[0], packet.size());
+    EXPECT_EQ(packet.size(), flightStats().txBytes);
+    EXPECT_EQ(0u, flightStats().txErrors);
+
+    ut_relay_short = 1;
+    EXPECT_EQ(-1, UAVTalkRelayPacket(gcs, flight));
+    EXPECT_EQ(packet.size(), flightStats().txBytes);
+    EXPECT_EQ(1u, flightStats().txErrors);
+
+    UAVTalkStats stats;
+    UAVTalkGetStats(flight, &stats, true);
+    EXPECT_EQ(0u, flightStats().txBytes);
+    EXPECT_EQ(0u, flightStats().txErrors);
+}
+
+TEST_F(UAVTalkRelayTest, CopiedWithoutRelayStream) {
+    std::vector<uint8_t> packet;
+
+    UAVTalkSetRelayStream(flight, NULL);
+    packObject(4, 0x44, packet);
+    relay(&packet[0], packet.size());
+
+    EXPECT_EQ(0u, ut_relayed.size());
+    ASSERT_EQ(packet.size(), ut_to_gcs.size());
+    EXPECT_TRUE(std::equal(packet.begin(), packet.end(), ut_to_gcs.begin()));
+}
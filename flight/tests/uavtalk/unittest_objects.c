@@ -0,0 +1,16 @@
+#include "openpilot.h"
+#include "unittest_objects.h"
+
+/* Handle slots for the test objects, laid out like the generated UAVO code does */
+UAVObjHandle ut_handles[UT_NUM_OBJECTS] __attribute__((section("_uavo_handles")));
+
+int xQueueSend(__attribute__((unused)) xQueueHandle queue, __attribute__((unused)) const void *item, __attribute__((unused)) unsigned int timeout)
+{
+    return pdTRUE;
+}
+
+int32_t EventCallbackDispatch(UAVObjEvent *ev, UAVObjEventCallback cb)
+{
+    cb(ev);
+    return pdTRUE;
+}
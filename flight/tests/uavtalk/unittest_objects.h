@@ -0,0 +1,8 @@
+#ifndef UNITTEST_OBJECTS_H
+#define UNITTEST_OBJECTS_H
+
+#define UT_NUM_OBJECTS 8
+
+extern UAVObjHandle ut_handles[UT_NUM_OBJECTS];
+
+#endif /* UNITTEST_OBJECTS_H */
@@ -44,6 +44,7 @@
 #define CALLBACK_PRIORITY    CALLBACK_PRIORITY_CRITICAL
 #define TASK_PRIORITY        CALLBACK_TASK_FLIGHTCONTROL
 #define MAX_UPDATE_PERIOD_MS 1000
+#define HEAP_INITIAL_SIZE    16
 
 // Private types
 
@@ -60,17 +61,24 @@ typedef struct {
 
 /**
  * List of object properties that are needed for the periodic updates.
+ * Entries with a non zero period are also kept in a binary min heap
+ * ordered by timeToNextUpdateMs, so that only the due events are visited.
  */
 struct PeriodicObjectListStruct {
     EventCallbackInfo evInfo; /** Event callback information */
     uint16_t updatePeriodMs; /** Update period in ms or 0 if no periodic updates are needed */
     int32_t  timeToNextUpdateMs; /** Time delay to the next update */
+    int16_t  heapIndex; /** Position in the heap, -1 if not scheduled */
+    bool     rephased; /** Deadline was randomized, do not account the next dispatch as late */
     struct PeriodicObjectListStruct *next; /** Needed by linked list library (utlist.h) */
 };
 typedef struct PeriodicObjectListStruct PeriodicObjectList;
 
 // Private variables
 static PeriodicObjectList *mObjList;
+static PeriodicObjectList * *mHeap;
+static uint16_t mHeapCount;
+static uint16_t mHeapSize;
 static xQueueHandle mQueue;
 static DelayedCallbackInfo *eventSchedulerCallback;
 static xSemaphoreHandle mMutex;
@@ -82,6 +90,10 @@ static void eventTask();
 static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static uint16_t randomizePeriod(uint16_t periodMs);
+static int32_t heapSchedule(PeriodicObjectList *objEntry);
+static void heapRemove(PeriodicObjectList *objEntry);
+static void heapSiftUp(uint16_t index);
+static void heapSiftDown(uint16_t index);
 
 
 /**
@@ -91,7 +103,10 @@ static uint16_t randomizePeriod(uint16_t periodMs);
 int32_t EventDispatcherInitialize()
 {
     // Initialize variables
-    mObjList = NULL;
+    mObjList   = NULL;
+    mHeap      = NULL;
+    mHeapCount = 0;
+    mHeapSize  = 0;
     memset(&mStats, 0, sizeof(EventStats));
 
     // Create mMutex
@@ -230,6 +245,7 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     // Create handle
     objEntry = (PeriodicObjectList *)pios_malloc(sizeof(PeriodicObjectList));
     if (objEntry == NULL) {
+        xSemaphoreGiveRecursive(mMutex);
         return -1;
     }
     objEntry->evInfo.ev.obj      = ev->obj;
@@ -239,6 +255,13 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     objEntry->evInfo.queue       = queue;
     objEntry->updatePeriodMs     = periodMs;
     objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+    objEntry->rephased  = true;
+    objEntry->heapIndex = -1;
+    if (heapSchedule(objEntry) != 0) {
+        vPortFree(objEntry);
+        xSemaphoreGiveRecursive(mMutex);
+        return -1;
+    }
     // Add to list
     LL_APPEND(mObjList, objEntry);
     // Release lock
@@ -270,9 +293,11 @@ static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
             // Object found, update period
             objEntry->updatePeriodMs     = periodMs;
             objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
+            objEntry->rephased = true;
+            int32_t rc = heapSchedule(objEntry);
             // Release lock
             xSemaphoreGiveRecursive(mMutex);
-            return 0;
+            return rc;
         }
     }
     // If this point is reached the object was not found
@@ -320,41 +345,59 @@ static int32_t processPeriodicUpdates()
     int32_t timeNow;
     int32_t timeToNextUpdate;
     int32_t offset;
+    uint32_t lateness;
+    uint16_t limit;
 
     // Get lock
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update.
-    timeToNextUpdate = xTaskGetTickCount() * portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
-    LL_FOREACH(mObjList, objEntry) {
-        // If object is configured for periodic updates
-        if (objEntry->updatePeriodMs > 0) {
-            // Check if time for the next update
-            timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
-            if (objEntry->timeToNextUpdateMs <= timeNow) {
-                // Reset timer
-                offset = (timeNow - objEntry->timeToNextUpdateMs) % objEntry->updatePeriodMs;
-                objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
-                // Invoke callback, if one
-                if (objEntry->evInfo.cb != 0) {
-                    objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
-                }
-                // Push event to queue, if one
-                if (objEntry->evInfo.queue != 0) {
-                    if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
-                        if (objEntry->evInfo.ev.obj != NULL) {
-                            mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
-                        }
-                        ++mStats.eventErrors;
-                    }
-                }
+    // Take the due objects off the top of the heap, update their timer and transmit them.
+    // Each object is visited at most once per call, even if its callback reschedules it.
+    limit   = mHeapCount;
+    timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    while (limit-- > 0 && mHeapCount > 0 && mHeap[0]->timeToNextUpdateMs <= timeNow) {
+        objEntry = mHeap[0];
+
+        // Account for the lateness, unless the deadline was just randomized
+        lateness = timeNow - objEntry->timeToNextUpdateMs;
+        ++mStats.periodicDispatches;
+        if (objEntry->rephased) {
+            objEntry->rephased = false;
+        } else if (lateness > 0) {
+            ++mStats.lateDispatches;
+            mStats.latenessSumMs += lateness;
+            mStats.missedPeriods += lateness / objEntry->updatePeriodMs;
+            if (lateness > mStats.latenessMaxMs) {
+                mStats.latenessMaxMs = lateness;
+                mStats.latenessMaxID = objEntry->evInfo.ev.obj ? UAVObjGetID(objEntry->evInfo.ev.obj) : 0;
             }
-            // Update minimum delay
-            if (objEntry->timeToNextUpdateMs < timeToNextUpdate) {
-                timeToNextUpdate = objEntry->timeToNextUpdateMs;
+        }
+
+        // Reset timer
+        offset = lateness % objEntry->updatePeriodMs;
+        objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
+        heapSiftDown(0);
+
+        // Invoke callback, if one
+        if (objEntry->evInfo.cb != 0) {
+            objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
+        }
+        // Push event to queue, if one
+        if (objEntry->evInfo.queue != 0) {
+            if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
+                if (objEntry->evInfo.ev.obj != NULL) {
+                    mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
+                }
+                ++mStats.eventErrors;
             }
         }
+        timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    }
+
+    // The earliest deadline is at the top of the heap
+    timeToNextUpdate = timeNow + MAX_UPDATE_PERIOD_MS;
+    if (mHeapCount > 0 && mHeap[0]->timeToNextUpdateMs < timeToNextUpdate) {
+        timeToNextUpdate = mHeap[0]->timeToNextUpdateMs;
     }
 
     // Done
@@ -362,6 +405,111 @@ static int32_t processPeriodicUpdates()
     return timeToNextUpdate;
 }
 
+/**
+ * Put an object in the heap according to its period and timer, or take
+ * it out if periodic updates got disabled. Must be called with the lock held.
+ * \return Success (0), failure (-1)
+ */
+static int32_t heapSchedule(PeriodicObjectList *objEntry)
+{
+    if (objEntry->updatePeriodMs == 0) {
+        heapRemove(objEntry);
+        return 0;
+    }
+
+    if (objEntry->heapIndex < 0) {
+        // Grow the heap if needed
+        if (mHeapCount == mHeapSize) {
+            uint16_t newSize = mHeapSize ? mHeapSize * 2 : HEAP_INITIAL_SIZE;
+            PeriodicObjectList * *newHeap = (PeriodicObjectList * *)pios_malloc(newSize * sizeof(PeriodicObjectList *));
+            if (newHeap == NULL) {
+                return -1;
+            }
+            if (mHeap) {
+                memcpy(newHeap, mHeap, mHeapCount * sizeof(PeriodicObjectList *));
+                vPortFree(mHeap);
+            }
+            mHeap     = newHeap;
+            mHeapSize = newSize;
+        }
+        objEntry->heapIndex = mHeapCount;
+        mHeap[mHeapCount++] = objEntry;
+    }
+
+    // The timer may have moved either way
+    heapSiftUp(objEntry->heapIndex);
+    heapSiftDown(objEntry->heapIndex);
+    return 0;
+}
+
+/**
+ * Take an object out of the heap, if it is in there.
+ */
+static void heapRemove(PeriodicObjectList *objEntry)
+{
+    int16_t index = objEntry->heapIndex;
+
+    if (index < 0) {
+        return;
+    }
+    objEntry->heapIndex = -1;
+    if (index == --mHeapCount) {
+        return;
+    }
+    // Fill the hole with the last entry
+    PeriodicObjectList *moved = mHeap[mHeapCount];
+    mHeap[index]     = moved;
+    moved->heapIndex = index;
+    heapSiftUp(index);
+    heapSiftDown(moved->heapIndex);
+}
+
+/**
+ * Move a heap entry up until its parent is due earlier.
+ */
+static void heapSiftUp(uint16_t index)
+{
+    PeriodicObjectList *objEntry = mHeap[index];
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if (mHeap[parent]->timeToNextUpdateMs <= objEntry->timeToNextUpdateMs) {
+            break;
+        }
+        mHeap[index] = mHeap[parent];
+        mHeap[index]->heapIndex = index;
+        index = parent;
+    }
+    mHeap[index] = objEntry;
+    objEntry->heapIndex = index;
+}
+
+/**
+ * Move a heap entry down until its children are due later.
+ */
+static void heapSiftDown(uint16_t index)
+{
+    PeriodicObjectList *objEntry = mHeap[index];
+
+    while (1) {
+        uint16_t child = 2 * index + 1;
+        if (child >= mHeapCount) {
+            break;
+        }
+        if (child + 1 < mHeapCount && mHeap[child + 1]->timeToNextUpdateMs < mHeap[child]->timeToNextUpdateMs) {
+            ++child;
+        }
+        if (objEntry->timeToNextUpdateMs <= mHeap[child]->timeToNextUpdateMs) {
+            break;
+        }
+        mHeap[index] = mHeap[child];
+        mHeap[index]->heapIndex = index;
+        index = child;
+    }
+    mHeap[index] = objEntry;
+    objEntry->heapIndex = index;
+}
+
 /**
  * Return a psedorandom integer from 0 to periodMs
  * Based on the Park-Miller-Carta Pseudo-Random Number Generator
@@ -33,6 +33,12 @@
 typedef struct {
     uint32_t lastErrorID;
     uint32_t eventErrors;
+    uint32_t periodicDispatches; /** Periodic events dispatched */
+    uint32_t lateDispatches; /** Periodic events dispatched after their deadline */
+    uint32_t latenessSumMs; /** Accumulated lateness of the late dispatches */
+    uint32_t latenessMaxMs; /** Worst lateness */
+    uint32_t latenessMaxID; /** Object ID of the event with the worst lateness */
+    uint32_t missedPeriods; /** Whole periods skipped because of late dispatches */
 } EventStats;
 
 // Public functions
@@ -46,6 +46,8 @@
 #define UAVOBJ_GCS_TELEMETRY_UPDATE_MODE_SHIFT 6
 #define UAVOBJ_LOGGING_UPDATE_MODE_SHIFT       8
 #define UAVOBJ_UPDATE_MODE_MASK                0x3
+#define UAVOBJ_TELEMETRY_CLASS_SHIFT           10
+#define UAVOBJ_TELEMETRY_CLASS_MASK            0x3
 
 typedef void *UAVObjHandle;
 
@@ -98,6 +100,16 @@ typedef enum {
     UPDATEMODE_THROTTLED = 3 /** Object is updated on change, but not more often than the interval time */
 } UAVObjUpdateMode;
 
+/**
+ * Telemetry priority class, decides which transmit queue the updates of an object go through
+ */
+typedef enum {
+    TELEMETRYCLASS_DEFAULT = 0, /** Class derived from the object type by the telemetry module */
+    TELEMETRYCLASS_HIGH    = 1, /** Flight state, never waits behind the other classes */
+    TELEMETRYCLASS_NORMAL  = 2, /** Regular updates */
+    TELEMETRYCLASS_BULK    = 3 /** Settings, logs and other transfers that can wait */
+} UAVObjTelemetryClass;
+
 /**
  * Object metadata, each object has a meta object that holds its metadata. The metadata define
  * properties for each object and can be used by multiple modules (e.g. telemetry and logger)
@@ -114,6 +126,7 @@ typedef enum {
  *    4-5    telemetryUpdateMode      Update mode used by the telemetry module (UAVObjUpdateMode)
  *    6-7    gcsTelemetryUpdateMode   Update mode used by the GCS (UAVObjUpdateMode)
  *    8-9    loggingUpdateMode        Update mode used by the logging module (UAVObjUpdateMode)
+ *  10-11    telemetryClass           Priority class used by the telemetry module (UAVObjTelemetryClass)
  */
 typedef struct {
     uint16_t flags; /** Defines flags for update and logging modes and whether an update should be ACK'd (bits defined above) */
@@ -133,7 +146,8 @@ typedef enum {
     EV_UPDATED_PERIODIC = 0x08, /** Object update from periodic event */
     EV_LOGGING_MANUAL   = 0x10, /** Object update event manually generated */
     EV_LOGGING_PERIODIC = 0x20, /** Object update from periodic event */
-    EV_UPDATE_REQ = 0x40 /** Request to update object data */
+    EV_UPDATE_REQ = 0x40, /** Request to update object data */
+    EV_BATCH_READY = 0x80 /** Wake up message of a batch listener, events are pending in the batch */
 } UAVObjEventType;
 
 /**
@@ -172,6 +186,16 @@ typedef void (*UAVObjEventCallback)(UAVObjEvent *ev);
  */
 typedef void (*UAVObjInitializeCallback)(UAVObjHandle obj_handle, uint16_t instId);
 
+/**
+ * Layout of one field of the packed object data, the generated table of an object
+ * has one entry per field in packed order and ends with an all zero entry.
+ * Used to transfer the changed elements of an object only (UAVObjPackDelta()).
+ */
+typedef struct {
+    uint16_t numElements;
+    uint8_t  elementSize;
+} __attribute__((packed)) UAVObjFieldInfo;
+
 /**
  * Event manager statistics
  */
@@ -182,10 +206,33 @@ typedef struct {
     uint32_t lastQueueErrorID;
 } UAVObjStats;
 
+/**
+ * Per listener (event queue) statistics
+ */
+typedef struct {
+    uint32_t events; /** Events delivered to the listener */
+    uint32_t overflows; /** Events dropped because the listener was full */
+    uint32_t superseded; /** Events merged into a pending one of the same object instance */
+    uint32_t lastOverflowID; /** Object ID of the last dropped event */
+    uint32_t wakeups; /** Wake up messages posted to the queue of a batch listener */
+    uint16_t highWater; /** Highest number of events pending in the batch */
+} UAVObjListenerStats;
+
+/** opaque type for batch listeners **/
+typedef void *UAVObjBatchHandle;
+
+/**
+ * What a full batch listener does with a new event
+ */
+typedef enum {
+    UAVOBJ_DROP_NEWEST = 0, /** The new event is dropped */
+    UAVOBJ_DROP_OLDEST = 1 /** The oldest pending event is dropped to make room for the new one */
+} UAVObjDropPolicy;
+
 int32_t UAVObjInitialize();
 void UAVObjGetStats(UAVObjStats *statsOut);
 void UAVObjClearStats();
-UAVObjHandle UAVObjRegister(uint32_t id, bool isSingleInstance, bool isSettings, bool isPriority, uint32_t num_bytes, UAVObjInitializeCallback initCb);
+UAVObjHandle UAVObjRegister(uint32_t id, bool isSingleInstance, bool isSettings, bool isPriority, uint32_t num_bytes, uint16_t arena_instances, UAVObjInitializeCallback initCb);
 UAVObjHandle UAVObjGetByID(uint32_t id);
 uint32_t UAVObjGetID(UAVObjHandle obj);
 uint32_t UAVObjGetNumBytes(UAVObjHandle obj);
@@ -198,6 +245,10 @@ bool UAVObjIsSettings(UAVObjHandle obj);
 bool UAVObjIsPriority(UAVObjHandle obj);
 int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *dataIn);
 int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut);
+int32_t UAVObjSetFieldInfo(UAVObjHandle obj_handle, const UAVObjFieldInfo *fieldInfo);
+const UAVObjFieldInfo *UAVObjGetFieldInfo(UAVObjHandle obj_handle);
+int32_t UAVObjPackDelta(UAVObjHandle obj_handle, uint16_t instId, uint8_t *reference, uint8_t *dataOut);
+int32_t UAVObjUnpackDelta(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *dataIn, uint32_t length);
 uint8_t UAVObjUpdateCRC(UAVObjHandle obj_handle, uint16_t instId, uint8_t crc);
 int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId);
 int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId);
@@ -216,6 +267,8 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId, const vo
 int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, const void *dataIn, uint32_t offset, uint32_t size);
 int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId, void *dataOut);
 int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, void *dataOut, uint32_t offset, uint32_t size);
+const void *UAVObjBorrowInstanceData(UAVObjHandle obj_handle, uint16_t instId);
+void UAVObjReleaseInstanceData(UAVObjHandle obj_handle, uint16_t instId);
 int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata *dataIn);
 int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut);
 uint8_t UAVObjGetMetadataAccess(const UAVObjMetadata *dataOut);
@@ -233,9 +286,16 @@ UAVObjUpdateMode UAVObjGetGcsTelemetryUpdateMode(const UAVObjMetadata *dataOut);
 void UAVObjSetTelemetryGcsUpdateMode(UAVObjMetadata *dataOut, UAVObjUpdateMode val);
 UAVObjUpdateMode UAVObjGetLoggingUpdateMode(const UAVObjMetadata *dataOut);
 void UAVObjSetLoggingUpdateMode(UAVObjMetadata *dataOut, UAVObjUpdateMode val);
+UAVObjTelemetryClass UAVObjGetTelemetryClass(const UAVObjMetadata *dataOut);
+void UAVObjSetTelemetryClass(UAVObjMetadata *dataOut, UAVObjTelemetryClass val);
 int8_t UAVObjReadOnly(UAVObjHandle obj);
 int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, xQueueHandle queue, uint8_t eventMask);
 int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, xQueueHandle queue);
+UAVObjBatchHandle UAVObjBatchCreate(xQueueHandle queue, uint16_t length);
+bool UAVObjBatchReceive(UAVObjBatchHandle batch, UAVObjEvent *ev);
+void UAVObjBatchSetDropPolicy(UAVObjBatchHandle batch, UAVObjDropPolicy policy);
+void UAVObjBatchSetCoalescing(UAVObjBatchHandle batch, bool coalesce);
+int32_t UAVObjGetListenerStats(xQueueHandle queue, UAVObjListenerStats *statsOut);
 int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb, uint8_t eventMask, bool fast);
 int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb);
 void UAVObjRequestUpdate(UAVObjHandle obj);
@@ -38,6 +38,9 @@
 // Macros
 #define SET_BITS(var, shift, value, mask) var = (var & ~(mask << shift)) | (value << shift);
 
+/* Full memory barrier, orders the lockless readers against the writers */
+#define UAVO_MEMORY_BARRIER()             __sync_synchronize()
+
 // Mach-o: dummy segment to calculate ASLR offset in sim_osx
 #if (defined(__MACH__) && defined(__APPLE__))
 static long _aslr_offset __attribute__((section("__DATA,_aslr")));
@@ -68,9 +71,30 @@ extern struct UAVOData *__stop__uavo_handles[] __attribute__((weak));
 /** opaque type for instances **/
 typedef void *InstanceHandle;
 
+/*
+ * Event queue listener, there is a single one per queue. A batch listener
+ * buffers the object events in a ring and only posts an EV_BATCH_READY
+ * message to its queue when the ring was drained by the consumer, so a
+ * burst of updates costs one queue operation instead of one per event.
+ * The ring has a single producer (sendEvent, under the manager mutex) and
+ * a single consumer (UAVObjBatchReceive).
+ */
+struct UAVOListener {
+    struct UAVOListener *next;
+    xQueueHandle queue;
+    UAVObjEvent  *ring;
+    uint16_t     ringSize;
+    volatile uint16_t    head;
+    volatile uint16_t    tail;
+    volatile bool wakeupPending;
+    UAVObjDropPolicy     dropPolicy;
+    bool coalesce;
+    UAVObjListenerStats  stats;
+};
+
 struct ObjectEventEntry {
     struct ObjectEventEntry *next;
-    xQueueHandle queue;
+    struct UAVOListener     *listener;
     UAVObjEventCallback     cb;
     uint8_t eventMask;
     bool fast;
@@ -84,6 +108,11 @@ struct ObjectEventEntry {
    \-->[InstanceData1 [next]]
                                                   _________...________/
    \-->[InstanceDataN [next]]
+
+   The first ArenaInstances instances of a multi instance UAVO are laid out
+   back to back in the same allocation as the UAVO itself (the arena), the
+   next pointers still chain them. Instances beyond the arena are allocated
+   one by one from the heap.
  */
 
 /*
@@ -120,6 +149,14 @@ struct UAVOData {
      */
     struct UAVOMeta metaObj;
     uint16_t instance_size;
+    /*
+     * Sequence counter for lockless readers, covers the data of all
+     * instances as well as the embedded meta object. Odd while a write
+     * is in progress.
+     */
+    volatile uint32_t seq __attribute__((aligned(4)));
+    /* Generated field layout, NULL when the object did not provide one */
+    const UAVObjFieldInfo *fieldInfo;
 } __attribute__((packed, aligned(4)));
 
 /* Augmented type for Single Instance Data UAVO */
@@ -147,10 +184,11 @@ struct UAVOMultiInst {
 struct UAVOMulti {
     struct UAVOData uavo;
     uint16_t num_instances;
+    uint16_t arena_instances;
     struct UAVOMultiInst instance0 __attribute__((aligned(4)));
     /*
      * Additional space will be malloc'd here to hold the
-     * the data for instance 0.
+     * the data for instance 0 and the rest of the arena.
      */
 } __attribute__((packed));
 
@@ -166,8 +204,46 @@ struct UAVOMulti {
 #define InstanceDataOffset(inst)         ((void *)&(((struct UAVOMultiInst *)inst)->instance))
 #define InstanceData(instance)           ((void *)instance)
 
+/** instances in the arena of a multi instance object are directly indexed **/
+#define ArenaStride(num_bytes)           ((sizeof(struct UAVOMultiInst) + (num_bytes) + 3) & ~3)
+#define ArenaInstance(multi, n)          ((struct UAVOMultiInst *)((uint8_t *)&((multi)->instance0) + (n) * ArenaStride((multi)->uavo.instance_size)))
+
+/* Number of lockless read attempts before a reader falls back to the lock */
+#define UAVO_SEQLOCK_RETRIES             3
+
+/**
+ * Data object whose sequence counter covers the given object,
+ * metaobjects share the counter of their parent object.
+ */
+static inline struct UAVOData *SeqOwner(struct UAVOBase *obj)
+{
+    if (obj->flags.isMeta) {
+        return container_of((struct UAVOMeta *)obj, struct UAVOData, metaObj);
+    }
+    return (struct UAVOData *)obj;
+}
+
+/**
+ * Mark the start and the end of a modification of the object data.
+ * Writers are still serialized by the object manager lock, the counter
+ * only lets lockless readers detect that they raced with a writer.
+ */
+static inline void SeqWriteBegin(struct UAVOData *obj)
+{
+    __sync_fetch_and_add(&obj->seq, 1);
+    UAVO_MEMORY_BARRIER();
+}
+
+static inline void SeqWriteEnd(struct UAVOData *obj)
+{
+    UAVO_MEMORY_BARRIER();
+    __sync_fetch_and_add(&obj->seq, 1);
+}
+
 // Private functions
 int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType event);
 InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId);
+void lockManager();
+void unlockManager();
 
 #endif /* UAVOBJECTPRIVATE_H_ */
@@ -40,6 +40,13 @@ static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId);
 static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb, uint8_t eventMask, bool fast);
 static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb);
 static void instanceAutoUpdated(UAVObjHandle obj_handle, uint16_t instId);
+static int32_t indexInsert(struct UAVOData *obj);
+static UAVObjHandle indexLookup(uint32_t id);
+static int32_t copyInstanceData(UAVObjHandle obj_handle, uint16_t instId, void *dataOut, uint32_t offset, uint32_t size);
+static int32_t readInstanceData(UAVObjHandle obj_handle, uint16_t instId, void *dataOut, uint32_t offset, uint32_t size);
+static struct UAVOListener *getListener(xQueueHandle queue, bool create);
+static int32_t deliverEvent(struct UAVOListener *listener, const UAVObjEvent *msg);
+static bool isPending(struct UAVOListener *listener, const UAVObjEvent *msg, uint16_t tail);
 
 
 int32_t UAVObjPers_stub(__attribute__((unused)) UAVObjHandle obj_handle, __attribute__((unused))  uint16_t instId)
@@ -67,6 +74,20 @@ static const UAVObjMetadata defMetadata = {
 
 static UAVObjStats stats;
 
+/*
+ * Lookup index of all registered objects, sorted by object ID.
+ * Entries are only added (under the mutex) and never removed. Readers search
+ * the index without taking the mutex and use indexSeq to detect a concurrent
+ * insertion: the counter is odd while the index is being modified.
+ */
+static struct UAVOData * *uavoIndex;
+static uint16_t uavoIndexSize;
+static volatile uint16_t uavoIndexCount;
+static volatile uint32_t indexSeq;
+
+// Event queue listeners, one for each queue ever connected
+static struct UAVOListener *listeners;
+
 
 static inline bool IsMetaobject(UAVObjHandle obj_handle)
 {
@@ -154,6 +175,7 @@ int32_t UAVObjInitialize()
 {
     // Initialize variables
     memset(&stats, 0, sizeof(UAVObjStats));
+    listeners = NULL;
 
     /* Initialize _uavo_handles start/stop pointers */
         #if (defined(__MACH__) && defined(__APPLE__))
@@ -166,6 +188,17 @@ int32_t UAVObjInitialize()
     memset(__start__uavo_handles, 0,
            (uintptr_t)__stop__uavo_handles - (uintptr_t)__start__uavo_handles);
 
+    // Allocate the lookup index, one entry for each handle slot linked in
+    uavoIndexSize  = __stop__uavo_handles - __start__uavo_handles;
+    uavoIndexCount = 0;
+    indexSeq = 0;
+    if (uavoIndexSize > 0) {
+        uavoIndex = (struct UAVOData * *)pios_malloc(uavoIndexSize * sizeof(struct UAVOData *));
+        if (uavoIndex == NULL) {
+            return -1;
+        }
+    }
+
     // Create mutex
     mutex = xSemaphoreCreateRecursiveMutex();
     if (mutex == NULL) {
@@ -196,9 +229,58 @@ void UAVObjGetStats(UAVObjStats *statsOut)
  */
 void UAVObjClearStats()
 {
+    struct UAVOListener *listener;
+
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
     memset(&stats, 0, sizeof(UAVObjStats));
+    LL_FOREACH(listeners, listener) {
+        memset(&listener->stats, 0, sizeof(UAVObjListenerStats));
+    }
+    xSemaphoreGiveRecursive(mutex);
+}
+
+/**
+ * Get the statistics counters of the listener attached to an event queue
+ * @param[in] queue The event queue
+ * @param[out] statsOut The statistics counters will be copied there
+ * @return 0 if success or -1 if nothing was ever connected to the queue
+ */
+int32_t UAVObjGetListenerStats(xQueueHandle queue, UAVObjListenerStats *statsOut)
+{
+    struct UAVOListener *listener;
+    int32_t rc = -1;
+
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    listener = getListener(queue, false);
+    if (listener) {
+        memcpy(statsOut, &listener->stats, sizeof(UAVObjListenerStats));
+        rc = 0;
+    }
     xSemaphoreGiveRecursive(mutex);
+    return rc;
+}
+
+/**
+ * Look for an event of the same object instance and type among the pending events
+ * of a batch listener. Consumers read the object data once they took the event out,
+ * so any pending event taken out after the object was updated sends the new data.
+ * The head is read after the update for that reason, what the consumer took before
+ * is not considered pending anymore.
+ * \return true if such an event is pending
+ */
+static bool isPending(struct UAVOListener *listener, const UAVObjEvent *msg, uint16_t tail)
+{
+    UAVO_MEMORY_BARRIER();
+    uint16_t n = listener->head;
+
+    while (n != tail) {
+        const UAVObjEvent *pending = &listener->ring[n];
+        if (pending->obj == msg->obj && pending->instId == msg->instId && pending->event == msg->event) {
+            return true;
+        }
+        n = (n + 1 == listener->ringSize) ? 0 : n + 1;
+    }
+    return false;
 }
 
 /************************
@@ -244,10 +326,15 @@ static struct UAVOData *UAVObjAllocSingle(uint32_t num_bytes)
     return &(uavo_single->uavo);
 }
 
-static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes)
+static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes, uint16_t arena_instances)
 {
-    /* Compute the complete size of the object, including the data for a single embedded instance */
-    uint32_t object_size = sizeof(struct UAVOMulti) + num_bytes;
+    /* Instance 0 always lives with the object */
+    if (arena_instances < 1) {
+        arena_instances = 1;
+    }
+
+    /* Compute the complete size of the object, including the data for all instances of the arena */
+    uint32_t object_size = offsetof(struct UAVOMulti, instance0) + arena_instances * ArenaStride(num_bytes);
 
     /* Allocate the object from the heap */
     struct UAVOMulti *uavo_multi = (struct UAVOMulti *)pios_malloc(object_size);
@@ -263,9 +350,10 @@ static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes)
     uavo_base->next_event     = NULL;
 
     /* Set up the type-specific part of the UAVO */
-    uavo_multi->num_instances = 1;
+    uavo_multi->num_instances   = 1;
+    uavo_multi->arena_instances = arena_instances;
 
-    /* Clear the multi instance data carried in the UAVO */
+    /* Clear the multi instance data carried in the UAVO, the rest of the arena is cleared on instance creation */
     memset(&(uavo_multi->instance0), 0, sizeof(struct UAVOMultiInst) + num_bytes);
 
     /* Give back the generic UAVO part */
@@ -282,13 +370,14 @@ static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes)
  * \param[in] isSingleInstance Is this a single instance or multi-instance object
  * \param[in] isSettings Is this a settings object
  * \param[in] numBytes Number of bytes of object data (for one instance)
+ * \param[in] arenaInstances Number of instances of a multi-instance object to reserve contiguously
  * \param[in] initCb Default field and metadata initialization function
  * \return Object handle, or NULL if failure.
  * \return
  */
 UAVObjHandle UAVObjRegister(uint32_t id,
                             bool isSingleInstance, bool isSettings, bool isPriority,
-                            uint32_t num_bytes,
+                            uint32_t num_bytes, uint16_t arena_instances,
                             UAVObjInitializeCallback initCb)
 {
     struct UAVOData *uavo_data = NULL;
@@ -300,11 +389,16 @@ UAVObjHandle UAVObjRegister(uint32_t id,
         goto unlock_exit;
     }
 
+    /* Make sure the object will fit in the lookup index */
+    if (uavoIndexCount >= uavoIndexSize) {
+        goto unlock_exit;
+    }
+
     /* Map the various flags to one of the UAVO types we understand */
     if (isSingleInstance) {
         uavo_data = UAVObjAllocSingle(num_bytes);
     } else {
-        uavo_data = UAVObjAllocMulti(num_bytes);
+        uavo_data = UAVObjAllocMulti(num_bytes, arena_instances);
     }
 
     if (!uavo_data) {
@@ -314,6 +408,8 @@ UAVObjHandle UAVObjRegister(uint32_t id,
     /* Fill in the details about this UAVO */
     uavo_data->id = id;
     uavo_data->instance_size = num_bytes;
+    uavo_data->seq = 0;
+    uavo_data->fieldInfo = NULL;
     if (isSettings) {
         uavo_data->base.flags.isSettings = true;
         // settings defaults to being sent with priority
@@ -337,6 +433,9 @@ UAVObjHandle UAVObjRegister(uint32_t id,
         UAVObjLoad((UAVObjHandle)uavo_data, 0);
     }
 
+    /* Make the object visible to UAVObjGetByID() */
+    indexInsert(uavo_data);
+
     // fire events for outer object and its embedded meta object
     instanceAutoUpdated((UAVObjHandle)uavo_data, 0);
     instanceAutoUpdated((UAVObjHandle) & (uavo_data->metaObj), 0);
@@ -348,31 +447,31 @@ unlock_exit:
 
 /**
  * Retrieve an object from the list given its id
+ * The lookup is a binary search in the object index and does not take the
+ * object manager lock, unless an object is being registered concurrently.
  * \param[in] The object ID
  * \return The object or NULL if not found.
  */
 UAVObjHandle UAVObjGetByID(uint32_t id)
 {
-    UAVObjHandle *found_obj = (UAVObjHandle *)NULL;
-
-    // Get lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    UAVObjHandle found_obj;
+    uint32_t seq = indexSeq;
 
-    // Look for object
-    UAVO_LIST_ITERATE(tmp_obj)
-    if (tmp_obj->id == id) {
-        found_obj = (UAVObjHandle *)tmp_obj;
-        goto unlock_exit;
-    }
-    if (MetaObjectId(tmp_obj->id) == id) {
-        found_obj = (UAVObjHandle *)&(tmp_obj->metaObj);
-        goto unlock_exit;
+    if ((seq & 1) == 0) {
+        UAVO_MEMORY_BARRIER();
+        found_obj = indexLookup(id);
+        UAVO_MEMORY_BARRIER();
+        if (indexSeq == seq) {
+            return found_obj;
+        }
     }
-}
 
-unlock_exit:
-xSemaphoreGiveRecursive(mutex);
-return found_obj;
+    // The index is being updated, wait for the writer to finish
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    found_obj = indexLookup(id);
+    xSemaphoreGiveRecursive(mutex);
+
+    return found_obj;
 }
 
 /**
@@ -531,7 +630,9 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
         if (instId != 0) {
             goto unlock_exit;
         }
+        SeqWriteBegin(SeqOwner((struct UAVOBase *)obj_handle));
         memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
+        SeqWriteEnd(SeqOwner((struct UAVOBase *)obj_handle));
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -550,7 +651,9 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
             }
         }
         // Set the data
+        SeqWriteBegin(obj);
         memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+        SeqWriteEnd(obj);
     }
 
     // Fire event
@@ -573,32 +676,180 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    return readInstanceData(obj_handle, instId, dataOut, 0, UAVObjGetNumBytes(obj_handle));
+}
 
-    int32_t rc = -1;
+/**
+ * Attach the generated field layout to an object, this enables UAVObjPackDelta()
+ * and UAVObjUnpackDelta() on it.
+ * \param[in] obj The object handle
+ * \param[in] fieldInfo Field table ending with an all zero entry, must stay valid
+ * \return 0 if success or -1 if the table does not match the object size
+ */
+int32_t UAVObjSetFieldInfo(UAVObjHandle obj_handle, const UAVObjFieldInfo *fieldInfo)
+{
+    PIOS_Assert(obj_handle);
 
     if (IsMetaobject(obj_handle)) {
-        if (instId != 0) {
-            goto unlock_exit;
+        return -1;
+    }
+
+    struct UAVOData *obj = (struct UAVOData *)obj_handle;
+    uint32_t numBytes    = 0;
+    for (const UAVObjFieldInfo *field = fieldInfo; field->numElements; ++field) {
+        numBytes += field->numElements * field->elementSize;
+    }
+    if (numBytes != obj->instance_size) {
+        return -1;
+    }
+
+    obj->fieldInfo = fieldInfo;
+    return 0;
+}
+
+/**
+ * Get the field layout of an object
+ * \param[in] obj The object handle
+ * \return The field table or NULL if the object has none
+ */
+const UAVObjFieldInfo *UAVObjGetFieldInfo(UAVObjHandle obj_handle)
+{
+    PIOS_Assert(obj_handle);
+
+    if (IsMetaobject(obj_handle)) {
+        return NULL;
+    }
+    return ((struct UAVOData *)obj_handle)->fieldInfo;
+}
+
+/**
+ * Number of bytes of the element bitmap in front of a delta
+ */
+static uint32_t deltaBitmapLength(const UAVObjFieldInfo *fieldInfo)
+{
+    uint32_t numElements = 0;
+
+    for (const UAVObjFieldInfo *field = fieldInfo; field->numElements; ++field) {
+        numElements += field->numElements;
+    }
+    return (numElements + 7) / 8;
+}
+
+/**
+ * Pack the elements of an object instance that differ from a reference copy.
+ * The delta is a bitmap with one bit per field element, in packed order and
+ * least significant bit first, followed by the changed elements.
+ * \param[in] obj The object handle
+ * \param[in] instId The instance ID
+ * \param[in,out] reference Packed data the delta is relative to, the changed
+ *                 elements are copied into it when dataOut is not NULL
+ * \param[out] dataOut The delta, or NULL to only get its length
+ * \return Length of the delta or -1 if failure
+ */
+int32_t UAVObjPackDelta(UAVObjHandle obj_handle, uint16_t instId, uint8_t *reference, uint8_t *dataOut)
+{
+    const UAVObjFieldInfo *fieldInfo = UAVObjGetFieldInfo(obj_handle);
+
+    if (!fieldInfo) {
+        return -1;
+    }
+
+    const uint8_t *data = (const uint8_t *)UAVObjBorrowInstanceData(obj_handle, instId);
+    if (!data) {
+        return -1;
+    }
+
+    uint32_t bitmapLength = deltaBitmapLength(fieldInfo);
+    uint32_t length = bitmapLength;
+    uint32_t offset = 0;
+    uint32_t bit    = 0;
+
+    if (dataOut) {
+        memset(dataOut, 0, bitmapLength);
+    }
+    for (const UAVObjFieldInfo *field = fieldInfo; field->numElements; ++field) {
+        for (uint16_t n = 0; n < field->numElements; ++n, ++bit, offset += field->elementSize) {
+            if (memcmp(&data[offset], &reference[offset], field->elementSize) == 0) {
+                continue;
+            }
+            if (dataOut) {
+                dataOut[bit / 8] |= 1 << (bit % 8);
+                memcpy(&dataOut[length], &data[offset], field->elementSize);
+                memcpy(&reference[offset], &data[offset], field->elementSize);
+            }
+            length += field->elementSize;
         }
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
-    } else {
-        struct UAVOData *obj;
-        InstanceHandle instEntry;
+    }
 
-        // Cast handle to object
-        obj = (struct UAVOData *)obj_handle;
+    UAVObjReleaseInstanceData(obj_handle, instId);
+    return length;
+}
 
-        // Get the instance
-        instEntry = getInstance(obj, instId);
-        if (instEntry == NULL) {
-            goto unlock_exit;
+/**
+ * Apply a delta made by UAVObjPackDelta() to an existing object instance.
+ * \param[in] obj The object handle
+ * \param[in] instId The instance ID
+ * \param[in] dataIn The delta
+ * \param[in] length Length of the delta
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjUnpackDelta(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *dataIn, uint32_t length)
+{
+    const UAVObjFieldInfo *fieldInfo = UAVObjGetFieldInfo(obj_handle);
+
+    if (!fieldInfo) {
+        return -1;
+    }
+
+    uint32_t bitmapLength = deltaBitmapLength(fieldInfo);
+    if (length < bitmapLength) {
+        return -1;
+    }
+
+    // Check the bitmap matches the length before touching the instance
+    uint32_t expected = bitmapLength;
+    uint32_t bit = 0;
+    for (const UAVObjFieldInfo *field = fieldInfo; field->numElements; ++field) {
+        for (uint16_t n = 0; n < field->numElements; ++n, ++bit) {
+            if (dataIn[bit / 8] & (1 << (bit % 8))) {
+                expected += field->elementSize;
+            }
         }
-        // Pack data
-        memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
     }
+    if (expected != length) {
+        return -1;
+    }
+
+    // Lock
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+
+    int32_t rc = -1;
+    struct UAVOData *obj = (struct UAVOData *)obj_handle;
+
+    // A delta needs the data it is relative to, do not create the instance
+    InstanceHandle instEntry = getInstance(obj, instId);
+    if (instEntry == NULL) {
+        goto unlock_exit;
+    }
+
+    uint8_t *data    = (uint8_t *)InstanceData(instEntry);
+    const uint8_t *element = &dataIn[bitmapLength];
+    uint32_t offset  = 0;
+    bit = 0;
+
+    SeqWriteBegin(obj);
+    for (const UAVObjFieldInfo *field = fieldInfo; field->numElements; ++field) {
+        for (uint16_t n = 0; n < field->numElements; ++n, ++bit, offset += field->elementSize) {
+            if (dataIn[bit / 8] & (1 << (bit % 8))) {
+                memcpy(&data[offset], element, field->elementSize);
+                element += field->elementSize;
+            }
+        }
+    }
+    SeqWriteEnd(obj);
 
+    // Fire event
+    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
     rc = 0;
 
 unlock_exit:
@@ -722,9 +973,7 @@ return rc;
  */
 int32_t UAVObjLoadSettings()
 {
-    // Get lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
+    // No lock, UAVObjLoad() reads the flash outside of it
     int32_t rc = -1;
 
     // Load all settings objects
@@ -734,15 +983,14 @@ int32_t UAVObjLoadSettings()
         // Load object
         if (UAVObjLoad((UAVObjHandle)obj, 0) ==
             -1) {
-            goto unlock_exit;
+            goto exit;
         }
     }
 }
 
 rc = 0;
 
-unlock_exit:
-xSemaphoreGiveRecursive(mutex);
+exit:
 return rc;
 }
 
@@ -809,9 +1057,7 @@ return rc;
  */
 int32_t UAVObjLoadMetaobjects()
 {
-    // Get lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
+    // No lock, UAVObjLoad() reads the flash outside of it
     int32_t rc = -1;
 
     // Load all settings objects
@@ -819,14 +1065,13 @@ int32_t UAVObjLoadMetaobjects()
     // Load object
     if (UAVObjLoad((UAVObjHandle)MetaObjectPtr(obj), 0) ==
         -1) {
-        goto unlock_exit;
+        goto exit;
     }
 }
 
 rc = 0;
 
-unlock_exit:
-xSemaphoreGiveRecursive(mutex);
+exit:
 return rc;
 }
 
@@ -922,7 +1167,9 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
         if (instId != 0) {
             goto unlock_exit;
         }
+        SeqWriteBegin(SeqOwner((struct UAVOBase *)obj_handle));
         memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
+        SeqWriteEnd(SeqOwner((struct UAVOBase *)obj_handle));
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -940,7 +1187,9 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
             goto unlock_exit;
         }
         // Set data
+        SeqWriteBegin(obj);
         memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+        SeqWriteEnd(obj);
     }
 
     // Fire event
@@ -980,7 +1229,9 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
         }
 
         // Set data
-        memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, dataIn, size);
+        SeqWriteBegin(SeqOwner((struct UAVOBase *)obj_handle));
+        memcpy((uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, dataIn, size);
+        SeqWriteEnd(SeqOwner((struct UAVOBase *)obj_handle));
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -1005,7 +1256,9 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
         }
 
         // Set data
+        SeqWriteBegin(obj);
         memcpy(InstanceData(instEntry) + offset, dataIn, size);
+        SeqWriteEnd(obj);
     }
 
 
@@ -1020,6 +1273,7 @@ unlock_exit:
 
 /**
  * Get the data of a specific object instance
+ * The data is read without taking the object manager lock, see readInstanceData().
  * \param[in] obj The object handle
  * \param[in] instId The object instance ID
  * \param[out] dataOut The object's data structure
@@ -1030,39 +1284,7 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
-
-    if (IsMetaobject(obj_handle)) {
-        // Get instance information
-        if (instId != 0) {
-            goto unlock_exit;
-        }
-        // Set data
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
-    } else {
-        struct UAVOData *obj;
-        InstanceHandle instEntry;
-
-        // Cast to object info
-        obj = (struct UAVOData *)obj_handle;
-
-        // Get instance information
-        instEntry = getInstance(obj, instId);
-        if (instEntry == NULL) {
-            goto unlock_exit;
-        }
-        // Set data
-        memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
-    }
-
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return readInstanceData(obj_handle, instId, dataOut, 0, UAVObjGetNumBytes(obj_handle));
 }
 
 /**
@@ -1076,51 +1298,44 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
-
-    if (IsMetaobject(obj_handle)) {
-        // Get instance information
-        if (instId != 0) {
-            goto unlock_exit;
-        }
-
-        // Check for overrun
-        if ((size + offset) > MetaNumBytes) {
-            goto unlock_exit;
-        }
-
-        // Set data
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
-    } else {
-        struct UAVOData *obj;
-        InstanceHandle instEntry;
-
-        // Cast to object info
-        obj = (struct UAVOData *)obj_handle;
+    return readInstanceData(obj_handle, instId, dataOut, offset, size);
+}
 
-        // Get instance information
-        instEntry = getInstance(obj, instId);
-        if (instEntry == NULL) {
-            goto unlock_exit;
-        }
+/**
+ * Borrow read-only access to the data of an object instance, without copying it.
+ * The object manager lock is held until UAVObjReleaseInstanceData() is called,
+ * so the borrow must be short and must not block. Other readers are not affected.
+ * \param[in] obj The object handle
+ * \param[in] instId The object instance ID
+ * \return Pointer to the instance data or NULL if the instance does not exist
+ */
+const void *UAVObjBorrowInstanceData(UAVObjHandle obj_handle, uint16_t instId)
+{
+    PIOS_Assert(obj_handle);
 
-        // Check for overrun
-        if ((size + offset) > obj->instance_size) {
-            goto unlock_exit;
-        }
+    // Lock
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
-        // Set data
-        memcpy(dataOut, InstanceData(instEntry) + offset, size);
+    InstanceHandle instEntry = getInstance((struct UAVOData *)obj_handle, instId);
+    if (instEntry == NULL) {
+        xSemaphoreGiveRecursive(mutex);
+        return NULL;
     }
 
-    rc = 0;
+    return InstanceData(instEntry);
+}
 
-unlock_exit:
+/**
+ * End a read-only borrow started with UAVObjBorrowInstanceData()
+ * \param[in] obj The object handle
+ * \param[in] instId The object instance ID
+ */
+void UAVObjReleaseInstanceData(UAVObjHandle obj_handle, __attribute__((unused)) uint16_t instId)
+{
+    PIOS_Assert(obj_handle);
+
+    // Unlock
     xSemaphoreGiveRecursive(mutex);
-    return rc;
 }
 
 /**
@@ -1156,9 +1371,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
     // Get metadata
     if (IsMetaobject(obj_handle)) {
         memcpy(dataOut, &defMetadata, sizeof(UAVObjMetadata));
@@ -1167,8 +1379,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
                       dataOut);
     }
 
-    // Unlock
-    xSemaphoreGiveRecursive(mutex);
     return 0;
 }
 
@@ -1330,6 +1540,28 @@ void UAVObjSetLoggingUpdateMode(UAVObjMetadata *metadata, UAVObjUpdateMode val)
     SET_BITS(metadata->flags, UAVOBJ_LOGGING_UPDATE_MODE_SHIFT, val, UAVOBJ_UPDATE_MODE_MASK);
 }
 
+/**
+ * Get the UAVObject metadata telemetry priority class
+ * \param[in] metadata The metadata object
+ * \return the telemetry priority class
+ */
+UAVObjTelemetryClass UAVObjGetTelemetryClass(const UAVObjMetadata *metadata)
+{
+    PIOS_Assert(metadata);
+    return (metadata->flags >> UAVOBJ_TELEMETRY_CLASS_SHIFT) & UAVOBJ_TELEMETRY_CLASS_MASK;
+}
+
+/**
+ * Set the UAVObject metadata telemetry priority class
+ * \param[in] metadata The metadata object
+ * \param[in] val The telemetry priority class
+ */
+void UAVObjSetTelemetryClass(UAVObjMetadata *metadata, UAVObjTelemetryClass val)
+{
+    PIOS_Assert(metadata);
+    SET_BITS(metadata->flags, UAVOBJ_TELEMETRY_CLASS_SHIFT, val, UAVOBJ_TELEMETRY_CLASS_MASK);
+}
+
 
 /**
  * Check if an object is read only
@@ -1385,6 +1617,107 @@ int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, xQueueHandle queue)
     return res;
 }
 
+/**
+ * Turn an event queue into a batch listener. Events of all objects connected to the
+ * queue (with UAVObjConnectQueue) are then buffered in a ring of the given length, and
+ * a single EV_BATCH_READY message is posted to the queue whenever the ring stops being
+ * empty. On that message the consumer calls UAVObjBatchReceive() until it returns false.
+ * Other messages sent to the queue directly (e.g. periodic events) are not affected.
+ * \param[in] queue The event queue
+ * \param[in] length Number of events the batch can hold
+ * \return The batch handle or NULL if the allocation failed
+ */
+UAVObjBatchHandle UAVObjBatchCreate(xQueueHandle queue, uint16_t length)
+{
+    PIOS_Assert(queue);
+    PIOS_Assert(length > 0 && length < 0xFFFF);
+    struct UAVOListener *listener;
+
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    listener = getListener(queue, true);
+    if (listener && listener->ring == NULL) {
+        // One slot is kept free to tell a full ring from an empty one
+        listener->ring = (UAVObjEvent *)pios_malloc((length + 1) * sizeof(UAVObjEvent));
+        if (listener->ring == NULL) {
+            listener = NULL;
+        } else {
+            listener->ringSize = length + 1;
+            listener->head     = 0;
+            listener->tail     = 0;
+            listener->wakeupPending = false;
+        }
+    }
+    xSemaphoreGiveRecursive(mutex);
+    return (UAVObjBatchHandle)listener;
+}
+
+/**
+ * Take the oldest pending event out of a batch listener. Must only be called from
+ * the single task consuming the batch queue.
+ * \param[in] batch The batch handle
+ * \param[out] ev The event
+ * \return true if an event was returned, false if the batch is empty
+ */
+bool UAVObjBatchReceive(UAVObjBatchHandle batch, UAVObjEvent *ev)
+{
+    struct UAVOListener *listener = (struct UAVOListener *)batch;
+
+    PIOS_Assert(listener && listener->ring);
+    uint16_t head;
+    do {
+        head = listener->head;
+        if (head == listener->tail) {
+            // Drained, the next event will post a new wake up message. Check again
+            // after clearing the flag, an event may have slipped in meanwhile
+            listener->wakeupPending = false;
+            UAVO_MEMORY_BARRIER();
+            head = listener->head;
+            if (head == listener->tail) {
+                return false;
+            }
+        }
+        UAVO_MEMORY_BARRIER();
+        *ev = listener->ring[head];
+        UAVO_MEMORY_BARRIER();
+        // A producer dropping the oldest event moves the head as well, the copy is
+        // only valid if the slot was still at the head after reading it
+    } while (!__sync_bool_compare_and_swap(&listener->head, head, (head + 1 == listener->ringSize) ? 0 : head + 1));
+    return true;
+}
+
+/**
+ * Choose what a full batch listener does with new events, see UAVObjDropPolicy.
+ * The default is to drop the new event.
+ * \param[in] batch The batch handle
+ * \param[in] policy The drop policy
+ */
+void UAVObjBatchSetDropPolicy(UAVObjBatchHandle batch, UAVObjDropPolicy policy)
+{
+    struct UAVOListener *listener = (struct UAVOListener *)batch;
+
+    PIOS_Assert(listener && listener->ring);
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    listener->dropPolicy = policy;
+    xSemaphoreGiveRecursive(mutex);
+}
+
+/**
+ * Coalesce the events of a batch listener: an event is not added while one of the
+ * same type and object instance is still pending, it is counted as superseded
+ * instead. Only for consumers which read the object data when they process the event.
+ * \param[in] batch The batch handle
+ * \param[in] coalesce True to coalesce the events
+ */
+void UAVObjBatchSetCoalescing(UAVObjBatchHandle batch, bool coalesce)
+{
+    struct UAVOListener *listener = (struct UAVOListener *)batch;
+
+    PIOS_Assert(listener && listener->ring);
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    listener->coalesce = coalesce;
+    xSemaphoreGiveRecursive(mutex);
+}
+
 /**
  * Connect an event callback to the object, if the callback is already connected then the event mask is only updated.
  * The supplied callback will be invoked on all events matching the event mask.
@@ -1523,6 +1856,20 @@ void UAVObjIterate(void (*iterator)(UAVObjHandle obj))
 xSemaphoreGiveRecursive(mutex);
 }
 
+/**
+ * Take and release the object manager lock, for the private users of the
+ * object data outside this file. The lock is recursive.
+ */
+void lockManager()
+{
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+}
+
+void unlockManager()
+{
+    xSemaphoreGiveRecursive(mutex);
+}
+
 /**
  * Send a triggered event to all event queues registered on the object.
  */
@@ -1542,9 +1889,8 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
     LL_FOREACH(obj->next_event, event) {
         if (event->eventMask == 0 || (event->eventMask & triggered_event) != 0) {
             // Send to queue if a valid queue is registered
-            if (event->queue) {
-                // will not block
-                if (xQueueSend(event->queue, &msg, 0) != pdTRUE) {
+            if (event->listener) {
+                if (deliverEvent(event->listener, &msg) != 0) {
                     ++stats.eventQueueErrors;
                     stats.lastQueueErrorID = UAVObjGetID(obj);
                 }
@@ -1566,6 +1912,201 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
     return 0;
 }
 
+/**
+ * Hand an event over to a queue listener, either straight to its queue or through its batch.
+ * Will not block.
+ * \return 0 if success or -1 if the listener was full
+ */
+static int32_t deliverEvent(struct UAVOListener *listener, const UAVObjEvent *msg)
+{
+    if (listener->ring == NULL) {
+        if (xQueueSend(listener->queue, msg, 0) != pdTRUE) {
+            ++listener->stats.overflows;
+            listener->stats.lastOverflowID = UAVObjGetID(msg->obj);
+            return -1;
+        }
+        ++listener->stats.events;
+        return 0;
+    }
+
+    // Producers are serialized by the mutex, not all callers of sendEvent hold it
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    int32_t rc    = 0;
+    uint16_t head = listener->head;
+    uint16_t tail = listener->tail;
+    uint16_t next = (tail + 1 == listener->ringSize) ? 0 : tail + 1;
+    bool superseded = listener->coalesce && isPending(listener, msg, tail);
+    if (!superseded && next == head && listener->dropPolicy == UAVOBJ_DROP_OLDEST) {
+        // Take the oldest event out, unless the consumer got to it first which makes room as well
+        UAVObjHandle dropped = listener->ring[head].obj;
+        if (__sync_bool_compare_and_swap(&listener->head, head, (head + 1 == listener->ringSize) ? 0 : head + 1)) {
+            ++listener->stats.overflows;
+            listener->stats.lastOverflowID = UAVObjGetID(dropped);
+        }
+        head = listener->head;
+    }
+    if (superseded) {
+        // The pending event will carry the latest data as well
+        ++listener->stats.superseded;
+    } else if (next == head) {
+        ++listener->stats.overflows;
+        listener->stats.lastOverflowID = UAVObjGetID(msg->obj);
+        rc = -1;
+    } else {
+        listener->ring[tail] = *msg;
+        UAVO_MEMORY_BARRIER();
+        listener->tail = next;
+        UAVO_MEMORY_BARRIER();
+        ++listener->stats.events;
+        uint16_t pending = (next >= head) ? next - head : next + listener->ringSize - head;
+        if (pending > listener->stats.highWater) {
+            listener->stats.highWater = pending;
+        }
+    }
+
+    // Wake up the consumer, unless it was woken up already and did not drain the batch yet
+    if (!listener->wakeupPending) {
+        UAVObjEvent wakeup = {
+            .obj    = NULL,
+            .event  = EV_BATCH_READY,
+            .instId = 0,
+            .lowPriority = true,
+        };
+        listener->wakeupPending = true;
+        if (xQueueSend(listener->queue, &wakeup, 0) == pdTRUE) {
+            ++listener->stats.wakeups;
+        } else {
+            // Queue is full, retry with the next event
+            listener->wakeupPending = false;
+        }
+    }
+    xSemaphoreGiveRecursive(mutex);
+    return rc;
+}
+
+/**
+ * Copy (part of) the data of an object instance, without any locking.
+ * \return 0 if success or -1 if the instance does not exist or the range is invalid
+ */
+static int32_t copyInstanceData(UAVObjHandle obj_handle, uint16_t instId, void *dataOut, uint32_t offset, uint32_t size)
+{
+    if (IsMetaobject(obj_handle)) {
+        if (instId != 0 || (size + offset) > MetaNumBytes) {
+            return -1;
+        }
+        memcpy(dataOut, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
+    } else {
+        struct UAVOData *obj = (struct UAVOData *)obj_handle;
+        InstanceHandle instEntry = getInstance(obj, instId);
+
+        if (instEntry == NULL || (size + offset) > obj->instance_size) {
+            return -1;
+        }
+        memcpy(dataOut, InstanceData(instEntry) + offset, size);
+    }
+
+    return 0;
+}
+
+/**
+ * Read (part of) the data of an object instance.
+ * The copy is done without the object manager lock and retried if a writer
+ * modified the object meanwhile. If a write is in progress (the writer was
+ * preempted or runs concurrently) the reader falls back to the lock, which
+ * lets the writer finish first.
+ */
+static int32_t readInstanceData(UAVObjHandle obj_handle, uint16_t instId, void *dataOut, uint32_t offset, uint32_t size)
+{
+    struct UAVOData *owner = SeqOwner((struct UAVOBase *)obj_handle);
+    int32_t rc;
+
+    for (uint8_t retry = 0; retry < UAVO_SEQLOCK_RETRIES; ++retry) {
+        uint32_t seq = owner->seq;
+        if (seq & 1) {
+            break;
+        }
+        UAVO_MEMORY_BARRIER();
+        rc = copyInstanceData(obj_handle, instId, dataOut, offset, size);
+        UAVO_MEMORY_BARRIER();
+        if (owner->seq == seq) {
+            return rc;
+        }
+    }
+
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    rc = copyInstanceData(obj_handle, instId, dataOut, offset, size);
+    xSemaphoreGiveRecursive(mutex);
+
+    return rc;
+}
+
+/**
+ * Insert a newly registered object in the lookup index, keeping it sorted by ID.
+ * Must be called with the object manager lock held.
+ * \return 0 if success or -1 if the index is full
+ */
+static int32_t indexInsert(struct UAVOData *obj)
+{
+    uint16_t count = uavoIndexCount;
+    uint16_t pos   = count;
+
+    if (count >= uavoIndexSize) {
+        return -1;
+    }
+
+    // Find the insertion point
+    while (pos > 0 && uavoIndex[pos - 1]->id > obj->id) {
+        --pos;
+    }
+
+    // Tell lockless readers an update is in progress
+    ++indexSeq;
+    UAVO_MEMORY_BARRIER();
+
+    // Shift one pointer at a time so readers never see a torn entry
+    for (uint16_t n = count; n > pos; --n) {
+        uavoIndex[n] = uavoIndex[n - 1];
+    }
+    uavoIndex[pos] = obj;
+    uavoIndexCount = count + 1;
+
+    UAVO_MEMORY_BARRIER();
+    ++indexSeq;
+
+    return 0;
+}
+
+/**
+ * Binary search of the lookup index for an object or metaobject ID.
+ * The result is only valid if the index was not modified during the search.
+ */
+static UAVObjHandle indexLookup(uint32_t id)
+{
+    uint16_t lo = 0;
+    uint16_t hi = uavoIndexCount;
+
+    // Find the first entry with an ID not less than the requested one
+    while (lo < hi) {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (uavoIndex[mid]->id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo < uavoIndexCount && uavoIndex[lo]->id == id) {
+        return (UAVObjHandle)uavoIndex[lo];
+    }
+
+    // Metaobject IDs are the data object ID plus one
+    if (lo > 0 && MetaObjectId(uavoIndex[lo - 1]->id) == id) {
+        return (UAVObjHandle)MetaObjectPtr(uavoIndex[lo - 1]);
+    }
+
+    return NULL;
+}
+
 /**
  * Create a new object instance, return the instance info or NULL if failure.
  */
@@ -1596,16 +2137,23 @@ static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
         }
     }
 
-    /* Create the actual instance */
+    /* Create the actual instance, in the arena if it is reserved there */
+    struct UAVOMulti *uavo_multi = (struct UAVOMulti *)obj;
     uint32_t size = sizeof(struct UAVOMultiInst) + obj->instance_size;
-    instEntry = (struct UAVOMultiInst *)pios_malloc(size);
-    if (!instEntry) {
-        return NULL;
+    if (instId < uavo_multi->arena_instances) {
+        instEntry = ArenaInstance(uavo_multi, instId);
+    } else {
+        instEntry = (struct UAVOMultiInst *)pios_malloc(size);
+        if (!instEntry) {
+            return NULL;
+        }
     }
     memset(instEntry, 0, size);
-    LL_APPEND(((struct UAVOMulti *)obj)->instance0.next, instEntry);
+    SeqWriteBegin(obj);
+    LL_APPEND(uavo_multi->instance0.next, instEntry);
 
-    ((struct UAVOMulti *)obj)->num_instances++;
+    uavo_multi->num_instances++;
+    SeqWriteEnd(obj);
 
     // Fire event
     instanceAutoUpdated((UAVObjHandle)obj, instId);
@@ -1647,10 +2195,15 @@ InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId)
             return NULL;
         }
 
-        // Look for specified instance ID
-        uint16_t instance = 0;
+        // Instances in the arena are directly indexed
+        if (instId < uavo_multi->arena_instances) {
+            return &(ArenaInstance(uavo_multi, instId)->instance);
+        }
+
+        // Look for specified instance ID, starting at the end of the arena
+        uint16_t instance = uavo_multi->arena_instances - 1;
         struct UAVOMultiInst *instEntry;
-        LL_FOREACH(&(uavo_multi->instance0), instEntry) {
+        LL_FOREACH(ArenaInstance(uavo_multi, instance), instEntry) {
             if (instance++ == instId) {
                 /* Found it */
                 return &(instEntry->instance);
@@ -1674,11 +2227,19 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
 {
     struct ObjectEventEntry *event;
     struct UAVOBase *obj;
+    struct UAVOListener *listener = NULL;
+
+    if (queue) {
+        listener = getListener(queue, true);
+        if (listener == NULL) {
+            return -1;
+        }
+    }
 
     // Check that the queue is not already connected, if it is simply update event mask
     obj = (struct UAVOBase *)obj_handle;
     LL_FOREACH(obj->next_event, event) {
-        if (event->queue == queue && event->cb == cb) {
+        if (event->listener == listener && event->cb == cb) {
             // Already connected, update event mask and return
             event->eventMask = eventMask;
             event->fast = fast;
@@ -1691,7 +2252,7 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
     if (event == NULL) {
         return -1;
     }
-    event->queue     = queue;
+    event->listener  = listener;
     event->cb        = cb;
     event->eventMask = eventMask;
     event->fast      = fast;
@@ -1713,11 +2274,19 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
 {
     struct ObjectEventEntry *event;
     struct UAVOBase *obj;
+    struct UAVOListener *listener = NULL;
+
+    if (queue) {
+        listener = getListener(queue, false);
+        if (listener == NULL) {
+            return -1;
+        }
+    }
 
     // Find queue and remove it
     obj = (struct UAVOBase *)obj_handle;
     LL_FOREACH(obj->next_event, event) {
-        if ((event->queue == queue
+        if ((event->listener == listener
              && event->cb == cb)) {
             LL_DELETE(obj->next_event, event);
             vPortFree(event);
@@ -1728,3 +2297,33 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
     // If this point is reached the queue was not found
     return -1;
 }
+
+/**
+ * Find the listener attached to an event queue
+ * \param[in] queue The event queue
+ * \param[in] create Allocate a new listener if the queue has none yet
+ * \return The listener or NULL if not found (or out of memory)
+ */
+static struct UAVOListener *getListener(xQueueHandle queue, bool create)
+{
+    struct UAVOListener *listener;
+
+    LL_FOREACH(listeners, listener) {
+        if (listener->queue == queue) {
+            return listener;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    // Listeners are never freed, queues live as long as the firmware does
+    listener = (struct UAVOListener *)pios_malloc(sizeof(struct UAVOListener));
+    if (listener == NULL) {
+        return NULL;
+    }
+    memset(listener, 0, sizeof(struct UAVOListener));
+    listener->queue = queue;
+    LL_APPEND(listeners, listener);
+    return listener;
+}
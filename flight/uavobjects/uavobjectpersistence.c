@@ -27,9 +27,15 @@
 #include "openpilot.h"
 #include "pios_struct_helper.h"
 #include "inc/uavobjectprivate.h"
+#include "uavobjectsinit.h"
 
 extern uintptr_t pios_uavo_settings_fs_id;
 
+// UAVObjLoad() bounce buffer, guarded by loadLock. Callers must not hold the
+// object manager lock, except while registering the object.
+static uint8_t loadBuffer[UAVOBJECTS_LARGEST];
+static xSemaphoreHandle loadLock;
+
 /**
  * Save the data of the specified object to the file system (SD card).
  * If the object contains multiple instances, all of them will be saved.
@@ -70,6 +76,22 @@ int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId)
 }
 
 
+/**
+ * Data of an instance that UAVObjLoad() writes to, NULL if it does not exist.
+ * Called with the object manager lock held, or on an object that is not
+ * registered yet.
+ */
+static void *loadTarget(UAVObjHandle obj_handle, uint16_t instId)
+{
+    if (UAVObjIsMetaobject(obj_handle)) {
+        return (instId == 0) ? MetaDataPtr((struct UAVOMeta *)obj_handle) : NULL;
+    }
+
+    InstanceHandle instEntry = getInstance((struct UAVOData *)obj_handle, instId);
+
+    return instEntry ? InstanceData(instEntry) : NULL;
+}
+
 /**
  * Load an object from the file system (SD card).
  * A file with the name of the object will be opened.
@@ -82,34 +104,58 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
 
-    if (UAVObjIsMetaobject(obj_handle)) {
-        if (instId != 0) {
-            return -1;
-        }
+    struct UAVOData *owner = SeqOwner((struct UAVOBase *)obj_handle);
+    uint32_t num_bytes     = UAVObjGetNumBytes(obj_handle);
+    void *data;
+    int32_t rc = -1;
 
-        // Fire event on success
-        if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle), UAVObjGetNumBytes(obj_handle)) == 0) {
-            sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
-        } else {
+    // An object being registered is not visible to anyone else yet, load in place
+    if (UAVObjGetByID(owner->id) != (UAVObjHandle)owner) {
+        data = loadTarget(obj_handle, instId);
+        if (data == NULL || PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, data, num_bytes) != 0) {
             return -1;
         }
-    } else {
-        InstanceHandle instEntry = getInstance((struct UAVOData *)obj_handle, instId);
+        sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
+        return 0;
+    }
 
-        if (instEntry == NULL) {
+    if (num_bytes > sizeof(loadBuffer)) {
+        return -1;
+    }
+
+    if (loadLock == NULL) {
+        lockManager();
+        if (loadLock == NULL) {
+            loadLock = xSemaphoreCreateMutex();
+        }
+        unlockManager();
+        if (loadLock == NULL) {
             return -1;
         }
+    }
 
-        // Fire event on success
-        if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle)) == 0) {
+    // The flash read can wait behind a logfs erase or garbage collection, so
+    // it goes to the bounce buffer outside the object manager lock. Only the
+    // copy is done under the lock, writers must be serialized for the
+    // lockless readers.
+    xSemaphoreTake(loadLock, portMAX_DELAY);
+    if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, loadBuffer, num_bytes) == 0) {
+        lockManager();
+        data = loadTarget(obj_handle, instId);
+        if (data != NULL) {
+            SeqWriteBegin(owner);
+            memcpy(data, loadBuffer, num_bytes);
+            SeqWriteEnd(owner);
+
+            // Fire event on success
             sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
-        } else {
-            return -1;
+            rc = 0;
         }
+        unlockManager();
     }
+    xSemaphoreGive(loadLock);
 
-
-    return 0;
+    return rc;
 }
 
 /**
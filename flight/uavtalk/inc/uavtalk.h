@@ -32,11 +32,20 @@
 // Public types
 typedef int32_t (*UAVTalkOutputStream)(uint8_t *data, int32_t length);
 
+// One frame in pieces, see UAVTalkSetRelayStream()
+typedef struct {
+    const uint8_t *data;
+    uint16_t length;
+} UAVTalkFragment;
+typedef int32_t (*UAVTalkRelayStream)(const UAVTalkFragment *fragments, uint8_t count);
+
 typedef struct {
     uint32_t txBytes;
     uint32_t txObjectBytes;
     uint32_t txObjects;
     uint32_t txErrors;
+    uint32_t txRetries;
+    uint32_t txTransactionsFailed;
 
     uint32_t rxBytes;
     uint32_t rxObjectBytes;
@@ -48,6 +57,12 @@ typedef struct {
 
 typedef void *UAVTalkConnection;
 
+// Protocol features the GCS announces in GCSTelemetryFeatures
+#define UAVTALK_FEATURE_MULTI_OBJECT 0x01 // several objects per frame, see UAVTalkSendObjectAggregated()
+#define UAVTALK_FEATURE_DELTA        0x02 // changed elements of an object only, see UAVTalkSetDeltaEncoding()
+#define UAVTALK_FEATURE_TIMESTAMP    0x04 // timestamped objects, see UAVTalkSendObjectTimestamped()
+#define UAVTALK_FEATURES             (UAVTALK_FEATURE_MULTI_OBJECT | UAVTALK_FEATURE_DELTA | UAVTALK_FEATURE_TIMESTAMP)
+
 typedef enum { UAVTALK_STATE_ERROR = 0, UAVTALK_STATE_SYNC, UAVTALK_STATE_TYPE, UAVTALK_STATE_SIZE, UAVTALK_STATE_OBJID, UAVTALK_STATE_INSTID, UAVTALK_STATE_TIMESTAMP, UAVTALK_STATE_DATA, UAVTALK_STATE_CS, UAVTALK_STATE_COMPLETE } UAVTalkRxState;
 
 // Public functions
@@ -57,9 +72,18 @@ UAVTalkOutputStream UAVTalkGetOutputStream(UAVTalkConnection connection);
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectRequest(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs);
+int32_t UAVTalkSendObjectPipelined(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries);
+int32_t UAVTalkSendObjectRequestPipelined(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries);
+void UAVTalkProcessTransactions(UAVTalkConnection connection);
+void UAVTalkSetAggregation(UAVTalkConnection connection, bool enable);
+int32_t UAVTalkSendObjectAggregated(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId);
+int32_t UAVTalkFlushAggregated(UAVTalkConnection connection);
+void UAVTalkSetDeltaEncoding(UAVTalkConnection connection, bool enable);
+uint8_t UAVTalkGetPendingTransactions(UAVTalkConnection connection);
 UAVTalkRxState UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxbuffer, uint8_t length);
 UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
 int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnection outConnectionHandle);
+void UAVTalkSetRelayStream(UAVTalkConnection connection, UAVTalkRelayStream relayStream);
 int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle);
 void UAVTalkGetStats(UAVTalkConnection connection, UAVTalkStats *stats, bool reset);
 void UAVTalkAddStats(UAVTalkConnection connection, UAVTalkStats *stats, bool reset);
@@ -58,8 +58,66 @@ typedef struct {
     uint32_t rxCount;
     UAVTalkRxState state;
     uint16_t rxPacketLength;
+    uint8_t  *data; // payload of a complete packet, in rxBuffer or in the caller's receive buffer
+    uint8_t  *frame; // whole packet as received when it came in one buffer, otherwise NULL
 } UAVTalkInputProcessor;
 
+// multi-object record : object ID(4), instance ID(2), length(1)
+#define UAVTALK_MULTI_RECORD_HEADER_LENGTH 7
+
+// Largest payload of a multi-object frame, the GCS accepts at most 255 bytes
+#ifndef UAVTALK_MULTI_MAX_PAYLOAD
+#define UAVTALK_MULTI_MAX_PAYLOAD 255
+#endif
+#if UAVTALK_MULTI_MAX_PAYLOAD < UAVOBJECTS_LARGEST
+#define UAVTALK_MULTI_PAYLOAD_LIMIT UAVTALK_MULTI_MAX_PAYLOAD
+#else
+#define UAVTALK_MULTI_PAYLOAD_LIMIT UAVOBJECTS_LARGEST
+#endif
+
+// Number of acked transactions that may be outstanding at once, see UAVTalkSendObjectPipelined()
+#ifndef UAVTALK_WINDOW_SIZE
+#define UAVTALK_WINDOW_SIZE 4
+#endif
+
+typedef struct {
+    UAVObjHandle obj;
+    uint32_t     objId;
+    uint16_t     instId;
+    uint8_t      type;
+    uint8_t      respType;
+    uint8_t      retries;
+    uint8_t      dirtyRetries;
+    bool         active;
+    bool         dirty; // sent again while in flight
+    portTickType timeout;
+    portTickType deadline;
+} UAVTalkTransaction;
+
+// Number of object instances a connection keeps a delta reference for, see UAVTalkSetDeltaEncoding()
+#ifndef UAVTALK_DELTA_SLOTS
+#define UAVTALK_DELTA_SLOTS 8
+#endif
+
+// A full object (keyframe) goes out after this many deltas or this much time
+#ifndef UAVTALK_DELTA_KEYFRAME_INTERVAL
+#define UAVTALK_DELTA_KEYFRAME_INTERVAL 16
+#endif
+#ifndef UAVTALK_DELTA_KEYFRAME_MS
+#define UAVTALK_DELTA_KEYFRAME_MS 2000
+#endif
+
+typedef struct {
+    UAVObjHandle obj;
+    uint16_t     instId;
+    uint16_t     size; // of reference, an evicted slot is reused for objects that fit
+    uint8_t      deltas; // sent since the last keyframe
+    bool         pending; // keyframe waiting in the multi-object frame
+    portTickType keyframeTime;
+    portTickType lastSent; // the least recently sent slot is evicted first
+    uint8_t      reference[]; // object data as the receiver has it
+} UAVTalkDeltaSlot;
+
 typedef struct {
     uint8_t canari;
     UAVTalkOutputStream outStream;
@@ -69,6 +127,21 @@ typedef struct {
     uint8_t      respType;
     uint32_t     respObjId;
     uint16_t     respInstId;
+    xSemaphoreHandle    windowSema;
+    UAVTalkTransaction  window[UAVTALK_WINDOW_SIZE];
+    uint8_t      windowUsed;
+    bool         multiEnabled;
+    uint16_t     multiLength; // records waiting in txBuffer, behind the frame header
+    uint16_t     multiCount;
+    bool         deltaEnabled;
+    UAVTalkDeltaSlot    *delta[UAVTALK_DELTA_SLOTS];
+    UAVTalkRelayStream  relayStream;
+    // Frames passed through to relayStream, only written by the relaying task
+    uint32_t     relayBytes;
+    uint32_t     relayErrors;
+    // Part of the above already reported in stats
+    uint32_t     relayBytesReported;
+    uint32_t     relayErrorsReported;
     UAVTalkStats stats;
     UAVTalkInputProcessor iproc;
     uint8_t      *rxBuffer;
@@ -86,9 +159,14 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK    (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK        (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK       (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_MULTI      (UAVTALK_TYPE_VER | 0x05) // instance ID carries the number of records
+#define UAVTALK_TYPE_DELTA      (UAVTALK_TYPE_VER | 0x06) // payload is an UAVObjPackDelta() delta
 #define UAVTALK_TYPE_OBJ_TS     (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
 #define UAVTALK_TYPE_OBJ_ACK_TS (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ_ACK)
 
+// Object ID in the header of a multi-object frame, no object has it
+#define UAVTALK_MULTI_OBJID     0
+
 // macros
 #define CHECKCONHANDLE(handle, variable, failcommand) \
     variable = (UAVTalkConnectionData *)handle; \
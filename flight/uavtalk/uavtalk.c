@@ -53,7 +53,23 @@ static int32_t sendObject(UAVTalkConnectionData *connection, uint8_t type, uint3
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, UAVObjHandle obj);
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data);
 static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId);
+static int32_t startTransaction(UAVTalkConnectionData *connection, uint8_t type, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries);
+static UAVTalkTransaction *findTransaction(UAVTalkConnectionData *connection, uint8_t respType, uint32_t objId, uint16_t instId);
+static void endTransaction(UAVTalkConnectionData *connection, UAVTalkTransaction *trans);
+static void restartTransaction(UAVTalkConnectionData *connection, UAVTalkTransaction *trans);
+static void processTransactions(UAVTalkConnectionData *connection);
+static int32_t appendMultiRecord(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj);
+static int32_t flushMulti(UAVTalkConnectionData *connection);
+static int32_t receiveMultiObject(UAVTalkConnectionData *connection, uint16_t count, uint8_t *data, uint32_t length);
+static int32_t sendDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj);
+static UAVTalkDeltaSlot *findDeltaSlot(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, bool create);
+static void deltaKeyframe(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, const uint8_t *data);
+static void deltaKeyframeMulti(UAVTalkConnectionData *connection, const uint8_t *records, uint16_t count);
+static int32_t receiveDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, uint8_t *data, uint32_t length);
+static void relayStats(UAVTalkConnectionData *connection, UAVTalkStats *stats, bool reset);
+static int32_t relayFrame(UAVTalkInputProcessor *iproc, UAVTalkConnectionData *outConnection);
 // UavTalk Process FSM functions
+static bool UAVTalkProcess_FRAME(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
 static bool UAVTalkProcess_SYNC(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
 static bool UAVTalkProcess_TYPE(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
 static bool UAVTalkProcess_OBJID(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
@@ -88,12 +104,28 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
     if (!connection->rxBuffer) {
         return 0;
     }
+    connection->iproc.data = connection->rxBuffer;
     connection->txBuffer = pios_malloc(UAVTALK_MAX_PACKET_LENGTH);
     if (!connection->txBuffer) {
         return 0;
     }
     vSemaphoreCreateBinary(connection->respSema);
     xSemaphoreTake(connection->respSema, 0); // reset to zero
+    vSemaphoreCreateBinary(connection->windowSema);
+    xSemaphoreTake(connection->windowSema, 0); // reset to zero
+    memset(connection->window, 0, sizeof(connection->window));
+    connection->windowUsed = 0;
+    connection->multiEnabled = false;
+    connection->multiLength  = 0;
+    connection->multiCount   = 0;
+    connection->deltaEnabled = false;
+    memset(connection->delta, 0, sizeof(connection->delta));
+    connection->relayStream  = NULL;
+    connection->relayBytes   = 0;
+    connection->relayErrors  = 0;
+    connection->relayBytesReported  = 0;
+    connection->relayErrorsReported = 0;
+    connection->iproc.frame  = NULL;
     UAVTalkResetStats((UAVTalkConnection)connection);
     return (UAVTalkConnection)connection;
 }
@@ -152,6 +184,7 @@ void UAVTalkGetStats(UAVTalkConnection connectionHandle, UAVTalkStats *statsOut,
 
     // Copy stats
     memcpy(statsOut, &connection->stats, sizeof(UAVTalkStats));
+    relayStats(connection, statsOut, reset);
 
     if (reset) {
         // Clear stats
@@ -181,12 +214,15 @@ void UAVTalkAddStats(UAVTalkConnection connectionHandle, UAVTalkStats *statsOut,
     statsOut->txObjectBytes += connection->stats.txObjectBytes;
     statsOut->txObjects     += connection->stats.txObjects;
     statsOut->txErrors      += connection->stats.txErrors;
+    statsOut->txRetries     += connection->stats.txRetries;
+    statsOut->txTransactionsFailed += connection->stats.txTransactionsFailed;
     statsOut->rxBytes       += connection->stats.rxBytes;
     statsOut->rxObjectBytes += connection->stats.rxObjectBytes;
     statsOut->rxObjects     += connection->stats.rxObjects;
     statsOut->rxErrors      += connection->stats.rxErrors;
     statsOut->rxSyncErrors  += connection->stats.rxSyncErrors;
     statsOut->rxCrcErrors   += connection->stats.rxCrcErrors;
+    relayStats(connection, statsOut, reset);
 
     if (reset) {
         // Clear stats
@@ -212,11 +248,34 @@ void UAVTalkResetStats(UAVTalkConnection connectionHandle)
 
     // Clear stats
     memset(&connection->stats, 0, sizeof(UAVTalkStats));
+    relayStats(connection, NULL, true);
 
     // Release lock
     xSemaphoreGiveRecursive(connection->lock);
 }
 
+/**
+ * Add the frames passed through since the last reset to the stats. They are
+ * counted apart because UAVTalkRelayPacket() does not take the lock then.
+ * \param[in] connection UAVTalkConnection the frames were relayed to
+ * \param[out] stats Statistics counters to add to, may be NULL
+ * \param[in] reset Start counting over
+ */
+static void relayStats(UAVTalkConnectionData *connection, UAVTalkStats *stats, bool reset)
+{
+    uint32_t bytes  = connection->relayBytes;
+    uint32_t errors = connection->relayErrors;
+
+    if (stats) {
+        stats->txBytes  += bytes - connection->relayBytesReported;
+        stats->txErrors += errors - connection->relayErrorsReported;
+    }
+    if (reset) {
+        connection->relayBytesReported  = bytes;
+        connection->relayErrorsReported = errors;
+    }
+}
+
 /**
  * Accessor method to get the timestamp from the last UAVTalk message
  */
@@ -297,6 +356,179 @@ int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjH
     }
 }
 
+/**
+ * Send the specified object with an ack, without waiting for the ack.
+ * Up to UAVTALK_WINDOW_SIZE transactions can be outstanding on a connection, they are
+ * matched with their ACK by object and instance ID. A new send of an instance that is
+ * still pending does not go out right away: an ACK carries no sequence number, so the
+ * ACK of the older copy would end the transaction of the newer one. The latest data is
+ * sent with a new set of retries once the pending copy is acked or timed out.
+ * Timeouts and retries are handled by UAVTalkProcessTransactions(), which must be called
+ * periodically. This call only blocks while the window is full.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \param[in] timeoutMs Time to wait for the ack before sending again
+ * \param[in] retries Number of times the object is sent again before the transaction fails
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectPipelined(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    return startTransaction(connection, UAVTALK_TYPE_OBJ_ACK, obj, instId, timeoutMs, retries);
+}
+
+/**
+ * Request an update for the specified object, without waiting for the response.
+ * See UAVTalkSendObjectPipelined().
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to update
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \param[in] timeoutMs Time to wait for the response before requesting again
+ * \param[in] retries Number of times the request is sent again before the transaction fails
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectRequestPipelined(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    return startTransaction(connection, UAVTALK_TYPE_OBJ_REQ, obj, instId, timeoutMs, retries);
+}
+
+/**
+ * Resend or fail the pipelined transactions whose response did not arrive in time.
+ * Failed transactions are counted in the txTransactionsFailed statistic.
+ * \param[in] connection UAVTalkConnection to be used
+ */
+void UAVTalkProcessTransactions(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return );
+
+    processTransactions(connection);
+}
+
+/**
+ * Get the number of pipelined transactions waiting for a response.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return The number of outstanding transactions
+ */
+uint8_t UAVTalkGetPendingTransactions(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return 0);
+
+    return connection->windowUsed;
+}
+
+/**
+ * Enable or disable multi-object frames on a connection. Only enable them when the other
+ * side announced UAVTALK_FEATURE_MULTI_OBJECT in GCSTelemetryFeatures.
+ * Records still waiting are sent out when disabling.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] enable Pack objects sent with UAVTalkSendObjectAggregated() into multi-object frames
+ */
+void UAVTalkSetAggregation(UAVTalkConnection connectionHandle, bool enable)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return );
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    if (!enable) {
+        flushMulti(connection);
+    }
+    connection->multiEnabled = enable;
+    xSemaphoreGiveRecursive(connection->lock);
+}
+
+/**
+ * Send the specified object without an ack. When aggregation is enabled the object is added
+ * to a multi-object frame, which goes out when it is full, before any other packet sent on
+ * the connection or on UAVTalkFlushAggregated(). When delta encoding is enabled only the
+ * changed elements are sent if that is shorter. Otherwise this is UAVTalkSendObject().
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectAggregated(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId)
+{
+    UAVTalkConnectionData *connection;
+    uint8_t type;
+    int32_t ret;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    if (connection->deltaEnabled) {
+        type = UAVTALK_TYPE_DELTA;
+    } else if (connection->multiEnabled) {
+        type = UAVTALK_TYPE_MULTI;
+    } else {
+        type = UAVTALK_TYPE_OBJ;
+    }
+    ret = sendObject(connection, type, UAVObjGetID(obj), instId, obj);
+    xSemaphoreGiveRecursive(connection->lock);
+    return ret;
+}
+
+/**
+ * Send the multi-object frame that is being filled by UAVTalkSendObjectAggregated().
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success or nothing to send
+ * \return -1 Failure
+ */
+int32_t UAVTalkFlushAggregated(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+    int32_t ret;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    ret = flushMulti(connection);
+    xSemaphoreGiveRecursive(connection->lock);
+    return ret;
+}
+
+/**
+ * Enable or disable delta encoding on a connection. Only enable it when the other side
+ * announced UAVTALK_FEATURE_DELTA in GCSTelemetryFeatures.
+ * Objects with a field layout sent with UAVTalkSendObjectAggregated() then only carry the
+ * elements that changed since they were last sent, with a full object every
+ * UAVTALK_DELTA_KEYFRAME_INTERVAL deltas or UAVTALK_DELTA_KEYFRAME_MS so that a lost
+ * frame does not leave the receiver out of date for long.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] enable Send deltas
+ */
+void UAVTalkSetDeltaEncoding(UAVTalkConnection connectionHandle, bool enable)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return );
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    if (enable && !connection->deltaEnabled) {
+        // The receiver may have missed anything sent meanwhile, start with keyframes
+        for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS && connection->delta[n]; ++n) {
+            connection->delta[n]->deltas = UAVTALK_DELTA_KEYFRAME_INTERVAL;
+        }
+    }
+    connection->deltaEnabled = enable;
+    xSemaphoreGiveRecursive(connection->lock);
+}
+
 /**
  * Execute the requested transaction on an object.
  * \param[in] connection UAVTalkConnection to be used
@@ -355,8 +587,162 @@ static int32_t objectTransaction(UAVTalkConnectionData *connection, uint8_t type
     return ret;
 }
 
+/**
+ * Start a pipelined transaction on an object.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] type Transaction type, UAVTALK_TYPE_OBJ_ACK or UAVTALK_TYPE_OBJ_REQ
+ * \param[in] obj Object
+ * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
+ * \param[in] timeoutMs Time to wait for the response before sending again
+ * \param[in] retries Number of retries before the transaction fails
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t startTransaction(UAVTalkConnectionData *connection, uint8_t type, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t retries)
+{
+    uint8_t respType = (type == UAVTALK_TYPE_OBJ_REQ) ? UAVTALK_TYPE_OBJ : UAVTALK_TYPE_ACK;
+    uint32_t objId   = UAVObjGetID(obj);
+    UAVTalkTransaction *trans;
+    bool fresh = false;
+    int32_t ret;
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    while ((trans = findTransaction(connection, respType, objId, instId)) == NULL) {
+        portTickType now = xTaskGetTickCount();
+        int32_t wait     = INT32_MAX;
+
+        // Take a free slot if there is one
+        for (uint8_t n = 0; n < UAVTALK_WINDOW_SIZE; ++n) {
+            if (!connection->window[n].active) {
+                trans = &connection->window[n];
+                trans->active = true;
+                ++connection->windowUsed;
+                fresh = true;
+                break;
+            }
+            if ((int32_t)(connection->window[n].deadline - now) < wait) {
+                wait = connection->window[n].deadline - now;
+            }
+        }
+        if (trans) {
+            break;
+        }
+
+        // Window is full, wait for a response or the next timeout
+        xSemaphoreGiveRecursive(connection->lock);
+        xSemaphoreTake(connection->windowSema, (wait > 0) ? wait : 1);
+        processTransactions(connection);
+        xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    }
+
+    if (!fresh) {
+        // Already in flight, a pending request is answered with the latest data anyway
+        if (type == UAVTALK_TYPE_OBJ_ACK) {
+            trans->dirty        = true;
+            trans->dirtyRetries = retries;
+        }
+        xSemaphoreGiveRecursive(connection->lock);
+        return 0;
+    }
+
+    trans->obj      = obj;
+    trans->objId    = objId;
+    trans->instId   = instId;
+    trans->type     = type;
+    trans->respType = respType;
+    trans->retries  = retries;
+    trans->dirty    = false;
+    trans->timeout  = timeoutMs / portTICK_RATE_MS;
+    trans->deadline = xTaskGetTickCount() + trans->timeout;
+
+    ret = sendObject(connection, type, objId, instId, obj);
+    if (ret != 0) {
+        endTransaction(connection, trans);
+    }
+
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Find the pipelined transaction waiting for the given response.
+ * \return The transaction or NULL when there is none
+ */
+static UAVTalkTransaction *findTransaction(UAVTalkConnectionData *connection, uint8_t respType, uint32_t objId, uint16_t instId)
+{
+    for (uint8_t n = 0; n < UAVTALK_WINDOW_SIZE; ++n) {
+        UAVTalkTransaction *trans = &connection->window[n];
+        if (trans->active && trans->objId == objId && trans->respType == respType && trans->instId == instId) {
+            return trans;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Free the slot of a pipelined transaction and wake up a sender waiting for one.
+ */
+static void endTransaction(UAVTalkConnectionData *connection, UAVTalkTransaction *trans)
+{
+    trans->active = false;
+    --connection->windowUsed;
+    xSemaphoreGive(connection->windowSema);
+}
+
+/**
+ * Send the latest data of a pipelined transaction that was sent again while in flight.
+ */
+static void restartTransaction(UAVTalkConnectionData *connection, UAVTalkTransaction *trans)
+{
+    trans->dirty    = false;
+    trans->retries  = trans->dirtyRetries;
+    trans->deadline = xTaskGetTickCount() + trans->timeout;
+    // A failed send is retried at the next deadline
+    sendObject(connection, trans->type, trans->objId, trans->instId, trans->obj);
+}
+
+/**
+ * Resend the pipelined transactions that timed out, fail those out of retries.
+ */
+static void processTransactions(UAVTalkConnectionData *connection)
+{
+    if (!connection->windowUsed) {
+        return;
+    }
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+    portTickType now = xTaskGetTickCount();
+    for (uint8_t n = 0; n < UAVTALK_WINDOW_SIZE; ++n) {
+        UAVTalkTransaction *trans = &connection->window[n];
+        if (!trans->active || (int32_t)(now - trans->deadline) < 0) {
+            continue;
+        }
+        if (trans->dirty) {
+            ++connection->stats.txRetries;
+            restartTransaction(connection, trans);
+        } else if (trans->retries > 0) {
+            --trans->retries;
+            ++connection->stats.txRetries;
+            trans->deadline = now + trans->timeout;
+            // A failed send is retried at the next deadline
+            sendObject(connection, trans->type, trans->objId, trans->instId, trans->obj);
+        } else {
+            ++connection->stats.txTransactionsFailed;
+            endTransaction(connection, trans);
+        }
+    }
+
+    xSemaphoreGiveRecursive(connection->lock);
+}
+
 /**
  * Process an byte from the telemetry stream.
+ * A packet that is entirely contained in rxbuffer is parsed in one go and its payload
+ * is left in rxbuffer, so the buffer must stay untouched until the packet has been
+ * received or relayed. Packets split across buffers go through the byte state machine.
  * \param[in] connectionHandle UAVTalkConnection to be used
  * \param[in] rxbuffer Received buffer
  * \param[in/out] Length in bytes of received buffer
@@ -381,6 +767,12 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
     while ((length > (*position))
            && iproc->state != UAVTALK_STATE_COMPLETE
            && iproc->state != UAVTALK_STATE_ERROR) {
+        // Fast path for a complete packet
+        if (iproc->state == UAVTALK_STATE_SYNC &&
+            UAVTalkProcess_FRAME(connection, iproc, rxbuffer, length, position)) {
+            break;
+        }
+
         // Receive state machine
         if ((length > (*position)) && iproc->state == UAVTALK_STATE_SYNC &&
             !UAVTalkProcess_SYNC(connection, iproc, rxbuffer, length, position)) {
@@ -450,10 +842,75 @@ UAVTalkRxState UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uin
     return state;
 }
 
+/**
+ * Pass frames relayed to a connection through unchanged, see UAVTalkRelayPacket().
+ * \param[in] connection UAVTalkConnection the frames are relayed to
+ * \param[in] relayStream Function that sends the fragments of one frame in one go, NULL to
+ *            relay through the output stream again
+ */
+void UAVTalkSetRelayStream(UAVTalkConnection connectionHandle, UAVTalkRelayStream relayStream)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return );
+    connection->relayStream = relayStream;
+}
+
+/**
+ * Pass a complete frame through to the relay stream of a connection, as it
+ * was received. A frame that came in one receive buffer goes out from there,
+ * otherwise the header is rebuilt in front of the payload in rxBuffer and
+ * the checksum. Nothing is copied and the connection is not locked, so the
+ * frame may overtake objects aggregated on it.
+ */
+static int32_t relayFrame(UAVTalkInputProcessor *iproc, UAVTalkConnectionData *outConnection)
+{
+    uint8_t header[UAVTALK_MAX_HEADER_LENGTH];
+    UAVTalkFragment fragments[3];
+    uint8_t count;
+    uint16_t length = iproc->packet_size + UAVTALK_CHECKSUM_LENGTH;
+
+    if (iproc->frame) {
+        fragments[0].data   = iproc->frame;
+        fragments[0].length = length;
+        count = 1;
+    } else {
+        header[0] = UAVTALK_SYNC_VAL;
+        header[1] = iproc->type;
+        header[2] = (uint8_t)(iproc->packet_size & 0xFF);
+        header[3] = (uint8_t)((iproc->packet_size >> 8) & 0xFF);
+        header[4] = (uint8_t)(iproc->objId & 0xFF);
+        header[5] = (uint8_t)((iproc->objId >> 8) & 0xFF);
+        header[6] = (uint8_t)((iproc->objId >> 16) & 0xFF);
+        header[7] = (uint8_t)((iproc->objId >> 24) & 0xFF);
+        header[8] = (uint8_t)(iproc->instId & 0xFF);
+        header[9] = (uint8_t)((iproc->instId >> 8) & 0xFF);
+        header[10] = (uint8_t)(iproc->timestamp & 0xFF);
+        header[11] = (uint8_t)((iproc->timestamp >> 8) & 0xFF);
+        fragments[0].data   = header;
+        fragments[0].length = UAVTALK_MIN_HEADER_LENGTH + iproc->timestampLength;
+        fragments[1].data   = iproc->data;
+        fragments[1].length = iproc->length;
+        fragments[2].data   = &iproc->cs;
+        fragments[2].length = UAVTALK_CHECKSUM_LENGTH;
+        count = 3;
+    }
+
+    int32_t rc = (*outConnection->relayStream)(fragments, count);
+
+    if (rc != length) {
+        outConnection->relayErrors++;
+        return -1;
+    }
+    outConnection->relayBytes += length;
+    return 0;
+}
+
 /**
  * Send a parsed packet received on one connection handle out on a different connection handle.
  * The packet must be in a complete state, meaning it is completed parsing.
- * The packet is re-assembled from the component parts into a complete message and sent.
+ * The packet is re-assembled from the component parts into a complete message and sent,
+ * or passed through unchanged if the out connection has a relay stream, see UAVTalkSetRelayStream().
  * This can be used to relay packets from one UAVTalk connection to another.
  * \param[in] connection UAVTalkConnection to be used
  * \param[in] rxbyte Received byte
@@ -477,6 +934,10 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
     UAVTalkConnectionData *outConnection;
     CHECKCONHANDLE(outConnectionHandle, outConnection, return -1);
 
+    if (outConnection->relayStream) {
+        return relayFrame(inIproc, outConnection);
+    }
+
     if (!outConnection->outStream) {
         outConnection->stats.txErrors++;
 
@@ -486,6 +947,9 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
     // Lock
     xSemaphoreTakeRecursive(outConnection->lock, portMAX_DELAY);
 
+    // Aggregated objects share txBuffer and were queued first
+    flushMulti(outConnection);
+
     outConnection->txBuffer[0] = UAVTALK_SYNC_VAL;
     // Setup type
     outConnection->txBuffer[1] = inIproc->type;
@@ -510,7 +974,7 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
 
     // Copy data (if any)
     if (inIproc->length > 0) {
-        memcpy(&outConnection->txBuffer[headerLength], inConnection->rxBuffer, inIproc->length);
+        memcpy(&outConnection->txBuffer[headerLength], inIproc->data, inIproc->length);
     }
 
     // Store the packet length
@@ -557,7 +1021,14 @@ int32_t UAVTalkReceiveObject(UAVTalkConnection connectionHandle)
         return -1;
     }
 
-    return receiveObject(connection, iproc->type, iproc->objId, iproc->instId, connection->rxBuffer);
+    if (iproc->type == UAVTALK_TYPE_MULTI) {
+        return receiveMultiObject(connection, iproc->instId, iproc->data, iproc->length);
+    }
+    if (iproc->type == UAVTALK_TYPE_DELTA) {
+        return receiveDelta(connection, iproc->objId, iproc->instId, iproc->data, iproc->length);
+    }
+
+    return receiveObject(connection, iproc->type, iproc->objId, iproc->instId, iproc->data);
 }
 
 /**
@@ -595,6 +1066,7 @@ uint32_t UAVTalkGetPacketObjId(UAVTalkConnection connectionHandle)
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data)
 {
     UAVObjHandle obj;
+    UAVTalkTransaction *trans;
     int32_t ret = 0;
 
     // Lock
@@ -668,7 +1140,16 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         break;
 
     case UAVTALK_TYPE_NACK:
-        // Do nothing on flight side, let it time out.
+        // A pipelined transaction fails right away, retrying will not help
+        trans = findTransaction(connection, UAVTALK_TYPE_ACK, objId, instId);
+        if (!trans) {
+            trans = findTransaction(connection, UAVTALK_TYPE_OBJ, objId, instId);
+        }
+        if (trans) {
+            ++connection->stats.txTransactionsFailed;
+            endTransaction(connection, trans);
+        }
+        // Do nothing else on flight side, let blocking transactions time out.
         // TODO:
         // The transaction takes the result code of the "semaphore taking operation" into account to determine success.
         // If we give that semaphore in time, its "success" (ack received)
@@ -717,6 +1198,20 @@ static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t
             connection->respObjId = 0;
         }
     }
+
+    // Complete a matching pipelined transaction, timestamped objects answer requests too
+    type &= ~UAVTALK_TIMESTAMPED;
+    UAVTalkTransaction *trans = findTransaction(connection, type, objId, instId);
+    if (!trans && instId == 0) {
+        // last instance of an all instances transaction
+        trans = findTransaction(connection, type, objId, UAVOBJ_ALL_INSTANCES);
+    }
+    if (trans && trans->dirty) {
+        // The acked copy is out of date
+        restartTransaction(connection, trans);
+    } else if (trans) {
+        endTransaction(connection, trans);
+    }
 }
 
 /**
@@ -743,7 +1238,8 @@ static int32_t sendObject(UAVTalkConnectionData *connection, uint8_t type, uint3
     }
 
     // Process message type
-    if (type == UAVTALK_TYPE_OBJ || type == UAVTALK_TYPE_OBJ_TS || type == UAVTALK_TYPE_OBJ_ACK || type == UAVTALK_TYPE_OBJ_ACK_TS) {
+    if (type == UAVTALK_TYPE_OBJ || type == UAVTALK_TYPE_OBJ_TS || type == UAVTALK_TYPE_OBJ_ACK || type == UAVTALK_TYPE_OBJ_ACK_TS || type == UAVTALK_TYPE_MULTI
+        || type == UAVTALK_TYPE_DELTA) {
         if (instId == UAVOBJ_ALL_INSTANCES) {
             // Get number of instances
             numInst = UAVObjGetNumInstances(obj);
@@ -789,6 +1285,16 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
         return -1;
     }
 
+    if (type == UAVTALK_TYPE_MULTI) {
+        return appendMultiRecord(connection, objId, instId, obj);
+    }
+    if (type == UAVTALK_TYPE_DELTA) {
+        return sendDelta(connection, objId, instId, obj);
+    }
+
+    // Aggregated objects share txBuffer and were queued first
+    flushMulti(connection);
+
     // Setup sync byte
     connection->txBuffer[0] = UAVTALK_SYNC_VAL;
     // Setup type
@@ -850,6 +1356,9 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
         ++connection->stats.txObjects;
         connection->stats.txObjectBytes += length;
         connection->stats.txBytes += tx_msg_len;
+        if (length > 0) {
+            deltaKeyframe(connection, obj, instId, &connection->txBuffer[headerLength]);
+        }
     } else {
         connection->stats.txErrors++;
         // TODO rc == -1 connection not open, -2 buffer full should retry
@@ -861,10 +1370,436 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
     return 0;
 }
 
+/**
+ * Add an object to the multi-object frame in txBuffer.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \param[in] obj Object handle to send
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t appendMultiRecord(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj)
+{
+    uint32_t length = UAVObjGetNumBytes(obj);
+
+    // Objects too large for a record go out on their own
+    if (length > 0xFF || UAVTALK_MULTI_RECORD_HEADER_LENGTH + length > UAVTALK_MULTI_PAYLOAD_LIMIT) {
+        return sendSingleObject(connection, UAVTALK_TYPE_OBJ, objId, instId, obj);
+    }
+
+    // Start a new frame when the record does not fit anymore
+    if (connection->multiLength + UAVTALK_MULTI_RECORD_HEADER_LENGTH + length > UAVTALK_MULTI_PAYLOAD_LIMIT) {
+        flushMulti(connection);
+    }
+
+    uint8_t *record = &connection->txBuffer[UAVTALK_MIN_HEADER_LENGTH + connection->multiLength];
+    record[0] = (uint8_t)(objId & 0xFF);
+    record[1] = (uint8_t)((objId >> 8) & 0xFF);
+    record[2] = (uint8_t)((objId >> 16) & 0xFF);
+    record[3] = (uint8_t)((objId >> 24) & 0xFF);
+    record[4] = (uint8_t)(instId & 0xFF);
+    record[5] = (uint8_t)((instId >> 8) & 0xFF);
+    record[6] = (uint8_t)length;
+
+    if (length > 0) {
+        if (UAVObjPack(obj, instId, &record[UAVTALK_MULTI_RECORD_HEADER_LENGTH]) == -1) {
+            connection->stats.txErrors++;
+            return -1;
+        }
+    }
+
+    // The record becomes the delta reference once the frame is sent, see flushMulti()
+    UAVTalkDeltaSlot *slot = findDeltaSlot(connection, obj, instId, false);
+    if (slot) {
+        slot->pending = true;
+    }
+
+    connection->multiLength += UAVTALK_MULTI_RECORD_HEADER_LENGTH + length;
+    connection->multiCount++;
+    return 0;
+}
+
+/**
+ * Send the multi-object frame in txBuffer, if any.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t flushMulti(UAVTalkConnectionData *connection)
+{
+    uint16_t recordsLength = connection->multiLength;
+    uint16_t count = connection->multiCount;
+
+    if (recordsLength == 0) {
+        return 0;
+    }
+    connection->multiLength = 0;
+    connection->multiCount  = 0;
+    for (uint8_t n = 0; n < UAVTALK_DELTA_SLOTS && connection->delta[n]; ++n) {
+        connection->delta[n]->pending = false;
+    }
+
+    if (!connection->outStream) {
+        connection->stats.txErrors++;
+        return -1;
+    }
+
+    uint16_t length = UAVTALK_MIN_HEADER_LENGTH + recordsLength;
+    connection->txBuffer[0] = UAVTALK_SYNC_VAL;
+    connection->txBuffer[1] = UAVTALK_TYPE_MULTI;
+    connection->txBuffer[2] = (uint8_t)(length & 0xFF);
+    connection->txBuffer[3] = (uint8_t)((length >> 8) & 0xFF);
+    connection->txBuffer[4] = (uint8_t)(UAVTALK_MULTI_OBJID & 0xFF);
+    connection->txBuffer[5] = (uint8_t)((UAVTALK_MULTI_OBJID >> 8) & 0xFF);
+    connection->txBuffer[6] = (uint8_t)((UAVTALK_MULTI_OBJID >> 16) & 0xFF);
+    connection->txBuffer[7] = (uint8_t)((UAVTALK_MULTI_OBJID >> 24) & 0xFF);
+    connection->txBuffer[8] = (uint8_t)(count & 0xFF);
+    connection->txBuffer[9] = (uint8_t)((count >> 8) & 0xFF);
+    connection->txBuffer[length] = PIOS_CRC_updateCRC(0, connection->txBuffer, length);
+
+    uint16_t tx_msg_len = length + UAVTALK_CHECKSUM_LENGTH;
+    int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
+
+    // Update stats, every record counts as an object
+    if (rc == tx_msg_len) {
+        connection->stats.txObjects     += count;
+        connection->stats.txObjectBytes += recordsLength - count * UAVTALK_MULTI_RECORD_HEADER_LENGTH;
+        connection->stats.txBytes += tx_msg_len;
+        deltaKeyframeMulti(connection, &connection->txBuffer[UAVTALK_MIN_HEADER_LENGTH], count);
+    } else {
+        connection->stats.txErrors++;
+        connection->stats.txBytes += (rc > 0) ? rc : 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Receive the records of a multi-object frame, each one as an UAVTALK_TYPE_OBJ message.
+ * Records of unknown objects are skipped.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] count Number of records
+ * \param[in] data Records
+ * \param[in] length Length of the records
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveMultiObject(UAVTalkConnectionData *connection, uint16_t count, uint8_t *data, uint32_t length)
+{
+    uint32_t position = 0;
+    int32_t ret = 0;
+
+    for (uint16_t n = 0; n < count; n++) {
+        if (position + UAVTALK_MULTI_RECORD_HEADER_LENGTH > length
+            || position + UAVTALK_MULTI_RECORD_HEADER_LENGTH + data[position + 6] > length) {
+            // records do not match the frame length
+            connection->stats.rxErrors++;
+            return -1;
+        }
+
+        uint8_t *record = &data[position];
+        uint32_t objId  = record[0] | (record[1] << 8) | (record[2] << 16) | ((uint32_t)record[3] << 24);
+        uint16_t instId = record[4] | (record[5] << 8);
+        uint8_t recordLength = record[6];
+        UAVObjHandle obj     = UAVObjGetByID(objId);
+
+        if (obj && UAVObjGetNumBytes(obj) == recordLength) {
+            if (receiveObject(connection, UAVTALK_TYPE_OBJ, objId, instId, &record[UAVTALK_MULTI_RECORD_HEADER_LENGTH]) == -1) {
+                ret = -1;
+            }
+        } else {
+            ret = -1;
+        }
+        position += UAVTALK_MULTI_RECORD_HEADER_LENGTH + recordLength;
+    }
+    return ret;
+}
+
+/**
+ * Send the elements of an object that changed since it was last sent, or the full
+ * object when a keyframe is due or the delta would not be shorter.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \param[in] obj Object handle to send
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj)
+{
+    uint8_t fullType  = connection->multiEnabled ? UAVTALK_TYPE_MULTI : UAVTALK_TYPE_OBJ;
+    uint32_t numBytes = UAVObjGetNumBytes(obj);
+
+    // A delta carries at most one bitmap bit per byte on top of the data, it must fit in txBuffer
+    if (!UAVObjGetFieldInfo(obj) || numBytes + (numBytes + 7) / 8 > UAVTALK_MAX_PAYLOAD_LENGTH) {
+        return sendSingleObject(connection, fullType, objId, instId, obj);
+    }
+
+    UAVTalkDeltaSlot *slot = findDeltaSlot(connection, obj, instId, true);
+    if (slot && slot->pending) {
+        // Its keyframe is still in the multi-object frame, send it to have the reference
+        flushMulti(connection);
+    }
+    if (!slot || slot->deltas >= UAVTALK_DELTA_KEYFRAME_INTERVAL
+        || xTaskGetTickCount() - slot->keyframeTime >= UAVTALK_DELTA_KEYFRAME_MS / portTICK_RATE_MS) {
+        // The full object refreshes the reference, see deltaKeyframe()
+        return sendSingleObject(connection, fullType, objId, instId, obj);
+    }
+
+    // Compare with what the full object would cost, as a multi-object record or on its own
+    int32_t length = UAVObjPackDelta(obj, instId, slot->reference, NULL);
+    uint32_t fullLength = numBytes + (connection->multiEnabled ? UAVTALK_MULTI_RECORD_HEADER_LENGTH : UAVTALK_MIN_HEADER_LENGTH);
+    if (length < 0 || UAVTALK_MIN_HEADER_LENGTH + (uint32_t)length >= fullLength) {
+        return sendSingleObject(connection, fullType, objId, instId, obj);
+    }
+
+    // Aggregated objects share txBuffer and were queued first
+    flushMulti(connection);
+
+    connection->txBuffer[0] = UAVTALK_SYNC_VAL;
+    connection->txBuffer[1] = UAVTALK_TYPE_DELTA;
+    connection->txBuffer[4] = (uint8_t)(objId & 0xFF);
+    connection->txBuffer[5] = (uint8_t)((objId >> 8) & 0xFF);
+    connection->txBuffer[6] = (uint8_t)((objId >> 16) & 0xFF);
+    connection->txBuffer[7] = (uint8_t)((objId >> 24) & 0xFF);
+    connection->txBuffer[8] = (uint8_t)(instId & 0xFF);
+    connection->txBuffer[9] = (uint8_t)((instId >> 8) & 0xFF);
+
+    // Pack again, the object may have changed since it was measured
+    length = UAVObjPackDelta(obj, instId, slot->reference, &connection->txBuffer[UAVTALK_MIN_HEADER_LENGTH]);
+    if (length < 0) {
+        connection->stats.txErrors++;
+        return -1;
+    }
+    slot->deltas++;
+
+    uint16_t packetLength = UAVTALK_MIN_HEADER_LENGTH + length;
+    connection->txBuffer[2] = (uint8_t)(packetLength & 0xFF);
+    connection->txBuffer[3] = (uint8_t)((packetLength >> 8) & 0xFF);
+    connection->txBuffer[packetLength] = PIOS_CRC_updateCRC(0, connection->txBuffer, packetLength);
+
+    uint16_t tx_msg_len = packetLength + UAVTALK_CHECKSUM_LENGTH;
+    int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
+
+    if (rc == tx_msg_len) {
+        ++connection->stats.txObjects;
+        connection->stats.txObjectBytes += length;
+        connection->stats.txBytes += tx_msg_len;
+    } else {
+        connection->stats.txErrors++;
+        connection->stats.txBytes += (rc > 0) ? rc : 0;
+        // The receiver is out of date now, send a keyframe next time
+        slot->deltas = UAVTALK_DELTA_KEYFRAME_INTERVAL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Find the delta reference of an object instance.
+ * When all slots are taken the least recently sent one that is large enough is
+ * evicted. Slots are never freed, the F1 heap cannot take them back.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle
+ * \param[in] instId The instance ID
+ * \param[in] create Take a slot if the instance has none and mark it as sent, its first send is a keyframe
+ * \return The slot or NULL when there is none
+ */
+static UAVTalkDeltaSlot *findDeltaSlot(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, bool create)
+{
+    portTickType now = xTaskGetTickCount();
+    UAVTalkDeltaSlot *slot;
+    UAVTalkDeltaSlot *oldest = NULL;
+    uint16_t size = UAVObjGetNumBytes(obj);
+    uint8_t n;
+
+    for (n = 0; n < UAVTALK_DELTA_SLOTS && connection->delta[n]; ++n) {
+        slot = connection->delta[n];
+        if (slot->obj == obj && slot->instId == instId) {
+            if (create) {
+                slot->lastSent = now;
+            }
+            return slot;
+        }
+        if (create && slot->size >= size && (!oldest || now - slot->lastSent > now - oldest->lastSent)) {
+            oldest = slot;
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+
+    if (n < UAVTALK_DELTA_SLOTS) {
+        slot = pios_malloc(sizeof(UAVTalkDeltaSlot) + size);
+        if (!slot) {
+            return NULL;
+        }
+        slot->size = size;
+        connection->delta[n] = slot;
+    } else if (oldest) {
+        slot = oldest;
+    } else {
+        return NULL;
+    }
+    slot->obj    = obj;
+    slot->instId = instId;
+    slot->deltas = UAVTALK_DELTA_KEYFRAME_INTERVAL;
+    slot->pending      = false;
+    slot->keyframeTime = 0;
+    slot->lastSent     = now;
+    return slot;
+}
+
+/**
+ * Record a full object sent on the connection as the reference of the next deltas.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle
+ * \param[in] instId The instance ID
+ * \param[in] data Packed object data that was sent
+ */
+static void deltaKeyframe(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, const uint8_t *data)
+{
+    UAVTalkDeltaSlot *slot = findDeltaSlot(connection, obj, instId, false);
+
+    if (slot) {
+        memcpy(slot->reference, data, UAVObjGetNumBytes(obj));
+        slot->deltas = 0;
+        slot->keyframeTime = xTaskGetTickCount();
+    }
+}
+
+/**
+ * Record the objects of a sent multi-object frame as the reference of the next deltas.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] records Records of the frame
+ * \param[in] count Number of records
+ */
+static void deltaKeyframeMulti(UAVTalkConnectionData *connection, const uint8_t *records, uint16_t count)
+{
+    uint32_t position = 0;
+
+    if (!connection->delta[0]) {
+        return;
+    }
+    for (uint16_t n = 0; n < count; n++) {
+        const uint8_t *record = &records[position];
+        uint32_t objId  = record[0] | (record[1] << 8) | (record[2] << 16) | ((uint32_t)record[3] << 24);
+        uint16_t instId = record[4] | (record[5] << 8);
+        uint8_t length  = record[6];
+
+        // Match the slots by ID, looking the object up would walk the whole object list
+        for (uint8_t s = 0; s < UAVTALK_DELTA_SLOTS && connection->delta[s]; ++s) {
+            UAVTalkDeltaSlot *slot = connection->delta[s];
+            if (slot->instId == instId && UAVObjGetID(slot->obj) == objId) {
+                memcpy(slot->reference, &record[UAVTALK_MULTI_RECORD_HEADER_LENGTH], length);
+                slot->deltas = 0;
+                slot->keyframeTime = xTaskGetTickCount();
+                break;
+            }
+        }
+        position += UAVTALK_MULTI_RECORD_HEADER_LENGTH + length;
+    }
+}
+
+/**
+ * Apply a received delta to an object instance.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId ID of the object to work on
+ * \param[in] instId The instance ID
+ * \param[in] data Delta
+ * \param[in] length Length of the delta
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveDelta(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, uint8_t *data, uint32_t length)
+{
+    UAVObjHandle obj = UAVObjGetByID(objId);
+    int32_t ret = -1;
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
+        ret = UAVObjUnpackDelta(obj, instId, data, length);
+    }
+    xSemaphoreGiveRecursive(connection->lock);
+    return ret;
+}
+
 /*
  * Functions that implements the UAVTalk Process FSM. return false to break out of current cycle
  */
 
+/**
+ * Parse a packet that is entirely contained in rxbuffer, without copying the payload.
+ * Does not consume anything and returns false if the packet is split or malformed,
+ * the byte state machine then takes it and does the error accounting.
+ */
+static bool UAVTalkProcess_FRAME(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, uint8_t length, uint8_t *position)
+{
+    uint8_t *frame    = &rxbuffer[(*position)];
+    uint8_t available = length - (*position);
+
+    if (available < UAVTALK_MIN_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH
+        || frame[0] != UAVTALK_SYNC_VAL
+        || (frame[1] & UAVTALK_TYPE_MASK) != UAVTALK_TYPE_VER) {
+        return false;
+    }
+
+    uint8_t type = frame[1];
+    uint16_t packet_size = frame[2] | (frame[3] << 8);
+
+    if (packet_size < UAVTALK_MIN_HEADER_LENGTH || packet_size + UAVTALK_CHECKSUM_LENGTH > available) {
+        return false;
+    }
+
+    uint32_t objId  = frame[4] | (frame[5] << 8) | (frame[6] << 16) | ((uint32_t)frame[7] << 24);
+    uint16_t instId = frame[8] | (frame[9] << 8);
+    uint8_t timestampLength = 0;
+    uint32_t dataLength     = 0;
+
+    // Determine data length, as UAVTalkProcess_INSTID does
+    if (type != UAVTALK_TYPE_OBJ_REQ && type != UAVTALK_TYPE_ACK && type != UAVTALK_TYPE_NACK) {
+        timestampLength = (type & UAVTALK_TIMESTAMPED) ? 2 : 0;
+        UAVObjHandle obj = UAVObjGetByID(objId);
+        if (obj && type != UAVTALK_TYPE_DELTA) {
+            dataLength = UAVObjGetNumBytes(obj);
+        } else {
+            dataLength = packet_size - UAVTALK_MIN_HEADER_LENGTH - timestampLength;
+        }
+    }
+
+    if (dataLength >= UAVTALK_MAX_PAYLOAD_LENGTH
+        || UAVTALK_MIN_HEADER_LENGTH + timestampLength + dataLength != packet_size) {
+        return false;
+    }
+
+    uint8_t cs = PIOS_CRC_updateCRC(0, frame, packet_size);
+    if (cs != frame[packet_size]) {
+        return false;
+    }
+
+    iproc->type            = type;
+    iproc->packet_size     = packet_size;
+    iproc->objId           = objId;
+    iproc->instId          = instId;
+    iproc->length          = dataLength;
+    iproc->timestampLength = timestampLength;
+    iproc->timestamp       = timestampLength ? (frame[10] | (frame[11] << 8)) : 0;
+    iproc->cs              = cs;
+    iproc->rxCount         = 0;
+    iproc->rxPacketLength  = packet_size + UAVTALK_CHECKSUM_LENGTH;
+    iproc->data            = &frame[UAVTALK_MIN_HEADER_LENGTH + timestampLength];
+    iproc->frame           = frame;
+
+    (*position) += packet_size + UAVTALK_CHECKSUM_LENGTH;
+
+    connection->stats.rxObjects++;
+    connection->stats.rxObjectBytes += dataLength;
+
+    iproc->state = UAVTALK_STATE_COMPLETE;
+    return true;
+}
+
 static bool UAVTalkProcess_SYNC(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, __attribute__((unused)) uint8_t length, uint8_t *position)
 {
     uint8_t rxbyte = rxbuffer[(*position)++];
@@ -973,7 +1908,7 @@ static bool UAVTalkProcess_INSTID(UAVTalkConnectionData *connection, UAVTalkInpu
         iproc->timestampLength = 0;
     } else {
         iproc->timestampLength = (iproc->type & UAVTALK_TIMESTAMPED) ? 2 : 0;
-        if (obj) {
+        if (obj && iproc->type != UAVTALK_TYPE_DELTA) {
             iproc->length = UAVObjGetNumBytes(obj);
         } else {
             iproc->length = iproc->packet_size - iproc->rxPacketLength - iproc->timestampLength;
@@ -1086,6 +2021,8 @@ static bool UAVTalkProcess_CS(UAVTalkConnectionData *connection, UAVTalkInputPro
     connection->stats.rxObjects++;
     connection->stats.rxObjectBytes += iproc->length;
 
+    iproc->data  = connection->rxBuffer;
+    iproc->frame = NULL;
     iproc->state = UAVTALK_STATE_COMPLETE;
     return true;
 }
@@ -48,6 +48,7 @@
 #define UAVOBJ_GCS_TELEMETRY_UPDATE_MODE_SHIFT 6
 #define UAVOBJ_LOGGING_UPDATE_MODE_SHIFT       8
 #define UAVOBJ_UPDATE_MODE_MASK                0x3
+#define UAVOBJ_TELEMETRY_CLASS_SHIFT           10
 
 class UAVObjectField;
 class QXmlStreamWriter;
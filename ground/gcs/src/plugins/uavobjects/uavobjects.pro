@@ -59,6 +59,7 @@ UAVOBJS = \
     $${UAVOBJ_XML_DIR}/auxmagsettings.xml \
     $${UAVOBJ_XML_DIR}/barosensor.xml \
     $${UAVOBJ_XML_DIR}/callbackinfo.xml \
+    $${UAVOBJ_XML_DIR}/callbacktiming.xml \
     $${UAVOBJ_XML_DIR}/cameracontrolactivity.xml \
     $${UAVOBJ_XML_DIR}/cameracontrolsettings.xml \
     $${UAVOBJ_XML_DIR}/cameradesired.xml \
@@ -82,6 +83,7 @@ UAVOBJS = \
     $${UAVOBJ_XML_DIR}/flightstatus.xml \
     $${UAVOBJ_XML_DIR}/flighttelemetrystats.xml \
     $${UAVOBJ_XML_DIR}/gcsreceiver.xml \
+    $${UAVOBJ_XML_DIR}/gcstelemetryfeatures.xml \
     $${UAVOBJ_XML_DIR}/gcstelemetrystats.xml \
     $${UAVOBJ_XML_DIR}/gpsextendedstatus.xml \
     $${UAVOBJ_XML_DIR}/gpspositionsensor.xml \
@@ -147,6 +149,11 @@ UAVOBJS = \
     $${UAVOBJ_XML_DIR}/systemstats.xml \
     $${UAVOBJ_XML_DIR}/takeofflocation.xml \
     $${UAVOBJ_XML_DIR}/taskinfo.xml \
+    $${UAVOBJ_XML_DIR}/telemetrylinkstats.xml \
+    $${UAVOBJ_XML_DIR}/telemetryprobe.xml \
+    $${UAVOBJ_XML_DIR}/telemetryprobeecho.xml \
+    $${UAVOBJ_XML_DIR}/telemetryschedulerstats.xml \
+    $${UAVOBJ_XML_DIR}/telemetrysettings.xml \
     $${UAVOBJ_XML_DIR}/txpidsettings.xml \
     $${UAVOBJ_XML_DIR}/txpidstatus.xml \
     $${UAVOBJ_XML_DIR}/velocitydesired.xml \
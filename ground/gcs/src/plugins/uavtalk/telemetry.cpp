@@ -72,6 +72,7 @@ Telemetry::Telemetry(UAVTalk *utalk, UAVObjectManager *objMngr) : objMngr(objMng
     // Setup and start the stats timer
     txErrors  = 0;
     txRetries = 0;
+    txQueueHighWater = 0;
 }
 
 Telemetry::~Telemetry()
@@ -366,6 +367,7 @@ void Telemetry::processObjectUpdates(UAVObject *obj, EventMask event, bool allIn
             obj->emitTransactionCompleted(false);
         }
     }
+    txQueueHighWater = qMax(txQueueHighWater, (quint32)(objPriorityQueue.length() + objQueue.length()));
 
     // Process the transaction
     processObjectQueue();
@@ -519,6 +521,7 @@ Telemetry::TelemetryStats Telemetry::getStats()
     stats.txObjects     = utalkStats.txObjects;
     stats.txErrors      = utalkStats.txErrors + txErrors;
     stats.txRetries     = txRetries;
+    stats.txQueueHighWater = txQueueHighWater;
 
     stats.rxBytes       = utalkStats.rxBytes;
     stats.rxObjectBytes = utalkStats.rxObjectBytes;
@@ -538,6 +541,7 @@ void Telemetry::resetStats()
     utalk->resetStats();
     txErrors  = 0;
     txRetries = 0;
+    txQueueHighWater = 0;
 }
 
 void Telemetry::objectUpdatedAuto(UAVObject *obj)
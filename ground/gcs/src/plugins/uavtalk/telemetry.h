@@ -64,6 +64,7 @@ public:
         quint32 txObjects;
         quint32 txErrors;
         quint32 txRetries;
+        quint32 txQueueHighWater;
 
         quint32 rxBytes;
         quint32 rxObjectBytes;
@@ -126,6 +127,7 @@ private:
     qint32 timeToNextUpdateMs;
     quint32 txErrors;
     quint32 txRetries;
+    quint32 txQueueHighWater;
 
     // Methods
     void registerObject(UAVObject *obj);
@@ -104,6 +104,7 @@ void TelemetryManager::onStart()
     connect(m_telemetryMonitor, SIGNAL(connected()), this, SLOT(onConnect()));
     connect(m_telemetryMonitor, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
     connect(m_telemetryMonitor, SIGNAL(telemetryUpdated(double, double)), this, SLOT(onTelemetryUpdate(double, double)));
+    connect(m_uavTalk, SIGNAL(timestampedObjectReceived(UAVObject *, quint16)), m_telemetryMonitor, SLOT(probeReceived(UAVObject *, quint16)));
 }
 
 void TelemetryManager::stop()
@@ -37,6 +37,7 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager *objMngr, Telemetry *tel) :
     objMngr(objMngr),
     tel(tel),
     gcsStatsObj(GCSTelemetryStats::GetInstance(objMngr)),
+    gcsFeaturesObj(GCSTelemetryFeatures::GetInstance(objMngr)),
     flightStatsObj(FlightTelemetryStats::GetInstance(objMngr)),
     firmwareIAPObj(FirmwareIAPObj::GetInstance(objMngr)),
     statsTimer(new QTimer(this)),
@@ -47,6 +48,9 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager *objMngr, Telemetry *tel) :
     // Listen for flight stats updates
     connect(flightStatsObj, SIGNAL(objectUpdated(UAVObject *)), this, SLOT(flightStatsUpdated(UAVObject *)));
 
+    // Clock of the probe echoes
+    probeClock.start();
+
     // Start update timer
     connect(statsTimer, SIGNAL(timeout()), this, SLOT(processStatsUpdates()));
     statsTimer->start(STATS_CONNECT_PERIOD_MS);
@@ -172,6 +176,65 @@ void TelemetryMonitor::flightStatsUpdated(UAVObject *obj)
     }
 }
 
+/**
+ * Called for each timestamped object received, answers the TelemetryProbe of the
+ * autopilot with the TelemetryProbeEcho instance of the same number right away.
+ * The downlink jitter and reordering of the probes are measured on the way.
+ */
+void TelemetryMonitor::probeReceived(UAVObject *obj, quint16 timestamp)
+{
+    QMutexLocker locker(mutex);
+    TelemetryProbe *probe = qobject_cast<TelemetryProbe *>(obj);
+
+    if (!probe) {
+        return;
+    }
+
+    quint16 receiveTime = (quint16)probeClock.elapsed();
+    quint16 instId     = probe->getInstID();
+    TelemetryProbe::DataFields probeData = probe->getData();
+    bool first         = !probes.contains(instId);
+    ProbeInfo &info    = probes[instId];
+
+    // RFC 3550 A.8: J += (|D| - J) / 16, kept scaled by 16, the 16 bit clocks wrap
+    quint16 transit    = receiveTime - timestamp;
+    qint16 delta       = (qint16)(transit - info.transit);
+    info.transit = transit;
+    if (!first) {
+        info.jitter += qAbs(delta) - ((info.jitter + 8) >> 4);
+    }
+
+    // Probes come in sequence unless the downlink reordered them, a repeated
+    // sequence number is a duplicate rather than a late probe
+    qint16 gap = (qint16)(probeData.Sequence - info.sequence);
+    if (first || gap > 0) {
+        info.sequence = probeData.Sequence;
+    } else if (gap < 0) {
+        ++info.reordered;
+    }
+
+    TelemetryProbeEcho *echo = TelemetryProbeEcho::GetInstance(objMngr, instId);
+    if (!echo) {
+        UAVDataObject *instObj = TelemetryProbeEcho::GetInstance(objMngr)->clone(instId);
+        if (!objMngr->registerObject(instObj)) {
+            qWarning() << "TelemetryMonitor - failed to register object " << instObj->toStringBrief();
+            return;
+        }
+        echo = TelemetryProbeEcho::GetInstance(objMngr, instId);
+    }
+
+    TelemetryProbeEcho::DataFields echoData;
+    echoData.Sequence       = probeData.Sequence;
+    echoData.ProbeTimestamp = timestamp;
+    echoData.Jitter         = (float)info.jitter / 16.0f;
+    echoData.Reordered      = info.reordered;
+    echoData.QueueHighWater = tel->getStats().txQueueHighWater;
+    echoData.EchoTime       = (quint16)probeClock.elapsed();
+    echoData.HoldTime       = echoData.EchoTime - receiveTime;
+    // Sent on change
+    echo->setData(echoData);
+}
+
 /**
  * Called each time the firmwareIAP object is updated by the autopilot
  */
@@ -245,20 +308,26 @@ void TelemetryMonitor::processStatsUpdates()
     // Set data
     gcsStatsObj->setData(gcsStats);
 
-    // Force telemetry update if not yet connected
+    // Force telemetry update if not yet connected, announcing the protocol
+    // features this side understands ahead of each handshake step
     if (gcsStats.Status != GCSTelemetryStats::STATUS_CONNECTED ||
         flightStats.Status != FlightTelemetryStats::STATUS_CONNECTED) {
+        gcsFeaturesObj->setFeatures(UAVTalk::FEATURES);
+        gcsFeaturesObj->updated();
         gcsStatsObj->updated();
     }
 
     // Act on new connections or disconnections
     if (gcsStats.Status == GCSTelemetryStats::STATUS_CONNECTED && gcsStats.Status != oldStatus) {
         statsTimer->setInterval(STATS_UPDATE_PERIOD_MS);
+        // The autopilot may have restarted, count its probes from scratch
+        probes.clear();
         qDebug() << "TelemetryMonitor::processStatsUpdates - connection with the autopilot established";
         startRetrievingObjects();
     }
     if (gcsStats.Status == GCSTelemetryStats::STATUS_DISCONNECTED && gcsStats.Status != oldStatus) {
         statsTimer->setInterval(STATS_CONNECT_PERIOD_MS);
+        probes.clear();
         qDebug() << "TelemetryMonitor::processStatsUpdates - connection with the autopilot lost";
         emit disconnected();
     }
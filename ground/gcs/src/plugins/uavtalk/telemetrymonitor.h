@@ -32,13 +32,18 @@
 #include <QQueue>
 #include <QTimer>
 #include <QTime>
+#include <QElapsedTimer>
+#include <QMap>
 #include <QMutex>
 #include <QMutexLocker>
 #include "uavobjectmanager.h"
 #include "gcstelemetrystats.h"
+#include "gcstelemetryfeatures.h"
 #include "flighttelemetrystats.h"
 #include "firmwareiapobj.h"
 #include "systemstats.h"
+#include "telemetryprobe.h"
+#include "telemetryprobeecho.h"
 #include "telemetry.h"
 
 class TelemetryMonitor : public QObject {
@@ -58,22 +63,35 @@ public slots:
     void processStatsUpdates();
     void flightStatsUpdated(UAVObject *obj);
     void firmwareIAPUpdated(UAVObject *obj);
+    void probeReceived(UAVObject *obj, quint16 timestamp);
 
 private:
     static const int STATS_UPDATE_PERIOD_MS  = 4000;
     static const int STATS_CONNECT_PERIOD_MS = 2000;
     static const int CONNECTION_TIMEOUT_MS   = 8000;
 
+    // Downlink of the round trip probes of a TelemetryProbe instance
+    typedef struct {
+        quint16 sequence;
+        quint16 transit;
+        // RFC 3550 interarrival jitter estimate, in 1/16 ms
+        quint32 jitter;
+        quint32 reordered;
+    } ProbeInfo;
+
     UAVObjectManager *objMngr;
     Telemetry *tel;
     QQueue<UAVObject *> queue;
     GCSTelemetryStats *gcsStatsObj;
+    GCSTelemetryFeatures *gcsFeaturesObj;
     FlightTelemetryStats *flightStatsObj;
     FirmwareIAPObj *firmwareIAPObj;
     QTimer *statsTimer;
     UAVObject *objPending;
     QMutex *mutex;
     QTime *connectionTimer;
+    QElapsedTimer probeClock;
+    QMap<quint16, ProbeInfo> probes;
 
     void startRetrievingObjects();
     void retrieveNextObject();
@@ -53,6 +53,7 @@ UAVTalk::UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr) : io(iodev), objMn
 {
     rxState = STATE_SYNC;
     rxPacketLength = 0;
+    rxTimestampLength = 0;
 
     memset(&stats, 0, sizeof(ComStats));
 
@@ -230,6 +231,13 @@ void UAVTalk::processInputStream()
                 }
                 mutex.unlock();
 
+                if (rxTimestampLength > 0) {
+                    UAVObject *rxObj = objMngr->getObject(rxObjId, rxInstId);
+                    if (rxObj) {
+                        emit timestampedObjectReceived(rxObj, rxTimestamp);
+                    }
+                }
+
                 if (useUDPMirror) {
                     // it is safe to do this outside of the above critical section as the rxDataArray is
                     // accessed from this thread only
@@ -291,14 +299,16 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
         // Update CRC
         rxCS = Crc::updateCRC(rxCS, rxbyte);
 
-        if ((rxbyte & TYPE_MASK) != TYPE_VER) {
+        if ((rxbyte & ~TIMESTAMPED & TYPE_MASK) != TYPE_VER) {
             qWarning() << "UAVTalk - error : bad type";
             stats.rxErrors++;
             rxState = STATE_ERROR;
             break;
         }
 
-        rxType     = rxbyte;
+        // The timestamp is kept apart, the type is handled as if there were none
+        rxType     = rxbyte & ~TIMESTAMPED;
+        rxTimestampLength = (rxbyte & TIMESTAMPED) ? TIMESTAMP_LENGTH : 0;
 
         packetSize = 0;
 
@@ -319,7 +329,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
         rxCount     = 0;
 
 
-        if (packetSize < HEADER_LENGTH || packetSize > HEADER_LENGTH + MAX_PAYLOAD_LENGTH) {
+        if (packetSize < HEADER_LENGTH + rxTimestampLength || packetSize > HEADER_LENGTH + rxTimestampLength + MAX_PAYLOAD_LENGTH) {
             // incorrect packet size
             qWarning() << "UAVTalk - error : incorrect packet size";
             stats.rxErrors++;
@@ -362,9 +372,10 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
         rxInstId = (qint16)qFromLittleEndian<quint16>(rxTmpBuffer);
 
         // Search for object, if not found reset state machine
+        // Multi-object frames carry no object in the header
         {
-            UAVObject *rxObj = objMngr->getObject(rxObjId);
-            if (rxObj == NULL && rxType != TYPE_OBJ_REQ) {
+            UAVObject *rxObj = (rxType == TYPE_MULTI) ? NULL : objMngr->getObject(rxObjId);
+            if (rxObj == NULL && rxType != TYPE_OBJ_REQ && rxType != TYPE_MULTI) {
                 qWarning() << "UAVTalk - error : unknown object" << rxObjId;
                 stats.rxErrors++;
                 rxState = STATE_ERROR;
@@ -375,10 +386,10 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK) {
                 rxLength = 0;
             } else {
-                if (rxObj) {
+                if (rxObj && rxType != TYPE_DELTA) {
                     rxLength = rxObj->getNumBytes();
                 } else {
-                    rxLength = packetSize - rxPacketLength;
+                    rxLength = packetSize - rxPacketLength - rxTimestampLength;
                 }
             }
 
@@ -392,7 +403,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             }
 
             // Check the lengths match
-            if ((rxPacketLength + rxLength) != packetSize) {
+            if ((rxPacketLength + rxTimestampLength + rxLength) != packetSize) {
                 // packet error - mismatched packet size
                 qWarning() << "UAVTalk - error : mismatched packet size" << rxObjId;
                 stats.rxErrors++;
@@ -401,7 +412,30 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
             }
         }
 
-        // If there is a payload get it, otherwise receive checksum
+        // Then the timestamp if any, the payload if any, the checksum
+        rxTimestamp = 0;
+        if (rxTimestampLength > 0) {
+            rxState = STATE_TIMESTAMP;
+        } else if (rxLength > 0) {
+            rxState = STATE_DATA;
+        } else {
+            rxState = STATE_CS;
+        }
+        break;
+
+    case STATE_TIMESTAMP:
+
+        // Update CRC
+        rxCS = Crc::updateCRC(rxCS, rxbyte);
+
+        rxTmpBuffer[rxCount++] = rxbyte;
+        if (rxCount < rxTimestampLength) {
+            break;
+        }
+        rxCount     = 0;
+
+        rxTimestamp = qFromLittleEndian<quint16>(rxTmpBuffer);
+
         if (rxLength > 0) {
             rxState = STATE_DATA;
         } else {
@@ -476,8 +510,6 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
  */
 bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length)
 {
-    Q_UNUSED(length);
-
     UAVObject *obj    = NULL;
     bool error        = false;
     bool allInstances = (instId == ALL_INSTANCES);
@@ -569,6 +601,14 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
         }
         break;
 
+    case TYPE_MULTI:
+        error = !receiveMultiObject(instId, data, length);
+        break;
+
+    case TYPE_DELTA:
+        error = allInstances || !receiveDeltaObject(objId, instId, data, length);
+        break;
+
     case TYPE_NACK:
         // All instances, not allowed for NACK messages
         if (!allInstances) {
@@ -596,6 +636,102 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
     return !error;
 }
 
+/**
+ * Receive the records of a multi-object frame, each one as a TYPE_OBJ message.
+ * Records of unknown objects or of a different object size are skipped.
+ * \param[in] count Number of records
+ * \param[in] data Records
+ * \param[in] length Length of the records
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveMultiObject(quint16 count, quint8 *data, qint32 length)
+{
+    bool success = true;
+    qint32 position = 0;
+
+    for (quint16 n = 0; n < count; ++n) {
+        if (position + MULTI_RECORD_HEADER_LENGTH > length
+            || position + MULTI_RECORD_HEADER_LENGTH + data[position + 6] > length) {
+            qWarning() << "UAVTalk - error : multi-object records exceed the frame";
+            return false;
+        }
+
+        quint8 *record = &data[position];
+        quint32 objId  = qFromLittleEndian<quint32>(&record[0]);
+        quint16 instId = qFromLittleEndian<quint16>(&record[4]);
+        quint8 recordLength = record[6];
+        UAVObject *obj = objMngr->getObject(objId);
+
+        if (obj != NULL && obj->getNumBytes() == recordLength) {
+            if (!receiveObject(TYPE_OBJ, objId, instId, &record[MULTI_RECORD_HEADER_LENGTH], recordLength)) {
+                success = false;
+            }
+        } else {
+            qWarning() << "UAVTalk - error : unknown object in multi-object frame" << objId;
+            success = false;
+        }
+        position += MULTI_RECORD_HEADER_LENGTH + recordLength;
+    }
+    return success;
+}
+
+/**
+ * Apply a delta frame to an object instance. The field layout comes from the
+ * object's fields, which are in packed order like the flight side's generated table.
+ * \param[in] objId ID of the object
+ * \param[in] instId The instance ID
+ * \param[in] data Element bitmap, least significant bit first, then the changed elements
+ * \param[in] length Length of the delta
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveDeltaObject(quint32 objId, quint16 instId, quint8 *data, qint32 length)
+{
+    // A delta is relative to the data of an existing instance
+    UAVObject *obj = objMngr->getObject(objId, instId);
+
+    if (obj == NULL) {
+        qWarning() << "UAVTalk - error : delta for an unknown instance" << objId << instId;
+        return false;
+    }
+
+    QList<UAVObjectField *> fields = obj->getFields();
+    qint32 numElements = 0;
+    foreach(UAVObjectField * field, fields) {
+        numElements += field->getNumElements();
+    }
+    qint32 position = (numElements + 7) / 8;
+    if (length < position) {
+        qWarning() << "UAVTalk - error : delta shorter than its bitmap" << objId;
+        return false;
+    }
+
+    QByteArray objData(obj->getNumBytes(), 0);
+    obj->pack((quint8 *)objData.data());
+
+    qint32 bit    = 0;
+    qint32 offset = 0;
+    foreach(UAVObjectField * field, fields) {
+        qint32 elementSize = field->getNumBytes() / field->getNumElements();
+        for (quint32 n = 0; n < field->getNumElements(); ++n, ++bit, offset += elementSize) {
+            if (data[bit / 8] & (1 << (bit % 8))) {
+                if (position + elementSize > length) {
+                    qWarning() << "UAVTalk - error : delta elements exceed the frame" << objId;
+                    return false;
+                }
+                memcpy(objData.data() + offset, &data[position], elementSize);
+                position += elementSize;
+            }
+        }
+    }
+    if (position != length) {
+        qWarning() << "UAVTalk - error : delta length mismatch" << objId;
+        return false;
+    }
+
+    obj->unpack((const quint8 *)objData.constData());
+    return true;
+}
+
 /**
  * Update the data of an object from a byte array (unpack).
  * If the object instance could not be found in the list, then a
@@ -898,6 +1034,16 @@ const char *UAVTalk::typeToString(quint8 type)
     case TYPE_NACK:
         return "nack";
 
+        break;
+
+    case TYPE_MULTI:
+        return "multi-object";
+
+        break;
+
+    case TYPE_DELTA:
+        return "delta";
+
         break;
     }
     return "<error>";
@@ -46,6 +46,12 @@ class UAVTALK_EXPORT UAVTalk : public QObject {
 public:
     static const quint16 ALL_INSTANCES = 0xFFFF;
 
+    // Protocol features announced in GCSTelemetryFeatures, the flight side uses them if it supports them too
+    static const quint8 FEATURE_MULTI_OBJECT = 0x01;
+    static const quint8 FEATURE_DELTA = 0x02;
+    static const quint8 FEATURE_TIMESTAMP = 0x04;
+    static const quint8 FEATURES = FEATURE_MULTI_OBJECT | FEATURE_DELTA | FEATURE_TIMESTAMP;
+
     typedef struct {
         quint32 txBytes;
         quint32 txObjectBytes;
@@ -72,6 +78,7 @@ public:
 
 signals:
     void transactionCompleted(UAVObject *obj, bool success);
+    void timestampedObjectReceived(UAVObject *obj, quint16 timestamp);
 
 private slots:
     void processInputStream();
@@ -93,21 +100,32 @@ private:
     static const int TYPE_OBJ_ACK  = (TYPE_VER | 0x02);
     static const int TYPE_ACK      = (TYPE_VER | 0x03);
     static const int TYPE_NACK     = (TYPE_VER | 0x04);
+    // several objects in one frame, the instance ID carries the number of records
+    static const int TYPE_MULTI    = (TYPE_VER | 0x05);
+    // changed elements of an object only, a bitmap with one bit per field element then the elements
+    static const int TYPE_DELTA    = (TYPE_VER | 0x06);
+    // flag of the types followed by the 16 bit time of the sender after the header
+    static const int TIMESTAMPED   = 0x80;
 
     // header : sync(1), type (1), size(2), object ID(4), instance ID(2)
     static const int HEADER_LENGTH = 10;
 
+    static const int TIMESTAMP_LENGTH = 2;
+
+    // multi-object record : object ID(4), instance ID(2), length(1)
+    static const int MULTI_RECORD_HEADER_LENGTH = 7;
+
     static const int MAX_PAYLOAD_LENGTH = 256;
 
     static const int CHECKSUM_LENGTH    = 1;
 
-    static const int MAX_PACKET_LENGTH  = (HEADER_LENGTH + MAX_PAYLOAD_LENGTH + CHECKSUM_LENGTH);
+    static const int MAX_PACKET_LENGTH  = (HEADER_LENGTH + TIMESTAMP_LENGTH + MAX_PAYLOAD_LENGTH + CHECKSUM_LENGTH);
 
     static const int TX_BUFFER_SIZE     = 2 * 1024;
 
     // Types
     typedef enum {
-        STATE_SYNC, STATE_TYPE, STATE_SIZE, STATE_OBJID, STATE_INSTID, STATE_DATA, STATE_CS, STATE_COMPLETE, STATE_ERROR
+        STATE_SYNC, STATE_TYPE, STATE_SIZE, STATE_OBJID, STATE_INSTID, STATE_TIMESTAMP, STATE_DATA, STATE_CS, STATE_COMPLETE, STATE_ERROR
     } RxStateType;
 
     // Variables
@@ -135,6 +153,8 @@ private:
     quint8 rxType;
     quint32 rxObjId;
     quint16 rxInstId;
+    quint16 rxTimestampLength;
+    quint16 rxTimestamp;
     quint16 rxLength;
     quint16 rxPacketLength;
     quint8 rxCSPacket;
@@ -149,6 +169,8 @@ private:
     bool objectTransaction(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     bool processInputByte(quint8 rxbyte);
     bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length);
+    bool receiveMultiObject(quint16 count, quint8 *data, qint32 length);
+    bool receiveDeltaObject(quint32 objId, quint16 instId, quint8 *data, qint32 length);
     UAVObject *updateObject(quint32 objId, quint16 instId, quint8 *data);
     void updateAck(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     void updateNack(quint32 objId, quint16 instId, UAVObject *obj);
@@ -265,6 +265,15 @@ bool UAVObjectGeneratorFlight::process_object(ObjectInfo *info)
     }
     outCode.replace(QString("$(INITFIELDS)"), initfields);
 
+    // Replace the $(FIELDINFO) tag, fields are already in packed order
+    QString fieldInfo;
+    for (int n = 0; n < info->fields.length(); ++n) {
+        fieldInfo.append(QString("    { %1, %2 },\n")
+                         .arg(info->fields[n]->numElements)
+                         .arg(info->fields[n]->numBytes));
+    }
+    outCode.replace(QString("$(FIELDINFO)"), fieldInfo);
+
     // Replace the $(SETGETFIELDS) tag
     QString setgetfields;
     for (int n = 0; n < info->fields.length(); ++n) {
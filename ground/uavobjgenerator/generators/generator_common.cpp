@@ -75,6 +75,8 @@ void replaceCommonTags(QString & out, ObjectInfo *info)
     // Replace $(ISPRIORITY) tag
     out.replace(QString("$(ISPRIORITY)"), boolTo01String(info->isPriority));
     out.replace(QString("$(ISPRIORITYTF)"), boolToTRUEFALSEString(info->isPriority));
+    // Replace $(ARENAINSTANCES) tag
+    out.replace(QString("$(ARENAINSTANCES)"), QString().setNum(info->arenaInstances));
     // Replace $(GCSACCESS) tag
     value = accessModeStr[info->gcsAccess];
     out.replace(QString("$(GCSACCESS)"), value);
@@ -87,6 +89,8 @@ void replaceCommonTags(QString & out, ObjectInfo *info)
     // Replace $(FLIGHTTELEM_UPDATEMODE) tag
     value = updateModeStr[info->flightTelemetryUpdateMode];
     out.replace(QString("$(FLIGHTTELEM_UPDATEMODE)"), value);
+    // Replace $(FLIGHTTELEM_CLASS) tag
+    out.replace(QString("$(FLIGHTTELEM_CLASS)"), QString().setNum(info->flightTelemetryClass));
     // Replace $(FLIGHTTELEM_UPDATEPERIOD) tag
     out.replace(QString("$(FLIGHTTELEM_UPDATEPERIOD)"), QString().setNum(info->flightTelemetryUpdatePeriod));
     // Replace $(GCSTELEM_ACKED) tag
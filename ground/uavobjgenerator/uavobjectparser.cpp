@@ -39,6 +39,8 @@ UAVObjectParser::UAVObjectParser()
 
     updateModeStrXML << "manual" << "periodic" << "onchange" << "throttled";
 
+    telemetryClassStrXML << "default" << "high" << "normal" << "bulk";
+
     accessModeStr << "ACCESS_READWRITE" << "ACCESS_READONLY";
 
     fieldTypeNumBytes << int(1) << int(2) << int(4) <<
@@ -188,6 +190,11 @@ QString UAVObjectParser::parseXML(QString & xml, QString & filename)
                     return status;
                 }
 
+                status = processObjectTelemetryClass(childNode, &info->flightTelemetryClass);
+                if (!status.isNull()) {
+                    return status;
+                }
+
                 telFlightFound = true;
             } else if (childNode.nodeName().compare(QString("logging")) == 0) {
                 QString status = processObjectMetadata(childNode, &info->loggingUpdateMode,
@@ -362,6 +369,25 @@ QString UAVObjectParser::processObjectMetadata(QDomNode & childNode, UpdateMode
     return QString();
 }
 
+/**
+ * Process the optional telemetry class attribute of the flight metadata
+ */
+QString UAVObjectParser::processObjectTelemetryClass(QDomNode & childNode, TelemetryClass *telemetryClass)
+{
+    QDomNode elemAttr = childNode.attributes().namedItem("class");
+
+    *telemetryClass = TELEMETRYCLASS_DEFAULT;
+    if (!elemAttr.isNull()) {
+        int index = telemetryClassStrXML.indexOf(elemAttr.nodeValue());
+        if (index < 0) {
+            return QString("Object:telemetryflight:class attribute value is invalid (default|high|normal|bulk)");
+        }
+        *telemetryClass = (TelemetryClass)index;
+    }
+    // Done
+    return QString();
+}
+
 /**
  * Process the object access tag of the XML
  */
@@ -658,6 +684,20 @@ QString UAVObjectParser::processObjectAttributes(QDomNode & node, ObjectInfo *in
         return QString("Object: Settings objects can not have multiple instances");
     }
 
+    // Get arenainstances attribute
+    attr = attributes.namedItem("arenainstances");
+    info->arenaInstances = 0;
+    if (!attr.isNull()) {
+        bool ok;
+        info->arenaInstances = attr.nodeValue().toInt(&ok);
+        if (!ok || info->arenaInstances < 1 || info->arenaInstances > 1000) {
+            return QString("Object:arenainstances attribute value is invalid (1-1000)");
+        }
+        if (info->isSingleInst) {
+            return QString("Object:arenainstances attribute is only valid for multi instance objects");
+        }
+    }
+
     // Done
     return QString();
 }
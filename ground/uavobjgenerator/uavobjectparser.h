@@ -71,6 +71,16 @@ typedef enum {
     UPDATEMODE_THROTTLED = 3 /** Object is updated on change, but not more often than the interval time */
 } UpdateMode;
 
+/**
+ * Telemetry priority class used by the autopilot
+ */
+typedef enum {
+    TELEMETRYCLASS_DEFAULT = 0, /** Derived from the object type */
+    TELEMETRYCLASS_HIGH    = 1,
+    TELEMETRYCLASS_NORMAL  = 2,
+    TELEMETRYCLASS_BULK    = 3
+} TelemetryClass;
+
 
 typedef enum {
     ACCESS_READWRITE = 0,
@@ -86,11 +96,13 @@ typedef struct  {
     bool       isSingleInst;
     bool       isSettings;
     bool       isPriority;
+    int arenaInstances; /** Number of instances reserved contiguously by the flight code (multi instance objects only) */
     AccessMode gcsAccess;
     AccessMode flightAccess;
     bool       flightTelemetryAcked;
     UpdateMode flightTelemetryUpdateMode; /** Update mode used by the autopilot (UpdateMode) */
     int flightTelemetryUpdatePeriod; /** Update period used by the autopilot (only if telemetry mode is PERIODIC) */
+    TelemetryClass flightTelemetryClass; /** Priority class of the updates sent by the autopilot (TelemetryClass) */
     bool       gcsTelemetryAcked;
     UpdateMode gcsTelemetryUpdateMode; /** Update mode used by the GCS (UpdateMode) */
     int gcsTelemetryUpdatePeriod; /** Update period used by the GCS (only if telemetry mode is PERIODIC) */
@@ -122,6 +134,7 @@ private:
     QList<int> fieldTypeNumBytes;
     QStringList updateModeStr;
     QStringList updateModeStrXML;
+    QStringList telemetryClassStrXML;
     QStringList accessModeStr;
     QStringList accessModeStrXML;
 
@@ -131,6 +144,7 @@ private:
     QString processObjectDescription(QDomNode & childNode, QString *description);
     QString processObjectCategory(QDomNode & childNode, QString *category);
     QString processObjectMetadata(QDomNode & childNode, UpdateMode *mode, int *period, bool *acked);
+    QString processObjectTelemetryClass(QDomNode & childNode, TelemetryClass *telemetryClass);
     void calculateID(ObjectInfo *info);
     quint32 updateHash(quint32 value, quint32 hash);
     quint32 updateHash(QString & value, quint32 hash);